@@ -0,0 +1,335 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/Target.h>
+#include "freezepiler.h"
+#include "ast.h"
+#include "codegen.h"
+#include "lexer.h"
+#include "parser.tab.h"
+#include "simplify.h"
+#include "stackguard.h"
+
+/*
+The expression is wrapped in a one-line translation unit,
+
+    double __freezepiler_expr(double price, int qty) { return (<source>); }
+
+which goes through yyparse, ast_simplify and codegen_build_module like
+any program. The parsed tree is checked to be exactly that function
+before it is compiled, so the source cannot close the function and add
+code of its own.
+*/
+
+#define EXPR_NAME "__freezepiler_expr"
+#define BATCH_NAME "__freezepiler_batch"
+
+struct freezepiler_expr {
+    LLVMExecutionEngineRef engine; // Dueño del módulo y del código nativo
+    void *function;
+    void (*batch)(size_t n, const void *const *columns, void *out);
+};
+
+static const char *type_names[] = { "int", "long", "float", "double" };
+
+static void set_error(char **error, const char *fmt, ...) {
+    if (error == NULL) {
+        return;
+    }
+    char message[512];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(message, sizeof(message), fmt, ap);
+    va_end(ap);
+    *error = strdup(message);
+}
+
+static int is_identifier(const char *s) {
+    if (s == NULL || !(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))) {
+        return 0;
+    }
+    for (; *s; s++) {
+        if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') || (*s >= '0' && *s <= '9'))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// =======================================================
+// VALIDACIÓN
+// =======================================================
+
+// Lo que puede aparecer en la expresión; message explica lo primero que no
+typedef struct check_context {
+    const freezepiler_var *vars;
+    int nvars;
+    char message[128];
+} check_context;
+
+typedef struct deep_check {
+    ast_node *node;
+    check_context *ctx;
+    int result;
+} deep_check;
+
+static int check_expression(ast_node *e, check_context *ctx);
+
+static void check_expression_deep(void *data) {
+    deep_check *call = data;
+    call->result = check_expression(call->node, call->ctx);
+}
+
+// 1 si e (con sus hermanos) sólo tiene operadores, constantes y variables declaradas
+static int check_expression(ast_node *e, check_context *ctx) {
+    if (stack_low()) {
+        deep_check call = { e, ctx, 0 };
+        stack_extend(check_expression_deep, &call);
+        return call.result;
+    }
+    for (; e; e = e->sibling) {
+        const char *bad = NULL;
+        switch (e->type) {
+        case NT_ID:
+        case NT_VAR: {
+            int found = 0;
+            for (int i = 0; i < ctx->nvars && !found; i++) found = strcmp(ctx->vars[i].name, e->value.strVal) == 0;
+            if (!found) {
+                snprintf(ctx->message, sizeof(ctx->message), "unknown variable '%.64s'", e->value.strVal);
+                return 0;
+            }
+            break;
+        }
+        case NT_ENTERO:
+        case NT_FLOTANTE:
+        case NT_CARACTER:
+        case NT_TERNARIO:
+            break;
+        case NT_OP_BINARIO:
+            if (e->value.op >= T_ASSIGN && e->value.op <= T_ASSIGN_XOR) bad = "assignments";
+            break;
+        case NT_OP_UNARIO:
+            if (e->value.op == T_INC || e->value.op == T_DEC) bad = "increments and decrements";
+            break;
+        case NT_LLAMADA_FUNCION:
+            bad = "function calls";
+            break;
+        default:
+            bad = "anything but operators, variables and constants";
+            break;
+        }
+        if (bad) {
+            snprintf(ctx->message, sizeof(ctx->message), "the expression may not contain %s", bad);
+            return 0;
+        }
+        if (!check_expression(e->child, ctx)) return 0;
+    }
+    return 1;
+}
+
+// The expression of the wrapper's return; NULL if the source added anything around it
+static ast_node *wrapped_expression(ast_node *root) {
+    ast_node *fn = root ? root->child : NULL;
+    if (!fn || fn->sibling || fn->type != NT_FUNCION || !fn->child || !fn->child->sibling) {
+        return NULL;
+    }
+    ast_node *body = fn->child->sibling->sibling;
+    while (body && body->type == NT_PARAMETRO) body = body->sibling;
+    if (!body || body->sibling || body->type != NT_BLOQUE) {
+        return NULL;
+    }
+    ast_node *ret = body->child;
+    if (!ret || ret->sibling || ret->type != NT_RETURN) {
+        return NULL;
+    }
+    return ret->child;
+}
+
+// =======================================================
+// COMPILACIÓN
+// =======================================================
+
+// void batch(i64 n, i8 **columns, i8 *out): out[i] = fn(columns[0][i], columns[1][i], ...)
+static void build_batch(LLVMModuleRef m, LLVMValueRef fn) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef i8p = LLVMPointerType(LLVMInt8Type(), 0);
+    LLVMTypeRef params[3] = { i64, LLVMPointerType(i8p, 0), i8p };
+    LLVMValueRef batch = LLVMAddFunction(m, BATCH_NAME, LLVMFunctionType(LLVMVoidType(), params, 3, 0));
+    LLVMValueRef n = LLVMGetParam(batch, 0);
+
+    LLVMTypeRef fty = LLVMGlobalGetValueType(fn);
+    unsigned nparams = LLVMCountParamTypes(fty);
+    LLVMTypeRef *types = malloc((nparams + 1) * sizeof(LLVMTypeRef));
+    LLVMValueRef *columns = malloc((nparams + 1) * sizeof(LLVMValueRef));
+    LLVMValueRef *args = malloc((nparams + 1) * sizeof(LLVMValueRef));
+    LLVMGetParamTypes(fty, types);
+    LLVMTypeRef ret_type = LLVMGetReturnType(fty);
+
+    LLVMBuilderRef b = LLVMCreateBuilder();
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(batch, "entry");
+    LLVMBasicBlockRef loop = LLVMAppendBasicBlock(batch, "loop");
+    LLVMBasicBlockRef done = LLVMAppendBasicBlock(batch, "done");
+    LLVMPositionBuilderAtEnd(b, entry);
+    for (unsigned k = 0; k < nparams; k++) {
+        LLVMValueRef idx = LLVMConstInt(i64, k, 0);
+        LLVMValueRef slot = LLVMBuildGEP2(b, i8p, LLVMGetParam(batch, 1), &idx, 1, "");
+        columns[k] = LLVMBuildBitCast(b, LLVMBuildLoad2(b, i8p, slot, ""), LLVMPointerType(types[k], 0), "column");
+    }
+    LLVMValueRef out = LLVMBuildBitCast(b, LLVMGetParam(batch, 2), LLVMPointerType(ret_type, 0), "out");
+    LLVMBuildCondBr(b, LLVMBuildICmp(b, LLVMIntEQ, n, LLVMConstInt(i64, 0, 0), ""), done, loop);
+
+    LLVMPositionBuilderAtEnd(b, loop);
+    LLVMValueRef i = LLVMBuildPhi(b, i64, "i");
+    for (unsigned k = 0; k < nparams; k++) {
+        args[k] = LLVMBuildLoad2(b, types[k], LLVMBuildGEP2(b, types[k], columns[k], &i, 1, ""), "");
+    }
+    LLVMValueRef call = LLVMBuildCall2(b, fty, fn, args, nparams, "");
+    LLVMSetInstructionCallConv(call, LLVMGetFunctionCallConv(fn));
+    LLVMBuildStore(b, call, LLVMBuildGEP2(b, ret_type, out, &i, 1, ""));
+    LLVMValueRef next = LLVMBuildAdd(b, i, LLVMConstInt(i64, 1, 0), "");
+    LLVMBuildCondBr(b, LLVMBuildICmp(b, LLVMIntEQ, next, n, ""), done, loop);
+    LLVMValueRef incoming[2] = { LLVMConstInt(i64, 0, 0), next };
+    LLVMBasicBlockRef from[2] = { entry, loop };
+    LLVMAddIncoming(i, incoming, from, 2);
+
+    LLVMPositionBuilderAtEnd(b, done);
+    LLVMBuildRetVoid(b);
+    LLVMDisposeBuilder(b);
+    free(types);
+    free(columns);
+    free(args);
+}
+
+// Parses and checks the wrapped source; the module, or NULL with *error set
+static LLVMModuleRef build_module(const char *code, const freezepiler_var *vars, int nvars,
+                                  const codegen_options *opts, char **error) {
+    initScanner(code);
+    ast_root = NULL;
+    parse_error_message[0] = '\0';
+    parse_errors_quiet = 1;
+    int parse_result = yyparse();
+    parse_errors_quiet = 0;
+    if (parse_result != 0) {
+        set_error(error, "%s", parse_error_message[0] ? parse_error_message : "syntax error");
+        ast_free(ast_root);
+        ast_root = NULL;
+        return NULL;
+    }
+
+    LLVMModuleRef m = NULL;
+    ast_node *expr = wrapped_expression(ast_root);
+    check_context ctx = { vars, nvars, "the source must be a single expression" };
+    if (!expr || !check_expression(expr, &ctx)) {
+        set_error(error, "%s", ctx.message);
+    } else {
+        ast_simplify(ast_root);
+        m = codegen_build_module(ast_root, opts);
+        if (m == NULL) {
+            set_error(error, "the expression could not be compiled");
+        }
+    }
+    ast_free(ast_root);
+    ast_root = NULL;
+    return m;
+}
+
+freezepiler_expr *freezepiler_compile(const char *source, const freezepiler_var *vars, int nvars,
+                                      freezepiler_type result, int opt_level, char **error) {
+    if (error) {
+        *error = NULL;
+    }
+    if (source == NULL || nvars < 0 || (nvars > 0 && vars == NULL) || result < FREEZEPILER_INT ||
+        result > FREEZEPILER_DOUBLE) {
+        set_error(error, "invalid arguments");
+        return NULL;
+    }
+    for (int i = 0; i < nvars; i++) {
+        if (!is_identifier(vars[i].name) || vars[i].type < FREEZEPILER_INT || vars[i].type > FREEZEPILER_DOUBLE) {
+            set_error(error, "invalid variable #%d", i);
+            return NULL;
+        }
+        for (int j = 0; j < i; j++) {
+            if (strcmp(vars[i].name, vars[j].name) == 0) {
+                set_error(error, "variable '%s' declared twice", vars[i].name);
+                return NULL;
+            }
+        }
+    }
+
+    // "<result> __freezepiler_expr(<type> <name>, ...) { return (<source>); }"
+    size_t len = strlen(source) + 64;
+    for (int i = 0; i < nvars; i++) len += strlen(vars[i].name) + 10;
+    char *code = malloc(len);
+    int pos = snprintf(code, len, "%s " EXPR_NAME "(", type_names[result]);
+    for (int i = 0; i < nvars; i++) {
+        pos += snprintf(code + pos, len - pos, "%s%s %s", i ? ", " : "", type_names[vars[i].type], vars[i].name);
+    }
+    snprintf(code + pos, len - pos, "%s) { return (%s); }", nvars ? "" : "void", source);
+
+    static int initialized = 0;
+    if (!initialized) {
+        LLVMInitializeNativeTarget();
+        LLVMInitializeNativeAsmPrinter();
+        LLVMLinkInMCJIT();
+        initialized = 1;
+    }
+
+    codegen_options opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.emit = EMIT_LLVM_BC; // En memoria: sin prepare_native
+    opts.opt_level = opt_level < 0 ? 0 : opt_level > 3 ? 3 : opt_level;
+    opts.module_name = "freezepiler_expr";
+    LLVMModuleRef m = build_module(code, vars, nvars, &opts, error);
+    free(code); // Los literales del AST apuntan al código: se libera después de codegen
+    if (m == NULL) {
+        return NULL;
+    }
+
+    build_batch(m, LLVMGetNamedFunction(m, EXPR_NAME));
+    if (codegen_optimize_module(m, &opts) != 0) {
+        LLVMDisposeModule(m);
+        set_error(error, "optimization failed");
+        return NULL;
+    }
+
+    struct LLVMMCJITCompilerOptions mcjit;
+    LLVMInitializeMCJITCompilerOptions(&mcjit, sizeof(mcjit));
+    mcjit.OptLevel = (unsigned)opts.opt_level;
+    LLVMExecutionEngineRef engine;
+    char *err = NULL;
+    if (LLVMCreateMCJITCompilerForModule(&engine, m, &mcjit, sizeof(mcjit), &err)) {
+        set_error(error, "MCJIT: %s", err);
+        LLVMDisposeMessage(err);
+        return NULL;
+    }
+
+    freezepiler_expr *e = malloc(sizeof(freezepiler_expr));
+    e->engine = engine;
+    e->function = (void *)(uintptr_t)LLVMGetFunctionAddress(engine, EXPR_NAME);
+    e->batch = (void (*)(size_t, const void *const *, void *))(uintptr_t)LLVMGetFunctionAddress(engine, BATCH_NAME);
+    if (e->function == NULL || e->batch == NULL) {
+        set_error(error, "MCJIT could not generate the expression");
+        freezepiler_free(e);
+        return NULL;
+    }
+    return e;
+}
+
+void *freezepiler_function(const freezepiler_expr *expr) {
+    return expr->function;
+}
+
+void freezepiler_eval_batch(const freezepiler_expr *expr, size_t n, const void *const *columns, void *out) {
+    expr->batch(n, columns, out);
+}
+
+void freezepiler_free(freezepiler_expr *expr) {
+    if (expr) {
+        LLVMDisposeExecutionEngine(expr->engine);
+        free(expr);
+    }
+}
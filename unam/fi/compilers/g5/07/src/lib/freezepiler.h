@@ -0,0 +1,63 @@
+#ifndef FREEZEPILER_H
+#define FREEZEPILER_H
+
+#include <stddef.h>
+
+/*
+libfreezepiler: compiles an expression over named variables (a formula,
+a filter) to native code in memory and hands back a function to call.
+The expression goes through the same parser and code generator as a
+program; it may use arithmetic, comparisons, logical and bitwise
+operators, ?: and constants, but no calls or assignments.
+
+    freezepiler_var vars[] = { { "price", FREEZEPILER_DOUBLE }, { "qty", FREEZEPILER_INT } };
+    freezepiler_expr *e = freezepiler_compile("qty > 10 ? price * qty * 0.9 : price * qty",
+                                              vars, 2, FREEZEPILER_DOUBLE, 2, &error);
+    double (*total)(double, int) = (double (*)(double, int))freezepiler_function(e);
+
+Compiling is not thread-safe (the compiler keeps global state), but the
+compiled functions are plain native code and can be called from any
+thread. Link with bin/libfreezepiler.a, `llvm-config --ldflags --libs
+core mcjit native passes --system-libs` and -pthread.
+*/
+
+typedef enum freezepiler_type {
+    FREEZEPILER_INT,    // int
+    FREEZEPILER_LONG,   // long (64 bits)
+    FREEZEPILER_FLOAT,  // float
+    FREEZEPILER_DOUBLE  // double
+} freezepiler_type;
+
+// A variable of the expression; it becomes a parameter, in the order given
+typedef struct freezepiler_var {
+    const char *name;
+    freezepiler_type type;
+} freezepiler_var;
+
+typedef struct freezepiler_expr freezepiler_expr;
+
+/*
+Compiles source with the variables as parameters and result as the
+return type (converted as a C return statement would). opt_level is
+0..3 like -O<n>. On errors returns NULL and, if error is not NULL,
+stores a message there that the caller releases with free().
+*/
+freezepiler_expr *freezepiler_compile(const char *source, const freezepiler_var *vars, int nvars,
+                                      freezepiler_type result, int opt_level, char **error);
+
+// The compiled function: result type and parameter types as declared, e.g. double (*)(double, int)
+void *freezepiler_function(const freezepiler_expr *expr);
+
+/*
+Evaluates the expression over n rows in one call: columns[i] points to
+an array of n values of variable i, and the results are stored in out,
+an array of n values of the result type. The loop is compiled along
+with the expression, so the optimizer inlines it and vectorizes it when
+it can. For a single evaluation, pass n = 1 and one value per column.
+*/
+void freezepiler_eval_batch(const freezepiler_expr *expr, size_t n, const void *const *columns, void *out);
+
+// Releases the native code; the function pointers stop being valid
+void freezepiler_free(freezepiler_expr *expr);
+
+#endif // FREEZEPILER_H
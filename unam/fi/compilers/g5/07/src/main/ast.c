@@ -41,7 +41,26 @@ struct ast_node *make_leaf_int(NodeType type, int val) {
     return node;
 }
 
-struct ast_node *make_leaf_float(NodeType type, float val) {
+struct ast_node *make_leaf_lit(int_lit lit) {
+    struct ast_node *node = make_node(NT_ENTERO, NULL);
+    node->value.lit = lit;
+    return node;
+}
+
+struct ast_node *make_leaf_int_lit(int val) {
+    int_lit lit = { val, 0, 0 };
+    return make_leaf_lit(lit);
+}
+
+int ast_int_literal(struct ast_node *node, int *value) {
+    if (node == NULL || node->type != NT_ENTERO || node->value.lit.is_long || node->value.lit.is_unsigned) {
+        return 0;
+    }
+    *value = (int)node->value.lit.value;
+    return 1;
+}
+
+struct ast_node *make_leaf_float(NodeType type, double val) {
     struct ast_node *node = make_node(type, NULL);
     node->value.floatVal = val;
     return node;
@@ -53,6 +72,12 @@ struct ast_node *make_leaf_str(NodeType type, char *str) {
     return node;
 }
 
+struct ast_node *make_leaf_span(NodeType type, lit_span span) {
+    struct ast_node *node = make_node(type, NULL);
+    node->value.span = span;
+    return node;
+}
+
 struct ast_node *ast_append_sibling(struct ast_node *list_head, struct ast_node *new_sibling) {
     if (list_head == NULL) {
         return new_sibling; // List was empty
@@ -65,6 +90,220 @@ struct ast_node *ast_append_sibling(struct ast_node *list_head, struct ast_node
     return list_head;
 }
 
+void (*ast_external_handler)(struct ast_node *decl) = NULL;
+
+struct ast_node *ast_add_external(struct ast_node *program, struct ast_node *decl) {
+    if (ast_external_handler != NULL) {
+        ast_external_handler(decl);
+        return program ? program : make_node(NT_PROGRAMA, NULL);
+    }
+    if (program == NULL) {
+        return make_node(NT_PROGRAMA, decl);
+    }
+    program->child = ast_append_sibling(program->child, decl);
+    return program;
+}
+
+void ast_free(struct ast_node *node) {
+    if (node == NULL) {
+        return;
+    }
+    // Iterative: the pending subtrees are chained through their sibling links
+    struct ast_node *pending = node->child;
+    if (node->type == NT_ID || node->type == NT_VAR) {
+        free(node->value.strVal);
+    }
+    free(node);
+    while (pending != NULL) {
+        struct ast_node *cur = pending;
+        pending = cur->sibling;
+        if (cur->child != NULL) {
+            // The children go in front of the remaining siblings
+            struct ast_node *last = cur->child;
+            while (last->sibling != NULL) {
+                last = last->sibling;
+            }
+            last->sibling = pending;
+            pending = cur->child;
+        }
+        if (cur->type == NT_ID || cur->type == NT_VAR) {
+            free(cur->value.strVal);
+        }
+        free(cur);
+    }
+}
+
+struct ast_node *ast_copy(struct ast_node *node) {
+    if (node == NULL) {
+        return NULL;
+    }
+    // Iterative too: each pending entry is a source node and the link where its copy goes
+    typedef struct copy_work {
+        struct ast_node *src;
+        struct ast_node **dst;
+    } copy_work;
+    struct ast_node *root = NULL;
+    size_t len = 0, cap = 64;
+    copy_work *work = malloc(sizeof(copy_work) * cap);
+    if (work == NULL) {
+        fprintf(stderr, "Fatal Error: malloc failed copying AST\n");
+        exit(1);
+    }
+    work[len++] = (copy_work){ node, &root };
+    while (len > 0) {
+        copy_work cur = work[--len];
+        struct ast_node *copy = make_node(cur.src->type, NULL);
+        *copy = *cur.src;
+        copy->child = NULL;
+        copy->sibling = NULL;
+        if (copy->type == NT_ID || copy->type == NT_VAR) {
+            copy->value.strVal = strdup(cur.src->value.strVal);
+        }
+        *cur.dst = copy;
+        if (len + 2 > cap) {
+            cap *= 2;
+            work = realloc(work, sizeof(copy_work) * cap);
+            if (work == NULL) {
+                fprintf(stderr, "Fatal Error: realloc failed copying AST\n");
+                exit(1);
+            }
+        }
+        // The siblings of node itself are not part of the subtree
+        if (cur.src != node && cur.src->sibling != NULL) {
+            work[len++] = (copy_work){ cur.src->sibling, &copy->sibling };
+        }
+        if (cur.src->child != NULL) {
+            work[len++] = (copy_work){ cur.src->child, &copy->child };
+        }
+    }
+    free(work);
+    return root;
+}
+
+// Base type specifiers; the rest (const, unsigned, static...) only qualify them
+static int is_base_type_token(int token) {
+    switch (token) {
+        case T_VOID: case T_CHAR: case T_SHORT: case T_INT: case T_LONG:
+        case T_FLOAT: case T_DOUBLE: case T_STRUCT: case T_UNION: case T_ENUM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+struct ast_node *ast_add_type_specifier(struct ast_node *type_node, struct ast_node *spec) {
+    int head = type_node->value.intVal;
+    int tok = spec->value.intVal;
+
+    // A typedef name brings its own specifiers (const, vector_size...): they join the others
+    if (tok != T_ATTRIBUTE) {
+        while (spec->child != NULL) {
+            struct ast_node *inner = spec->child;
+            spec->child = inner->sibling;
+            inner->sibling = type_node->child;
+            type_node->child = inner;
+        }
+    }
+
+    // "unsigned int", "long int", "int long": the base type moves to the head node
+    if (is_base_type_token(tok) &&
+        (!is_base_type_token(head) || (head == T_INT && (tok == T_SHORT || tok == T_LONG)))) {
+        type_node->value.intVal = tok;
+        spec->value.intVal = head;
+    }
+    spec->sibling = type_node->child;
+    type_node->child = spec;
+    return type_node;
+}
+
+int ast_type_count(struct ast_node *type_node, int token) {
+    int count = 0;
+    if (type_node == NULL || type_node->type != NT_TIPO) {
+        return 0;
+    }
+    if (type_node->value.intVal == token) {
+        count++;
+    }
+    for (struct ast_node *spec = type_node->child; spec != NULL; spec = spec->sibling) {
+        if (spec->value.intVal == token) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int ast_vector_size(struct ast_node *type_node) {
+    if (type_node == NULL || type_node->type != NT_TIPO) {
+        return 0;
+    }
+    for (struct ast_node *spec = type_node->child; spec != NULL; spec = spec->sibling) {
+        if (spec->value.intVal == T_ATTRIBUTE && spec->child != NULL) {
+            return (int)spec->child->value.lit.value;
+        }
+    }
+    return 0;
+}
+
+typedef struct typedef_entry {
+    char *name;
+    struct ast_node *type; // Without the typedef specifier
+    struct typedef_entry *next;
+} typedef_entry;
+
+static typedef_entry *typedefs = NULL;
+
+int ast_typedef_declare(struct ast_node *type_node, struct ast_node *declarators) {
+    for (struct ast_node *d = declarators; d != NULL; d = d->sibling) {
+        if (d->type != NT_VAR) {
+            return 0;
+        }
+    }
+    for (struct ast_node *d = declarators; d != NULL; d = d->sibling) {
+        struct ast_node *type = ast_copy(type_node);
+        for (struct ast_node **link = &type->child; *link != NULL;) {
+            if ((*link)->value.intVal == T_TYPEDEF) {
+                struct ast_node *spec = *link;
+                *link = spec->sibling;
+                ast_free(spec);
+            } else {
+                link = &(*link)->sibling;
+            }
+        }
+        if (type->value.intVal == T_TYPEDEF) { // typedef x; is an int, as in old C
+            type->value.intVal = T_INT;
+        }
+        typedef_entry *e = malloc(sizeof(typedef_entry));
+        if (e == NULL) {
+            fprintf(stderr, "Fatal Error: malloc failed declaring typedef\n");
+            exit(1);
+        }
+        e->name = strdup(d->value.strVal);
+        e->type = type;
+        e->next = typedefs;
+        typedefs = e;
+    }
+    return 1;
+}
+
+struct ast_node *ast_typedef_lookup(const char *name) {
+    for (typedef_entry *e = typedefs; e != NULL; e = e->next) {
+        if (strcmp(e->name, name) == 0) {
+            return e->type;
+        }
+    }
+    return NULL;
+}
+
+void ast_typedef_clear(void) {
+    while (typedefs != NULL) {
+        typedef_entry *e = typedefs;
+        typedefs = e->next;
+        free(e->name);
+        ast_free(e->type);
+        free(e);
+    }
+}
+
 /*
 Semantic (SDT) Validation
 This function is called by main.c after a successful parse.
@@ -122,14 +361,63 @@ char* node_type_to_string(NodeType type) {
         case NT_FLOTANTE: return "FLOTANTE";
         case NT_CADENA: return "CADENA";
         case NT_CARACTER: return "CARACTER";
+        case NT_LISTA_INIT: return "LISTA_INIT";
+        case NT_PRAGMA: return "PRAGMA";
         default: return "DESCONOCIDO";
     }
 }
 
-void print_ast(struct ast_node *node, int indent) {
+struct ast_node *ast_preorder(struct ast_node *node, int (*visit)(struct ast_node *node, int depth, void *data), void *data) {
     if (node == NULL) {
-        return;
+        return NULL;
     }
+    if (visit(node, 0, data)) {
+        return node;
+    }
+    // Each entry is the next sibling to visit at that depth
+    struct pending { struct ast_node *next; int depth; } *stack = NULL;
+    int len = 0, cap = 0;
+    struct ast_node *stopped = NULL;
+    if (node->child != NULL) {
+        cap = 64;
+        stack = malloc(cap * sizeof(*stack));
+        if (stack == NULL) {
+            fprintf(stderr, "Fatal Error: malloc failed walking the AST\n");
+            exit(1);
+        }
+        stack[len++] = (struct pending){ node->child, 1 };
+    }
+    while (len > 0) {
+        struct pending *top = &stack[len - 1];
+        struct ast_node *cur = top->next;
+        if (cur == NULL) {
+            len--;
+            continue;
+        }
+        int depth = top->depth;
+        top->next = cur->sibling;
+        if (visit(cur, depth, data)) {
+            stopped = cur;
+            break;
+        }
+        if (cur->child != NULL) {
+            if (len == cap) {
+                cap *= 2;
+                stack = realloc(stack, cap * sizeof(*stack));
+                if (stack == NULL) {
+                    fprintf(stderr, "Fatal Error: realloc failed walking the AST\n");
+                    exit(1);
+                }
+            }
+            stack[len++] = (struct pending){ cur->child, depth + 1 };
+        }
+    }
+    free(stack);
+    return stopped;
+}
+
+static int print_node(struct ast_node *node, int depth, void *data) {
+    int indent = *(int *)data + depth;
     for (int i = 0; i < indent; i++) {
         printf("  ");
     }
@@ -138,12 +426,20 @@ void print_ast(struct ast_node *node, int indent) {
     switch (node->type) {
         case NT_ID:
         case NT_VAR:
+            printf(": %s\n", node->value.strVal);
+            break;
         case NT_CADENA:
+            printf(": \"%.*s\"\n", node->value.span.len, node->value.span.ptr);
+            break;
         case NT_CARACTER:
-            printf(": %s\n", node->value.strVal);
+            printf(": '%.*s'\n", node->value.span.len, node->value.span.ptr);
+            break;
+        case NT_PRAGMA:
+            printf(": %.*s\n", node->value.span.len, node->value.span.ptr);
             break;
         case NT_ENTERO:
-            printf(": %d\n", node->value.intVal);
+            printf(": %lld%s%s\n", node->value.lit.value, node->value.lit.is_unsigned ? "U" : "",
+                   node->value.lit.is_long ? "L" : "");
             break;
         case NT_FLOTANTE:
             printf(": %f\n", node->value.floatVal);
@@ -158,10 +454,9 @@ void print_ast(struct ast_node *node, int indent) {
         default:
             printf("\n"); // Structure node
     }
+    return 0;
+}
 
-    struct ast_node *child = node->child;
-    while (child != NULL) {
-        print_ast(child, indent + 1);
-        child = child->sibling;
-    }
+void print_ast(struct ast_node *node, int indent) {
+    ast_preorder(node, print_node, &indent);
 }
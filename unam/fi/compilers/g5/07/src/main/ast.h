@@ -36,9 +36,25 @@ typedef enum {
     NT_ENTERO,
     NT_FLOTANTE,
     NT_CADENA,
-    NT_CARACTER
+    NT_CARACTER,
+    NT_LISTA_INIT,
+    NT_PRAGMA
 } NodeType;
 
+// A string or char literal as it appears in the source, without its quotes
+// and with its escape sequences still encoded; it points into the code buffer
+typedef struct lit_span {
+    const char *ptr;
+    int len;
+} lit_span;
+
+// An integer constant and the type C gives it: int, long, unsigned int or
+// unsigned long, from its value and its U and L suffixes
+typedef struct int_lit {
+    long long value;
+    unsigned char is_long, is_unsigned;
+} int_lit;
+
 // Abstract Syntax Tree Node Structure
 typedef struct ast_node {
     NodeType type;
@@ -48,8 +64,10 @@ typedef struct ast_node {
     // Leaf node value
     union {
         int intVal;
-        float floatVal;
+        int_lit lit; // NT_ENTERO
+        double floatVal;
         char *strVal;
+        lit_span span; // NT_CADENA, NT_CARACTER, NT_PRAGMA
         int op; // Operator token
     } value;
 } ast_node;
@@ -63,10 +81,63 @@ struct ast_node *make_node(NodeType type, struct ast_node *child);
 struct ast_node *make_op_node(int op, struct ast_node *left, struct ast_node *right);
 struct ast_node *make_unary_op_node(int op, struct ast_node *operand);
 struct ast_node *make_leaf_int(NodeType type, int val);
-struct ast_node *make_leaf_float(NodeType type, float val);
+struct ast_node *make_leaf_float(NodeType type, double val);
+struct ast_node *make_leaf_lit(int_lit lit);
+struct ast_node *make_leaf_int_lit(int val); // NT_ENTERO of type int
 struct ast_node *make_leaf_str(NodeType type, char *str);
+struct ast_node *make_leaf_span(NodeType type, lit_span span);
 struct ast_node *ast_append_sibling(struct ast_node *list_head, struct ast_node *new_sibling);
 
+/*
+Adds an external declaration (function or global) to the program. When
+ast_external_handler is set (-fstreaming) the declaration is handed to
+it instead and the program node keeps no children.
+*/
+extern void (*ast_external_handler)(struct ast_node *decl);
+struct ast_node *ast_add_external(struct ast_node *program, struct ast_node *decl);
+
+// Frees a subtree (node and its descendants, not its siblings), identifiers included
+void ast_free(struct ast_node *node);
+
+// Deep copy of a subtree (node and its descendants, not its siblings); identifiers are duplicated
+struct ast_node *ast_copy(struct ast_node *node);
+
+/*
+Type specifiers: the NT_TIPO node keeps the base type token (int, char,
+float...) in value.intVal and every other specifier (const, unsigned,
+the second long of long long...) as NT_TIPO children.
+__attribute__((vector_size(N))) is one more child, T_ATTRIBUTE, with
+the byte count as an NT_ENTERO below it.
+*/
+struct ast_node *ast_add_type_specifier(struct ast_node *type_node, struct ast_node *spec);
+// Number of times the token appears among the specifiers of a type
+int ast_type_count(struct ast_node *type_node, int token);
+// Bytes given by vector_size, or 0 if the type is not a vector
+int ast_vector_size(struct ast_node *type_node);
+
+/*
+typedef names. The parser registers them when the declaration is
+reduced and from then on the lexer returns T_TYPE_NAME for them; each
+use becomes a copy of the type, so the passes after the parser never
+see a typedef. The names are visible until the end of the file, blocks
+included, and cannot be reused for variables.
+*/
+// 0 if a declarator is not a plain name (arrays, initializers)
+int ast_typedef_declare(struct ast_node *type_node, struct ast_node *declarators);
+struct ast_node *ast_typedef_lookup(const char *name);
+void ast_typedef_clear(void);
+
+// 1 and its value if node is an integer literal of type int
+int ast_int_literal(struct ast_node *node, int *value);
+
+/*
+Preorder walk of a subtree (node and its descendants, not its siblings)
+with an explicit stack, so arbitrarily deep trees take no C stack. visit
+receives each node with its depth below node; a nonzero return stops the
+walk, and ast_preorder returns the node where it stopped (NULL if none).
+*/
+struct ast_node *ast_preorder(struct ast_node *node, int (*visit)(struct ast_node *node, int depth, void *data), void *data);
+
 // Function to print the AST
 void print_ast(struct ast_node *node, int indent);
 
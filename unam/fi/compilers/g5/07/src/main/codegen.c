@@ -1,45 +1,70 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
 
 #include "ast.h"
 #include "codegen.h"
+#include "profile.h"
+#include "pragma.h"
+#include "lexer.h"
+#include "stackguard.h"
 #include "parser.tab.h"
 
 #include <llvm-c/Core.h>
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/TargetMachine.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/DebugInfo.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#include <llvm-c/Transforms/Scalar.h>
+#include <llvm-c/Transforms/Utils.h>
 
 
 static LLVMModuleRef module;
 static LLVMBuilderRef builder;
 static LLVMTypeRef i32_type;
 static LLVMTypeRef i8_type;  /* char */
-static LLVMTypeRef f64_type; /* use double for floating point */
-static LLVMBasicBlockRef current_switch_end_block = NULL;
+static LLVMTypeRef f64_type; /* literales de punto flotante (double en C) */
+static LLVMBasicBlockRef current_break_block = NULL;    /* destino de break: bucle o switch más interno */
+static LLVMBasicBlockRef current_continue_block = NULL; /* destino de continue: bucle más interno */
+static int current_ret_unsigned = 0; /* signo del tipo de retorno de la función actual */
+static int codegen_errors = 0;       /* errores que impiden emitir el módulo */
+static int whole_program = 0;        /* -fwhole-program: sólo main y lo extern quedan visibles */
+static int freestanding_runtime = 0; /* -ffreestanding-runtime: printf del runtime sin libc (format.c) */
 
 
 void codegen_block(ast_node *block, LLVMValueRef function);
+static void codegen_cond_branch(ast_node *cond, LLVMBasicBlockRef true_bb, LLVMBasicBlockRef false_bb, LLVMValueRef current_fn);
+static LLVMValueRef codegen_global_variable(const char *name, LLVMTypeRef type, ast_node *tipo, ast_node *init, int lineno);
 
 // map token -> llvm type using the token names from parser.tab.h
 static LLVMTypeRef map_type_token(int token) {
   switch (token) {
-    case T_INT:       // 258
+    case T_CHAR:
+      return LLVMInt8Type();
+
     case T_SHORT:
-    case T_LONG:
+      return LLVMInt16Type();
+
+    case T_LONG:      // LP64: long y long long son de 64 bits
+      return LLVMInt64Type();
+
+    case T_INT:
     case T_SIGNED:
     case T_UNSIGNED:
-    case T_CHAR:      // 260
       return LLVMInt32Type();
 
-    case T_FLOAT:     // 259
+    case T_FLOAT:
       return LLVMFloatType();
 
-    case T_DOUBLE:    // 262
+    case T_DOUBLE:    // long double también se trata como double
       return LLVMDoubleType();
 
-    case T_VOID:      // 261
+    case T_VOID:
       return LLVMVoidType();
 
     default:
@@ -48,1107 +73,2384 @@ static LLVMTypeRef map_type_token(int token) {
   }
 }
 
+/*
+GCC vector types: vector_size(N) makes the base type a vector of N
+bytes, <N / sizeof(T) x T>. As in gcc the elements are integers or
+floating point and their number is a power of two.
+*/
+static LLVMTypeRef vector_type_of(LLVMTypeRef elem, int bytes, int lineno) {
+  unsigned elem_bytes = 0;
+  switch (LLVMGetTypeKind(elem)) {
+    case LLVMIntegerTypeKind: elem_bytes = LLVMGetIntTypeWidth(elem) / 8; break;
+    case LLVMFloatTypeKind:   elem_bytes = 4; break;
+    case LLVMDoubleTypeKind:  elem_bytes = 8; break;
+    default: break;
+  }
+  unsigned n = elem_bytes ? (unsigned)bytes / elem_bytes : 0;
+  if (n == 0 || bytes % elem_bytes != 0 || (n & (n - 1)) != 0) {
+    fprintf(stderr, "ERROR: vector_size(%d) no da un número de elementos potencia de 2 (linea %d)\n", bytes, lineno);
+    codegen_errors++;
+    return elem;
+  }
+  return LLVMVectorType(elem, n);
+}
+
+// El token base del NT_TIPO decide el tipo; los modificadores (unsigned, const...) van como hijos
 static LLVMTypeRef map_type_node(ast_node *type_node) {
   if (!type_node) {
-    //     //fprintf(stderr, "[map_type_node] NULL type_node, fallback i32\n");
     return LLVMInt32Type();
   }
+  LLVMTypeRef t = map_type_token(type_node->value.intVal);
+  int bytes = ast_vector_size(type_node);
+  return bytes > 0 ? vector_type_of(t, bytes, type_node->lineno) : t;
+}
 
-  LLVMTypeRef result = NULL;
+static int type_is_unsigned(ast_node *type_node) {
+  return ast_type_count(type_node, T_UNSIGNED) > 0;
+}
 
-  if (type_node->type == NT_TIPO) {
-    result = map_type_token(type_node->value.intVal);
-  } else {
-    result = map_type_token(type_node->value.intVal);
+/*
+Builds the LLVM type of an ARRAY_DECL(VAR, dim1, dim2, ...) node:
+int a[2][3] becomes [2 x [3 x i32]]. Every dimension must have been
+folded to a positive integer constant by the simplifier, except the
+first one, which may be left empty when a brace initializer gives the
+length (int t[] = {1, 2, 3}). Returns NULL otherwise.
+*/
+static LLVMTypeRef array_type_of(ast_node *decl, LLVMTypeRef elem_type, ast_node *init) {
+  int dims[32];
+  int ndims = 0;
+  for (ast_node *d = decl->child ? decl->child->sibling : NULL; d; d = d->sibling) {
+    if (ndims == 0 && d->type == NT_EXPR_SENTENCIA && !d->child && init && init->type == NT_LISTA_INIT) {
+      int len = 0;
+      for (ast_node *item = init->child; item; item = item->sibling) len++;
+      dims[ndims++] = len;
+      continue;
+    }
+    if (d->type != NT_ENTERO || d->value.lit.value <= 0 || d->value.lit.value > INT_MAX || ndims == 32) {
+      fprintf(stderr, "ERROR: el tamaño del arreglo '%s' debe ser una constante entera positiva (linea %d)\n",
+              decl->child ? decl->child->value.strVal : "?", decl->lineno);
+      codegen_errors++;
+      return NULL;
+    }
+    dims[ndims++] = (int)d->value.lit.value;
   }
 
+  LLVMTypeRef t = elem_type;
+  for (int i = ndims - 1; i >= 0; i--) {
+    t = LLVMArrayType(t, (unsigned)dims[i]);
+  }
+  return t;
+}
 
-  if (result) {
-    LLVMTypeKind kind = LLVMGetTypeKind(result);
-    //     //fprintf(stderr, "[map_type_node] tipo resultante kind=%d\n", kind);
-
-
-    if (kind != LLVMIntegerTypeKind && kind != LLVMFloatTypeKind && kind != LLVMDoubleTypeKind && kind != LLVMVoidTypeKind) {
-      //       //fprintf(stderr, "[map_type_node] ERROR: tipo no permitido (kind=%d), forzando i32\n", kind);
-      result = LLVMInt32Type();
-    }
-
+// Como hace clang en x86-64, los arreglos de 16 bytes o más se alinean a 16 para usar cargas SIMD alineadas
+static void align_array_storage(LLVMValueRef storage, LLVMTypeRef type) {
+  if (LLVMGetTypeKind(type) != LLVMArrayTypeKind) {
+    return;
+  }
+  LLVMTargetDataRef layout = LLVMGetModuleDataLayout(module);
+  if (LLVMABISizeOfType(layout, type) >= 16) {
+    LLVMSetAlignment(storage, 16);
+  }
+}
 
-    if (kind == LLVMIntegerTypeKind) {
-      unsigned width = LLVMGetIntTypeWidth(result);
-      if (width != 32) {
-        //         //fprintf(stderr, "[map_type_node] WARNING: integer width=%d, forzando i32\n", width);
-        result = LLVMInt32Type();
-      }
-    }
-  } else {
-    //     //fprintf(stderr, "[map_type_node] ERROR: tipo NULL, usando i32\n");
-    result = LLVMInt32Type();
+/*
+Splits a declarator (VAR, ARRAY_DECL, or either one as the left side of
+"= initializer") into the declared node and its initializer. Returns
+the variable name, or NULL for anything else.
+*/
+static const char *declarator_parts(ast_node *cur, ast_node **var, ast_node **init) {
+  *var = cur;
+  *init = NULL;
+  if (cur->type == NT_OP_BINARIO && cur->value.op == T_ASSIGN && cur->child) {
+    *var = cur->child;
+    *init = cur->child->sibling;
+  }
+  if ((*var)->type == NT_VAR || (*var)->type == NT_ID) {
+    return (*var)->value.strVal;
+  }
+  if ((*var)->type == NT_ARRAY_DECL && (*var)->child) {
+    return (*var)->child->value.strVal;
   }
+  return NULL;
+}
 
-  return result;
+// Tipo completo de lo declarado: el tipo base, o el arreglo con su primera dimensión tomada del inicializador si falta
+static LLVMTypeRef declarator_type(ast_node *var, LLVMTypeRef base_type, ast_node *init) {
+  if (var->type != NT_ARRAY_DECL) {
+    return base_type;
+  }
+  return array_type_of(var, base_type, init);
 }
 
 
 
 typedef struct sym_entry {
   char *name;
-  LLVMValueRef alloc; // i32* alloca
+  LLVMValueRef alloc; // alloca de la variable
+  LLVMTypeRef type;   // tipo del valor almacenado
+  int is_unsigned;
   struct sym_entry *next;
 } sym_entry;
 static sym_entry *sym_table = NULL;
+static sym_entry *global_table = NULL; // variables de archivo, visibles en todas las funciones
 
-static void sym_put(const char *name, LLVMValueRef alloc) {
+static void sym_push(sym_entry **list, const char *name, LLVMValueRef alloc, LLVMTypeRef type, int is_unsigned) {
   if (!name) name = "(null)";
-  //   //fprintf(stderr, "[sym_put] %s -> %p\n", name, (void*)alloc);
   sym_entry *e = malloc(sizeof(*e));
   e->name = strdup(name);
   e->alloc = alloc;
-  e->next = sym_table;
-  sym_table = e;
+  e->type = type;
+  e->is_unsigned = is_unsigned;
+  e->next = *list;
+  *list = e;
 }
-static LLVMValueRef sym_get(const char *name) {
+static void sym_put(const char *name, LLVMValueRef alloc, LLVMTypeRef type, int is_unsigned) {
+  sym_push(&sym_table, name, alloc, type, is_unsigned);
+}
+static sym_entry *sym_lookup(const char *name) {
   if (!name) name = "(null)";
-  //   //fprintf(stderr, "[sym_get] buscando '%s'\n", name);
   for (sym_entry *e = sym_table; e; e = e->next) {
-    //     //fprintf(stderr, "  comprobando %s (alloc=%p)\n", e->name, (void*)e->alloc);
     if (strcmp(e->name, name) == 0) {
-      //       //fprintf(stderr, "[sym_get] encontrado %s -> %p\n", e->name, (void*)e->alloc);
-      return e->alloc;
+      return e;
+    }
+  }
+  for (sym_entry *e = global_table; e; e = e->next) {
+    if (strcmp(e->name, name) == 0) {
+      return e;
     }
   }
-  //   //fprintf(stderr, "[sym_get] NO encontrado '%s'\n", name);
   return NULL;
 }
+static void sym_clear_list(sym_entry **list) {
+  while (*list) {
+    sym_entry *t = *list;
+    *list = t->next;
+    free(t->name);
+    free(t);
+  }
+}
 static void sym_clear(void) {
-  //   //fprintf(stderr, "[sym_clear] start\n");
-  while (sym_table) {
-    sym_entry *t = sym_table;
-    sym_table = t->next;
-    //     //fprintf(stderr, "  free %s\n", t->name);
+  sym_clear_list(&sym_table);
+}
+static void sym_put_global(const char *name, LLVMValueRef global, LLVMTypeRef type, int is_unsigned) {
+  sym_push(&global_table, name, global, type, is_unsigned);
+}
+
+
+// Signo del retorno y de los parámetros de cada función (LLVM no guarda el signo en los tipos)
+typedef struct fn_entry {
+  char *name;
+  int ret_unsigned;
+  int nparams;
+  int *param_unsigned;
+  struct fn_entry *next;
+} fn_entry;
+static fn_entry *fn_table = NULL;
+
+static fn_entry *fn_put(const char *name, int ret_unsigned, int nparams) {
+  fn_entry *e = malloc(sizeof(*e));
+  e->name = strdup(name);
+  e->ret_unsigned = ret_unsigned;
+  e->nparams = nparams;
+  e->param_unsigned = calloc(nparams > 0 ? nparams : 1, sizeof(int));
+  e->next = fn_table;
+  fn_table = e;
+  return e;
+}
+static fn_entry *fn_get(const char *name) {
+  for (fn_entry *e = fn_table; e; e = e->next) {
+    if (name && strcmp(e->name, name) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+static void fn_clear(void) {
+  while (fn_table) {
+    fn_entry *t = fn_table;
+    fn_table = t->next;
     free(t->name);
+    free(t->param_unsigned);
     free(t);
   }
-  //   //fprintf(stderr, "[sym_clear] end\n");
 }
 
 
 static LLVMValueRef create_entry_alloca(LLVMValueRef function, const char *name, LLVMTypeRef elem_type) {
-  //   //fprintf(stderr, "[create_entry_alloca] function=%p name=%s elem_type=%p\n", (void*)function, name?name:"(null)", (void*)elem_type);
-
-  if (!function) {
-    //     //fprintf(stderr, "[create_entry_alloca] ERROR: function NULL\n");
+  if (!function || !elem_type) {
     return NULL;
   }
 
-
-  elem_type = i32_type;
-  //   //fprintf(stderr, "  [create_entry_alloca] FORZANDO i32_type: %p\n", (void*)elem_type);
-
   LLVMBasicBlockRef entry = LLVMGetEntryBasicBlock(function);
   LLVMBuilderRef tmp = LLVMCreateBuilder();
 
   if (!entry) {
-    //     //fprintf(stderr, "  [create_entry_alloca] entry block no existe, creando uno\n");
     entry = LLVMAppendBasicBlock(function, "entry");
     LLVMPositionBuilderAtEnd(tmp, entry);
   } else {
     LLVMValueRef first = LLVMGetFirstInstruction(entry);
     if (first) {
       LLVMPositionBuilderBefore(tmp, first);
-      //       //fprintf(stderr, "  [create_entry_alloca] posicionando builder antes de la primera instruccion\n");
     } else {
       LLVMPositionBuilderAtEnd(tmp, entry);
-      //       //fprintf(stderr, "  [create_entry_alloca] posicionando builder al final del entry (sin instrucciones)\n");
     }
   }
 
   LLVMValueRef a = LLVMBuildAlloca(tmp, elem_type, name);
-  //   //fprintf(stderr, "  [create_entry_alloca] alloca creada: %p\n", (void*)a);
 
   LLVMDisposeBuilder(tmp);
   return a;
 }
 
 
+// Declara (una vez) una función de la libc, del runtime o un intrínseco de LLVM
+static LLVMValueRef external_function(const char *name, LLVMTypeRef ret, LLVMTypeRef *params, unsigned nparams, int vararg) {
+  LLVMValueRef f = LLVMGetNamedFunction(module, name);
+  if (!f) f = LLVMAddFunction(module, name, LLVMFunctionType(ret, params, nparams, vararg));
+  return f;
+}
 
-static LLVMValueRef safe_load(LLVMValueRef ptr, const char *name) {
-  //   //fprintf(stderr, "[safe_load] ptr=%p name=%s\n", (void*)ptr, name?name:"(null)");
-  if (!ptr) {
-    //     //fprintf(stderr, "[safe_load] ERROR: ptr NULL\n");
-    return NULL;
-  }
+static LLVMValueRef build_external_call(LLVMValueRef f, LLVMValueRef *args, unsigned nargs) {
+  return LLVMBuildCall2(builder, LLVMGlobalGetValueType(f), f, args, nargs, "");
+}
 
 
-  LLVMTypeRef t_elem = i32_type;
+// =======================================================
+// DEBUG INFO (-g, -gline-tables-only)
+// =======================================================
+/*
+Each function gets a DISubprogram and every instruction the line of the
+statement or expression it comes from, so profilers and debuggers map
+machine code back to the source. Full -g also describes the types of
+globals, parameters and locals. Everything lives in the function scope:
+the AST does not keep the columns or the extent of nested blocks.
+*/
+static debug_level debug_info = DEBUG_NONE;
+static int debug_optimized = 0;
+static LLVMDIBuilderRef dib = NULL;
+static LLVMMetadataRef debug_file = NULL;
+static LLVMMetadataRef debug_scope = NULL; /* subprograma de la función actual */
+static int debug_line = 0;                 /* línea de la ubicación actual del builder */
+
+static void debug_begin_module(const codegen_options *opts) {
+  debug_info = opts ? opts->debug_info : DEBUG_NONE;
+  debug_optimized = opts && opts->opt_level > 0;
+  if (debug_info == DEBUG_NONE) {
+    return;
+  }
+  dib = LLVMCreateDIBuilder(module);
+
+  // El archivo relativo al directorio de trabajo, como lo escribió el usuario
+  const char *path = opts->module_name ? opts->module_name : "-";
+  char cwd[4096];
+  if (!getcwd(cwd, sizeof(cwd))) strcpy(cwd, ".");
+  debug_file = LLVMDIBuilderCreateFile(dib, path, strlen(path), cwd, strlen(cwd));
+  const char *producer = "freezepiler";
+  LLVMDIBuilderCreateCompileUnit(dib, LLVMDWARFSourceLanguageC99, debug_file, producer, strlen(producer),
+                                 debug_optimized, "", 0, 0, "", 0,
+                                 debug_info == DEBUG_LINE_TABLES ? LLVMDWARFEmissionLineTablesOnly : LLVMDWARFEmissionFull,
+                                 0, 0, 0, "", 0, "", 0);
+
+  LLVMAddModuleFlag(module, LLVMModuleFlagBehaviorWarning, "Debug Info Version", 18,
+                    LLVMValueAsMetadata(LLVMConstInt(LLVMInt32Type(), LLVMDebugMetadataVersion(), 0)));
+  LLVMAddModuleFlag(module, LLVMModuleFlagBehaviorWarning, "Dwarf Version", 13,
+                    LLVMValueAsMetadata(LLVMConstInt(LLVMInt32Type(), 4, 0)));
+}
 
-  //   //fprintf(stderr, "[safe_load] llamando LLVMBuildLoad2 con tipo elemento %p...\n", (void*)t_elem);
-  LLVMValueRef v = LLVMBuildLoad2(builder, t_elem, ptr, name);
-  //   //fprintf(stderr, "[safe_load] load ok -> %p\n", (void*)v);
-  return v;
+static void debug_finish_module(void) {
+  if (dib) {
+    LLVMDIBuilderFinalize(dib);
+    LLVMDisposeDIBuilder(dib);
+  }
+  dib = NULL;
+  debug_file = NULL;
+  debug_scope = NULL;
+  debug_info = DEBUG_NONE;
+}
+
+// Tipo DWARF de un tipo de LLVM; el signo no está en LLVM y llega aparte
+static LLVMMetadataRef debug_type(LLVMTypeRef type, int is_unsigned) {
+  if (!type) {
+    return NULL;
+  }
+  const char *name = NULL;
+  unsigned encoding = 0;
+  switch (LLVMGetTypeKind(type)) {
+    case LLVMIntegerTypeKind:
+      switch (LLVMGetIntTypeWidth(type)) {
+        case 1:  name = "_Bool"; encoding = 0x02; break; // DW_ATE_boolean
+        case 8:  name = is_unsigned ? "unsigned char" : "char"; encoding = is_unsigned ? 0x08 : 0x06; break;
+        case 16: name = is_unsigned ? "unsigned short" : "short"; break;
+        case 32: name = is_unsigned ? "unsigned int" : "int"; break;
+        default: name = is_unsigned ? "unsigned long" : "long"; break;
+      }
+      if (!encoding) encoding = is_unsigned ? 0x08 : 0x05; // DW_ATE_unsigned / DW_ATE_signed
+      return LLVMDIBuilderCreateBasicType(dib, name, strlen(name), LLVMGetIntTypeWidth(type), encoding, LLVMDIFlagZero);
+    case LLVMFloatTypeKind:
+      return LLVMDIBuilderCreateBasicType(dib, "float", 5, 32, 0x04, LLVMDIFlagZero); // DW_ATE_float
+    case LLVMDoubleTypeKind:
+      return LLVMDIBuilderCreateBasicType(dib, "double", 6, 64, 0x04, LLVMDIFlagZero);
+    case LLVMArrayTypeKind: {
+      // int a[2][3]: un arreglo de dos subrangos sobre int
+      LLVMMetadataRef ranges[8];
+      unsigned n = 0;
+      LLVMTypeRef elem = type;
+      while (LLVMGetTypeKind(elem) == LLVMArrayTypeKind && n < 8) {
+        ranges[n++] = LLVMDIBuilderGetOrCreateSubrange(dib, 0, LLVMGetArrayLength(elem));
+        elem = LLVMGetElementType(elem);
+      }
+      LLVMMetadataRef elem_type = debug_type(elem, is_unsigned);
+      uint64_t bits = 8 * LLVMABISizeOfType(LLVMGetModuleDataLayout(module), type);
+      return elem_type ? LLVMDIBuilderCreateArrayType(dib, bits, 0, elem_type, ranges, n) : NULL;
+    }
+    case LLVMVectorTypeKind: {
+      LLVMMetadataRef range = LLVMDIBuilderGetOrCreateSubrange(dib, 0, LLVMGetVectorSize(type));
+      LLVMMetadataRef elem_type = debug_type(LLVMGetElementType(type), is_unsigned);
+      uint64_t bits = 8 * LLVMABISizeOfType(LLVMGetModuleDataLayout(module), type);
+      return elem_type ? LLVMDIBuilderCreateVectorType(dib, bits, 0, elem_type, &range, 1) : NULL;
+    }
+    case LLVMPointerTypeKind: {
+      LLVMMetadataRef pointee = debug_type(LLVMGetElementType(type), is_unsigned);
+      return LLVMDIBuilderCreatePointerType(dib, pointee, 64, 0, 0, "", 0);
+    }
+    default:
+      return NULL;
+  }
 }
 
+// Ubicación del builder en la línea de node (no cambia si ya está ahí)
+static void debug_set_location(ast_node *node) {
+  if (!debug_scope || !node || node->lineno <= 0 || node->lineno == debug_line) {
+    return;
+  }
+  debug_line = node->lineno;
+  LLVMMetadataRef loc = LLVMDIBuilderCreateDebugLocation(LLVMGetGlobalContext(), debug_line, 0, debug_scope, NULL);
+  LLVMSetCurrentDebugLocation2(builder, loc);
+}
 
+// Subprograma de una definición; todo lo que se genere hasta debug_end_function cae en él
+static void debug_begin_function(LLVMValueRef function, ast_node *tipo_node) {
+  if (!dib) {
+    return;
+  }
+  size_t len;
+  const char *name = LLVMGetValueName2(function, &len);
+
+  LLVMMetadataRef subroutine;
+  if (debug_info == DEBUG_FULL) {
+    // El primer elemento es el retorno (NULL = void), luego un tipo por parámetro
+    LLVMTypeRef fn_type = LLVMGlobalGetValueType(function);
+    unsigned nparams = LLVMCountParamTypes(fn_type);
+    LLVMTypeRef *param_types = malloc((nparams + 1) * sizeof(LLVMTypeRef));
+    LLVMMetadataRef *types = malloc((nparams + 1) * sizeof(LLVMMetadataRef));
+    LLVMGetParamTypes(fn_type, param_types);
+    fn_entry *sig = fn_get(name);
+    types[0] = debug_type(LLVMGetReturnType(fn_type), type_is_unsigned(tipo_node));
+    for (unsigned i = 0; i < nparams; i++) {
+      types[i + 1] = debug_type(param_types[i], sig && (int)i < sig->nparams ? sig->param_unsigned[i] : 0);
+    }
+    subroutine = LLVMDIBuilderCreateSubroutineType(dib, debug_file, types, nparams + 1, LLVMDIFlagZero);
+    free(types);
+    free(param_types);
+  } else {
+    subroutine = LLVMDIBuilderCreateSubroutineType(dib, debug_file, NULL, 0, LLVMDIFlagZero);
+  }
 
+  unsigned line = tipo_node && tipo_node->lineno > 0 ? tipo_node->lineno : 0;
+  int local = LLVMGetLinkage(function) == LLVMInternalLinkage;
+  debug_scope = LLVMDIBuilderCreateFunction(dib, debug_file, name, len, name, len, debug_file, line, subroutine,
+                                            local, 1, line, LLVMDIFlagPrototyped, debug_optimized);
+  LLVMSetSubprogram(function, debug_scope);
+  debug_line = 0;
+  debug_set_location(tipo_node);
+}
 
+static void debug_end_function(void) {
+  if (debug_scope) {
+    LLVMSetCurrentDebugLocation2(builder, NULL);
+  }
+  debug_scope = NULL;
+  debug_line = 0;
+}
 
+// Parámetro (argno >= 1) o variable local (argno 0) guardada en storage; sólo con -g completo
+static void debug_declare_variable(const char *name, LLVMValueRef storage, LLVMTypeRef type, int is_unsigned,
+                                   int lineno, unsigned argno) {
+  if (!debug_scope || debug_info != DEBUG_FULL || !name) {
+    return;
+  }
+  LLVMMetadataRef di_type = debug_type(type, is_unsigned);
+  if (!di_type) {
+    return;
+  }
+  LLVMMetadataRef var = argno > 0
+    ? LLVMDIBuilderCreateParameterVariable(dib, debug_scope, name, strlen(name), argno, debug_file, lineno, di_type, 1, LLVMDIFlagZero)
+    : LLVMDIBuilderCreateAutoVariable(dib, debug_scope, name, strlen(name), debug_file, lineno, di_type, 1, LLVMDIFlagZero, 0);
+  LLVMMetadataRef loc = LLVMDIBuilderCreateDebugLocation(LLVMGetGlobalContext(), lineno, 0, debug_scope, NULL);
+  LLVMDIBuilderInsertDeclareAtEnd(dib, storage, var, LLVMDIBuilderCreateExpression(dib, NULL, 0), loc,
+                                  LLVMGetInsertBlock(builder));
+}
 
+// Variable global (o static local) con nombre de C name; sólo con -g completo
+static void debug_global_variable(LLVMValueRef global, const char *name, LLVMTypeRef type, int is_unsigned, int lineno) {
+  if (!dib || debug_info != DEBUG_FULL) {
+    return;
+  }
+  LLVMMetadataRef di_type = debug_type(type, is_unsigned);
+  if (!di_type) {
+    return;
+  }
+  size_t link_len;
+  const char *link_name = LLVMGetValueName2(global, &link_len);
+  LLVMMetadataRef expr = LLVMDIBuilderCreateGlobalVariableExpression(
+    dib, debug_scope ? debug_scope : debug_file, name, strlen(name), link_name, link_len, debug_file, lineno,
+    di_type, LLVMGetLinkage(global) == LLVMInternalLinkage, LLVMDIBuilderCreateExpression(dib, NULL, 0), NULL, 0);
+  LLVMGlobalSetMetadata(global, LLVMGetMDKindID("dbg", 3), expr);
+}
 
 
+// =======================================================
+// CONVERSIONES
+// =======================================================
+static int is_float_type(LLVMTypeRef t) {
+  LLVMTypeKind k = LLVMGetTypeKind(t);
+  return k == LLVMFloatTypeKind || k == LLVMDoubleTypeKind;
+}
 
+static int is_int_type(LLVMTypeRef t) {
+  return LLVMGetTypeKind(t) == LLVMIntegerTypeKind;
+}
 
+static int is_vector_type(LLVMTypeRef t) {
+  return LLVMGetTypeKind(t) == LLVMVectorTypeKind;
+}
 
+// Tipo de los elementos de un vector; un escalar es su propio tipo
+static LLVMTypeRef scalar_type(LLVMTypeRef t) {
+  return is_vector_type(t) ? LLVMGetElementType(t) : t;
+}
 
-// =======================================================
-// EXPRESIONES
-// =======================================================
 static LLVMValueRef cast_to_bool(LLVMValueRef v) {
   LLVMTypeRef ty = LLVMTypeOf(v);
   LLVMTypeKind k = LLVMGetTypeKind(ty);
 
+  // Las comparaciones ya producen i1: no se vuelve a comparar contra cero
+  if (k == LLVMIntegerTypeKind && LLVMGetIntTypeWidth(ty) == 1) {
+    return v;
+  }
   if (k == LLVMIntegerTypeKind) {
     LLVMValueRef zero = LLVMConstInt(ty, 0, 0);
     return LLVMBuildICmp(builder, LLVMIntNE, v, zero, "i_bool");
   }
-  if (k == LLVMDoubleTypeKind) {
+  if (k == LLVMFloatTypeKind || k == LLVMDoubleTypeKind) {
     LLVMValueRef zero = LLVMConstReal(ty, 0.0);
     return LLVMBuildFCmp(builder, LLVMRealUNE, v, zero, "f_bool");
   }
+  if (k == LLVMPointerTypeKind) {
+    return LLVMBuildIsNotNull(builder, v, "p_bool");
+  }
 
   return LLVMConstInt(LLVMInt1Type(), 0, 0);
 }
 
-static LLVMValueRef codegen_expr(ast_node *expr, LLVMValueRef current_fn) {
-  if (!expr) {
-    //     fprintf(stderr, "[codegen_expr] ERROR: expr == NULL\n");
-    //printf("[DEBUG] codegen_expr: expr es NULL\n");
-    return NULL;
+// 0 si un valor de tipo src no puede asignarse a dst: un vector sólo va a otro vector del mismo tamaño
+static int vector_convertible(LLVMTypeRef src, LLVMTypeRef dst) {
+  if (src == dst || (!is_vector_type(src) && !is_vector_type(dst))) {
+    return 1;
   }
-  //   fprintf(stderr, "[codegen_expr] entrada: type=%d lineno=%d addr=%p\n", expr->type, expr->lineno, (void*)expr);
-  //printf("[DEBUG] codegen_expr: tipo=%d, lineno=%d\n", expr->type, expr->lineno);
-  switch (expr->type) {
-    case NT_ENTERO:
-      //       fprintf(stderr, "[codegen_expr] ENTERO: %d\n", expr->value.intVal);
-      return LLVMConstInt(i32_type, expr->value.intVal, 0);
+  LLVMTargetDataRef layout = LLVMGetModuleDataLayout(module);
+  return is_vector_type(src) && is_vector_type(dst) && LLVMABISizeOfType(layout, src) == LLVMABISizeOfType(layout, dst);
+}
 
-    case NT_FLOTANTE: {
-      double dv = (double) expr->value.floatVal;
-      return LLVMConstReal(f64_type, dv);
-    }
-    case NT_CARACTER: {
+static LLVMValueRef vector_splat(LLVMValueRef v, int is_unsigned, LLVMTypeRef vector_type);
+
+/*
+Converts v to dst as C does on assignment, argument passing and return.
+src_unsigned picks zext/uitofp over sext/sitofp when widening an integer;
+dst_unsigned picks fptoui over fptosi. i1 values (comparisons) are
+always zero-extended. A vector becomes another one of the same size
+keeping its bits (gcc's -flax-vector-conversions). A scalar becomes a
+vector by repeating it in every element, which only the operands of
+vector operations do: vector_convertible rejects it on assignment.
+*/
+static LLVMValueRef convert_value(LLVMValueRef v, int src_unsigned, LLVMTypeRef dst, int dst_unsigned) {
+  LLVMTypeRef src = LLVMTypeOf(v);
+  if (!v || src == dst) {
+    return v;
+  }
 
-      const char *s = expr->value.strVal ? expr->value.strVal : "\0";
-      unsigned char ch = 0;
-      if (s[0] == '\'' && s[1] && s[2] == '\'') ch = (unsigned char)s[1];
-      else ch = (unsigned char)s[0];
+  LLVMTypeKind sk = LLVMGetTypeKind(src);
+  LLVMTypeKind dk = LLVMGetTypeKind(dst);
 
-      return LLVMConstInt(LLVMInt8Type(), ch, 0);
+  if (dk == LLVMVectorTypeKind && (sk == LLVMIntegerTypeKind || is_float_type(src))) {
+    return vector_splat(v, src_unsigned, dst);
+  }
+  if (sk == LLVMVectorTypeKind && vector_convertible(src, dst)) {
+    return LLVMBuildBitCast(builder, v, dst, "vcasttmp");
+  }
+
+  if (sk == LLVMIntegerTypeKind && dk == LLVMIntegerTypeKind) {
+    unsigned sw = LLVMGetIntTypeWidth(src);
+    unsigned dw = LLVMGetIntTypeWidth(dst);
+    if (dw == 1) {
+      return cast_to_bool(v);
     }
-    case NT_ID:
-    case NT_VAR: {
-      const char *name = expr->value.strVal;
-      //       fprintf(stderr, "[codegen_expr] ID/VAR: '%s' (addr %p)\n", name?name:"(null)", (void*)expr);
-      if (!name) { //fprintf(stderr, "[codegen_expr] ERROR: name NULL\n"); 
-        return NULL; }
-      LLVMValueRef a = sym_get(name);
-      if (!a) {
-        //fprintf(stderr, "[codegen_expr] error: uso de identificador no declarado '%s' (linea %d)\n", name, expr->lineno);
-        return NULL;
-      }
-      LLVMTypeRef t_of_a = LLVMTypeOf(a);
-      LLVMTypeRef et = t_of_a ? LLVMGetElementType(t_of_a) : NULL;
-      //       fprintf(stderr, "[codegen_expr] preparándose para load: alloca=%p LLVMTypeOf(alloca)=%p LLVMGetElementType=%p\n",
-      //(void*)a, (void*)t_of_a, (void*)et);
-      LLVMBuilderRef cur_builder = builder;
-      //       fprintf(stderr, "[codegen_expr] builder=%p\n", (void*)cur_builder);
-      if (cur_builder) {
-        LLVMBasicBlockRef ib = LLVMGetInsertBlock(cur_builder);
-        //         fprintf(stderr, "[codegen_expr] LLVMGetInsertBlock(builder)=%p\n", (void*)ib);
-      }
-      LLVMValueRef loaded = safe_load(a, name);
-      if (!loaded) {
-        //         fprintf(stderr, "[codegen_expr] ERROR: safe_load devolvió NULL para %s\n", name);
-        return NULL;
-      }
-      //       fprintf(stderr, "[codegen_expr] load OK -> %p\n", (void*)loaded);
-      return loaded;
+    if (sw > dw) {
+      return LLVMBuildTrunc(builder, v, dst, "trunctmp");
     }
+    if (sw == 1 || src_unsigned) {
+      return LLVMBuildZExt(builder, v, dst, "zexttmp");
+    }
+    return LLVMBuildSExt(builder, v, dst, "sexttmp");
+  }
+  if (sk == LLVMIntegerTypeKind && is_float_type(dst)) {
+    if (src_unsigned || LLVMGetIntTypeWidth(src) == 1) {
+      return LLVMBuildUIToFP(builder, v, dst, "uitofptmp");
+    }
+    return LLVMBuildSIToFP(builder, v, dst, "sitofptmp");
+  }
+  if (is_float_type(src) && dk == LLVMIntegerTypeKind) {
+    if (LLVMGetIntTypeWidth(dst) == 1) {
+      return cast_to_bool(v);
+    }
+    if (dst_unsigned) {
+      return LLVMBuildFPToUI(builder, v, dst, "fptouitmp");
+    }
+    return LLVMBuildFPToSI(builder, v, dst, "fptositmp");
+  }
+  if (is_float_type(src) && is_float_type(dst)) {
+    return LLVMBuildFPCast(builder, v, dst, "fpcasttmp");
+  }
+  if (sk == LLVMPointerTypeKind && dk == LLVMPointerTypeKind) {
+    return LLVMBuildBitCast(builder, v, dst, "ptrcasttmp");
+  }
+  if (sk == LLVMPointerTypeKind && dk == LLVMIntegerTypeKind) {
+    return LLVMBuildPtrToInt(builder, v, dst, "ptrtointtmp");
+  }
+  if (sk == LLVMIntegerTypeKind && dk == LLVMPointerTypeKind) {
+    return LLVMBuildIntToPtr(builder, v, dst, "inttoptrtmp");
+  }
+  return v;
+}
 
-    case NT_CADENA: {  // tipo 31
-      //printf("[DEBUG] Procesando CADENA: %s\n", expr->value.strVal);
-
-      // Verificar que builder y module estén inicializados
-      if (!builder) {
-        //printf("[ERROR] builder es NULL al procesar cadena!\n");
-        return NULL;
-      }
-
-      if (!module) {
-        //printf("[ERROR] module es NULL al procesar cadena!\n");
-        return NULL;
-      }
+// convert_value en una asignación, un argumento o un return, con el error si un vector no cabe en el destino
+static LLVMValueRef convert_checked(LLVMValueRef v, int src_unsigned, LLVMTypeRef dst, int dst_unsigned, int lineno) {
+  if (v && !vector_convertible(LLVMTypeOf(v), dst)) {
+    fprintf(stderr, "ERROR: tipos incompatibles: un vector sólo se convierte a un vector del mismo tamaño (linea %d)\n", lineno);
+    codegen_errors++;
+    return LLVMGetUndef(dst); // El IR debe seguir siendo válido
+  }
+  return convert_value(v, src_unsigned, dst, dst_unsigned);
+}
 
-      const char *str = expr->value.strVal;
-      if (!str) {
-        //printf("[WARNING] strVal es NULL, usando cadena vacía\n");
-        str = "";
-      }
+// Un escalar repetido en todos los elementos: insertelement en el 0 y un shufflevector de ceros
+static LLVMValueRef vector_splat(LLVMValueRef v, int is_unsigned, LLVMTypeRef vector_type) {
+  v = convert_value(v, is_unsigned, LLVMGetElementType(vector_type), is_unsigned);
+  LLVMValueRef undef = LLVMGetUndef(vector_type);
+  LLVMValueRef first = LLVMBuildInsertElement(builder, undef, v, LLVMConstInt(i32_type, 0, 0), "splatinsert");
+  LLVMValueRef zeros = LLVMConstNull(LLVMVectorType(i32_type, LLVMGetVectorSize(vector_type)));
+  return LLVMBuildShuffleVector(builder, first, undef, zeros, "splat");
+}
 
-      // Crear cadena global constante
-      LLVMValueRef global_str = LLVMBuildGlobalStringPtr(builder, str, ".str");
-      //printf("[DEBUG] Cadena creada: %p\n", (void*)global_str);
+// Operandos de una operación con vectores: un escalar se repite; dos vectores deben ser del mismo tipo
+static int vector_operands(LLVMValueRef *lv, int *lu, LLVMValueRef *rv, int *ru) {
+  LLVMTypeRef lt = LLVMTypeOf(*lv), rt = LLVMTypeOf(*rv);
+  if (!is_vector_type(lt)) {
+    if (!is_int_type(lt) && !is_float_type(lt)) return 0;
+    *lv = vector_splat(*lv, *lu, rt);
+    *lu = *ru;
+  } else if (!is_vector_type(rt)) {
+    if (!is_int_type(rt) && !is_float_type(rt)) return 0;
+    *rv = vector_splat(*rv, *ru, lt);
+    *ru = *lu;
+  } else if (lt != rt) {
+    return 0;
+  }
+  return 1;
+}
 
-      return global_str;
-    }
+// Promoción entera: char, short y los i1 de las comparaciones pasan a int
+static LLVMValueRef promote_int(LLVMValueRef v, int *is_unsigned) {
+  LLVMTypeRef t = LLVMTypeOf(v);
+  if (is_int_type(t) && LLVMGetIntTypeWidth(t) < 32) {
+    v = convert_value(v, *is_unsigned, i32_type, 0);
+    *is_unsigned = 0;
+  }
+  return v;
+}
 
-    case NT_TERNARIO: { 
-      //       fprintf(stderr, "=== DEBUG: OPERADOR TERNARIO ===\n");
+// Conversiones aritméticas usuales: ambos operandos terminan con el mismo tipo y signo
+static void usual_arith_conversions(LLVMValueRef *lv, int *lu, LLVMValueRef *rv, int *ru) {
+  LLVMTypeRef lt = LLVMTypeOf(*lv);
+  LLVMTypeRef rt = LLVMTypeOf(*rv);
+
+  if (is_float_type(lt) || is_float_type(rt)) {
+    // El entero se convierte al tipo flotante del otro operando; entre float y double gana double
+    LLVMTypeRef target;
+    if (!is_float_type(lt)) target = rt;
+    else if (!is_float_type(rt)) target = lt;
+    else target = (LLVMGetTypeKind(lt) == LLVMDoubleTypeKind || LLVMGetTypeKind(rt) == LLVMDoubleTypeKind)
+                    ? LLVMDoubleType() : LLVMFloatType();
+    *lv = convert_value(*lv, *lu, target, 0);
+    *rv = convert_value(*rv, *ru, target, 0);
+    *lu = *ru = 0;
+    return;
+  }
+  if (!is_int_type(lt) || !is_int_type(rt)) {
+    return;
+  }
 
+  *lv = promote_int(*lv, lu);
+  *rv = promote_int(*rv, ru);
+  unsigned lw = LLVMGetIntTypeWidth(LLVMTypeOf(*lv));
+  unsigned rw = LLVMGetIntTypeWidth(LLVMTypeOf(*rv));
 
-      ast_node* cond_node = expr->child;
-      ast_node* then_node = expr->child->sibling;
-      ast_node* else_node = expr->child->sibling->sibling;
+  if (lw == rw) {
+    *lu = *ru = (*lu || *ru);
+  } else if (lw > rw) {
+    *rv = convert_value(*rv, *ru, LLVMTypeOf(*lv), *lu);
+    *ru = *lu;
+  } else {
+    *lv = convert_value(*lv, *lu, LLVMTypeOf(*rv), *ru);
+    *lu = *ru;
+  }
+}
 
+// Comparación escalar o elemento a elemento; el resultado es i1, o un vector de i1
+static LLVMValueRef build_compare(int op, LLVMValueRef lv, LLVMValueRef rv, int fp, int u) {
+  switch (op) {
+    case T_EQ:
+      return fp ? LLVMBuildFCmp(builder, LLVMRealOEQ, lv, rv, "eqtmp") : LLVMBuildICmp(builder, LLVMIntEQ, lv, rv, "eqtmp");
+    case T_NEQ:
+      return fp ? LLVMBuildFCmp(builder, LLVMRealUNE, lv, rv, "netmp") : LLVMBuildICmp(builder, LLVMIntNE, lv, rv, "netmp");
+    case T_LT:
+      if (fp) return LLVMBuildFCmp(builder, LLVMRealOLT, lv, rv, "cmptmp");
+      return LLVMBuildICmp(builder, u ? LLVMIntULT : LLVMIntSLT, lv, rv, "cmptmp");
+    case T_LE:
+      if (fp) return LLVMBuildFCmp(builder, LLVMRealOLE, lv, rv, "cmptmp");
+      return LLVMBuildICmp(builder, u ? LLVMIntULE : LLVMIntSLE, lv, rv, "cmptmp");
+    case T_GT:
+      if (fp) return LLVMBuildFCmp(builder, LLVMRealOGT, lv, rv, "cmptmp");
+      return LLVMBuildICmp(builder, u ? LLVMIntUGT : LLVMIntSGT, lv, rv, "cmptmp");
+    default: // T_GE
+      if (fp) return LLVMBuildFCmp(builder, LLVMRealOGE, lv, rv, "cmptmp");
+      return LLVMBuildICmp(builder, u ? LLVMIntUGE : LLVMIntSGE, lv, rv, "cmptmp");
+  }
+}
 
-      LLVMValueRef cond_value = codegen_expr(cond_node, current_fn);
-      if (!cond_value) return NULL;
+/*
+Emits a binary arithmetic, bitwise or comparison operator after the
+usual arithmetic conversions. Signedness picks sdiv/udiv, srem/urem,
+ashr/lshr and signed/unsigned comparisons; floats use the f* forms.
+Comparisons return i1. With a vector operand the operator applies to
+each element and a scalar operand is repeated in all of them; as in gcc
+a comparison gives a vector of signed integers as wide as the elements,
+-1 where it holds and 0 where it does not.
+*/
+static LLVMValueRef build_binary(int op, LLVMValueRef lv, int lu, LLVMValueRef rv, int ru, int *is_unsigned) {
+  *is_unsigned = 0;
+  if (!lv || !rv) {
+    return NULL;
+  }
 
+  int vec = is_vector_type(LLVMTypeOf(lv)) || is_vector_type(LLVMTypeOf(rv));
+  if (vec) {
+    if (!vector_operands(&lv, &lu, &rv, &ru)) return NULL;
+    if (op != T_LSHIFT && op != T_RSHIFT) lu = lu || ru;
+  } else if (op == T_LSHIFT || op == T_RSHIFT) {
+    // El tipo del resultado es el del operando izquierdo promovido
+    lv = promote_int(lv, &lu);
+    rv = promote_int(rv, &ru);
+    if (!is_int_type(LLVMTypeOf(lv)) || !is_int_type(LLVMTypeOf(rv))) return NULL;
+    rv = convert_value(rv, ru, LLVMTypeOf(lv), lu);
+  } else {
+    usual_arith_conversions(&lv, &lu, &rv, &ru);
+  }
+  LLVMTypeRef elem = scalar_type(LLVMTypeOf(lv));
+  int fp = is_float_type(elem);
+  int u = lu;
+
+  switch (op) {
+    // El desbordamiento con signo es indefinido en C: nsw permite ensanchar índices y vectorizar
+    case T_PLUS:
+      *is_unsigned = u;
+      if (fp) return LLVMBuildFAdd(builder, lv, rv, "addtmp");
+      return u ? LLVMBuildAdd(builder, lv, rv, "addtmp") : LLVMBuildNSWAdd(builder, lv, rv, "addtmp");
+    case T_MINUS:
+      *is_unsigned = u;
+      if (fp) return LLVMBuildFSub(builder, lv, rv, "subtmp");
+      return u ? LLVMBuildSub(builder, lv, rv, "subtmp") : LLVMBuildNSWSub(builder, lv, rv, "subtmp");
+    case T_STAR:
+      *is_unsigned = u;
+      if (fp) return LLVMBuildFMul(builder, lv, rv, "multmp");
+      return u ? LLVMBuildMul(builder, lv, rv, "multmp") : LLVMBuildNSWMul(builder, lv, rv, "multmp");
+    case T_SLASH:
+      *is_unsigned = u;
+      if (fp) return LLVMBuildFDiv(builder, lv, rv, "divtmp");
+      return u ? LLVMBuildUDiv(builder, lv, rv, "divtmp") : LLVMBuildSDiv(builder, lv, rv, "divtmp");
+    case T_PERCENT:
+      *is_unsigned = u;
+      if (fp) return LLVMBuildFRem(builder, lv, rv, "modtmp");
+      return u ? LLVMBuildURem(builder, lv, rv, "modtmp") : LLVMBuildSRem(builder, lv, rv, "modtmp");
+
+    case T_LSHIFT:
+    case T_RSHIFT:
+      if (fp) return NULL;
+      *is_unsigned = u;
+      if (op == T_LSHIFT) return LLVMBuildShl(builder, lv, rv, "shltmp");
+      return u ? LLVMBuildLShr(builder, lv, rv, "lshrtmp") : LLVMBuildAShr(builder, lv, rv, "ashrtmp");
+
+    case T_AMPERSAND: // & (AND bit a bit)
+      if (fp) return NULL;
+      *is_unsigned = u;
+      return LLVMBuildAnd(builder, lv, rv, "andtmp");
+    case T_PIPE:      // | (OR bit a bit)
+      if (fp) return NULL;
+      *is_unsigned = u;
+      return LLVMBuildOr(builder, lv, rv, "ortmp");
+    case T_CARET:     // ^ (XOR bit a bit)
+      if (fp) return NULL;
+      *is_unsigned = u;
+      return LLVMBuildXor(builder, lv, rv, "xortmp");
+
+    case T_EQ: case T_NEQ: case T_LT: case T_LE: case T_GT: case T_GE: {
+      LLVMValueRef cmp = build_compare(op, lv, rv, fp, u);
+      if (!vec) return cmp;
+      unsigned bits = fp ? (LLVMGetTypeKind(elem) == LLVMDoubleTypeKind ? 64 : 32) : LLVMGetIntTypeWidth(elem);
+      LLVMTypeRef mask = LLVMVectorType(LLVMIntType(bits), LLVMGetVectorSize(LLVMTypeOf(lv)));
+      return LLVMBuildSExt(builder, cmp, mask, "masktmp");
+    }
 
-      LLVMTypeRef cond_type = LLVMTypeOf(cond_value);
-      LLVMValueRef bool_cond;
+    default:
+      return NULL;
+  }
+}
 
-      if (LLVMGetTypeKind(cond_type) == LLVMIntegerTypeKind && 
-        LLVMGetIntTypeWidth(cond_type) == 1) {
-        bool_cond = cond_value;
-      } else {
+// Operador aritmético de una asignación compuesta (+= -> +)
+static int compound_base_op(int op) {
+  switch (op) {
+    case T_ASSIGN_PLUS:    return T_PLUS;
+    case T_ASSIGN_MINUS:   return T_MINUS;
+    case T_ASSIGN_STAR:    return T_STAR;
+    case T_ASSIGN_SLASH:   return T_SLASH;
+    case T_ASSIGN_PERCENT: return T_PERCENT;
+    case T_ASSIGN_LSHIFT:  return T_LSHIFT;
+    case T_ASSIGN_RSHIFT:  return T_RSHIFT;
+    case T_ASSIGN_AND:     return T_AMPERSAND;
+    case T_ASSIGN_OR:      return T_PIPE;
+    case T_ASSIGN_XOR:     return T_CARET;
+    default:               return 0;
+  }
+}
 
-        bool_cond = LLVMBuildICmp(builder, LLVMIntNE, cond_value, 
-                                  LLVMConstInt(LLVMInt32Type(), 0, 0), "ternary_cond");
-      }
 
+// =======================================================
+// ETIQUETAS
+// =======================================================
 
-      LLVMBasicBlockRef then_block = LLVMAppendBasicBlock(current_fn, "ternary_then");
-      LLVMBasicBlockRef else_block = LLVMAppendBasicBlock(current_fn, "ternary_else");
-      LLVMBasicBlockRef merge_block = LLVMAppendBasicBlock(current_fn, "ternary_merge");
+/*
+Labels of the function being generated. The block of a label is created
+the first time the label is named (by a goto, &&label or the label
+itself), so forward jumps need no second pass. GNU labels as values:
+&&label is the address of that block (blockaddress) as a long, since
+the language has no pointer types, and goto *expr is an indirectbr.
+Its possible destinations, every label whose address was taken, are
+only known once the whole function has been generated.
+*/
+typedef struct label_entry {
+  char *name;
+  LLVMBasicBlockRef block;
+  int defined;
+  int address_taken;
+  int lineno;
+  struct label_entry *next;
+} label_entry;
+
+static label_entry *label_table = NULL;
+static LLVMValueRef label_function = NULL;      /* función dueña de las etiquetas */
+static LLVMValueRef *indirect_branches = NULL;  /* los goto * de la función */
+static unsigned n_indirect_branches = 0, indirect_branches_cap = 0;
+
+static label_entry *label_get(const char *name, int lineno) {
+  for (label_entry *l = label_table; l; l = l->next) {
+    if (strcmp(l->name, name) == 0) return l;
+  }
+  label_entry *l = calloc(1, sizeof(label_entry));
+  l->name = strdup(name);
+  l->block = LLVMAppendBasicBlock(label_function, name);
+  l->lineno = lineno;
+  l->next = label_table;
+  label_table = l;
+  return l;
+}
 
+static void labels_begin(LLVMValueRef function) {
+  label_function = function;
+}
 
-      LLVMBuildCondBr(builder, bool_cond, then_block, else_block);
+static void labels_end(void) {
+  while (label_table) {
+    label_entry *l = label_table;
+    if (!l->defined) {
+      fprintf(stderr, "ERROR: la etiqueta '%s' no está definida (linea %d)\n", l->name, l->lineno);
+      codegen_errors++;
+      LLVMPositionBuilderAtEnd(builder, l->block); // El IR debe seguir siendo válido
+      LLVMBuildUnreachable(builder);
+    }
+    if (l->address_taken) {
+      for (unsigned i = 0; i < n_indirect_branches; i++) LLVMAddDestination(indirect_branches[i], l->block);
+    }
+    label_table = l->next;
+    free(l->name);
+    free(l);
+  }
+  n_indirect_branches = 0;
+  label_function = NULL;
+}
 
 
-      LLVMPositionBuilderAtEnd(builder, then_block);
-      LLVMValueRef then_value = codegen_expr(then_node, current_fn);
-      if (!then_value) return NULL;
-      LLVMBuildBr(builder, merge_block);
-      LLVMBasicBlockRef then_block_end = LLVMGetInsertBlock(builder);
 
+// =======================================================
+// EXPRESIONES
+// =======================================================
+static LLVMValueRef codegen_expr_sign(ast_node *expr, LLVMValueRef current_fn, int *is_unsigned);
+static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn);
+
+// El código muy anidado sigue en otro segmento de pila (ver stackguard.h)
+typedef struct deep_call {
+  ast_node *node;
+  LLVMValueRef current_fn;
+  int *is_unsigned;
+  LLVMBasicBlockRef true_bb, false_bb;
+  LLVMValueRef result;
+} deep_call;
+
+static void codegen_expr_deep(void *data) {
+  deep_call *call = data;
+  call->result = codegen_expr_sign(call->node, call->current_fn, call->is_unsigned);
+}
 
-      LLVMPositionBuilderAtEnd(builder, else_block);
-      LLVMValueRef else_value = codegen_expr(else_node, current_fn);
-      if (!else_value) return NULL;
-      LLVMBuildBr(builder, merge_block);
-      LLVMBasicBlockRef else_block_end = LLVMGetInsertBlock(builder);
+static void codegen_statement_deep(void *data) {
+  deep_call *call = data;
+  codegen_statement(call->node, call->current_fn);
+}
 
+static void codegen_cond_branch_deep(void *data) {
+  deep_call *call = data;
+  codegen_cond_branch(call->node, call->true_bb, call->false_bb, call->current_fn);
+}
 
-      LLVMPositionBuilderAtEnd(builder, merge_block);
+static LLVMValueRef codegen_expr(ast_node *expr, LLVMValueRef current_fn) {
+  int is_unsigned;
+  return codegen_expr_sign(expr, current_fn, &is_unsigned);
+}
 
+// En una expresión un arreglo se convierte en un puntero a su primer elemento
+static LLVMValueRef array_decay(LLVMValueRef ptr, LLVMTypeRef array_type) {
+  LLVMValueRef zero = LLVMConstInt(LLVMInt64Type(), 0, 0);
+  LLVMValueRef indices[2] = { zero, zero };
+  return LLVMBuildInBoundsGEP2(builder, array_type, ptr, indices, 2, "arraydecay");
+}
 
-      if (LLVMTypeOf(then_value) != LLVMTypeOf(else_value)) {
-        //         fprintf(stderr, "Error: tipos incompatibles en operador ternario\n");
-        return NULL;
-      }
+// Dirección de un lvalue junto con el tipo y signo del valor almacenado
+static LLVMValueRef codegen_lvalue(ast_node *lv, LLVMValueRef current_fn, LLVMTypeRef *type, int *is_unsigned) {
+  if (lv && lv->type == NT_ACCESO_ARRAY) { // a[i][j] -> getelementptr inbounds sobre el arreglo contenedor
+    ast_node *base = lv->child;
+    ast_node *index = base ? base->sibling : NULL;
+    LLVMTypeRef base_type;
+    LLVMValueRef base_ptr = codegen_lvalue(base, current_fn, &base_type, is_unsigned);
+    if (base_ptr && is_vector_type(base_type)) {
+      // v[i]: en memoria un vector está dispuesto como un arreglo de sus elementos
+      base_type = LLVMArrayType(LLVMGetElementType(base_type), LLVMGetVectorSize(base_type));
+      base_ptr = LLVMBuildBitCast(builder, base_ptr, LLVMPointerType(base_type, 0), "vecarray");
+    }
+    if (!base_ptr || !index || LLVMGetTypeKind(base_type) != LLVMArrayTypeKind) {
+      return NULL;
+    }
 
+    int iu;
+    LLVMValueRef idx = codegen_expr_sign(index, current_fn, &iu);
+    if (!idx || !is_int_type(LLVMTypeOf(idx))) {
+      return NULL;
+    }
+    // Índices de 64 bits, como en clang, para que el vectorizador vea una sola variable de inducción
+    idx = convert_value(idx, iu, LLVMInt64Type(), 0);
 
-      LLVMTypeRef result_type = LLVMTypeOf(then_value);
-      LLVMValueRef phi = LLVMBuildPhi(builder, result_type, "ternary_result");
+    LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt64Type(), 0, 0), idx };
+    *type = LLVMGetElementType(base_type);
+    return LLVMBuildInBoundsGEP2(builder, base_type, base_ptr, indices, 2, "arrayidx");
+  }
+  if (!lv || (lv->type != NT_ID && lv->type != NT_VAR)) {
+    return NULL;
+  }
+  sym_entry *e = sym_lookup(lv->value.strVal);
+  if (!e) {
+    //fprintf(stderr,"[codegen_lvalue] variable no declarada %s (linea %d)\n", lv->value.strVal, lv->lineno);
+    return NULL;
+  }
+  *type = e->type;
+  *is_unsigned = e->is_unsigned;
+  return e->alloc;
+}
 
-      LLVMValueRef phi_values[2] = {then_value, else_value};
-      LLVMBasicBlockRef phi_blocks[2] = {then_block_end, else_block_end};
-      LLVMAddIncoming(phi, phi_values, phi_blocks, 2);
+// (a + b)[i]: un elemento de un vector que no está en memoria, con extractelement
+static LLVMValueRef vector_element(ast_node *access, LLVMValueRef current_fn, int *is_unsigned) {
+  ast_node *base = access->child;
+  ast_node *index = base ? base->sibling : NULL;
+  // Las variables y los a[i] ya los intentó codegen_lvalue: no se evalúan dos veces
+  if (!base || !index || base->type == NT_ID || base->type == NT_VAR || base->type == NT_ACCESO_ARRAY) {
+    return NULL;
+  }
+  int iu;
+  LLVMValueRef v = codegen_expr_sign(base, current_fn, is_unsigned);
+  LLVMValueRef idx = v && is_vector_type(LLVMTypeOf(v)) ? codegen_expr_sign(index, current_fn, &iu) : NULL;
+  if (!idx || !is_int_type(LLVMTypeOf(idx))) {
+    return NULL;
+  }
+  return LLVMBuildExtractElement(builder, v, idx, "vecext");
+}
 
-      return phi;
-    }
-    case NT_OP_UNARIO: {
-      int op = expr->value.op;
-      //       fprintf(stderr, "[codegen_expr] OP_UNARIO token=%d (addr=%p)\n", op, (void*)expr);
+/*
+Shuffle builtins. __builtin_shufflevector(a, b, i0, i1, ...) is clang's:
+each index is an integer constant into the elements of a followed by
+those of b (-1: any value) and the result has one element per index.
+__builtin_shuffle(a, mask) and (a, b, mask) are gcc's: mask is an
+integer vector with as many elements as a, each taken modulo the number
+of elements to choose from. Both are a shufflevector when the indices
+are constants; otherwise each element is picked with extractelement.
+*/
+static LLVMValueRef codegen_shuffle(ast_node *call, LLVMValueRef current_fn, int *is_unsigned) {
+  ast_node *fnexpr = call->child;
+  int gcc = strcmp(fnexpr->value.strVal, "__builtin_shuffle") == 0;
+  ast_node *args[3] = { NULL, NULL, NULL };
+  int nargs = 0;
+  ast_node *t = fnexpr->sibling;
+  for (; t && nargs < 3; t = t->sibling) args[nargs++] = t;
+  if (nargs < 2 || (gcc && t)) {
+    fprintf(stderr, "ERROR: número de argumentos incorrecto para %s (linea %d)\n", fnexpr->value.strVal, call->lineno);
+    codegen_errors++;
+    return NULL;
+  }
 
-      ast_node *operand = expr->child;
-      if (!operand) {
-        //         fprintf(stderr, "[codegen_expr] ERROR: operando unario inválido\n");
+  int two = !gcc || nargs == 3; // Se elige entre los elementos de a y b
+  int bu;
+  LLVMValueRef a = codegen_expr_sign(args[0], current_fn, is_unsigned);
+  LLVMValueRef b = two ? codegen_expr_sign(args[1], current_fn, &bu) : NULL;
+  if (!a || !is_vector_type(LLVMTypeOf(a)) || (two && (!b || LLVMTypeOf(b) != LLVMTypeOf(a)))) {
+    fprintf(stderr, "ERROR: %s necesita vectores del mismo tipo (linea %d)\n", fnexpr->value.strVal, call->lineno);
+    codegen_errors++;
+    return NULL;
+  }
+  LLVMTypeRef type = LLVMTypeOf(a);
+  unsigned n = LLVMGetVectorSize(type);
+  unsigned total = two ? 2 * n : n;
+
+  if (!gcc) {
+    unsigned count = 0;
+    for (ast_node *i = args[1]->sibling; i; i = i->sibling) count++;
+    LLVMValueRef *mask = malloc(sizeof(LLVMValueRef) * (count > 0 ? count : 1));
+    unsigned k = 0;
+    for (ast_node *i = args[1]->sibling; i; i = i->sibling, k++) {
+      if (i->type != NT_ENTERO || i->value.lit.value < -1 || i->value.lit.value >= (long long)total) {
+        fprintf(stderr, "ERROR: los índices de __builtin_shufflevector son constantes entre -1 y %u (linea %d)\n",
+                total - 1, i->lineno);
+        codegen_errors++;
+        free(mask);
         return NULL;
       }
+      mask[k] = i->value.lit.value < 0 ? LLVMGetUndef(i32_type) : LLVMConstInt(i32_type, i->value.lit.value, 0);
+    }
+    LLVMValueRef result = count > 0 ? LLVMBuildShuffleVector(builder, a, b, LLVMConstVector(mask, count), "shuffle") : NULL;
+    free(mask);
+    return result;
+  }
 
-      //       fprintf(stderr, "[codegen_expr] Operando type=%d\n", operand->type);
-
-      if (op == 323) { // ++ (incremento)
-        //         fprintf(stderr, "[codegen_expr] INCREMENTO ++ INICIADO\n");
+  int mu;
+  LLVMValueRef m = codegen_expr_sign(args[nargs - 1], current_fn, &mu);
+  if (!m || !is_vector_type(LLVMTypeOf(m)) || !is_int_type(LLVMGetElementType(LLVMTypeOf(m))) ||
+      LLVMGetVectorSize(LLVMTypeOf(m)) != n) {
+    fprintf(stderr, "ERROR: la máscara de __builtin_shuffle es un vector de enteros con %u elementos (linea %d)\n", n,
+            call->lineno);
+    codegen_errors++;
+    return NULL;
+  }
+  if (!two) b = LLVMGetUndef(type);
+
+  LLVMValueRef *mask = malloc(sizeof(LLVMValueRef) * n);
+  int constant = 1;
+  for (unsigned i = 0; i < n && constant; i++) {
+    LLVMValueRef k = LLVMIsConstant(m) ? LLVMConstExtractElement(m, LLVMConstInt(i32_type, i, 0)) : NULL;
+    constant = k && LLVMIsAConstantInt(k);
+    if (constant) mask[i] = LLVMConstInt(i32_type, LLVMConstIntGetZExtValue(k) % total, 0);
+  }
+  LLVMValueRef result;
+  if (constant) {
+    result = LLVMBuildShuffleVector(builder, a, b, LLVMConstVector(mask, n), "shuffle");
+  } else {
+    // Con dos vectores se elige de su concatenación
+    LLVMValueRef source = a;
+    if (two) {
+      LLVMValueRef *all = malloc(sizeof(LLVMValueRef) * total);
+      for (unsigned i = 0; i < total; i++) all[i] = LLVMConstInt(i32_type, i, 0);
+      source = LLVMBuildShuffleVector(builder, a, b, LLVMConstVector(all, total), "concat");
+      free(all);
+    }
+    LLVMTypeRef mask_elem = LLVMGetElementType(LLVMTypeOf(m));
+    result = LLVMGetUndef(type);
+    for (unsigned i = 0; i < n; i++) {
+      LLVMValueRef lane = LLVMConstInt(i32_type, i, 0);
+      LLVMValueRef k = LLVMBuildExtractElement(builder, m, lane, "shufidx");
+      k = LLVMBuildURem(builder, k, LLVMConstInt(mask_elem, total, 0), "shufidx");
+      LLVMValueRef elem = LLVMBuildExtractElement(builder, source, k, "shufelt");
+      result = LLVMBuildInsertElement(builder, result, elem, lane, "shuffle");
+    }
+  }
+  free(mask);
+  return result;
+}
 
-        const char *name = operand->value.strVal;
-        //         fprintf(stderr, "[codegen_expr] Variable: %s\n", name);
-
-        LLVMValueRef dest = sym_get(name);
-        if (!dest) {
-          //           fprintf(stderr, "[codegen_expr] ERROR: variable no declarada '%s'\n", name);
-          return NULL;
-        }
-
-
-        LLVMValueRef current = safe_load(dest, "loadtmp");
-        if (!current) {
-          //           fprintf(stderr, "[codegen_expr] ERROR: no se pudo cargar valor\n");
-          return NULL;
-        }
-
-        //         fprintf(stderr, "[codegen_expr] Valor actual cargado: %p\n", (void*)current);
+// =, +=, -=, ... : el resultado se convierte al tipo de la variable antes de guardarse
+static LLVMValueRef codegen_assign(ast_node *expr, LLVMValueRef current_fn, int *is_unsigned) {
+  ast_node *L = expr->child;
+  ast_node *R = L ? L->sibling : NULL;
+  int op = expr->value.op;
 
+  LLVMTypeRef var_type;
+  int var_unsigned;
+  LLVMValueRef dest = codegen_lvalue(L, current_fn, &var_type, &var_unsigned);
+  if (!dest) {
+    return NULL;
+  }
 
-        LLVMValueRef one = LLVMConstInt(i32_type, 1, 0);
-        LLVMValueRef result = LLVMBuildAdd(builder, current, one, "inctmp");
+  int ru;
+  LLVMValueRef rv = codegen_expr_sign(R, current_fn, &ru);
+  if (!rv) {
+    return NULL;
+  }
 
-        //         fprintf(stderr, "[codegen_expr] Resultado del incremento: %p\n", (void*)result);
+  LLVMValueRef result = rv;
+  int result_unsigned = ru;
+  if (op != T_ASSIGN) {
+    LLVMValueRef current = LLVMBuildLoad2(builder, var_type, dest, "loadtmp");
+    result = build_binary(compound_base_op(op), current, var_unsigned, rv, ru, &result_unsigned);
+    if (!result) {
+      return NULL;
+    }
+  }
 
+  result = convert_checked(result, result_unsigned, var_type, var_unsigned, expr->lineno);
+  LLVMBuildStore(builder, result, dest);
+  *is_unsigned = var_unsigned;
+  return result;
+}
 
-        LLVMBuildStore(builder, result, dest);
-        //         fprintf(stderr, "[codegen_expr] Nuevo valor guardado\n");
+// =======================================================
+// LITERALES
+// =======================================================
 
+/*
+Per-module pool of string literals: identical strings share a single
+private unnamed_addr constant, so a format repeated all over a program
+is emitted once. The pool is keyed by the decoded bytes, so "A" and
+"\x41" are the same literal. In front of it, a table keyed by the
+source spelling keeps each spelling's decoded bytes: a literal seen
+before is found without decoding its escapes again.
+*/
+#define LITERAL_POOL_SIZE 256
+
+typedef struct literal_entry {
+  char *bytes;         // Decodificado, con el NUL final
+  int len;             // Sin el NUL
+  LLVMValueRef global; // [len + 1 x i8]
+  struct literal_entry *next;
+} literal_entry;
+
+static literal_entry *literal_pool[LITERAL_POOL_SIZE];
+
+static literal_entry *literal_intern(const char *bytes, int len) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < len; i++) h = (h ^ (unsigned char)bytes[i]) * 16777619u;
+  literal_entry **bucket = &literal_pool[h % LITERAL_POOL_SIZE];
+  for (literal_entry *e = *bucket; e; e = e->next) {
+    if (e->len == len && memcmp(e->bytes, bytes, len) == 0) return e;
+  }
 
-        //         fprintf(stderr, "[codegen_expr] INCREMENTO ++ COMPLETADO, retornando: %p\n", (void*)result);
-        return result;
-      }
+  literal_entry *e = malloc(sizeof(literal_entry));
+  e->bytes = malloc(len + 1);
+  memcpy(e->bytes, bytes, len);
+  e->bytes[len] = '\0';
+  e->len = len;
+  e->global = LLVMAddGlobal(module, LLVMArrayType(i8_type, len + 1), ".str");
+  LLVMSetInitializer(e->global, LLVMConstString(bytes, len, 0));
+  LLVMSetLinkage(e->global, LLVMPrivateLinkage);
+  LLVMSetGlobalConstant(e->global, 1);
+  LLVMSetUnnamedAddress(e->global, LLVMGlobalUnnamedAddr);
+  LLVMSetAlignment(e->global, 1);
+  e->next = *bucket;
+  *bucket = e;
+  return e;
+}
 
-      if (op == 324) { // -- (decremento)
-        //         fprintf(stderr, "[codegen_expr] DECREMENTO -- INICIADO\n");
+typedef struct spelling_entry {
+  char *raw;               // Como en la fuente, sin decodificar
+  int raw_len;
+  char *bytes;             // Decodificado, con el NUL final
+  int len;
+  literal_entry *literal;  // NULL hasta que hace falta la constante
+  struct spelling_entry *next;
+} spelling_entry;
+
+static spelling_entry *spelling_pool[LITERAL_POOL_SIZE];
+
+// The NT_CADENA's entry by its span of the source; its escapes are decoded only the first time
+static spelling_entry *string_spelling(ast_node *node) {
+  lit_span span = node->value.span;
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < span.len; i++) h = (h ^ (unsigned char)span.ptr[i]) * 16777619u;
+  spelling_entry **bucket = &spelling_pool[h % LITERAL_POOL_SIZE];
+  for (spelling_entry *e = *bucket; e; e = e->next) {
+    if (e->raw_len == span.len && memcmp(e->raw, span.ptr, span.len) == 0) return e;
+  }
 
-        const char *name = operand->value.strVal;
-        //         fprintf(stderr, "[codegen_expr] Variable: %s\n", name);
+  spelling_entry *e = malloc(sizeof(spelling_entry));
+  e->raw = malloc(span.len + 1);
+  memcpy(e->raw, span.ptr, span.len);
+  e->raw_len = span.len;
+  e->bytes = malloc(span.len + 1);
+  e->len = decode_literal(span.ptr, span.len, e->bytes);
+  e->literal = NULL;
+  e->next = *bucket;
+  *bucket = e;
+  return e;
+}
 
-        LLVMValueRef dest = sym_get(name);
-        if (!dest) {
-          //           fprintf(stderr, "[codegen_expr] ERROR: variable no declarada '%s'\n", name);
-          return NULL;
-        }
+// Decoded bytes of an NT_CADENA, owned by the pool
+static const char *string_literal_bytes(ast_node *node, int *len) {
+  spelling_entry *e = string_spelling(node);
+  *len = e->len;
+  return e->bytes;
+}
 
-        LLVMValueRef current = safe_load(dest, "loadtmp");
-        if (!current) {
-          //           fprintf(stderr, "[codegen_expr] ERROR: no se pudo cargar valor\n");
-          return NULL;
-        }
+static literal_entry *string_literal(ast_node *node) {
+  spelling_entry *e = string_spelling(node);
+  if (!e->literal) e->literal = literal_intern(e->bytes, e->len);
+  return e->literal;
+}
 
-        //         fprintf(stderr, "[codegen_expr] Valor actual cargado: %p\n", (void*)current);
+// char* al primer carácter del literal
+static LLVMValueRef literal_pointer(literal_entry *e) {
+  LLVMValueRef zero = LLVMConstInt(LLVMInt64Type(), 0, 0);
+  LLVMValueRef idx[2] = { zero, zero };
+  return LLVMConstInBoundsGEP2(LLVMArrayType(i8_type, e->len + 1), e->global, idx, 2);
+}
 
+static void literal_pool_clear(void) {
+  for (int i = 0; i < LITERAL_POOL_SIZE; i++) {
+    while (literal_pool[i]) {
+      literal_entry *next = literal_pool[i]->next;
+      free(literal_pool[i]->bytes);
+      free(literal_pool[i]);
+      literal_pool[i] = next;
+    }
+    while (spelling_pool[i]) {
+      spelling_entry *next = spelling_pool[i]->next;
+      free(spelling_pool[i]->raw);
+      free(spelling_pool[i]->bytes);
+      free(spelling_pool[i]);
+      spelling_pool[i] = next;
+    }
+  }
+}
 
-        LLVMValueRef one = LLVMConstInt(i32_type, 1, 0);
-        LLVMValueRef result = LLVMBuildSub(builder, current, one, "subtmp");
+// =======================================================
+// PRINTF
+// =======================================================
 
-        //         fprintf(stderr, "[codegen_expr] Resultado del decremento: %p\n", (void*)result);
+// Un trozo de un formato de printf ya analizado
+typedef struct printf_piece {
+  char conv;        // 0 = texto literal; si no 'd', 'u', 'x', 'X', 'c' o 's'
+  int bits;         // Ancho del argumento entero: 8 (hh), 16 (h), 32, 64 (l, ll, z, j)
+  const char *text; // Texto literal y su longitud
+  size_t len;
+} printf_piece;
+
+/*
+Splits a format into literal runs and conversions. Only conversions
+without flags, width or precision are specialized: %d %i %u %x %X %c
+%s and %%, with the hh, h, l, ll, z and j length modifiers. Returns the
+number of pieces, or -1 if the format needs the general printf.
+*/
+static int parse_printf_format(const char *fmt, printf_piece *pieces, int max_pieces) {
+  int n = 0;
+  const char *lit = fmt;
+  const char *p = fmt;
+  while (*p) {
+    if (*p != '%') {
+      p++;
+      continue;
+    }
+    if (p[1] == '%') { // %% sigue el texto literal con un solo %
+      if (n + 2 > max_pieces) return -1;
+      pieces[n++] = (printf_piece){ 0, 0, lit, (size_t)(p + 1 - lit) };
+      p += 2;
+      lit = p;
+      continue;
+    }
+    if (p > lit) {
+      if (n == max_pieces) return -1;
+      pieces[n++] = (printf_piece){ 0, 0, lit, (size_t)(p - lit) };
+    }
+    p++;
+    int bits = 32;
+    if (p[0] == 'h' && p[1] == 'h') { bits = 8; p += 2; }
+    else if (p[0] == 'h') { bits = 16; p++; }
+    else if (p[0] == 'l' && p[1] == 'l') { bits = 64; p += 2; }
+    else if (p[0] == 'l' || p[0] == 'z' || p[0] == 'j') { bits = 64; p++; }
+
+    char conv = *p;
+    if (conv == 'i') conv = 'd';
+    if (!strchr("duxXcs", conv) || conv == '\0' || ((conv == 'c' || conv == 's') && bits != 32)) {
+      return -1; // Banderas, ancho, precisión, flotantes, %p, %n...
+    }
+    if (n == max_pieces) return -1;
+    pieces[n++] = (printf_piece){ conv, bits, NULL, 0 };
+    p++;
+    lit = p;
+  }
+  if (p > lit) {
+    if (n == max_pieces) return -1;
+    pieces[n++] = (printf_piece){ 0, 0, lit, (size_t)(p - lit) };
+  }
+  return n;
+}
 
+/*
+The freestanding runtime formats with its own vsnprintf (format.c),
+which knows %d %i %u %o %x %X %c %s %p %f %F and %% but neither %e, %g
+nor %a: any other conversion in a constant format is an error, since it
+would print the conversion itself and shift the remaining arguments.
+*/
+static void check_freestanding_format(const char *fmt, int lineno) {
+  for (const char *p = fmt; (p = strchr(p, '%')) != NULL;) {
+    p++;
+    p += strspn(p, "-+ #0");
+    if (*p == '*') p++;
+    p += strspn(p, "0123456789");
+    if (*p == '.') {
+      p++;
+      if (*p == '*') p++;
+      p += strspn(p, "0123456789");
+    }
+    p += strspn(p, "hlzjtL");
+    if (*p == '\0') break;
+    if (!strchr("diuoxXpcsfF%", *p)) {
+      fprintf(stderr, "ERROR: printf: %%%c no existe en el runtime de -ffreestanding-runtime (linea %d)\n", *p, lineno);
+      codegen_errors++;
+    }
+    p++;
+  }
+}
 
-        LLVMBuildStore(builder, result, dest);
-        //         fprintf(stderr, "[codegen_expr] Nuevo valor guardado\n");
+/*
+Lowers printf with a constant format string to direct runtime calls:
+literal text becomes a single buffered write of known length, integers
+are converted by the runtime without parsing anything at run time and
+%s copies the string. Returns the number of bytes written, or NULL if
+the format or the argument types need the general printf.
+*/
+static LLVMValueRef codegen_printf_specialized(const char *fmt, LLVMValueRef *args, int *args_unsigned, int nargs) {
+  int max_pieces = (int)strlen(fmt) + 1;
+  printf_piece *pieces = malloc(max_pieces * sizeof(printf_piece));
+  int npieces = parse_printf_format(fmt, pieces, max_pieces);
+
+  // Cada conversión necesita su argumento y del tipo adecuado
+  int ok = npieces >= 0;
+  int arg = 0;
+  for (int i = 0; ok && i < npieces; i++) {
+    if (!pieces[i].conv) continue;
+    if (arg == nargs) {
+      ok = 0;
+      break;
+    }
+    LLVMTypeRef t = LLVMTypeOf(args[arg++]);
+    ok = pieces[i].conv == 's' ? LLVMGetTypeKind(t) == LLVMPointerTypeKind : is_int_type(t);
+  }
+  if (!ok) {
+    free(pieces);
+    return NULL;
+  }
 
+  // Varias llamadas van bajo el candado de stdout para que otro hilo no escriba entre ellas
+  int ncalls = 0;
+  for (int i = 0; i < npieces; i++) {
+    if (pieces[i].conv || pieces[i].len > 0) ncalls++;
+  }
+  if (ncalls > 1) {
+    build_external_call(external_function("__freezepiler_print_lock", LLVMVoidType(), NULL, 0, 0), NULL, 0);
+  }
 
-        //         fprintf(stderr, "[codegen_expr] DECREMENTO -- COMPLETADO, retornando: %p\n", (void*)result);
-        return result;
+  LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMValueRef total = LLVMConstInt(i32_type, 0, 0);
+  arg = 0;
+  for (int i = 0; i < npieces; i++) {
+    printf_piece *pc = &pieces[i];
+    LLVMValueRef written;
+    if (!pc->conv) {
+      if (pc->len == 0) continue;
+      LLVMTypeRef params[2] = { i8p, i32_type };
+      LLVMValueRef call_args[2] = { literal_pointer(literal_intern(pc->text, pc->len)), LLVMConstInt(i32_type, pc->len, 0) };
+      written = build_external_call(external_function("__freezepiler_write", i32_type, params, 2, 0), call_args, 2);
+    } else if (pc->conv == 's') {
+      LLVMValueRef str = LLVMBuildPointerCast(builder, args[arg++], i8p, "");
+      written = build_external_call(external_function("__freezepiler_puts", i32_type, &i8p, 1, 0), &str, 1);
+    } else if (pc->conv == 'c') {
+      LLVMValueRef c = convert_value(args[arg], args_unsigned[arg], i32_type, 0);
+      arg++;
+      written = build_external_call(external_function("__freezepiler_putchar", i32_type, &i32_type, 1, 0), &c, 1);
+    } else {
+      // Como printf, el valor se reinterpreta con el ancho y el signo de la conversión
+      int is_signed = pc->conv == 'd';
+      LLVMValueRef v = convert_value(args[arg], args_unsigned[arg], LLVMIntType(pc->bits), !is_signed);
+      arg++;
+      v = is_signed ? LLVMBuildSExt(builder, v, i64, "") : LLVMBuildZExt(builder, v, i64, "");
+      if (pc->conv == 'x' || pc->conv == 'X') {
+        LLVMTypeRef params[2] = { i64, i32_type };
+        LLVMValueRef call_args[2] = { v, LLVMConstInt(i32_type, pc->conv == 'X', 0) };
+        written = build_external_call(external_function("__freezepiler_write_hex", i32_type, params, 2, 0), call_args, 2);
+      } else {
+        const char *fn = is_signed ? "__freezepiler_write_i64" : "__freezepiler_write_u64";
+        written = build_external_call(external_function(fn, i32_type, &i64, 1, 0), &v, 1);
       }
+    }
+    total = LLVMBuildAdd(builder, total, written, "printed");
+  }
+  if (ncalls > 1) {
+    build_external_call(external_function("__freezepiler_print_unlock", LLVMVoidType(), NULL, 0, 0), NULL, 0);
+  }
 
+  free(pieces);
+  return total;
+}
 
-      else if (op == 336) { // NOT
-        LLVMValueRef result = NULL;
-
-        LLVMValueRef operand = codegen_expr(expr->child, current_fn);
-
-
-        LLVMTypeRef operand_type = LLVMTypeOf(operand);
-        LLVMValueRef operand_i32;
-
-        if (LLVMGetTypeKind(operand_type) == LLVMIntegerTypeKind && 
-          LLVMGetIntTypeWidth(operand_type) == 1) {
-
-          operand_i32 = LLVMBuildZExt(builder, operand, LLVMInt32Type(), "operand_i32");
-        } else {
-
-          operand_i32 = operand;
-        }
-
-
-        LLVMValueRef is_true = LLVMBuildICmp(builder, LLVMIntNE, operand_i32, 
-                                             LLVMConstInt(LLVMInt32Type(), 0, 0), "is_true");
-
+/*
+printf never reaches libc's printf: constant formats are specialized,
+and the rest goes through __freezepiler_printf, which formats with
+vsnprintf and writes to the same stdout so the output keeps its order.
+As in any call, every argument is evaluated before anything is written.
+*/
+static LLVMValueRef codegen_printf(ast_node *args, LLVMValueRef current_fn, int *is_unsigned) {
+  *is_unsigned = 0;
+  int nargs = 0;
+  for (ast_node *t = args; t; t = t->sibling) nargs++;
+  if (nargs == 0) {
+    fprintf(stderr, "ERROR: printf necesita un formato (linea %d)\n", args ? args->lineno : 0);
+    codegen_errors++;
+    return NULL;
+  }
 
-        LLVMValueRef not_bool = LLVMBuildICmp(builder, LLVMIntEQ, is_true, 
-                                              LLVMConstInt(LLVMInt1Type(), 0, 0), "not_bool");
+  LLVMValueRef *vals = malloc(nargs * sizeof(LLVMValueRef));
+  int *vals_unsigned = malloc(nargs * sizeof(int));
+  // El formato constante sólo llega al pool si hace falta el printf general
+  int fmt_len = 0;
+  const char *fmt = args->type == NT_CADENA ? string_literal_bytes(args, &fmt_len) : NULL;
+  int i = 0;
+  for (ast_node *t = args; t; t = t->sibling, i++) {
+    if (i == 0 && fmt) {
+      vals[0] = NULL;
+      vals_unsigned[0] = 0;
+      continue;
+    }
+    vals[i] = codegen_expr_sign(t, current_fn, &vals_unsigned[i]);
+    if (vals[i] && is_vector_type(LLVMTypeOf(vals[i]))) {
+      fprintf(stderr, "ERROR: printf no imprime vectores, sólo sus elementos (linea %d)\n", t->lineno);
+      codegen_errors++;
+      vals[i] = NULL;
+    }
+    if (!vals[i]) {
+      free(vals);
+      free(vals_unsigned);
+      return NULL;
+    }
+  }
 
-        result = LLVMBuildZExt(builder, not_bool, LLVMInt32Type(), "not_result");
-        return result;
+  LLVMValueRef result = NULL;
+  if (fmt && freestanding_runtime) check_freestanding_format(fmt, args->lineno);
+  if (fmt) {
+    result = codegen_printf_specialized(fmt, vals + 1, vals_unsigned + 1, nargs - 1);
+    if (!result) vals[0] = literal_pointer(string_literal(args));
+  }
+  if (!result) {
+    // Promociones por defecto de los argumentos variádicos
+    for (i = 1; i < nargs; i++) {
+      if (LLVMGetTypeKind(LLVMTypeOf(vals[i])) == LLVMFloatTypeKind) {
+        vals[i] = LLVMBuildFPExt(builder, vals[i], LLVMDoubleType(), "fpexttmp");
+      } else if (is_int_type(LLVMTypeOf(vals[i]))) {
+        vals[i] = promote_int(vals[i], &vals_unsigned[i]);
       }
+    }
+    LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+    LLVMValueRef fn = external_function("__freezepiler_printf", i32_type, &i8p, 1, 1);
+    result = LLVMBuildCall2(builder, LLVMGlobalGetValueType(fn), fn, vals, nargs, "calltmp");
+  }
+  free(vals);
+  free(vals_unsigned);
+  return result;
+}
 
-      else if (op == 337) { // ~
-
-        LLVMValueRef operand = codegen_expr(expr->child, current_fn);
-        if (!operand) return NULL;
-
+// Operador binario que se evalúa como operandos + build_binary (sin asignación ni corto circuito)
+static int is_plain_binary(ast_node *expr) {
+  if (expr->type != NT_OP_BINARIO || !expr->child || !expr->child->sibling) return 0;
+  int op = expr->value.op;
+  return op != T_ASSIGN && compound_base_op(op) == 0 && op != T_AND && op != T_OR;
+}
 
-        LLVMTypeRef int32_type = LLVMInt32Type();
-        LLVMValueRef minus_one = LLVMConstInt(int32_type, -1, 1); // 1 = signed
+static LLVMValueRef codegen_expr_sign(ast_node *expr, LLVMValueRef current_fn, int *is_unsigned) {
+  *is_unsigned = 0;
+  if (!expr) {
+    return NULL;
+  }
+  if (stack_low()) {
+    deep_call call = { expr, current_fn, is_unsigned, NULL, NULL, NULL };
+    stack_extend(codegen_expr_deep, &call);
+    return call.result;
+  }
+  debug_set_location(expr);
+  switch (expr->type) {
+    case NT_ENTERO: {
+      int_lit lit = expr->value.lit;
+      *is_unsigned = lit.is_unsigned;
+      return LLVMConstInt(lit.is_long ? LLVMInt64Type() : i32_type, (unsigned long long)lit.value, !lit.is_unsigned);
+    }
 
-        return LLVMBuildXor(builder, operand, minus_one, "bitwise_not");
+    case NT_FLOTANTE:
+      return LLVMConstReal(f64_type, expr->value.floatVal);
+
+    case NT_CARACTER: { // En C una constante de carácter es un int
+      lit_span span = expr->value.span;
+      char small[16];
+      char *buf = span.len < (int)sizeof(small) ? small : malloc(span.len + 1);
+      int len = decode_literal(span.ptr, span.len, buf);
+      // 'ab' (multicarácter) vale como en gcc: los bytes en orden, el último en el byte bajo
+      int value = len == 1 ? (signed char)buf[0] : 0;
+      for (int i = 0; len > 1 && i < len; i++) value = (int)((unsigned)value << 8 | (unsigned char)buf[i]);
+      if (buf != small) free(buf);
+      return LLVMConstInt(i32_type, (unsigned)value, 1);
+    }
+    case NT_ID:
+    case NT_VAR: {
+      const char *name = expr->value.strVal;
+      if (!name) {
+        return NULL;
       }
-
-      else if (op == 319 || op == 340) { // T_UMINUS (operador unario negativo) - AMBOS TOKENS
-        //         fprintf(stderr, "[codegen_expr] OPERADOR UNARIO NEGATIVO\n");
-
-        LLVMValueRef operand_val = codegen_expr(operand, current_fn);
-        if (!operand_val) {
-          //           fprintf(stderr, "[codegen_expr] ERROR: no se pudo generar operando\n");
-          return NULL;
-        }
-
-        // Negar el valor
-        LLVMValueRef result = LLVMBuildNeg(builder, operand_val, "negtmp");
-        //         fprintf(stderr, "[codegen_expr] NEGACIÓN COMPLETADA: %p\n", (void*)result);
-        return result;
+      sym_entry *e = sym_lookup(name);
+      if (!e) {
+        //fprintf(stderr, "[codegen_expr] error: uso de identificador no declarado '%s' (linea %d)\n", name, expr->lineno);
+        return NULL;
       }
-
-      //       fprintf(stderr, "[codegen_expr] op unario no soportado %d\n", op);
-      return NULL;
+      *is_unsigned = e->is_unsigned;
+      if (LLVMGetTypeKind(e->type) == LLVMArrayTypeKind) {
+        return array_decay(e->alloc, e->type);
+      }
+      return LLVMBuildLoad2(builder, e->type, e->alloc, name);
     }
 
-
-    case NT_OP_BINARIO: {
-      int op = expr->value.op;
-      //       fprintf(stderr, "[codegen_expr] OP_BINARIO token=%d (addr=%p)\n", op, (void*)expr);
-      ast_node *L = expr->child;
-      ast_node *R = L ? L->sibling : NULL;
-      if (!L || !R) { 
-        //fprintf(stderr,"[codegen_expr] ERROR: subexpresión inválida (linea %d) L=%p R=%p\n", expr->lineno, (void*)L, (void*)R); 
-        return NULL; }
-
-      if (op == 307) { // assign =
-        const char *name = NULL;
-        if (L->type == NT_ID || L->type == NT_VAR) name = L->value.strVal;
-        if (!name) { 
-          //fprintf(stderr,"[codegen_expr] assign: LHS inválido (linea %d)\n", expr->lineno); 
-          return NULL; }
-        LLVMValueRef dest = sym_get(name);
-        if (!dest) { 
-          //fprintf(stderr,"[codegen_expr] assign: variable no declarada %s (linea %d)\n", name, expr->lineno); 
-          return NULL; }
-        LLVMValueRef rv = codegen_expr(R, current_fn);
-        if (!rv) { 
-          //fprintf(stderr,"[codegen_expr] assign: RHS produjo NULL (linea %d)\n", expr->lineno); 
-          return NULL; }
-        LLVMBuildStore(builder, rv, dest);
-        //         fprintf(stderr, "[codegen_expr] asignación store OK dest=%p val=%p\n", (void*)dest, (void*)rv);
-        return rv;
-      }
-      if (op == 308) { // += 
-        const char *name = (L->type==NT_ID||L->type==NT_VAR)?L->value.strVal:NULL;
-        if (!name) { 
-          //fprintf(stderr,"[codegen_expr] assignAdd: LHS inválido\n"); 
-          return NULL; }
-        LLVMValueRef dest = sym_get(name);
-        if (!dest) { 
-          //fprintf(stderr,"[codegen_expr] assignAdd: variable no declarada %s\n", name); 
-          return NULL; }
-        LLVMValueRef lv = safe_load(dest, "loadtmp");
-        if (!lv) { 
-          //fprintf(stderr, "[codegen_expr] assignAdd: load failed\n"); 
-          return NULL; }
-        LLVMValueRef rv = codegen_expr(R, current_fn);
-        if (!rv) { 
-          //fprintf(stderr,"[codegen_expr] assignAdd: RHS null\n"); 
-          return NULL; }
-        LLVMValueRef result = LLVMBuildAdd(builder, lv, rv, "addtmp");
-        LLVMBuildStore(builder, result, dest);
-        //         fprintf(stderr, "[codegen_expr] assignAdd OK dest=%p result=%p\n", (void*)dest, (void*)result);
-        return result;
+    case NT_ACCESO_ARRAY: {
+      LLVMTypeRef elem_type;
+      LLVMValueRef ptr = codegen_lvalue(expr, current_fn, &elem_type, is_unsigned);
+      if (!ptr) {
+        return vector_element(expr, current_fn, is_unsigned);
       }
-      if (op == 310) { // *= compuesto
-        const char *name = (L->type==NT_ID||L->type==NT_VAR)?L->value.strVal:NULL;
-        if (!name) { 
-          //fprintf(stderr,"[codegen_expr] assignComp: LHS inválido (linea %d)\n", expr->lineno); 
-          return NULL; }
-        LLVMValueRef dest = sym_get(name);
-        if (!dest) { 
-          //fprintf(stderr,"[codegen_expr] assignComp: variable no declarada %s (linea %d)\n", name, expr->lineno); 
-          return NULL; }
-        LLVMValueRef lv = safe_load(dest, "loadtmp");
-        if (!lv) { 
-          //fprintf(stderr, "[codegen_expr] assignComp: load failed\n"); 
-          return NULL; }
-        LLVMValueRef rv = codegen_expr(R, current_fn);
-        if (!rv) { 
-          //fprintf(stderr,"[codegen_expr] assignComp: RHS null\n"); 
-          return NULL; }
-        LLVMValueRef result = LLVMBuildMul(builder, lv, rv, "multmp");
-        LLVMBuildStore(builder, result, dest);
-        //         fprintf(stderr, "[codegen_expr] assignComp OK dest=%p result=%p\n", (void*)dest, (void*)result);
-        return result;
+      if (LLVMGetTypeKind(elem_type) == LLVMArrayTypeKind) { // a[i] de un arreglo de varias dimensiones
+        return array_decay(ptr, elem_type);
       }
+      return LLVMBuildLoad2(builder, elem_type, ptr, "arrayval");
+    }
 
+    case NT_CADENA: {
+      // Constante del pool del módulo: un literal repetido no crea otra global
+      return literal_pointer(string_literal(expr));
+    }
 
+    case NT_TERNARIO: {
+      ast_node* cond_node = expr->child;
+      ast_node* then_node = expr->child->sibling;
+      ast_node* else_node = expr->child->sibling->sibling;
 
+      LLVMBasicBlockRef then_block = LLVMAppendBasicBlock(current_fn, "ternary_then");
+      LLVMBasicBlockRef else_block = LLVMAppendBasicBlock(current_fn, "ternary_else");
+      LLVMBasicBlockRef merge_block = LLVMAppendBasicBlock(current_fn, "ternary_merge");
 
-      LLVMValueRef lv = codegen_expr(L, current_fn);
-      LLVMValueRef rv = codegen_expr(R, current_fn);
-      if (!lv || !rv) { 
-        //         fprintf(stderr, "[codegen_expr] ERROR: subexpr produjo NULL lv=%p rv=%p\n", (void*)lv, (void*)rv); 
-        return NULL; 
-      }
-
+      codegen_cond_branch(cond_node, then_block, else_block, current_fn);
 
-      if (op == 309) { // -=
-        //         fprintf(stderr, "=== DEBUG: -= assignment ===\n");
+      // Ambas ramas se generan antes de saltar al merge para poder llevarlas a un tipo común
+      int then_u, else_u;
+      LLVMPositionBuilderAtEnd(builder, then_block);
+      LLVMValueRef then_value = codegen_expr_sign(then_node, current_fn, &then_u);
+      LLVMBasicBlockRef then_block_end = LLVMGetInsertBlock(builder);
 
-        ast_node* lhs_node = expr->child;
-        if (lhs_node->type != 28) {
-          //           fprintf(stderr, "Error: lhs must be a variable for -= assignment\n");
-          return NULL;
-        }
+      LLVMPositionBuilderAtEnd(builder, else_block);
+      LLVMValueRef else_value = codegen_expr_sign(else_node, current_fn, &else_u);
+      LLVMBasicBlockRef else_block_end = LLVMGetInsertBlock(builder);
 
-        const char* var_name = lhs_node->value.strVal;
-        LLVMValueRef lhs_ptr = sym_get(var_name);
+      if (!then_value || !else_value) return NULL;
 
-        if (!lhs_ptr) {
-          //           fprintf(stderr, "Error: variable '%s' not found\n", var_name);
+      LLVMTypeRef result_type = LLVMTypeOf(then_value);
+      int result_unsigned = then_u;
+      if (LLVMTypeOf(then_value) != LLVMTypeOf(else_value)) {
+        // Tipo común calculado sin emitir código; las conversiones se emiten en cada rama
+        LLVMTypeRef lt = LLVMTypeOf(then_value), rt = LLVMTypeOf(else_value);
+        if (is_float_type(lt) || is_float_type(rt)) {
+          result_type = (LLVMGetTypeKind(lt) == LLVMDoubleTypeKind || LLVMGetTypeKind(rt) == LLVMDoubleTypeKind)
+                          ? LLVMDoubleType() : LLVMFloatType();
+          result_unsigned = 0;
+        } else if (is_int_type(lt) && is_int_type(rt)) {
+          unsigned lw = LLVMGetIntTypeWidth(lt) < 32 ? 32 : LLVMGetIntTypeWidth(lt);
+          unsigned rw = LLVMGetIntTypeWidth(rt) < 32 ? 32 : LLVMGetIntTypeWidth(rt);
+          result_type = LLVMIntType(lw > rw ? lw : rw);
+          result_unsigned = lw == rw ? ((then_u && lw == LLVMGetIntTypeWidth(lt)) || (else_u && rw == LLVMGetIntTypeWidth(rt)))
+                                     : (lw > rw ? then_u : else_u);
+        } else {
           return NULL;
         }
-
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildSub(builder, current_val, rv, "sub_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-
-        return result;
       }
 
-      if (op == 311) { // /=
-        //         fprintf(stderr, "=== DEBUG: /= assignment ===\n");
+      LLVMPositionBuilderAtEnd(builder, then_block_end);
+      then_value = convert_value(then_value, then_u, result_type, result_unsigned);
+      LLVMBuildBr(builder, merge_block);
 
-        ast_node* lhs_node = expr->child;
-        if (lhs_node->type != 28) {
-          //           fprintf(stderr, "Error: lhs must be a variable for /= assignment\n");
-          return NULL;
-        }
+      LLVMPositionBuilderAtEnd(builder, else_block_end);
+      else_value = convert_value(else_value, else_u, result_type, result_unsigned);
+      LLVMBuildBr(builder, merge_block);
 
-        const char* var_name = lhs_node->value.strVal;
-        LLVMValueRef lhs_ptr = sym_get(var_name);
+      LLVMPositionBuilderAtEnd(builder, merge_block);
+      LLVMValueRef phi = LLVMBuildPhi(builder, result_type, "ternary_result");
 
-        if (!lhs_ptr) {
-          //           fprintf(stderr, "Error: variable '%s' not found\n", var_name);
-          return NULL;
-        }
+      LLVMValueRef phi_values[2] = {then_value, else_value};
+      LLVMBasicBlockRef phi_blocks[2] = {then_block_end, else_block_end};
+      LLVMAddIncoming(phi, phi_values, phi_blocks, 2);
 
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildSDiv(builder, current_val, rv, "div_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
+      *is_unsigned = result_unsigned;
+      return phi;
+    }
+    case NT_OP_UNARIO: {
+      int op = expr->value.op;
 
-        return result;
+      ast_node *operand = expr->child;
+      if (!operand) {
+        return NULL;
       }
 
-      if (op == 312) { // %=
-        //         fprintf(stderr, "=== DEBUG: %%= assignment ===\n");
-
-        ast_node* lhs_node = expr->child;
-        if (lhs_node->type != 28) {
-          //           fprintf(stderr, "Error: lhs must be a variable for %%= assignment\n");
+      if (op == T_INC || op == T_DEC) { // ++ y -- (devuelven el valor nuevo)
+        LLVMTypeRef var_type;
+        int var_unsigned;
+        LLVMValueRef dest = codegen_lvalue(operand, current_fn, &var_type, &var_unsigned);
+        if (!dest) {
           return NULL;
         }
 
-        const char* var_name = lhs_node->value.strVal;
-        LLVMValueRef lhs_ptr = sym_get(var_name);
-
-        if (!lhs_ptr) {
-          //           fprintf(stderr, "Error: variable '%s' not found\n", var_name);
-          return NULL;
+        LLVMValueRef current = LLVMBuildLoad2(builder, var_type, dest, "loadtmp");
+        LLVMValueRef result;
+        LLVMTypeRef elem = scalar_type(var_type); // Un vector suma 1 a cada elemento
+        if (is_float_type(elem)) {
+          LLVMValueRef one = convert_value(LLVMConstReal(elem, 1.0), 0, var_type, 0);
+          result = op == T_INC ? LLVMBuildFAdd(builder, current, one, "inctmp")
+                               : LLVMBuildFSub(builder, current, one, "subtmp");
+        } else {
+          LLVMValueRef one = convert_value(LLVMConstInt(elem, 1, 0), 0, var_type, 0);
+          if (var_unsigned || LLVMGetIntTypeWidth(elem) < 32) // char y short se promueven: su desborde no es UB
+            result = op == T_INC ? LLVMBuildAdd(builder, current, one, "inctmp")
+                                 : LLVMBuildSub(builder, current, one, "subtmp");
+          else
+            result = op == T_INC ? LLVMBuildNSWAdd(builder, current, one, "inctmp")
+                                 : LLVMBuildNSWSub(builder, current, one, "subtmp");
         }
 
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildSRem(builder, current_val, rv, "mod_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-
+        LLVMBuildStore(builder, result, dest);
+        *is_unsigned = var_unsigned;
         return result;
       }
 
-      if (op == 333) { // & (AND bit a bit)
-        return LLVMBuildAnd(builder, lv, rv, "andtmp");
-      }
-      if (op == 334) { // | (OR bit a bit)
-        return LLVMBuildOr(builder, lv, rv, "ortmp");
-      }
-
-      if (op == 335) { // ^ (XOR bit a bit)
-        return LLVMBuildXor(builder, lv, rv, "xortmp");
-      }
-
-      if (op == 338) { // << (shift left)
-        return LLVMBuildShl(builder, lv, rv, "shltmp");
-      }
-
-      if (op == 339) { // >> (shift right)
-        return LLVMBuildAShr(builder, lv, rv, "ashrtmp"); // Arithmetic shift
-      }
-
-
-      if (op == 340) { // &=
-
-        ast_node *var_node = expr->child;
-
-        LLVMValueRef lhs_ptr = sym_get(var_node->value.strVal);
-        if (!lhs_ptr) {
-          //           fprintf(stderr, "Error: variable no encontrada para asignación compuesta\n");
+      if (op == T_AND) { // &&etiqueta (GNU): dirección del bloque, como long
+        if (!label_function || operand->type != NT_ID) {
+          fprintf(stderr, "ERROR: &&etiqueta fuera de una función (linea %d)\n", expr->lineno);
+          codegen_errors++;
           return NULL;
         }
-
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildAnd(builder, current_val, rv, "and_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-        return result;
+        label_entry *l = label_get(operand->value.strVal, expr->lineno);
+        l->address_taken = 1;
+        *is_unsigned = 0;
+        return LLVMConstPtrToInt(LLVMBlockAddress(label_function, l->block), LLVMInt64Type());
       }
 
-      if (op == 341) { // |= (OR assignment)
-        LLVMValueRef lhs_ptr = codegen_expr(expr->child, current_fn);
-        if (!lhs_ptr) return NULL;
+      int ou;
+      LLVMValueRef value = codegen_expr_sign(operand, current_fn, &ou);
+      if (!value) return NULL;
 
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildOr(builder, current_val, rv, "or_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-        return result;
-      }
-
-      if (op == 342) { // ^= (XOR assignment)  NO ESXISTe
-        LLVMValueRef lhs_ptr = codegen_expr(expr->child, current_fn);
-        if (!lhs_ptr) return NULL;
-
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildXor(builder, current_val, rv, "xor_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-        return result;
+      if (op == T_NOT) {
+        if (is_vector_type(LLVMTypeOf(value))) { // Como en gcc: se escribe v == 0
+          fprintf(stderr, "ERROR: ! no se aplica a un vector (linea %d)\n", expr->lineno);
+          codegen_errors++;
+          return NULL;
+        }
+        LLVMValueRef is_true = cast_to_bool(value);
+        LLVMValueRef not_bool = LLVMBuildNot(builder, is_true, "not_bool");
+        return LLVMBuildZExt(builder, not_bool, i32_type, "not_result");
       }
 
-      if (op == 343) { // <<= (Shift left assignment) NO EXISTE
-        LLVMValueRef lhs_ptr = codegen_expr(expr->child, current_fn);
-        if (!lhs_ptr) return NULL;
-
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildShl(builder, current_val, rv, "shl_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-        return result;
+      if (op == T_TILDE) {
+        value = promote_int(value, &ou);
+        if (!is_int_type(scalar_type(LLVMTypeOf(value)))) return NULL;
+        *is_unsigned = ou;
+        return LLVMBuildNot(builder, value, "bitwise_not");
       }
 
-      if (op == 344) { // >>= (Shift right assignment) NO EXISTE
-        LLVMValueRef lhs_ptr = codegen_expr(expr->child, current_fn);
-        if (!lhs_ptr) return NULL;
-
-        LLVMValueRef current_val = LLVMBuildLoad2(builder, LLVMInt32Type(), lhs_ptr, "load_current");
-        LLVMValueRef result = LLVMBuildAShr(builder, current_val, rv, "shr_assign");
-        LLVMBuildStore(builder, result, lhs_ptr);
-        return result;
-      }
-
-      if (op == 318) { LLVMValueRef t = LLVMBuildAdd(builder, lv, rv, "addtmp"); 
-        //fprintf(stderr,"[codegen_expr] ADD -> %p\n",(void*)t); 
-        return t; }
-
-      if (op == 319) { // -
-        LLVMValueRef t = LLVMBuildSub(builder, lv, rv, "subtmp"); 
-        //         fprintf(stderr,"[codegen_expr] SUB -> %p\n",(void*)t); 
-        return t; 
-      }
-      if (op == 320) { // *
-        LLVMValueRef t = LLVMBuildMul(builder, lv, rv, "multmp"); 
-        //         fprintf(stderr,"[codegen_expr] MUL -> %p\n",(void*)t); 
-        return t; 
-      }
-      if (op == 321) { // /
-        LLVMValueRef t = LLVMBuildSDiv(builder, lv, rv, "divtmp"); 
-        //         fprintf(stderr,"[codegen_expr] DIV -> %p\n",(void*)t); 
-        return t; 
+      if (op == T_MINUS) { // Menos unario
+        if (is_float_type(scalar_type(LLVMTypeOf(value)))) {
+          return LLVMBuildFNeg(builder, value, "negtmp");
+        }
+        value = promote_int(value, &ou);
+        *is_unsigned = ou;
+        return LLVMBuildNeg(builder, value, "negtmp");
       }
 
-      if (op == 322) { // %
-        LLVMValueRef t = LLVMBuildSRem(builder, lv, rv, "modtmp"); 
-        //         fprintf(stderr,"[codegen_expr] MOD -> %p\n",(void*)t); 
-        return t; 
-      }
+      //       fprintf(stderr, "[codegen_expr] op unario no soportado %d\n", op);
+      return NULL;
+    }
 
 
-      if (op == 325) { // T_EQ (igualdad)
-        //         fprintf(stderr, "[codegen_expr] CMP ==\n");
-        LLVMValueRef t = LLVMBuildICmp(builder, LLVMIntEQ, lv, rv, "eqtmp");
-        return t;
-      }
-      if (op == 326) { // T_NEQ (desigualdad)  
-        //         fprintf(stderr, "[codegen_expr] CMP !=\n");
-        LLVMValueRef t = LLVMBuildICmp(builder, LLVMIntNE, lv, rv, "netmp");
-        return t;
+    case NT_OP_BINARIO: {
+      int op = expr->value.op;
+      ast_node *L = expr->child;
+      ast_node *R = L ? L->sibling : NULL;
+      if (!L || !R) {
+        return NULL;
       }
 
-      if (op == 327) { LLVMValueRef t = LLVMBuildICmp(builder, LLVMIntSLT, lv, rv, "cmptmp"); 
-        //fprintf(stderr,"[codegen_expr] CMP < -> %p\n",(void*)t); 
-        return t; } // <
-
-
-      if (op == 329) { // >
-        LLVMValueRef t = LLVMBuildICmp(builder, LLVMIntSGT, lv, rv, "cmptmp"); 
-        //         fprintf(stderr,"[codegen_expr] CMP > -> %p\n",(void*)t); 
-        return t; 
+      if (op == T_ASSIGN || compound_base_op(op) != 0) {
+        return codegen_assign(expr, current_fn, is_unsigned);
       }
 
-      if (op == 328) { // <=
-        LLVMValueRef t = LLVMBuildICmp(builder, LLVMIntSLE, lv, rv, "cmptmp");
-        //         fprintf(stderr,"[codegen_expr] CMP <= -> %p\n",(void*)t);
-        return t;
+      if (op == T_AND || op == T_OR) { // && y || con corto circuito: el lado derecho no siempre se evalúa
+        LLVMBasicBlockRef true_bb = LLVMAppendBasicBlock(current_fn, "logic_true");
+        LLVMBasicBlockRef false_bb = LLVMAppendBasicBlock(current_fn, "logic_false");
+        LLVMBasicBlockRef merge_bb = LLVMAppendBasicBlock(current_fn, "logic_merge");
+
+        codegen_cond_branch(expr, true_bb, false_bb, current_fn);
+
+        LLVMPositionBuilderAtEnd(builder, true_bb);
+        LLVMBuildBr(builder, merge_bb);
+        LLVMPositionBuilderAtEnd(builder, false_bb);
+        LLVMBuildBr(builder, merge_bb);
+
+        // En C el resultado de && y || es un int (0 o 1)
+        LLVMPositionBuilderAtEnd(builder, merge_bb);
+        LLVMValueRef phi = LLVMBuildPhi(builder, i32_type, "logic_result");
+        LLVMValueRef phi_values[2] = {LLVMConstInt(i32_type, 1, 0), LLVMConstInt(i32_type, 0, 0)};
+        LLVMBasicBlockRef phi_blocks[2] = {true_bb, false_bb};
+        LLVMAddIncoming(phi, phi_values, phi_blocks, 2);
+        return phi;
       }
-      if (op == 330) { // >=
-        LLVMValueRef t = LLVMBuildICmp(builder, LLVMIntSGE, lv, rv, "cmptmp"); 
-        //         fprintf(stderr,"[codegen_expr] CMP >= -> %p\n",(void*)t); 
-        return t; 
-      }
-
-
-      if (op == 331) { //  && and 
-        LLVMValueRef lb = cast_to_bool(lv);
-        LLVMValueRef rb = cast_to_bool(rv);
-
-        LLVMValueRef r = LLVMBuildAnd(builder, lb, rb, "and_i1");
-
 
-        return r;    
+      // a+b+c+... anida a la izquierda: la espina izquierda se recorre con una pila explícita
+      int depth = 0;
+      ast_node *leftmost = expr;
+      while (is_plain_binary(leftmost)) {
+        leftmost = leftmost->child;
+        depth++;
       }
-      if (op == 332) { // ||   or
-        LLVMValueRef lb = cast_to_bool(lv);
-        LLVMValueRef rb = cast_to_bool(rv);
-
-        LLVMValueRef r = LLVMBuildOr(builder, lb, rb, "or_i1");
-
-
-        return r;
+      ast_node **spine = malloc(depth * sizeof(ast_node *));
+      ast_node *n = expr;
+      for (int i = depth - 1; i >= 0; i--, n = n->child) spine[i] = n;
+
+      int lu;
+      LLVMValueRef lv = codegen_expr_sign(leftmost, current_fn, &lu);
+      for (int i = 0; i < depth && lv; i++) {
+        int ru;
+        LLVMValueRef rv = codegen_expr_sign(spine[i]->child->sibling, current_fn, &ru);
+        LLVMValueRef result = rv ? build_binary(spine[i]->value.op, lv, lu, rv, ru, &lu) : NULL;
+        //       if (!lv) fprintf(stderr, "[codegen_expr] op no soportado %d (linea %d)\n", op, expr->lineno);
+        if (rv && !result && (is_vector_type(LLVMTypeOf(lv)) || is_vector_type(LLVMTypeOf(rv)))) {
+          fprintf(stderr, "ERROR: operandos no válidos para una operación con vectores (linea %d)\n", spine[i]->lineno);
+          codegen_errors++;
+        }
+        lv = result;
       }
-      //       fprintf(stderr, "[codegen_expr] op no soportado %d (linea %d)\n", op, expr->lineno);
-      return NULL;
+      free(spine);
+      *is_unsigned = lu;
+      return lv;
     }
 
     case NT_LLAMADA_FUNCION: {
-      //       fprintf(stderr, "[codegen_expr] LLAMADA_FUNCION entrada (addr=%p)\n", (void*)expr);
-
       ast_node *fnexpr = expr->child;
       if (!fnexpr) {
-        //         fprintf(stderr,"[codegen_expr] call: sin nombre (linea %d)\n", expr->lineno);
         return NULL;
       }
       const char *fname = fnexpr->value.strVal;
-      //       fprintf(stderr, "[codegen_expr] call a '%s'\n", fname ? fname : "(null)");
-      //printf("[DEBUG] Llamada a función: %s\n", fname);
-
-      // Manejo especial para printf (función con argumentos variables)
-      if (fname && strcmp(fname, "printf") == 0) {
-        //printf("[DEBUG] Procesando llamada a printf\n");
-
-        // Contar argumentos
-        int nargs = 0;
-        ast_node *arg_node = fnexpr->sibling;
-        for (ast_node *t = arg_node; t; t = t->sibling) nargs++;
-
-        //printf("[DEBUG] printf tiene %d argumentos\n", nargs);
-
-        // Procesar argumentos
-        LLVMValueRef *args = malloc(sizeof(LLVMValueRef) * nargs);
-        LLVMTypeRef *arg_types = malloc(sizeof(LLVMTypeRef) * nargs);
-
-        int i = 0;
-        for (ast_node *t = arg_node; t; t = t->sibling) {
-          args[i] = codegen_expr(t, current_fn);
-          LLVMTypeRef original_type = LLVMTypeOf(args[i]);
-
-          // Para printf, los tipos deben ser específicos:
-          // - cadenas: i8*
-          // - enteros con %i, %d: i32
-          // - caracteres con %c: i8 (pero se pasa como i32 en variádicas)
-          // - floats/doubles con %f: double (se promueve float a double)
-
-          if (LLVMGetTypeKind(original_type) == LLVMIntegerTypeKind) {
-            // Para enteros, usar i32 (tamaño estándar para variádicas)
-            unsigned width = LLVMGetIntTypeWidth(original_type);
-            if (width != 32) {
-              args[i] = LLVMBuildIntCast(builder, args[i], i32_type, "intcast");
-            }
-            arg_types[i] = i32_type;
-          }
-          else if (LLVMGetTypeKind(original_type) == LLVMPointerTypeKind) {
-            // Para punteros (cadenas), usar i8*
-            arg_types[i] = original_type;
-          }
-          else {
-            // Para otros tipos, mantener el tipo original
-            arg_types[i] = original_type;
-          }
-
-          i++;
-        }
-
-        // Crear tipo de función para esta llamada específica
-        LLVMTypeRef printf_type = LLVMFunctionType(LLVMInt32Type(), arg_types, nargs, 1);
-
-        // Obtener función printf 
-        LLVMValueRef printf_func = LLVMGetNamedFunction(module, "printf");
-        if (!printf_func) {
-          // Declarar con el tipo correcto
-          printf_func = LLVMAddFunction(module, "printf", printf_type);
-        }
-
-        // Construir la llamada
-        LLVMValueRef call = LLVMBuildCall2(builder, printf_type, printf_func, args, nargs, "printfcall");
-
-        //printf("[DEBUG] Llamada a printf construida exitosamente\n");
-
-        free(args);
-        free(arg_types);
-        return call;
+      if (fname && (strcmp(fname, "__builtin_shuffle") == 0 || strcmp(fname, "__builtin_shufflevector") == 0)) {
+        return codegen_shuffle(expr, current_fn, is_unsigned);
       }
 
-
-
-
-
-
-      LLVMValueRef callee = LLVMGetNamedFunction(module, fname);
+      LLVMValueRef callee = fname ? LLVMGetNamedFunction(module, fname) : NULL;
       if (!callee) {
-        //         fprintf(stderr, "[codegen_expr] call: función '%s' no encontrada (linea %d)\n", fname, expr->lineno);
+        fprintf(stderr, "ERROR: llamada a la función no declarada '%s' (linea %d)\n", fname ? fname : "?", expr->lineno);
+        codegen_errors++;
         return NULL;
       }
+      // printf de la libc (declarado en todo módulo): ver codegen_printf
+      if (strcmp(fname, "printf") == 0 && LLVMIsDeclaration(callee)) {
+        return codegen_printf(fnexpr->sibling, current_fn, is_unsigned);
+      }
+      LLVMTypeRef callee_type = LLVMGlobalGetValueType(callee);
+      unsigned nparams = LLVMCountParamTypes(callee_type);
+      fn_entry *sig = fn_get(fname);
 
-
-      LLVMTypeRef callee_type = LLVMTypeOf(callee);
-      //       fprintf(stderr, "[codegen_expr] callee_type=%p\n", (void*)callee_type);
-
-      if (!callee_type) {
-        //         fprintf(stderr, "[codegen_expr] ERROR: no se pudo obtener tipo de callee\n");
+      int nargs = 0;
+      for (ast_node *t = fnexpr->sibling; t; t = t->sibling) nargs++;
+      if ((unsigned)nargs < nparams || ((unsigned)nargs > nparams && !LLVMIsFunctionVarArg(callee_type))) {
+        //         fprintf(stderr, "[codegen_expr] ERROR: número de argumentos incorrecto\n");
         return NULL;
       }
 
-      LLVMTypeKind callee_kind = LLVMGetTypeKind(callee_type);
-      //       fprintf(stderr, "[codegen_expr] callee_type kind=%d\n", callee_kind);
-
-      LLVMTypeRef callee_elem = NULL;
-      if (callee_kind == LLVMPointerTypeKind) {
-        callee_elem = LLVMGetElementType(callee_type);
-        //         fprintf(stderr, "[codegen_expr] callee_elem=%p\n", (void*)callee_elem);
-        if (callee_elem) {
-          LLVMTypeKind elem_kind = LLVMGetTypeKind(callee_elem);
-          //           fprintf(stderr, "[codegen_expr] callee_elem kind=%d\n", elem_kind);
+      LLVMTypeRef *param_types = malloc(sizeof(LLVMTypeRef) * (nparams > 0 ? nparams : 1));
+      LLVMGetParamTypes(callee_type, param_types);
+      LLVMValueRef *argv = malloc(sizeof(LLVMValueRef) * (nargs > 0 ? nargs : 1));
+
+      int i = 0;
+      for (ast_node *t = fnexpr->sibling; t; t = t->sibling, i++) {
+        int au;
+        LLVMValueRef arg = codegen_expr_sign(t, current_fn, &au);
+        if (!arg) {
+          free(param_types);
+          free(argv);
+          return NULL;
+        }
+        if ((unsigned)i < nparams) {
+          int pu = (sig && i < sig->nparams) ? sig->param_unsigned[i] : 0;
+          arg = convert_checked(arg, au, param_types[i], pu, t->lineno);
+        } else if (LLVMGetTypeKind(LLVMTypeOf(arg)) == LLVMFloatTypeKind) {
+          // Promociones por defecto de los argumentos variádicos
+          arg = LLVMBuildFPExt(builder, arg, LLVMDoubleType(), "fpexttmp");
+        } else {
+          arg = promote_int(arg, &au);
         }
+        argv[i] = arg;
       }
 
+      int returns_void = LLVMGetTypeKind(LLVMGetReturnType(callee_type)) == LLVMVoidTypeKind;
+      LLVMValueRef call = LLVMBuildCall2(builder, callee_type, callee, argv, nargs, returns_void ? "" : "calltmp");
+      LLVMSetInstructionCallConv(call, LLVMGetFunctionCallConv(callee));
+      *is_unsigned = sig ? sig->ret_unsigned : 0;
 
-      if (!callee_elem || LLVMGetTypeKind(callee_elem) != LLVMFunctionTypeKind) {
-        //         fprintf(stderr, "[codegen_expr] WARNING: tipo de función inválido, creando fallback\n");
+      free(param_types);
+      free(argv);
+      return call;
+    }
 
+    case NT_EXPR_SENTENCIA:
+      return codegen_expr_sign(expr->child, current_fn, is_unsigned);
 
-        int nargs = 0;
-        ast_node *a = fnexpr->sibling;
-        for (ast_node *t = a; t; t = t->sibling) nargs++;
+    default:
+      //       fprintf(stderr, "[codegen_expr] tipo no soportado %d (linea %d)\n", expr->type, expr->lineno);
+      return NULL;
+  }
+}
 
+/*
+Lowers a condition directly into a conditional branch.
+&& and || jump to the next operand only when needed (short circuit),
+! swaps the targets, and comparisons branch on their i1 result without
+being materialized as an int and compared against zero again.
+*/
+static void codegen_cond_branch(ast_node *cond, LLVMBasicBlockRef true_bb, LLVMBasicBlockRef false_bb, LLVMValueRef current_fn) {
+  if (!cond || (cond->type == NT_EXPR_SENTENCIA && !cond->child)) { // Condición vacía (for(;;)): siempre verdadera
+    LLVMBuildBr(builder, true_bb);
+    return;
+  }
+  if (stack_low()) {
+    deep_call call = { cond, current_fn, NULL, true_bb, false_bb, NULL };
+    stack_extend(codegen_cond_branch_deep, &call);
+    return;
+  }
 
-        LLVMTypeRef *param_types = NULL;
-        if (nargs > 0) {
-          param_types = malloc(sizeof(LLVMTypeRef) * nargs);
-          for (int i = 0; i < nargs; i++) {
-            param_types[i] = i32_type;
-          }
-        }
-        callee_elem = LLVMFunctionType(i32_type, param_types, nargs, 0);
-        if (param_types) free(param_types);
+  if (cond->type == NT_OP_BINARIO && (cond->value.op == T_AND || cond->value.op == T_OR)) {
+    ast_node *L = cond->child;
+    ast_node *R = L ? L->sibling : NULL;
+    const char *rhs_name = cond->value.op == T_AND ? "and_rhs" : "or_rhs";
+    // El lado derecho se coloca justo después del bloque actual para que el caso común caiga en secuencia
+    LLVMBasicBlockRef next_bb = LLVMGetNextBasicBlock(LLVMGetInsertBlock(builder));
+    LLVMBasicBlockRef rhs_bb = next_bb ? LLVMInsertBasicBlock(next_bb, rhs_name)
+                                       : LLVMAppendBasicBlock(current_fn, rhs_name);
+
+    if (cond->value.op == T_AND)
+      codegen_cond_branch(L, rhs_bb, false_bb, current_fn);
+    else
+      codegen_cond_branch(L, true_bb, rhs_bb, current_fn);
+
+    LLVMPositionBuilderAtEnd(builder, rhs_bb);
+    codegen_cond_branch(R, true_bb, false_bb, current_fn);
+    return;
+  }
 
-        //         fprintf(stderr, "[codegen_expr] Fallback type creado: %p\n", (void*)callee_elem);
-      }
+  if (cond->type == NT_OP_UNARIO && cond->value.op == T_NOT) {
+    codegen_cond_branch(cond->child, false_bb, true_bb, current_fn);
+    return;
+  }
 
-      // Procesar argumentos
-      int nargs = 0;
-      ast_node *a = fnexpr->sibling;
-      for (ast_node *t = a; t; t = t->sibling) nargs++;
-      //       fprintf(stderr, "[codegen_expr] call: nargs AST = %d\n", nargs);
-
-      LLVMValueRef *argv = NULL;
-      if (nargs > 0) {
-        argv = malloc(sizeof(LLVMValueRef) * nargs);
-        if (!argv) {
-          //           fprintf(stderr, "[codegen_expr] ERROR: malloc argv failed\n");
-          return NULL;
-        }
-        int i = 0;
-        for (ast_node *t = a; t; t = t->sibling) {
-          argv[i] = codegen_expr(t, current_fn);
-          //           fprintf(stderr, "[codegen_expr] call: arg %d expr -> %p\n", i, (void*)argv[i]);
-          i++;
-        }
+  LLVMValueRef v = codegen_expr(cond, current_fn);
+  if (!v) {
+    fprintf(stderr, "[codegen_cond_branch] condición nula (linea %d)\n", cond->lineno);
+    v = LLVMConstInt(LLVMInt1Type(), 0, 0);
+  } else if (is_vector_type(LLVMTypeOf(v))) {
+    fprintf(stderr, "ERROR: un vector no puede usarse como condición (linea %d)\n", cond->lineno);
+    codegen_errors++;
+    v = LLVMConstInt(LLVMInt1Type(), 0, 0);
+  }
+  LLVMBuildCondBr(builder, cast_to_bool(v), true_bb, false_bb);
+}
+
+/*
+Initializes a local variable. Arrays are zero-filled first, as C
+requires for the elements a brace list leaves out, and then each
+listed element is stored through its own GEP.
+*/
+static void codegen_local_init(LLVMValueRef ptr, LLVMTypeRef type, int is_unsigned, ast_node *init, LLVMValueRef current_fn, int zeroed) {
+  if (LLVMGetTypeKind(type) == LLVMArrayTypeKind) {
+    if (init->type != NT_LISTA_INIT) {
+      fprintf(stderr, "ERROR: un arreglo se inicializa con una lista entre llaves (linea %d)\n", init->lineno);
+      codegen_errors++;
+      return;
+    }
+    if (!zeroed) {
+      LLVMBuildMemSet(builder, ptr, LLVMConstInt(i8_type, 0, 0), LLVMSizeOf(type), LLVMGetAlignment(ptr));
+    }
+
+    unsigned n = LLVMGetArrayLength(type);
+    LLVMTypeRef elem_type = LLVMGetElementType(type);
+    unsigned i = 0;
+    ast_node *item = init->child;
+    for (; item && i < n; item = item->sibling, i++) {
+      LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt64Type(), 0, 0), LLVMConstInt(LLVMInt64Type(), i, 0) };
+      LLVMValueRef elem_ptr = LLVMBuildInBoundsGEP2(builder, type, ptr, indices, 2, "arrayinit");
+      codegen_local_init(elem_ptr, elem_type, is_unsigned, item, current_fn, 1);
+    }
+    if (item) {
+      fprintf(stderr, "ERROR: demasiados inicializadores para el arreglo (linea %d)\n", item->lineno);
+      codegen_errors++;
+    }
+    return;
+  }
+
+  if (is_vector_type(type) && init->type == NT_LISTA_INIT) {
+    // v4i v = {1, 2}: el vector se arma en un registro; lo que la lista deja fuera vale 0
+    LLVMTypeRef elem_type = LLVMGetElementType(type);
+    unsigned n = LLVMGetVectorSize(type);
+    LLVMValueRef v = LLVMConstNull(type);
+    unsigned i = 0;
+    ast_node *item = init->child;
+    for (; item && i < n; item = item->sibling, i++) {
+      int iu;
+      LLVMValueRef x = codegen_expr_sign(item, current_fn, &iu);
+      if (!x) {
+        return;
       }
+      x = convert_checked(x, iu, elem_type, is_unsigned, item->lineno);
+      v = LLVMBuildInsertElement(builder, v, x, LLVMConstInt(i32_type, i, 0), "vecinit");
+    }
+    if (item) {
+      fprintf(stderr, "ERROR: demasiados inicializadores para el vector (linea %d)\n", item->lineno);
+      codegen_errors++;
+    }
+    LLVMBuildStore(builder, v, ptr);
+    return;
+  }
+
+  if (init->type == NT_LISTA_INIT) { // int x = { 5 };
+    init = init->child;
+  }
+  int ru;
+  LLVMValueRef rv = codegen_expr_sign(init, current_fn, &ru);
+  if (rv) {
+    LLVMBuildStore(builder, convert_checked(rv, ru, type, is_unsigned, init->lineno), ptr);
+  }
+}
 
+// =======================================================
+// PGO (-fprofile-generate / -fprofile-use, ver profile.h)
+// =======================================================
+
+typedef struct prof_fn {
+  char *key;             // nombre en el perfil: "archivo:función" si es static
+  uint64_t hash;
+  unsigned n;
+  LLVMValueRef counters; // [n x i64]
+  struct prof_fn *next;
+} prof_fn;
+
+static const char *profile_generate = NULL; // perfil que escribe el programa instrumentado
+static profile_data *profile_use = NULL;    // perfil leído con -fprofile-use
+static const char *profile_module = NULL;   // archivo fuente, prefijo de las funciones static
+static prof_fn *prof_fns = NULL;            // funciones instrumentadas del módulo
+static char *prof_key = NULL;               // función actual
+static uint64_t prof_hash = 0;
+static LLVMValueRef prof_counters = NULL;   // contadores de la función actual ([0 x i64] provisional)
+static unsigned prof_next = 0;              // siguiente contador de la función actual
+static const uint64_t *prof_counts = NULL;  // conteos de la función actual con -fprofile-use
+static unsigned prof_ncounts = 0;
+
+// Reserva el siguiente contador; ambos modos los numeran en el mismo orden de generación
+static unsigned profile_counter(void) {
+  return prof_next++;
+}
 
-      unsigned expected_params = LLVMCountParamTypes(callee_elem);
-      //       fprintf(stderr, "[codegen_expr] Función espera %u params, tenemos %d\n", expected_params, nargs);
+static uint64_t profile_count(unsigned id) {
+  return prof_counts && id < prof_ncounts ? prof_counts[id] : 0;
+}
 
-      if ((unsigned)nargs != expected_params) {
-        //         fprintf(stderr, "[codegen_expr] ERROR: número de argumentos incorrecto\n");
-        if (argv) free(argv);
-        return NULL;
-      }
+static void profile_increment(unsigned id) {
+  if (!prof_counters) return;
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMValueRef idx[2] = { LLVMConstInt(i64, 0, 0), LLVMConstInt(i64, id, 0) };
+  LLVMValueRef ptr = LLVMBuildInBoundsGEP2(builder, LLVMArrayType(i64, 0), prof_counters, idx, 2, "prof.ptr");
+  LLVMValueRef v = LLVMBuildLoad2(builder, i64, ptr, "prof.count");
+  LLVMBuildStore(builder, LLVMBuildAdd(builder, v, LLVMConstInt(i64, 1, 0), "prof.inc"), ptr);
+}
 
-      //       fprintf(stderr, "[codegen_expr] calling LLVMBuildCall2 con callee=%p callee_elem=%p nargs=%d\n", 
-      //    (void*)callee, (void*)callee_elem, nargs);
+/*
+Counts the edges into dest. With -fprofile-generate this returns a new
+block that bumps counter id and jumps to dest, to be used as the branch
+target; otherwise it returns dest unchanged. Counting edges instead of
+blocks keeps break, continue and case fallthrough out of the counts.
+*/
+static LLVMBasicBlockRef profile_edge(LLVMValueRef fn, LLVMBasicBlockRef dest, unsigned id) {
+  if (!prof_counters) return dest;
+  LLVMBasicBlockRef saved = LLVMGetInsertBlock(builder);
+  LLVMBasicBlockRef edge = LLVMAppendBasicBlock(fn, "prof.edge");
+  LLVMPositionBuilderAtEnd(builder, edge);
+  profile_increment(id);
+  LLVMBuildBr(builder, dest);
+  if (saved) LLVMPositionBuilderAtEnd(builder, saved);
+  return edge;
+}
 
-      LLVMValueRef call = LLVMBuildCall2(builder, callee_elem, callee, argv, nargs, "calltmp");
-      //       fprintf(stderr, "[codegen_expr] call result %p\n", (void*)call);
+// !prof branch_weights, escalados a 32 bits y con +1 como hace clang para no marcar nada como imposible
+static void profile_set_weights(LLVMValueRef inst, const uint64_t *counts, unsigned n) {
+  uint64_t max = 0;
+  for (unsigned i = 0; i < n; i++) {
+    if (counts[i] > max) max = counts[i];
+  }
+  if (max == 0) return; // Nunca se ejecutó: no hay nada que decir
+  uint64_t scale = max / UINT32_MAX + 1;
+
+  LLVMContextRef ctx = LLVMGetModuleContext(module);
+  LLVMMetadataRef *ops = malloc((n + 1) * sizeof(LLVMMetadataRef));
+  ops[0] = LLVMMDStringInContext2(ctx, "branch_weights", 14);
+  for (unsigned i = 0; i < n; i++) {
+    ops[i + 1] = LLVMValueAsMetadata(LLVMConstInt(i32_type, counts[i] / scale + 1, 0));
+  }
+  LLVMMetadataRef node = LLVMMDNodeInContext2(ctx, ops, n + 1);
+  LLVMSetMetadata(inst, LLVMGetMDKindID("prof", 4), LLVMMetadataAsValue(ctx, node));
+  free(ops);
+}
 
-      if (argv) free(argv);
-      return call;
-    }
+/*
+Attaches the profile to the branch codegen_cond_branch just emitted.
+A short-circuit condition ends in several branches that share the same
+outcome counters, so only single-branch conditions get weights.
+*/
+static void profile_cond_weights(ast_node *cond, LLVMBasicBlockRef true_bb, uint64_t taken, uint64_t not_taken) {
+  if (!prof_counts) return;
+  while (cond && cond->type == NT_OP_UNARIO && cond->value.op == T_NOT) cond = cond->child;
+  if (cond && cond->type == NT_OP_BINARIO && (cond->value.op == T_AND || cond->value.op == T_OR)) return;
+
+  LLVMValueRef term = LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder));
+  if (!term || LLVMGetNumSuccessors(term) != 2) return; // for(;;) o condición constante
+  uint64_t w[2] = { taken, not_taken };
+  if (LLVMGetSuccessor(term, 0) != true_bb) { // ! invierte los destinos
+    w[0] = not_taken;
+    w[1] = taken;
+  }
+  profile_set_weights(term, w, 2);
+}
 
-    case NT_EXPR_SENTENCIA:
-      return codegen_expr(expr->child, current_fn);
+// =======================================================
+// ENTRADA A UN BUCLE DEL INTÉRPRETE (-run)
+// =======================================================
 
-    default:
-      //       fprintf(stderr, "[codegen_expr] tipo no soportado %d (linea %d)\n", expr->type, expr->lineno);
-      return NULL;
+// Sólo mientras se genera la función de entrada de codegen_build_osr_module
+static const codegen_osr_var *osr_vars = NULL;
+static LLVMValueRef *osr_slots = NULL;   // dirección de cada variable en el marco del intérprete
+static int osr_nvars = 0;
+static const char *osr_function = NULL;  // función del bucle: nombre de sus variables static
+static LLVMTypeRef osr_ret_type = NULL;   // retorno de esa función
+static LLVMValueRef osr_ret = NULL;      // dónde deja return el valor
+
+static LLVMValueRef osr_slot(ast_node *declarator) {
+  for (int i = 0; i < osr_nvars; i++) {
+    if (osr_vars[i].declarator == declarator) return osr_slots[i];
   }
+  return NULL;
 }
 
+// return dentro del bucle: el valor queda para el intérprete, que termina la llamada
+static void codegen_osr_return(ast_node *stmt, LLVMValueRef current_fn) {
+  if (LLVMGetTypeKind(osr_ret_type) == LLVMVoidTypeKind) {
+    if (stmt->child) codegen_expr(stmt->child, current_fn);
+  } else {
+    int ru = 0;
+    LLVMValueRef rv = stmt->child ? codegen_expr_sign(stmt->child, current_fn, &ru) : NULL;
+    rv = rv ? convert_value(rv, ru, osr_ret_type, current_ret_unsigned) : LLVMConstNull(osr_ret_type);
+    LLVMBuildStore(builder, rv, osr_ret);
+  }
+  LLVMBuildRet(builder, LLVMConstInt(i32_type, 1, 0));
+}
 
 // =======================================================
 // STATEMENTS
 // =======================================================
+
+// switch que se está generando: sus case y default se agregan al encontrarlos en el cuerpo
+typedef struct switch_ctx {
+  LLVMValueRef inst;
+  LLVMTypeRef type;
+  int has_default;
+  unsigned default_id; // contador de la arista hacia default (o al final si no hay default)
+  unsigned *case_ids;  // contador de la arista hacia cada case, en el orden de LLVMAddCase
+  unsigned ncases, cap;
+} switch_ctx;
+
+static switch_ctx *current_switch = NULL;
+
+/*
+Hints of #pragma unroll, ivdep and clang loop (see pragma.h). The pragma
+leaves them pending and the loop statement it precedes takes them before
+generating its body, so nested loops do not see them. Once the loop is
+built they become its llvm.loop metadata, on every branch back to the
+header; ivdep also marks the loop's loads and stores as free of
+loop-carried dependencies, which lets the vectorizer skip its checks.
+*/
+static pragma_loop_hints pending_hints;
+static int has_pending_hints = 0;
+
+static int loop_take_hints(pragma_loop_hints *hints) {
+  int had = has_pending_hints;
+  *hints = pending_hints;
+  memset(&pending_hints, 0, sizeof(pending_hints));
+  has_pending_hints = 0;
+  return had;
+}
+
+static LLVMMetadataRef loop_hint(const char *name, LLVMValueRef value) {
+  LLVMContextRef ctx = LLVMGetGlobalContext();
+  LLVMMetadataRef ops[2] = { LLVMMDStringInContext2(ctx, name, strlen(name)), value ? LLVMValueAsMetadata(value) : NULL };
+  return LLVMMDNodeInContext2(ctx, ops, value ? 2 : 1);
+}
+
+static void loop_apply_hints(const pragma_loop_hints *h, LLVMBasicBlockRef header) {
+  LLVMContextRef ctx = LLVMGetGlobalContext();
+  LLVMTypeRef i1 = LLVMInt1Type();
+  LLVMMetadataRef ops[8];
+  unsigned n = 1;
+  if (h->unroll == PRAGMA_HINT_ENABLE) ops[n++] = loop_hint("llvm.loop.unroll.enable", NULL);
+  if (h->unroll == PRAGMA_HINT_DISABLE) ops[n++] = loop_hint("llvm.loop.unroll.disable", NULL);
+  if (h->unroll == PRAGMA_HINT_FULL) ops[n++] = loop_hint("llvm.loop.unroll.full", NULL);
+  if (h->unroll_count) ops[n++] = loop_hint("llvm.loop.unroll.count", LLVMConstInt(i32_type, h->unroll_count, 0));
+  if (h->vectorize) ops[n++] = loop_hint("llvm.loop.vectorize.enable", LLVMConstInt(i1, h->vectorize != PRAGMA_HINT_DISABLE, 0));
+  if (h->vectorize_width) ops[n++] = loop_hint("llvm.loop.vectorize.width", LLVMConstInt(i32_type, h->vectorize_width, 0));
+  if (h->interleave == PRAGMA_HINT_DISABLE) ops[n++] = loop_hint("llvm.loop.interleave.count", LLVMConstInt(i32_type, 1, 0));
+  if (h->interleave_count) ops[n++] = loop_hint("llvm.loop.interleave.count", LLVMConstInt(i32_type, h->interleave_count, 0));
+
+  // El primer operando de un llvm.loop es el propio nodo, que así queda distinto de cualquier otro
+  LLVMMetadataRef self = LLVMTemporaryMDNode(ctx, NULL, 0);
+  ops[0] = self;
+  LLVMMetadataRef loop_id = LLVMMDNodeInContext2(ctx, ops, n);
+  LLVMMetadataReplaceAllUsesWith(self, loop_id);
+  LLVMValueRef loop_value = LLVMMetadataAsValue(ctx, loop_id);
+
+  unsigned loop_kind = LLVMGetMDKindID("llvm.loop", 9);
+  unsigned access_kind = LLVMGetMDKindID("llvm.mem.parallel_loop_access", 29);
+  for (LLVMBasicBlockRef bb = header; bb; bb = LLVMGetNextBasicBlock(bb)) { // Los bloques del bucle van del encabezado al final
+    LLVMValueRef term = LLVMGetBasicBlockTerminator(bb);
+    for (unsigned i = 0; term && i < LLVMGetNumSuccessors(term); i++) {
+      if (LLVMGetSuccessor(term, i) == header) {
+        LLVMSetMetadata(term, loop_kind, loop_value);
+        break;
+      }
+    }
+    if (!h->ivdep) continue;
+    for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst; inst = LLVMGetNextInstruction(inst)) {
+      if (!LLVMIsALoadInst(inst) && !LLVMIsAStoreInst(inst)) continue;
+      // Dentro de otro bucle con ivdep el acceso lista los dos
+      LLVMValueRef outer = LLVMGetMetadata(inst, access_kind);
+      if (outer) {
+        LLVMMetadataRef both[2] = { LLVMValueAsMetadata(outer), loop_id };
+        LLVMSetMetadata(inst, access_kind, LLVMMetadataAsValue(ctx, LLVMMDNodeInContext2(ctx, both, 2)));
+      } else {
+        LLVMSetMetadata(inst, access_kind, loop_value);
+      }
+    }
+  }
+}
+static void codegen_parallel_for(ast_node *stmt, const pragma_info *info, LLVMValueRef current_fn);
 static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
   if (!stmt) {
     //     fprintf(stderr, "[codegen_statement] stmt == NULL\n");
     return;
   }
+  if (stack_low()) {
+    deep_call call = { stmt, current_fn, NULL, NULL, NULL, NULL };
+    stack_extend(codegen_statement_deep, &call);
+    return;
+  }
+  debug_set_location(stmt);
   //   fprintf(stderr, "\n[codegen_statement] entrada: type=%d lineno=%d addr=%p\n", stmt->type, stmt->lineno, (void*)stmt);
 
   switch (stmt->type) {
 
 
-    case NT_SWITCH: { // NO SE NECESITA
-      //printf("[codegen_statement] SWITCH - adaptado a estructura actual\n");
-
+    case NT_SWITCH: {
       ast_node *switch_expr = stmt->child;
-      ast_node *switch_body = switch_expr->sibling;
-
-      // Generar expresión del switch
-      LLVMValueRef switch_value = codegen_expr(switch_expr, current_fn);
-
-      LLVMContextRef ctx = LLVMGetGlobalContext();
-      LLVMBasicBlockRef switch_end_block = LLVMCreateBasicBlockInContext(ctx, "switch.end");
-      LLVMBasicBlockRef switch_default_block = LLVMCreateBasicBlockInContext(ctx, "switch.default");
-
-      // Guardar estado para break
-      LLVMBasicBlockRef prev_switch_end = current_switch_end_block;
-      current_switch_end_block = switch_end_block;
-
-      LLVMValueRef switch_inst = LLVMBuildSwitch(builder, switch_value, switch_default_block, 0);
-
-
-      ast_node *case_node = switch_body->child;
-      int case_index = 0;
-
-      while (case_node != NULL) {
-        if (case_node->type == 13) { // CASE_VALUE con asignación
-          //printf("  Procesando CASE_VALUE[%d]\n", case_index);
-
-          ast_node *case_value_node = case_node->child; // Valor del case
-          ast_node *assign_node = case_value_node->sibling; // Asignación
-
-          // Generar valor del case
-          LLVMValueRef case_value = codegen_expr(case_value_node, current_fn);
-
-
-          char case_block_name[32];
-          snprintf(case_block_name, sizeof(case_block_name), "switch.case.%d", case_index);
-          LLVMBasicBlockRef case_block = LLVMCreateBasicBlockInContext(ctx, case_block_name);
+      ast_node *switch_body = switch_expr ? switch_expr->sibling : NULL;
+      if (!switch_body) return;
+
+      int switch_unsigned;
+      LLVMValueRef switch_value = codegen_expr_sign(switch_expr, current_fn, &switch_unsigned);
+      if (!switch_value || !is_int_type(LLVMTypeOf(switch_value))) {
+        fprintf(stderr, "ERROR: la expresión de un switch debe ser entera (linea %d)\n", stmt->lineno);
+        codegen_errors++;
+        return;
+      }
+      switch_value = promote_int(switch_value, &switch_unsigned);
 
-          LLVMAddCase(switch_inst, case_value, case_block);
+      // Sin default el switch salta al final; un default en el cuerpo reemplaza ese destino
+      LLVMBasicBlockRef end_block = LLVMAppendBasicBlock(current_fn, "switch.end");
+      switch_ctx sw = { NULL, LLVMTypeOf(switch_value), 0, profile_counter(), NULL, 0, 0 };
+      sw.inst = LLVMBuildSwitch(builder, switch_value, end_block, 0);
 
+      switch_ctx *prev_switch = current_switch;
+      LLVMBasicBlockRef prev_break = current_break_block;
+      current_switch = &sw;
+      current_break_block = end_block;
 
-          LLVMPositionBuilderAtEnd(builder, case_block);
-          codegen_statement(assign_node, current_fn);
+      // Lo que precede al primer case es inalcanzable
+      LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(current_fn, "switch.body"));
+      codegen_statement(switch_body, current_fn);
+      if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, end_block);
+      }
 
+      if (!sw.has_default) {
+        LLVMSetSuccessor(sw.inst, 0, profile_edge(current_fn, end_block, sw.default_id));
+      }
+      if (prof_counts) { // El primer peso es el de default, luego uno por case en orden
+        uint64_t *w = malloc((sw.ncases + 1) * sizeof(uint64_t));
+        w[0] = profile_count(sw.default_id);
+        for (unsigned i = 0; i < sw.ncases; i++) w[i + 1] = profile_count(sw.case_ids[i]);
+        profile_set_weights(sw.inst, w, sw.ncases + 1);
+        free(w);
+      }
+      free(sw.case_ids);
 
-          if (LLVMGetInsertBlock(builder) != NULL) {
-            LLVMBuildBr(builder, switch_end_block);
-          }
+      current_switch = prev_switch;
+      current_break_block = prev_break;
+      LLVMPositionBuilderAtEnd(builder, end_block);
+      break;
+    }
 
-        } else if (case_node->type == 14) { 
-          //printf("  Procesando CASE_FINAL como DEFAULT\n");
+    case NT_CASE: {
+      ast_node *value_node = stmt->child;
+      ast_node *labeled = value_node ? value_node->sibling : NULL;
+      if (!current_switch) {
+        fprintf(stderr, "ERROR: case fuera de un switch (linea %d)\n", stmt->lineno);
+        codegen_errors++;
+        break;
+      }
+      int value_unsigned = 0;
+      LLVMValueRef value = codegen_expr_sign(value_node, current_fn, &value_unsigned);
+      if (!value || !LLVMIsAConstantInt(value)) {
+        fprintf(stderr, "ERROR: la etiqueta de un case debe ser una constante entera (linea %d)\n", stmt->lineno);
+        codegen_errors++;
+        value = NULL;
+      }
 
-          LLVMPositionBuilderAtEnd(builder, switch_default_block);
-          codegen_statement(case_node->child, current_fn);             
-          if (LLVMGetInsertBlock(builder) != NULL) {
-            LLVMBuildBr(builder, switch_end_block);
-          }
+      LLVMBasicBlockRef case_block = LLVMAppendBasicBlock(current_fn, "switch.case");
+      // Sin break el case anterior continúa en éste
+      if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, case_block);
+      }
+      if (value) {
+        switch_ctx *sw = current_switch;
+        unsigned id = profile_counter();
+        LLVMAddCase(sw->inst, LLVMConstIntCast(value, sw->type, !value_unsigned), profile_edge(current_fn, case_block, id));
+        if (sw->ncases == sw->cap) {
+          sw->cap = sw->cap ? sw->cap * 2 : 8;
+          sw->case_ids = realloc(sw->case_ids, sw->cap * sizeof(unsigned));
         }
-
-        case_node = case_node->sibling;
-        case_index++;
+        sw->case_ids[sw->ncases++] = id;
       }
+      LLVMPositionBuilderAtEnd(builder, case_block);
+      codegen_statement(labeled, current_fn);
+      break;
+    }
 
-      if (LLVMGetBasicBlockTerminator(switch_default_block) == NULL) {
-        LLVMPositionBuilderAtEnd(builder, switch_default_block);
-        LLVMBuildBr(builder, switch_end_block);
+    case NT_DEFAULT: {
+      if (!current_switch || current_switch->has_default) {
+        fprintf(stderr, "ERROR: default %s (linea %d)\n", current_switch ? "repetido en el switch" : "fuera de un switch", stmt->lineno);
+        codegen_errors++;
+        break;
+      }
+      LLVMBasicBlockRef default_block = LLVMAppendBasicBlock(current_fn, "switch.default");
+      if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, default_block);
       }
+      current_switch->has_default = 1;
+      LLVMSetSuccessor(current_switch->inst, 0, profile_edge(current_fn, default_block, current_switch->default_id));
+      LLVMPositionBuilderAtEnd(builder, default_block);
+      codegen_statement(stmt->child, current_fn);
+      break;
+    }
 
-      LLVMPositionBuilderAtEnd(builder, switch_end_block);
-      current_switch_end_block = prev_switch_end;
+    case NT_BREAK:
+    case NT_CONTINUE: {
+      LLVMBasicBlockRef target = stmt->type == NT_BREAK ? current_break_block : current_continue_block;
+      if (!target) {
+        fprintf(stderr, "ERROR: %s fuera de un %s (linea %d)\n", stmt->type == NT_BREAK ? "break" : "continue",
+                stmt->type == NT_BREAK ? "bucle o switch" : "bucle", stmt->lineno);
+        codegen_errors++;
+        break;
+      }
+      LLVMBuildBr(builder, target);
+      break;
+    }
 
-      //printf("  SWITCH completado\n");
+    case NT_GOTO: {
+      ast_node *target = stmt->child;
+      if (!target) break;
+      if (target->type == NT_ID) {
+        LLVMBuildBr(builder, label_get(target->value.strVal, stmt->lineno)->block);
+        break;
+      }
+      // goto *expr: salto a una dirección tomada con &&etiqueta
+      LLVMValueRef addr = target->child ? codegen_expr(target->child, current_fn) : NULL;
+      if (!addr || !is_int_type(LLVMTypeOf(addr)) || LLVMGetIntTypeWidth(LLVMTypeOf(addr)) != 64) {
+        fprintf(stderr, "ERROR: goto * necesita una dirección de etiqueta (un long) (linea %d)\n", stmt->lineno);
+        codegen_errors++;
+        break;
+      }
+      addr = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8_type, 0), "target");
+      if (n_indirect_branches == indirect_branches_cap) {
+        indirect_branches_cap = indirect_branches_cap ? indirect_branches_cap * 2 : 8;
+        indirect_branches = realloc(indirect_branches, indirect_branches_cap * sizeof(LLVMValueRef));
+      }
+      indirect_branches[n_indirect_branches++] = LLVMBuildIndirectBr(builder, addr, 0);
       break;
     }
-    case NT_BREAK: { // NO SE NECESITa
-      //printf("[codegen_statement] BREAK encontrado (type=13) en línea %d\n", stmt->lineno);
 
-      if (current_switch_end_block != NULL) {
-        printf("  -> Break dentro de switch, saltando al final del switch\n");
-      } else {
-        printf("  -> Break fuera de switch (no implementado)\n");
+    case NT_ETIQUETA: {
+      ast_node *name = stmt->child;
+      if (!name) break;
+      label_entry *l = label_get(name->value.strVal, stmt->lineno);
+      if (l->defined) {
+        fprintf(stderr, "ERROR: la etiqueta '%s' está repetida (linea %d)\n", l->name, stmt->lineno);
+        codegen_errors++;
+        codegen_statement(name->sibling, current_fn);
+        break;
       }
+      l->defined = 1;
+      // El código anterior continúa en la etiqueta; su bloque se acomoda aquí, en el orden del fuente
+      if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, l->block);
+      }
+      LLVMMoveBasicBlockAfter(l->block, LLVMGetInsertBlock(builder));
+      LLVMPositionBuilderAtEnd(builder, l->block);
+      codegen_statement(name->sibling, current_fn);
       break;
     }
+
     case NT_DECLARACION: {
       //       fprintf(stderr, "[codegen_statement] DECLARACION\n");
       ast_node *tipo = stmt->child;
       LLVMTypeRef decl_type = map_type_node(tipo);
+      int decl_unsigned = type_is_unsigned(tipo);
       ast_node *inits = tipo ? tipo->sibling : NULL;
       for (ast_node *cur = inits; cur; cur = cur->sibling) {
         //         fprintf(stderr, "  decl element type=%d\n", cur->type);
-        if (cur->type == NT_VAR || cur->type == NT_ID) {
-          const char *name = cur->value.strVal;
-          //           fprintf(stderr, "    VAR %s type=%p\n", name?name:"(null)", (void*)decl_type);
-          LLVMValueRef a = create_entry_alloca(current_fn, name, decl_type);
-          if (!a) { 
-            //fprintf(stderr, "    ERROR: alloca NULL\n"); 
-            continue; }
-          sym_put(name, a);
+        ast_node *var, *init;
+        const char *name = declarator_parts(cur, &var, &init);
+        if (!name) continue;
+        LLVMTypeRef var_type = declarator_type(var, decl_type, init);
+        if (!var_type) continue;
+
+        if (ast_type_count(tipo, T_STATIC) > 0 || ast_type_count(tipo, T_EXTERN) > 0) {
+          // Almacenamiento estático: una global con nombre "función.variable" (sólo "variable" si es extern)
+          const char *fname = osr_function ? osr_function : LLVMGetValueName(current_fn);
+          char *gname = malloc(strlen(fname) + strlen(name) + 2);
+          if (ast_type_count(tipo, T_EXTERN) > 0) strcpy(gname, name);
+          else sprintf(gname, "%s.%s", fname, name);
+          LLVMValueRef g = codegen_global_variable(gname, var_type, tipo, init, cur->lineno);
+          if (g) {
+            sym_put(name, g, var_type, decl_unsigned);
+            debug_global_variable(g, name, var_type, decl_unsigned, cur->lineno);
+          }
+          free(gname);
+          continue;
         }
-        else if (cur->type == NT_OP_BINARIO && cur->value.op == 307) {
-          ast_node *left = cur->child;
-          ast_node *right = left ? left->sibling : NULL;
-          const char *vname = left ? left->value.strVal : "(null)";
-          //           fprintf(stderr, "    VAR+INIT %s\n", vname);
-          LLVMValueRef a = create_entry_alloca(current_fn, vname, decl_type);
-          if (!a) { 
-            //fprintf(stderr, "    ERROR: alloca NULL for init\n"); 
+
+        LLVMValueRef a = osr_slot(cur); // -run: la variable ya vive en el marco del intérprete
+        if (!a) {
+          a = create_entry_alloca(current_fn, name, var_type);
+          if (!a) {
+            //fprintf(stderr, "    ERROR: alloca NULL\n");
             continue; }
-          sym_put(vname, a);
-          LLVMValueRef rv = codegen_expr(right, current_fn);
-          if (rv) {
-            LLVMBuildStore(builder, rv, a);
-            //             fprintf(stderr, "    store init OK\n");
-          } else {
-            //             fprintf(stderr, "    WARNING: init produced NULL\n");
-          }
-        } else {
-          //           fprintf(stderr, "    elemento decl no soportado type=%d\n", cur->type);
+          align_array_storage(a, var_type);
+        }
+        sym_put(name, a, var_type, decl_unsigned);
+        debug_declare_variable(name, a, var_type, decl_unsigned, cur->lineno, 0);
+        if (init) {
+          codegen_local_init(a, var_type, decl_unsigned, init, current_fn, 0);
+        }
+      }
+      break;
+    }
+
+    case NT_PRAGMA: {
+      pragma_info info;
+      if (!pragma_parse(stmt->value.span.ptr, stmt->value.span.len, &info)) {
+        fprintf(stderr, "ERROR: #pragma %.*s: %s (linea %d)\n", stmt->value.span.len, stmt->value.span.ptr, info.error, stmt->lineno);
+        codegen_errors++;
+        break;
+      }
+      if (info.kind == PRAGMA_LOOP) {
+        pragma_merge_hints(&pending_hints, &info.loop);
+        has_pending_hints = 1;
+        ast_node *loop = stmt->child;
+        if (loop && loop->type != NT_FOR && loop->type != NT_WHILE && loop->type != NT_DO_WHILE && loop->type != NT_PRAGMA) {
+          fprintf(stderr, "WARNING: #pragma %.*s no precede a un bucle, se ignora (linea %d)\n", stmt->value.span.len, stmt->value.span.ptr, stmt->lineno);
+          loop_take_hints(&info.loop);
         }
+        codegen_statement(loop, current_fn);
+        loop_take_hints(&info.loop); // Si nadie las tomó
+        break;
+      }
+      if (info.kind == PRAGMA_OMP_PARALLEL_FOR && stmt->child && stmt->child->type == NT_FOR) {
+        codegen_parallel_for(stmt, &info, current_fn);
+        break;
+      }
+      // Un for que el simplificador quitó ya no tiene su pragma; los de bucle van antes del omp
+      if (info.kind != PRAGMA_UNKNOWN) {
+        fprintf(stderr, "ERROR: #pragma omp parallel for debe ir justo antes de un for (linea %d)\n", stmt->lineno);
+        codegen_errors++;
+        break;
       }
+      fprintf(stderr, "WARNING: #pragma %.*s no está soportado, se ignora (linea %d)\n", stmt->value.span.len, stmt->value.span.ptr, stmt->lineno);
+      codegen_statement(stmt->child, current_fn);
       break;
     }
 
+    case NT_BLOQUE: // Bloque anidado, o rama que quedó tras podar un if constante
+      codegen_block(stmt, current_fn);
+      break;
+
     case NT_EXPR_SENTENCIA: {
       //       fprintf(stderr, "[codegen_statement] EXPR_SENTENCIA\n");
       LLVMValueRef v = codegen_expr(stmt->child, current_fn);
@@ -1158,6 +2460,10 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
 
     case NT_RETURN: {
       //printf("[codegen_statement] RETURN\n");
+      if (osr_ret_type) {
+        codegen_osr_return(stmt, current_fn);
+        break;
+      }
 
       LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
       if (current_block == NULL) {
@@ -1167,14 +2473,21 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
       }
 
       //printf("  Bloque actual es válido, generando return...\n");
+      LLVMTypeRef ret_type = LLVMGetReturnType(LLVMGlobalGetValueType(current_fn));
+      if (LLVMGetTypeKind(ret_type) == LLVMVoidTypeKind) {
+        if (stmt->child) codegen_expr(stmt->child, current_fn);
+        LLVMBuildRetVoid(builder);
+        break;
+      }
+
+      int ru = 0;
       LLVMValueRef rv = NULL;
-      if (stmt->child) rv = codegen_expr(stmt->child, current_fn);
-      else rv = LLVMConstInt(i32_type, 0, 0);
+      if (stmt->child) rv = codegen_expr_sign(stmt->child, current_fn, &ru);
       if (!rv) {
         //         fprintf(stderr,"[codegen_statement] return: expr produjo NULL (line %d)\n", stmt->lineno);
-        LLVMBuildRet(builder, LLVMConstInt(i32_type, 0, 0));
+        LLVMBuildRet(builder, LLVMConstNull(ret_type));
       } else {
-        LLVMBuildRet(builder, rv);
+        LLVMBuildRet(builder, convert_checked(rv, ru, ret_type, current_ret_unsigned, stmt->lineno));
         //         fprintf(stderr, "[codegen_statement] return OK\n");
       }
       break;
@@ -1190,21 +2503,15 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
         return;
       }
 
-      LLVMValueRef cval = codegen_expr(cond, current_fn);
-      //       fprintf(stderr, "[codegen_statement] IF cond value = %p\n", (void*)cval);
-      if (!cval) { 
-        fprintf(stderr,"[codegen_statement] if: condición nula (linea %d)\n", stmt->lineno); 
-        return; 
-      }
-
       LLVMBasicBlockRef thenBB = LLVMAppendBasicBlock(current_fn, "then");
       LLVMBasicBlockRef elseBB = LLVMAppendBasicBlock(current_fn, "else");
       LLVMBasicBlockRef contBB = LLVMAppendBasicBlock(current_fn, "ifcont");
 
-      //       fprintf(stderr, "[codegen_statement] IF building condbr then=%p else=%p cont=%p\n", 
-      //   (void*)thenBB, (void*)elseBB, (void*)contBB);
-
-      LLVMBuildCondBr(builder, cval, thenBB, elseBB);
+      unsigned then_id = profile_counter();
+      unsigned else_id = profile_counter();
+      LLVMBasicBlockRef then_target = profile_edge(current_fn, thenBB, then_id);
+      codegen_cond_branch(cond, then_target, profile_edge(current_fn, elseBB, else_id), current_fn);
+      profile_cond_weights(cond, then_target, profile_count(then_id), profile_count(else_id));
 
       // Generar bloque THEN
       LLVMPositionBuilderAtEnd(builder, thenBB);
@@ -1239,11 +2546,13 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
       ast_node *inc = cond ? cond->sibling : NULL;
       ast_node *body = inc ? inc->sibling : NULL;
 
-      if (!init || !cond || !inc || !body) {
+      if (!body) {
         //         fprintf(stderr, "[codegen_statement] ERROR: estructura for inválida\n");
         return;
       }
 
+      pragma_loop_hints hints;
+      int hinted = loop_take_hints(&hints);
       codegen_expr(init, current_fn);
 
       LLVMBasicBlockRef condBB = LLVMAppendBasicBlock(current_fn, "for.cond");
@@ -1254,19 +2563,24 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
       LLVMBuildBr(builder, condBB);
 
       LLVMPositionBuilderAtEnd(builder, condBB);
-      LLVMValueRef cond_val = codegen_expr(cond, current_fn);
-      if (!cond_val) {
-        //         fprintf(stderr, "[codegen_statement] ERROR: condición en for inválida\n");
-        return;
-      }
-      LLVMBuildCondBr(builder, cond_val, bodyBB, afterBB);
-
+      unsigned body_id = profile_counter();
+      unsigned exit_id = profile_counter();
+      LLVMBasicBlockRef body_target = profile_edge(current_fn, bodyBB, body_id);
+      codegen_cond_branch(cond, body_target, profile_edge(current_fn, afterBB, exit_id), current_fn);
+      profile_cond_weights(cond, body_target, profile_count(body_id), profile_count(exit_id));
+
+      LLVMBasicBlockRef prev_break = current_break_block;
+      LLVMBasicBlockRef prev_continue = current_continue_block;
+      current_break_block = afterBB;
+      current_continue_block = incBB;
       LLVMPositionBuilderAtEnd(builder, bodyBB);
       if (body->type == NT_BLOQUE) {
         codegen_block(body, current_fn); 
       } else {
         codegen_statement(body, current_fn); 
       }
+      current_break_block = prev_break;
+      current_continue_block = prev_continue;
 
       if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
         LLVMBuildBr(builder, incBB);
@@ -1278,6 +2592,7 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
       if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
         LLVMBuildBr(builder, condBB);
       }
+      if (hinted) loop_apply_hints(&hints, condBB);
 
       LLVMPositionBuilderAtEnd(builder, afterBB);
       break;
@@ -1289,6 +2604,8 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
       ast_node* while_node = stmt;
       ast_node* cond_node = while_node->child;
       ast_node* body_node = while_node->child->sibling;
+      pragma_loop_hints hints;
+      int hinted = loop_take_hints(&hints);
 
       // Crear bloques básicos
       LLVMBasicBlockRef cond_block = LLVMAppendBasicBlock(current_fn, "while_cond");
@@ -1300,44 +2617,40 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
 
       // Bloque de condición
       LLVMPositionBuilderAtEnd(builder, cond_block);
-      LLVMValueRef cond_value = codegen_expr(cond_node, current_fn);
-      if (!cond_value) return;
-
-      LLVMTypeRef cond_type = LLVMTypeOf(cond_value);
-      LLVMValueRef bool_cond;
-
-      if (LLVMGetTypeKind(cond_type) == LLVMIntegerTypeKind && 
-        LLVMGetIntTypeWidth(cond_type) == 1) {
-        bool_cond = cond_value;
-      } else {
-        bool_cond = LLVMBuildICmp(builder, LLVMIntNE, cond_value, 
-                                  LLVMConstInt(LLVMInt32Type(), 0, 0), "while_cond");
-      }
-
-      LLVMBuildCondBr(builder, bool_cond, body_block, after_block);
-
+      unsigned body_id = profile_counter();
+      unsigned exit_id = profile_counter();
+      LLVMBasicBlockRef body_target = profile_edge(current_fn, body_block, body_id);
+      codegen_cond_branch(cond_node, body_target, profile_edge(current_fn, after_block, exit_id), current_fn);
+      profile_cond_weights(cond_node, body_target, profile_count(body_id), profile_count(exit_id));
+
+      LLVMBasicBlockRef prev_break = current_break_block;
+      LLVMBasicBlockRef prev_continue = current_continue_block;
+      current_break_block = after_block;
+      current_continue_block = cond_block;
       LLVMPositionBuilderAtEnd(builder, body_block);
       if (body_node->type == 7) { // BLOCK
         codegen_block(body_node, current_fn);
       } else {
         codegen_statement(body_node, current_fn);
       }
+      current_break_block = prev_break;
+      current_continue_block = prev_continue;
 
-      LLVMBuildBr(builder, cond_block);
+      if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, cond_block);
+      }
+      if (hinted) loop_apply_hints(&hints, cond_block);
 
       LLVMPositionBuilderAtEnd(builder, after_block);
 
       break;
     } 
-    case NT_DO_WHILE : { // DO_WHILE statement NO SE NECESITa
-      //       fprintf(stderr, "[codegen_statement] DO_WHILE loop\n");
-
-      ast_node* do_while_node = stmt;
-      ast_node* body_node = do_while_node->child;
-      ast_node* cond_block_node = do_while_node->child->sibling;
-
-      //       fprintf(stderr, "=== DEBUG: Body type: %d, Cond block type: %d\n", 
-      //  body_node->type, cond_block_node->type);
+    case NT_DO_WHILE : {
+      // El parser guarda la condición como primer hijo y el cuerpo como su hermano
+      ast_node* cond_node = stmt->child;
+      ast_node* body_node = cond_node ? cond_node->sibling : NULL;
+      pragma_loop_hints hints;
+      int hinted = loop_take_hints(&hints);
 
       // Crear bloques básicos
       LLVMBasicBlockRef body_block = LLVMAppendBasicBlock(current_fn, "do_body");
@@ -1347,294 +2660,1138 @@ static void codegen_statement(ast_node *stmt, LLVMValueRef current_fn) {
       // Saltar al cuerpo
       LLVMBuildBr(builder, body_block);
 
+      // La condición decide entre repetir (arista de regreso) y salir
+      unsigned back_id = profile_counter();
+      unsigned exit_id = profile_counter();
+
       // Cuerpo
+      LLVMBasicBlockRef prev_break = current_break_block;
+      LLVMBasicBlockRef prev_continue = current_continue_block;
+      current_break_block = after_block;
+      current_continue_block = cond_block;
       LLVMPositionBuilderAtEnd(builder, body_block);
-      if (body_node->type == 22) {
-        LLVMValueRef body_result = codegen_expr(body_node, current_fn);
-        (void)body_result; // Evitar warning de variable no usada
-      } else if (body_node->type == 7) {
+      if (body_node && body_node->type == NT_BLOQUE) {
         codegen_block(body_node, current_fn);
       } else {
         codegen_statement(body_node, current_fn);
       }
-      LLVMBuildBr(builder, cond_block);
+      current_break_block = prev_break;
+      current_continue_block = prev_continue;
+      if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, cond_block);
+      }
 
+      // Condición
       LLVMPositionBuilderAtEnd(builder, cond_block);
+      LLVMBasicBlockRef back_target = profile_edge(current_fn, body_block, back_id);
+      codegen_cond_branch(cond_node, back_target, profile_edge(current_fn, after_block, exit_id), current_fn);
+      profile_cond_weights(cond_node, back_target, profile_count(back_id), profile_count(exit_id));
+      if (hinted) loop_apply_hints(&hints, body_block);
 
-      LLVMValueRef cond_value = NULL;
-      if (cond_block_node->type == 7 && cond_block_node->child) {
-        ast_node* current_stmt = cond_block_node->child;
-        ast_node* last_expr = NULL;
+      // After
+      LLVMPositionBuilderAtEnd(builder, after_block);
 
-        while (current_stmt) {
-          if (current_stmt->type == 20 || current_stmt->type == 22) {
-            last_expr = current_stmt;
-          }
-          current_stmt = current_stmt->sibling;
-        }
+      break;
 
-        if (last_expr) {
-          current_stmt = cond_block_node->child;
-          while (current_stmt && current_stmt != last_expr) {
-            codegen_statement(current_stmt, current_fn);
-            current_stmt = current_stmt->sibling;
-          }
+    }
 
-          if (last_expr->type == 20) {
-            cond_value = codegen_expr(last_expr->child, current_fn);
-          } else if (last_expr->type == 22) {
-            cond_value = codegen_expr(last_expr, current_fn);
-          }
-        }
-      }
+    default:
+    //       fprintf(stderr, "[codegen_statement] tipo no soportado %d (addr=%p)\n", stmt->type, (void*)stmt);
+  }
+}
 
-      if (!cond_value) {
-        //         fprintf(stderr, "Error: No se pudo generar condición. Usando condición falsa.\n");
-        cond_value = LLVMConstInt(LLVMInt32Type(), 0, 0);
-      }
 
-      // Convertir a booleano
-      LLVMValueRef bool_cond = LLVMBuildICmp(builder, LLVMIntNE, cond_value, 
-                                             LLVMConstInt(LLVMInt32Type(), 0, 0), "do_cond");
+// =======================================================
+// BLOQUE
+// =======================================================
+void codegen_block(ast_node *block, LLVMValueRef function) {
+  if (!block) {
+    //     fprintf(stderr, "[codegen_block] block == NULL\n");
+    return;
+  }
+  //   fprintf(stderr, "codegen_block: ENTER block=%p type=%d\n", (void*)block, block->type);
+  if (block->type != NT_BLOQUE) {
+    //     fprintf(stderr, "[codegen_block] ERROR: nodo no es BLOQUE (type=%d)\n", block->type);
+    return;
+  }
+  ast_node *stmt = block->child;
+  int idx = 0;
+  while (stmt) {
+    //     fprintf(stderr, "  BLOCK stmt #%d type=%d ptr=%p lineno=%d\n", idx, stmt->type, (void*)stmt, stmt->lineno);
+    // Código después de un return: se genera en un bloque inalcanzable para no romper el IR
+    if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+      LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(function, "unreachable"));
+    }
+    codegen_statement(stmt, function);
+    //     fprintf(stderr, "  returned from stmt #%d\n", idx);
+    stmt = stmt->sibling;
+    idx++;
+  }
+  //   fprintf(stderr, "codegen_block: EXIT\n");
+}
+
+
+// =======================================================
+// BUCLES PARALELOS (#pragma omp parallel for)
+// =======================================================
+/*
+The loop must be canonical: for (i = a; i < b; i += c) with <, <=, > or
+>= against the loop variable and ++, --, += c, -= c or i = i +/- c by a
+constant. The parent evaluates a and b once and computes the trip
+count; the body goes into an internal function <fn>.omp.<n>(ctx, state)
+that runs the ranges of iterations __freezepiler_parallel_for hands it.
+ctx holds the address of the first value and of every local visible at
+the loop, so the body uses the parent's variables in place; the loop
+variable and the reduction variables get private copies, and each
+thread merges its partial results at the end under the parallel lock.
+*/
+static unsigned omp_outlined_count = 0;
+
+typedef struct omp_loop {
+  const char *var;
+  ast_node *start, *bound;
+  int cmp;   // T_LT, T_LE, T_GT o T_GE
+  long step;
+} omp_loop;
+
+static int is_var(ast_node *node, const char *name) {
+  return node && node->type == NT_ID && (!name || strcmp(node->value.strVal, name) == 0);
+}
+
+static int omp_canonical_loop(ast_node *for_node, omp_loop *loop) {
+  ast_node *init = for_node->child;
+  ast_node *cond = init->sibling;
+  ast_node *inc = cond->sibling;
+
+  if (init->type != NT_OP_BINARIO || init->value.op != T_ASSIGN || !is_var(init->child, NULL)) return 0;
+  loop->var = init->child->value.strVal;
+  loop->start = init->child->sibling;
+
+  if (cond->type != NT_OP_BINARIO || !is_var(cond->child, loop->var)) return 0;
+  loop->cmp = cond->value.op;
+  if (loop->cmp != T_LT && loop->cmp != T_LE && loop->cmp != T_GT && loop->cmp != T_GE) return 0;
+  loop->bound = cond->child->sibling;
+
+  loop->step = 0;
+  if (inc->type == NT_OP_UNARIO && is_var(inc->child, loop->var)) {
+    if (inc->value.op == T_INC) loop->step = 1;
+    if (inc->value.op == T_DEC) loop->step = -1;
+  } else if (inc->type == NT_OP_BINARIO && is_var(inc->child, loop->var)) {
+    ast_node *r = inc->child->sibling;
+    int op = inc->value.op;
+    if (op == T_ASSIGN && r->type == NT_OP_BINARIO && is_var(r->child, loop->var)) { // i = i + c
+      op = r->value.op == T_PLUS ? T_ASSIGN_PLUS : r->value.op == T_MINUS ? T_ASSIGN_MINUS : 0;
+      r = r->child->sibling;
+    }
+    int c;
+    if (ast_int_literal(r, &c) && op == T_ASSIGN_PLUS) loop->step = c;
+    if (ast_int_literal(r, &c) && op == T_ASSIGN_MINUS) loop->step = -(long)c;
+  }
+  // El paso tiene que acercar la variable al límite
+  return (loop->cmp == T_LT || loop->cmp == T_LE) ? loop->step > 0 : loop->step < 0;
+}
+
+static int is_return(ast_node *node, int depth, void *data) {
+  return node->type == NT_RETURN;
+}
+
+// Valor inicial de la copia privada de una reducción; max y min parten del valor compartido
+static LLVMValueRef omp_reduction_identity(pragma_reduction_op op, LLVMTypeRef type, LLVMValueRef shared) {
+  int fp = is_float_type(type);
+  switch (op) {
+    case PRAGMA_RED_MUL:
+    case PRAGMA_RED_LAND:
+      return fp ? LLVMConstReal(type, 1.0) : LLVMConstInt(type, 1, 0);
+    case PRAGMA_RED_BAND:
+      return LLVMConstAllOnes(type);
+    case PRAGMA_RED_MAX:
+    case PRAGMA_RED_MIN:
+      return LLVMBuildLoad2(builder, type, shared, "omp.shared");
+    default:
+      return LLVMConstNull(type);
+  }
+}
+
+static LLVMValueRef omp_reduction_combine(pragma_reduction_op op, LLVMValueRef a, LLVMValueRef b, LLVMTypeRef type, int u) {
+  int ru = 0;
+  switch (op) {
+    case PRAGMA_RED_ADD: return convert_value(build_binary(T_PLUS, a, u, b, u, &ru), ru, type, u);
+    case PRAGMA_RED_MUL: return convert_value(build_binary(T_STAR, a, u, b, u, &ru), ru, type, u);
+    case PRAGMA_RED_BAND: return LLVMBuildAnd(builder, a, b, "");
+    case PRAGMA_RED_BOR: return LLVMBuildOr(builder, a, b, "");
+    case PRAGMA_RED_BXOR: return LLVMBuildXor(builder, a, b, "");
+    case PRAGMA_RED_LAND:
+    case PRAGMA_RED_LOR: {
+      LLVMValueRef x = cast_to_bool(a), y = cast_to_bool(b);
+      LLVMValueRef r = op == PRAGMA_RED_LAND ? LLVMBuildAnd(builder, x, y, "") : LLVMBuildOr(builder, x, y, "");
+      return convert_value(r, 1, type, u);
+    }
+    case PRAGMA_RED_MAX:
+    case PRAGMA_RED_MIN:
+      return LLVMBuildSelect(builder, build_binary(op == PRAGMA_RED_MAX ? T_GT : T_LT, a, u, b, u, &ru), a, b, "");
+  }
+  return b;
+}
+
+// Número de iteraciones de un bucle canónico, en i64: 0 si la condición falla desde el principio
+static LLVMValueRef omp_trip_count(const omp_loop *loop, LLVMValueRef start, LLVMValueRef bound) {
+  LLVMTypeRef i64 = LLVMInt64Type();
+  int up = loop->step > 0;
+  long s = up ? loop->step : -loop->step;
+  LLVMValueRef diff = up ? LLVMBuildSub(builder, bound, start, "omp.diff") : LLVMBuildSub(builder, start, bound, "omp.diff");
+  if (loop->cmp == T_LE || loop->cmp == T_GE) {
+    diff = LLVMBuildAdd(builder, diff, LLVMConstInt(i64, 1, 0), "omp.diff");
+  }
+  LLVMValueRef count = LLVMBuildSDiv(builder, LLVMBuildAdd(builder, diff, LLVMConstInt(i64, s - 1, 0), ""),
+                                     LLVMConstInt(i64, s, 0), "omp.count");
+  LLVMValueRef positive = LLVMBuildICmp(builder, LLVMIntSGT, diff, LLVMConstInt(i64, 0, 0), "");
+  return LLVMBuildSelect(builder, positive, count, LLVMConstInt(i64, 0, 0), "omp.n");
+}
+
+static void codegen_parallel_for(ast_node *stmt, const pragma_info *info, LLVMValueRef current_fn) {
+  ast_node *for_node = stmt->child;
+  ast_node *body = for_node->child->sibling->sibling->sibling;
+  omp_loop loop;
+  if (!omp_canonical_loop(for_node, &loop)) {
+    fprintf(stderr, "ERROR: el for de #pragma omp parallel for debe tener la forma i = a; i < b; i += c (linea %d)\n", stmt->lineno);
+    codegen_errors++;
+    return;
+  }
+  sym_entry *var = sym_lookup(loop.var);
+  if (!var || !is_int_type(var->type)) {
+    fprintf(stderr, "ERROR: la variable de un for paralelo debe ser entera (linea %d)\n", stmt->lineno);
+    codegen_errors++;
+    return;
+  }
+  pragma_loop_hints hints; // Las de otro #pragma van al bucle de cada rango
+  int hinted = loop_take_hints(&hints);
+  ast_node *ret = ast_preorder(body, is_return, NULL);
+  if (ret) {
+    fprintf(stderr, "ERROR: return dentro de un for paralelo (linea %d)\n", ret->lineno);
+    codegen_errors++;
+    return;
+  }
+
+  // Primer valor y número de iteraciones, una sola vez en el padre
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+  int su, bu;
+  LLVMValueRef start = codegen_expr_sign(loop.start, current_fn, &su);
+  LLVMValueRef bound = codegen_expr_sign(loop.bound, current_fn, &bu);
+  if (!start || !bound) return;
+  start = convert_value(convert_value(start, su, var->type, var->is_unsigned), var->is_unsigned, i64, 0);
+  bound = convert_value(bound, bu, i64, 0);
+  LLVMValueRef n = omp_trip_count(&loop, start, bound);
+
+  // Variables locales visibles (la primera de cada nombre, las demás están ocultas)
+  unsigned ncaptured = 0;
+  for (sym_entry *e = sym_table; e; e = e->next) ncaptured++;
+  sym_entry **captured = malloc((ncaptured + 1) * sizeof(sym_entry *));
+  ncaptured = 0;
+  for (sym_entry *e = sym_table; e; e = e->next) {
+    int hidden = 0;
+    for (unsigned k = 0; k < ncaptured && !hidden; k++) hidden = strcmp(captured[k]->name, e->name) == 0;
+    if (!hidden) captured[ncaptured++] = e;
+  }
+
+  LLVMTypeRef ctx_type = LLVMArrayType(i8p, ncaptured + 1);
+  LLVMValueRef ctx = create_entry_alloca(current_fn, "omp.ctx", ctx_type);
+  LLVMValueRef start_slot = create_entry_alloca(current_fn, "omp.start", i64);
+  LLVMBuildStore(builder, start, start_slot);
+  for (unsigned k = 0; k <= ncaptured; k++) {
+    LLVMValueRef idx[2] = { LLVMConstInt(i32_type, 0, 0), LLVMConstInt(i32_type, k, 0) };
+    LLVMValueRef slot = LLVMBuildInBoundsGEP2(builder, ctx_type, ctx, idx, 2, "");
+    LLVMBuildStore(builder, LLVMBuildBitCast(builder, k ? captured[k - 1]->alloc : start_slot, i8p, ""), slot);
+  }
+
+  char name[256];
+  snprintf(name, sizeof(name), "%s.omp.%u", LLVMGetValueName(current_fn), omp_outlined_count++);
+  LLVMTypeRef outlined_params[2] = { i8p, i8p };
+  LLVMValueRef outlined = LLVMAddFunction(module, name, LLVMFunctionType(LLVMVoidType(), outlined_params, 2, 0));
+  LLVMSetLinkage(outlined, LLVMInternalLinkage);
+
+  LLVMTypeRef run_params[5] = { i8p, i8p, i64, i32_type, i64 };
+  LLVMValueRef run = external_function("__freezepiler_parallel_for", LLVMVoidType(), run_params, 5, 0);
+  LLVMValueRef run_args[5] = {
+    LLVMConstBitCast(outlined, i8p), LLVMBuildBitCast(builder, ctx, i8p, ""), n,
+    LLVMConstInt(i32_type, info->schedule, 0), LLVMConstInt(i64, info->chunk, 0)
+  };
+  build_external_call(run, run_args, 5);
+
+  // El cuerpo se genera en la función nueva, con su propio estado de función
+  LLVMBasicBlockRef parent_block = LLVMGetInsertBlock(builder);
+  sym_entry *parent_syms = sym_table;
+  LLVMBasicBlockRef parent_break = current_break_block, parent_continue = current_continue_block;
+  switch_ctx *parent_switch = current_switch;
+  label_entry *parent_labels = label_table;
+  LLVMValueRef parent_label_fn = label_function, *parent_indirect = indirect_branches;
+  unsigned parent_nindirect = n_indirect_branches, parent_indirect_cap = indirect_branches_cap;
+  LLVMMetadataRef parent_scope = debug_scope;
+  sym_table = NULL;
+  label_table = NULL;
+  indirect_branches = NULL;
+  n_indirect_branches = indirect_branches_cap = 0;
+  labels_begin(outlined);
+
+  LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(outlined, "entry"));
+  debug_begin_function(outlined, NULL);
+  debug_set_location(stmt);
+  LLVMValueRef ctx_param = LLVMBuildBitCast(builder, LLVMGetParam(outlined, 0), LLVMPointerType(i8p, 0), "ctx");
+  LLVMValueRef state = LLVMGetParam(outlined, 1);
+  for (unsigned k = 0; k <= ncaptured; k++) {
+    LLVMValueRef idx = LLVMConstInt(i32_type, k, 0);
+    LLVMValueRef addr = LLVMBuildLoad2(builder, i8p, LLVMBuildInBoundsGEP2(builder, i8p, ctx_param, &idx, 1, ""), "");
+    if (k == 0) {
+      start = LLVMBuildLoad2(builder, i64, LLVMBuildBitCast(builder, addr, LLVMPointerType(i64, 0), ""), "omp.start");
+      continue;
+    }
+    sym_entry *e = captured[k - 1];
+    sym_put(e->name, LLVMBuildBitCast(builder, addr, LLVMPointerType(e->type, 0), e->name), e->type, e->is_unsigned);
+  }
+  free(captured);
+
+  LLVMValueRef private_var = create_entry_alloca(outlined, loop.var, var->type);
+  sym_put(loop.var, private_var, var->type, var->is_unsigned);
+
+  LLVMValueRef shared[PRAGMA_MAX_REDUCTIONS], priv[PRAGMA_MAX_REDUCTIONS];
+  LLVMTypeRef red_type[PRAGMA_MAX_REDUCTIONS];
+  int red_unsigned[PRAGMA_MAX_REDUCTIONS];
+  pragma_reduction_op red_op[PRAGMA_MAX_REDUCTIONS];
+  int nred = 0;
+  for (int r = 0; r < info->nreductions; r++) {
+    const pragma_reduction *red = &info->reductions[r];
+    sym_entry *e = sym_lookup(red->name);
+    int bitwise = red->op == PRAGMA_RED_BAND || red->op == PRAGMA_RED_BOR || red->op == PRAGMA_RED_BXOR;
+    if (!e || strcmp(red->name, loop.var) == 0 || !(is_int_type(e->type) || (is_float_type(e->type) && !bitwise))) {
+      fprintf(stderr, "ERROR: '%s' no puede ser una variable de reduction (linea %d)\n", red->name, stmt->lineno);
+      codegen_errors++;
+      continue;
+    }
+    shared[nred] = e->alloc;
+    red_type[nred] = e->type;
+    red_unsigned[nred] = e->is_unsigned;
+    red_op[nred] = red->op;
+    priv[nred] = create_entry_alloca(outlined, red->name, e->type);
+    LLVMBuildStore(builder, omp_reduction_identity(red->op, e->type, e->alloc), priv[nred]);
+    sym_put(red->name, priv[nred], e->type, e->is_unsigned);
+    nred++;
+  }
+
+  LLVMValueRef lo = create_entry_alloca(outlined, "omp.lo", i64);
+  LLVMValueRef hi = create_entry_alloca(outlined, "omp.hi", i64);
+  LLVMValueRef iv = create_entry_alloca(outlined, "omp.iv", i64);
+  LLVMBasicBlockRef next_bb = LLVMAppendBasicBlock(outlined, "omp.next");
+  LLVMBasicBlockRef range_bb = LLVMAppendBasicBlock(outlined, "omp.range");
+  LLVMBasicBlockRef cond_bb = LLVMAppendBasicBlock(outlined, "omp.cond");
+  LLVMBasicBlockRef body_bb = LLVMAppendBasicBlock(outlined, "omp.body");
+  LLVMBasicBlockRef inc_bb = LLVMAppendBasicBlock(outlined, "omp.inc");
+  LLVMBasicBlockRef done_bb = LLVMAppendBasicBlock(outlined, "omp.done");
+  LLVMBuildBr(builder, next_bb);
+
+  // Pide rangos [lo, hi) hasta que no queden
+  LLVMPositionBuilderAtEnd(builder, next_bb);
+  LLVMTypeRef next_params[3] = { i8p, LLVMPointerType(i64, 0), LLVMPointerType(i64, 0) };
+  LLVMValueRef next_fn = external_function("__freezepiler_loop_next", i32_type, next_params, 3, 0);
+  LLVMValueRef next_args[3] = { state, lo, hi };
+  LLVMValueRef more = build_external_call(next_fn, next_args, 3);
+  LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntNE, more, LLVMConstInt(i32_type, 0, 0), ""), range_bb, done_bb);
+
+  LLVMPositionBuilderAtEnd(builder, range_bb);
+  LLVMBuildStore(builder, LLVMBuildLoad2(builder, i64, lo, ""), iv);
+  LLVMBuildBr(builder, cond_bb);
+
+  LLVMPositionBuilderAtEnd(builder, cond_bb);
+  LLVMValueRef iv_value = LLVMBuildLoad2(builder, i64, iv, "omp.iv");
+  LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntSLT, iv_value, LLVMBuildLoad2(builder, i64, hi, ""), ""), body_bb, next_bb);
+
+  // i = a + iv * c; continue pasa a la siguiente iteración y break no tiene destino
+  LLVMPositionBuilderAtEnd(builder, body_bb);
+  LLVMValueRef value = LLVMBuildNSWAdd(builder, start, LLVMBuildNSWMul(builder, iv_value, LLVMConstInt(i64, loop.step, 1), ""), "");
+  LLVMBuildStore(builder, convert_value(value, 0, var->type, var->is_unsigned), private_var);
+  current_break_block = NULL;
+  current_continue_block = inc_bb;
+  current_switch = NULL;
+  if (body->type == NT_BLOQUE) {
+    codegen_block(body, outlined);
+  } else {
+    codegen_statement(body, outlined);
+  }
+  if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+    LLVMBuildBr(builder, inc_bb);
+  }
+  LLVMMoveBasicBlockAfter(inc_bb, LLVMGetInsertBlock(builder));
+  LLVMMoveBasicBlockAfter(done_bb, inc_bb);
+
+  LLVMPositionBuilderAtEnd(builder, inc_bb);
+  LLVMBuildStore(builder, LLVMBuildNSWAdd(builder, LLVMBuildLoad2(builder, i64, iv, ""), LLVMConstInt(i64, 1, 0), ""), iv);
+  LLVMBuildBr(builder, cond_bb);
+  if (hinted) loop_apply_hints(&hints, cond_bb);
+
+  // Resultados parciales de las reducciones
+  LLVMPositionBuilderAtEnd(builder, done_bb);
+  if (nred > 0) {
+    build_external_call(external_function("__freezepiler_parallel_lock", LLVMVoidType(), NULL, 0, 0), NULL, 0);
+    for (int r = 0; r < nred; r++) {
+      LLVMValueRef total = LLVMBuildLoad2(builder, red_type[r], shared[r], "");
+      LLVMValueRef part = LLVMBuildLoad2(builder, red_type[r], priv[r], "");
+      LLVMBuildStore(builder, omp_reduction_combine(red_op[r], total, part, red_type[r], red_unsigned[r]), shared[r]);
+    }
+    build_external_call(external_function("__freezepiler_parallel_unlock", LLVMVoidType(), NULL, 0, 0), NULL, 0);
+  }
+  LLVMBuildRetVoid(builder);
+
+  labels_end();
+  free(indirect_branches);
+  debug_end_function();
+  sym_clear();
+
+  sym_table = parent_syms;
+  current_break_block = parent_break;
+  current_continue_block = parent_continue;
+  current_switch = parent_switch;
+  label_table = parent_labels;
+  label_function = parent_label_fn;
+  indirect_branches = parent_indirect;
+  n_indirect_branches = parent_nindirect;
+  indirect_branches_cap = parent_indirect_cap;
+  debug_scope = parent_scope;
+  LLVMPositionBuilderAtEnd(builder, parent_block);
+  debug_set_location(stmt);
+}
+
+
+// =======================================================
+// FUNCIÓN
+// =======================================================
+
+static void add_function_attribute(LLVMValueRef function, const char *name) {
+  unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+  LLVMAddAttributeAtIndex(function, LLVMAttributeFunctionIndex, LLVMCreateEnumAttribute(LLVMGetGlobalContext(), kind, 0));
+}
+
+// f(void) se representa con un único parámetro de tipo void sin nombre
+static int is_void_param(ast_node *param) {
+  ast_node *ptype = param ? param->child : NULL;
+  return ptype && ptype->value.intVal == T_VOID && ptype->sibling == NULL;
+}
+
+/*
+A function no other object file can see gets internal linkage, so the
+optimizer may inline it, drop it once unused, specialize its arguments
+and switch it to fastcc (calls read the convention from the callee).
+Only definitions qualify: a prototype may be defined in another file.
+*/
+static void codegen_linkage(LLVMValueRef function, ast_node *tipo_node, const char *fnname) {
+  int is_static = ast_type_count(tipo_node, T_STATIC) > 0;
+  int exported = strcmp(fnname, "main") == 0 || ast_type_count(tipo_node, T_EXTERN) > 0;
+  if (is_static || (whole_program && !exported)) {
+    LLVMSetLinkage(function, LLVMInternalLinkage);
+    LLVMSetFunctionCallConv(function, LLVMFastCallConv);
+  }
+  if (ast_type_count(tipo_node, T_INLINE) > 0) {
+    add_function_attribute(function, "inlinehint");
+  }
+}
+
+// Nombre de la función en los perfiles; las static de distintos archivos pueden llamarse igual
+static char *profile_function_name(LLVMValueRef function, ast_node *tipo_node) {
+  const char *fnname = LLVMGetValueName(function);
+  const char *prefix = ast_type_count(tipo_node, T_STATIC) > 0 && profile_module ? profile_module : NULL;
+  char *name = malloc(strlen(fnname) + (prefix ? strlen(prefix) + 1 : 0) + 1);
+  if (prefix) sprintf(name, "%s:%s", prefix, fnname);
+  else strcpy(name, fnname);
+  return name;
+}
+
+/*
+Starts the profile of a function body: picks its name in the profile,
+reserves counter 0 for its entries and, with -fprofile-use, looks up
+its counts and records function_entry_count. The counters live in a
+[0 x i64] placeholder until the function is done and their number is
+known.
+*/
+static void profile_begin_function(LLVMValueRef function, ast_node *tipo_node, ast_node *body) {
+  prof_next = 0;
+  prof_counters = NULL;
+  prof_counts = NULL;
+  if (!profile_generate && !profile_use) return;
+
+  prof_key = profile_function_name(function, tipo_node);
+  prof_hash = profile_function_hash(body);
+
+  if (profile_generate) {
+    prof_counters = LLVMAddGlobal(module, LLVMArrayType(LLVMInt64Type(), 0), "");
+  } else {
+    prof_counts = profile_lookup(profile_use, prof_key, prof_hash, &prof_ncounts);
+  }
+
+  unsigned entry_id = profile_counter();
+  profile_increment(entry_id);
+  if (prof_counts) {
+    LLVMContextRef ctx = LLVMGetModuleContext(module);
+    LLVMMetadataRef ops[2] = {
+      LLVMMDStringInContext2(ctx, "function_entry_count", 20),
+      LLVMValueAsMetadata(LLVMConstInt(LLVMInt64Type(), profile_count(entry_id), 0))
+    };
+    LLVMGlobalSetMetadata(function, LLVMGetMDKindID("prof", 4), LLVMMDNodeInContext2(ctx, ops, 2));
+  }
+}
+
+static void profile_end_function(void) {
+  if (!prof_key) return;
+  if (prof_counters) {
+    // Ya se sabe cuántos contadores hay: el arreglo real reemplaza al provisional
+    char *gname = malloc(strlen(prof_key) + 8);
+    sprintf(gname, "__prof.%s", prof_key);
+    LLVMTypeRef counters_type = LLVMArrayType(LLVMInt64Type(), prof_next);
+    LLVMValueRef counters = LLVMAddGlobal(module, counters_type, gname);
+    LLVMSetLinkage(counters, LLVMInternalLinkage);
+    LLVMSetInitializer(counters, LLVMConstNull(counters_type));
+    LLVMReplaceAllUsesWith(prof_counters, LLVMConstBitCast(counters, LLVMTypeOf(prof_counters)));
+    LLVMDeleteGlobal(prof_counters);
+    free(gname);
+
+    prof_fn *f = malloc(sizeof(prof_fn));
+    f->key = prof_key;
+    f->hash = prof_hash;
+    f->n = prof_next;
+    f->counters = counters;
+    f->next = prof_fns;
+    prof_fns = f;
+    prof_key = NULL;
+  } else if (prof_counts && prof_ncounts != prof_next) {
+    fprintf(stderr, "WARNING: el perfil de '%s' no corresponde al código (%u contadores, se esperaban %u)\n",
+            prof_key, prof_ncounts, prof_next);
+  }
+  free(prof_key);
+  prof_key = NULL;
+  prof_counters = NULL;
+  prof_counts = NULL;
+}
+
+// Constructores del módulo; llvm.global_ctors se emite una sola vez al final
+static LLVMValueRef module_ctors[4];
+static unsigned n_module_ctors = 0;
+
+// Creates an internal void() function run before main and leaves the builder in its entry block
+static LLVMValueRef module_constructor(const char *name) {
+  LLVMValueRef ctor = LLVMAddFunction(module, name, LLVMFunctionType(LLVMVoidType(), NULL, 0, 0));
+  LLVMSetLinkage(ctor, LLVMInternalLinkage);
+  add_function_attribute(ctor, "nounwind");
+  LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(ctor, "entry"));
+  module_ctors[n_module_ctors++] = ctor;
+  return ctor;
+}
+
+static void emit_module_constructors(void) {
+  if (n_module_ctors == 0) return;
+  LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+  LLVMTypeRef ctor_fields[3] = { i32_type, LLVMPointerType(LLVMFunctionType(LLVMVoidType(), NULL, 0, 0), 0), i8p };
+  LLVMTypeRef ctor_type = LLVMStructType(ctor_fields, 3, 0);
+  LLVMValueRef entries[4];
+  for (unsigned i = 0; i < n_module_ctors; i++) {
+    LLVMValueRef fields[3] = { LLVMConstInt(i32_type, 65535, 0), module_ctors[i], LLVMConstNull(i8p) };
+    entries[i] = LLVMConstStruct(fields, 3, 0);
+  }
+  LLVMValueRef ctors = LLVMAddGlobal(module, LLVMArrayType(ctor_type, n_module_ctors), "llvm.global_ctors");
+  LLVMSetLinkage(ctors, LLVMAppendingLinkage);
+  LLVMSetInitializer(ctors, LLVMConstArray(ctor_type, entries, n_module_ctors));
+  n_module_ctors = 0;
+}
+
+/*
+Emits the code that writes the profile. A module constructor registers
+__freezepiler.prof_dump with atexit, and at exit it appends one line
+per instrumented function of this module to the profile file.
+*/
+static void profile_emit_dump(void) {
+  LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMTypeRef void_fn_type = LLVMFunctionType(LLVMVoidType(), NULL, 0, 0);
+  LLVMTypeRef two_ptrs[2] = { i8p, i8p };
+  LLVMValueRef fopen_fn = external_function("fopen", i8p, two_ptrs, 2, 0);
+  LLVMValueRef fprintf_fn = external_function("fprintf", i32_type, two_ptrs, 2, 1);
+  LLVMValueRef fclose_fn = external_function("fclose", i32_type, &i8p, 1, 0);
+
+  LLVMValueRef dump = LLVMAddFunction(module, "__freezepiler.prof_dump", void_fn_type);
+  LLVMSetLinkage(dump, LLVMInternalLinkage);
+  add_function_attribute(dump, "nounwind");
+  LLVMBasicBlockRef entry = LLVMAppendBasicBlock(dump, "entry");
+  LLVMBasicBlockRef write_bb = LLVMAppendBasicBlock(dump, "write");
+  LLVMBasicBlockRef done_bb = LLVMAppendBasicBlock(dump, "done");
+
+  LLVMPositionBuilderAtEnd(builder, entry);
+  LLVMValueRef open_args[2] = {
+    LLVMBuildGlobalStringPtr(builder, profile_generate, "prof.path"),
+    LLVMBuildGlobalStringPtr(builder, "a", "prof.mode")
+  };
+  LLVMValueRef fp = build_external_call(fopen_fn, open_args, 2);
+  LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, fp, "prof.nofile"), done_bb, write_bb);
+
+  LLVMPositionBuilderAtEnd(builder, write_bb);
+  LLVMValueRef header_fmt = LLVMBuildGlobalStringPtr(builder, "%s %llu %u", "prof.header");
+  LLVMValueRef count_fmt = LLVMBuildGlobalStringPtr(builder, " %llu", "prof.countfmt");
+  LLVMValueRef newline = LLVMBuildGlobalStringPtr(builder, "\n", "prof.newline");
+  for (prof_fn *f = prof_fns; f; f = f->next) {
+    LLVMValueRef header_args[5] = {
+      fp, header_fmt, LLVMBuildGlobalStringPtr(builder, f->key, "prof.name"),
+      LLVMConstInt(i64, f->hash, 0), LLVMConstInt(i32_type, f->n, 0)
+    };
+    build_external_call(fprintf_fn, header_args, 5);
+
+    // for (i = 0; i < n; i++) fprintf(fp, " %llu", counters[i]);
+    LLVMBasicBlockRef pre = LLVMGetInsertBlock(builder);
+    LLVMBasicBlockRef loop = LLVMAppendBasicBlock(dump, "prof.loop");
+    LLVMBasicBlockRef next = LLVMAppendBasicBlock(dump, "prof.next");
+    LLVMMoveBasicBlockBefore(loop, done_bb);
+    LLVMMoveBasicBlockBefore(next, done_bb);
+    LLVMBuildBr(builder, loop);
+    LLVMPositionBuilderAtEnd(builder, loop);
+    LLVMValueRef i = LLVMBuildPhi(builder, i64, "i");
+    LLVMValueRef idx[2] = { LLVMConstInt(i64, 0, 0), i };
+    LLVMValueRef ptr = LLVMBuildInBoundsGEP2(builder, LLVMGlobalGetValueType(f->counters), f->counters, idx, 2, "");
+    LLVMValueRef count_args[3] = { fp, count_fmt, LLVMBuildLoad2(builder, i64, ptr, "") };
+    build_external_call(fprintf_fn, count_args, 3);
+    LLVMValueRef i_next = LLVMBuildAdd(builder, i, LLVMConstInt(i64, 1, 0), "");
+    LLVMValueRef zero = LLVMConstInt(i64, 0, 0);
+    LLVMAddIncoming(i, &zero, &pre, 1);
+    LLVMAddIncoming(i, &i_next, &loop, 1);
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntULT, i_next, LLVMConstInt(i64, f->n, 0), ""), loop, next);
+
+    LLVMPositionBuilderAtEnd(builder, next);
+    LLVMValueRef nl_args[2] = { fp, newline };
+    build_external_call(fprintf_fn, nl_args, 2);
+  }
+  build_external_call(fclose_fn, &fp, 1);
+  LLVMBuildBr(builder, done_bb);
+  LLVMPositionBuilderAtEnd(builder, done_bb);
+  LLVMBuildRetVoid(builder);
+
+  // Constructor del módulo: atexit(__freezepiler.prof_dump)
+  LLVMTypeRef dump_ptr = LLVMPointerType(void_fn_type, 0);
+  LLVMValueRef atexit_fn = external_function("atexit", i32_type, &dump_ptr, 1, 0);
+  module_constructor("__freezepiler.prof_init");
+  build_external_call(atexit_fn, &dump, 1);
+  LLVMBuildRetVoid(builder);
+}
+
+// -fprofile-functions (ver src/runtime/freezepiler_rt.h)
+static int fprof_enabled = 0;
+static const char *fprof_json = NULL;    // =<archivo>: JSON en lugar de la tabla en stderr
+static LLVMValueRef *fprof_records = NULL; // un fprof_record por función del módulo
+static unsigned fprof_n = 0;
+static LLVMValueRef fprof_record = NULL;   // función actual
+static LLVMValueRef fprof_start = NULL;    // ciclo de entrada
+static LLVMValueRef fprof_saved_child = NULL; // tiempo en llamadas del llamador, guardado al entrar
+
+static LLVMTypeRef fprof_record_type(void) {
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMTypeRef fields[5] = { LLVMPointerType(i8_type, 0), i64, i64, i64, i64 };
+  return LLVMStructType(fields, 5, 0);
+}
 
-      LLVMBuildCondBr(builder, bool_cond, body_block, after_block);
+static LLVMValueRef fprof_child_global(void) {
+  LLVMValueRef g = LLVMGetNamedGlobal(module, "__freezepiler_fprof_child");
+  return g ? g : LLVMAddGlobal(module, LLVMInt64Type(), "__freezepiler_fprof_child");
+}
 
-      // After
-      LLVMPositionBuilderAtEnd(builder, after_block);
+static LLVMValueRef read_cycle_counter(void) {
+  LLVMValueRef f = external_function("llvm.readcyclecounter", LLVMInt64Type(), NULL, 0, 0);
+  return build_external_call(f, NULL, 0);
+}
 
-      break;
+// record->field += delta
+static void fprof_add(unsigned field, LLVMValueRef delta) {
+  LLVMValueRef ptr = LLVMBuildStructGEP2(builder, fprof_record_type(), fprof_record, field, "");
+  LLVMValueRef v = LLVMBuildLoad2(builder, LLVMInt64Type(), ptr, "");
+  LLVMBuildStore(builder, LLVMBuildAdd(builder, v, delta, ""), ptr);
+}
 
-    }
+/*
+Function prologue for -fprofile-functions: counts the call, marks one
+more active frame, saves the callee time the caller has accumulated so
+far and reads the cycle counter (rdtsc on x86) last, so the
+bookkeeping stays out of the measurement.
+*/
+static void fprof_begin_function(LLVMValueRef function, ast_node *tipo_node) {
+  fprof_record = NULL;
+  if (!fprof_enabled) return;
+
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMTypeRef rtype = fprof_record_type();
+  char *name = profile_function_name(function, tipo_node);
+  char *gname = malloc(strlen(name) + 9);
+  sprintf(gname, "__fprof.%s", name);
+  LLVMValueRef record = LLVMAddGlobal(module, rtype, gname);
+  LLVMSetLinkage(record, LLVMInternalLinkage);
+  LLVMValueRef fields[5] = {
+    LLVMBuildGlobalStringPtr(builder, name, "fprof.name"),
+    LLVMConstInt(i64, 0, 0), LLVMConstInt(i64, 0, 0), LLVMConstInt(i64, 0, 0), LLVMConstInt(i64, 0, 0)
+  };
+  LLVMSetInitializer(record, LLVMConstNamedStruct(rtype, fields, 5));
+  free(gname);
+  free(name);
+  fprof_records = realloc(fprof_records, (fprof_n + 1) * sizeof(LLVMValueRef));
+  fprof_records[fprof_n++] = record;
+  fprof_record = record;
+
+  fprof_add(1, LLVMConstInt(i64, 1, 0));
+  fprof_add(4, LLVMConstInt(i64, 1, 0));
+  LLVMValueRef child = fprof_child_global();
+  fprof_saved_child = LLVMBuildLoad2(builder, i64, child, "fprof.saved");
+  LLVMBuildStore(builder, LLVMConstInt(i64, 0, 0), child);
+  fprof_start = read_cycle_counter();
+}
 
-    default:
-    //       fprintf(stderr, "[codegen_statement] tipo no soportado %d (addr=%p)\n", stmt->type, (void*)stmt);
+/*
+Epilogue before every ret: the frame's elapsed cycles minus those its
+callees reported are its self time; the outermost active frame also
+adds them to the inclusive time. The elapsed cycles are then handed to
+the caller as callee time.
+*/
+static void fprof_end_function(LLVMValueRef function) {
+  if (!fprof_record) return;
+  LLVMTypeRef i64 = LLVMInt64Type();
+  LLVMValueRef child = fprof_child_global();
+  for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); bb; bb = LLVMGetNextBasicBlock(bb)) {
+    LLVMValueRef term = LLVMGetBasicBlockTerminator(bb);
+    if (!term || LLVMGetInstructionOpcode(term) != LLVMRet) continue;
+    LLVMPositionBuilderBefore(builder, term);
+
+    LLVMValueRef elapsed = LLVMBuildSub(builder, read_cycle_counter(), fprof_start, "fprof.elapsed");
+    LLVMValueRef callees = LLVMBuildLoad2(builder, i64, child, "");
+    fprof_add(2, LLVMBuildSub(builder, elapsed, callees, ""));
+
+    LLVMValueRef active_ptr = LLVMBuildStructGEP2(builder, fprof_record_type(), fprof_record, 4, "");
+    LLVMValueRef active = LLVMBuildSub(builder, LLVMBuildLoad2(builder, i64, active_ptr, ""), LLVMConstInt(i64, 1, 0), "");
+    LLVMBuildStore(builder, active, active_ptr);
+    LLVMValueRef outermost = LLVMBuildICmp(builder, LLVMIntEQ, active, LLVMConstInt(i64, 0, 0), "");
+    fprof_add(3, LLVMBuildSelect(builder, outermost, elapsed, LLVMConstInt(i64, 0, 0), ""));
+
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, fprof_saved_child, elapsed, ""), child);
   }
+  fprof_record = NULL;
 }
 
+// Constructor que registra los registros del módulo en el runtime
+static void fprof_emit_register(void) {
+  LLVMTypeRef rptr = LLVMPointerType(fprof_record_type(), 0);
+  LLVMValueRef table = LLVMAddGlobal(module, LLVMArrayType(rptr, fprof_n), "__fprof.table");
+  LLVMSetLinkage(table, LLVMInternalLinkage);
+  LLVMSetGlobalConstant(table, 1);
+  LLVMSetInitializer(table, LLVMConstArray(rptr, fprof_records, fprof_n));
+
+  LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+  LLVMTypeRef params[3] = { LLVMPointerType(rptr, 0), i32_type, i8p };
+  LLVMValueRef reg = external_function("__freezepiler_fprof_register", LLVMVoidType(), params, 3, 0);
+  module_constructor("__freezepiler.fprof_init");
+  LLVMValueRef zero = LLVMConstInt(i32_type, 0, 0);
+  LLVMValueRef idx[2] = { zero, zero };
+  LLVMValueRef args[3] = {
+    LLVMConstInBoundsGEP2(LLVMArrayType(rptr, fprof_n), table, idx, 2),
+    LLVMConstInt(i32_type, fprof_n, 0),
+    fprof_json ? LLVMBuildGlobalStringPtr(builder, fprof_json, "fprof.path") : LLVMConstNull(i8p)
+  };
+  build_external_call(reg, args, 3);
+  LLVMBuildRetVoid(builder);
+}
 
-// =======================================================
-// BLOQUE
-// =======================================================
-void codegen_block(ast_node *block, LLVMValueRef function) {
-  if (!block) {
-    //     fprintf(stderr, "[codegen_block] block == NULL\n");
-    return;
-  }
-  //   fprintf(stderr, "codegen_block: ENTER block=%p type=%d\n", (void*)block, block->type);
-  if (block->type != NT_BLOQUE) {
-    //     fprintf(stderr, "[codegen_block] ERROR: nodo no es BLOQUE (type=%d)\n", block->type);
-    return;
-  }
-  ast_node *stmt = block->child;
-  int idx = 0;
-  while (stmt) {
-    //     fprintf(stderr, "  BLOCK stmt #%d type=%d ptr=%p lineno=%d\n", idx, stmt->type, (void*)stmt, stmt->lineno);
-    codegen_statement(stmt, function);
-    //     fprintf(stderr, "  returned from stmt #%d\n", idx);
-    stmt = stmt->sibling;
-    idx++;
+static void profile_clear(void) {
+  while (prof_fns) {
+    prof_fn *next = prof_fns->next;
+    free(prof_fns->key);
+    free(prof_fns);
+    prof_fns = next;
   }
-  //   fprintf(stderr, "codegen_block: EXIT\n");
+  profile_free(profile_use);
+  profile_use = NULL;
+  profile_generate = NULL;
+  free(fprof_records);
+  fprof_records = NULL;
+  fprof_n = 0;
 }
 
-
-// =======================================================
-// FUNCIÓN
-// =======================================================
-void codegen_function(ast_node *fn_node) {
-  //   fprintf(stderr, "\n==== codegen_function INICIO ====\n");
-  if (!fn_node) { //fprintf(stderr, "ERROR: fn_node NULL\n"); 
-    return; }
-  //   fprintf(stderr, "fn_node->type = %d\n", fn_node->type);
-
-  ast_node *tipo_node = fn_node->child;
+/*
+Declares the function in the module and records the signedness of its
+return value and parameters. All prototypes are emitted before any body
+so calls to functions defined later in the file resolve.
+*/
+static LLVMValueRef codegen_prototype(ast_node *fn_node) {
+  ast_node *tipo_node = fn_node ? fn_node->child : NULL;
   ast_node *idnode = tipo_node ? tipo_node->sibling : NULL;
-  if (!tipo_node || !idnode) { 
-    //fprintf(stderr, "ERROR: función sin tipo o ID\n"); 
-    return; }
-  const char *fnname = idnode->value.strVal;
-  //   fprintf(stderr, "Función nombre = %s\n", fnname);
-
-  ast_node *after_id = idnode->sibling;
-  //   fprintf(stderr, "after_id->type = %d (addr=%p)\n", after_id ? after_id->type : -1, (void*)after_id);
-
-  // Mapear tipo de retorno
-  LLVMTypeRef ret_type = map_type_node(tipo_node);
-  if (!ret_type) { 
-    //     fprintf(stderr, "ERROR: ret_type NULL, fallback i32\n"); 
-    ret_type = LLVMInt32Type(); 
+  if (!tipo_node || !idnode) {
+    return NULL;
   }
+  const char *fnname = idnode->value.strVal;
 
   // Contar parámetros
   int nparams = 0;
-  ast_node *it = after_id;
-  while (it && it->type == NT_PARAMETRO) { nparams++; it = it->sibling; }
-  //   fprintf(stderr, "Total parámetros = %d\n", nparams);
-
-  LLVMTypeRef *param_types = NULL;
-  if (nparams > 0) {
-    param_types = malloc(sizeof(LLVMTypeRef) * nparams);
-    if (!param_types) {
-      //       fprintf(stderr, "ERROR: no se pudo allocar param_types\n");
-      return;
-    }
-
-    // Llenar los tipos de parámetros
-    it = after_id;
-    int idx = 0;
-    while (it && it->type == NT_PARAMETRO) {
-      ast_node *ptype = it->child;
-      LLVMTypeRef pt = map_type_node(ptype);
-      if (!pt) {
-        //         fprintf(stderr, "  param %d: tipo NULL, usando i32\n", idx);
-        pt = LLVMInt32Type();
-      }
-      param_types[idx] = pt;
-      //       fprintf(stderr, "  param %d llvm type = %p\n", idx, (void*)pt);
-      idx++; 
-      it = it->sibling;
-    }
+  ast_node *body = idnode->sibling;
+  for (; body && body->type == NT_PARAMETRO; body = body->sibling) {
+    if (!is_void_param(body)) nparams++;
   }
 
-  LLVMTypeRef fty = LLVMFunctionType(ret_type, param_types, nparams, 0);
-
-  if (!fty) {
-    //     fprintf(stderr, "ERROR: no se pudo crear function type\n");
-    if (param_types) free(param_types);
-    return;
+  LLVMValueRef existing = LLVMGetNamedFunction(module, fnname);
+  if (existing) {
+    if (body) codegen_linkage(existing, tipo_node, fnname); // Definición tras un prototipo
+    return existing;
   }
 
-  //   fprintf(stderr, "Tipo de función creado: %p\n", (void*)fty);
-  //   fprintf(stderr, "Kind del tipo de función: %d\n", LLVMGetTypeKind(fty));
-
-  if (!module) {
-    //     fprintf(stderr, "ERROR: module es NULL\n");
-    if (param_types) free(param_types);
-    return;
+  LLVMTypeRef *param_types = malloc(sizeof(LLVMTypeRef) * (nparams > 0 ? nparams : 1));
+  fn_entry *sig = fn_put(fnname, type_is_unsigned(tipo_node), nparams);
+  int idx = 0;
+  for (ast_node *it = idnode->sibling; it && it->type == NT_PARAMETRO; it = it->sibling) {
+    if (is_void_param(it)) continue;
+    param_types[idx] = map_type_node(it->child);
+    sig->param_unsigned[idx] = type_is_unsigned(it->child);
+    idx++;
   }
 
+  LLVMTypeRef fty = LLVMFunctionType(map_type_node(tipo_node), param_types, nparams, 0);
+  free(param_types);
   LLVMValueRef function = LLVMAddFunction(module, fnname, fty);
-  //   fprintf(stderr, "LLVMAddFunction OK: %p\n", (void*)function);
 
-  if (!function) {
-    //     fprintf(stderr, "ERROR: no se pudo añadir función %s\n", fnname);
-    if (param_types) free(param_types);
-    return;
+  // En C no hay excepciones
+  add_function_attribute(function, "nounwind");
+  if (body) {
+    codegen_linkage(function, tipo_node, fnname);
   }
+  return function;
+}
 
-  LLVMTypeRef actual_func_type = LLVMTypeOf(function);
-  //   fprintf(stderr, "Tipo real de la función: %p\n", (void*)actual_func_type);
-  if (actual_func_type) {
-    //     fprintf(stderr, "Kind del tipo real: %d\n", LLVMGetTypeKind(actual_func_type));
-    if (LLVMGetTypeKind(actual_func_type) == LLVMPointerTypeKind) {
-      LLVMTypeRef element_type = LLVMGetElementType(actual_func_type);
-      //       fprintf(stderr, "Tipo elemento: %p\n", (void*)element_type);
-      if (element_type) {
-        //         fprintf(stderr, "Kind del tipo elemento: %d\n", LLVMGetTypeKind(element_type));
-      }
-    }
-  }
+void codegen_function(ast_node *fn_node) {
+  //   fprintf(stderr, "\n==== codegen_function INICIO ====\n");
+  LLVMValueRef function = codegen_prototype(fn_node);
+  if (!function) { //fprintf(stderr, "ERROR: función sin tipo o ID\n");
+    return; }
 
-  // Crear entry block
-  LLVMBasicBlockRef entry = LLVMAppendBasicBlock(function, "entry");
-  //   fprintf(stderr, "entry block = %p\n", (void*)entry);
+  ast_node *tipo_node = fn_node->child;
+  ast_node *idnode = tipo_node->sibling;
+  current_ret_unsigned = type_is_unsigned(tipo_node);
 
-  if (!builder) {
-    //     fprintf(stderr, "ERROR: builder es NULL\n");
-    if (param_types) free(param_types);
+  ast_node *body = idnode->sibling;
+  while (body && body->type == NT_PARAMETRO) body = body->sibling;
+  if (!body) { // Prototipo: la declaración ya quedó en el módulo
     return;
   }
 
+  // Crear entry block
+  LLVMBasicBlockRef entry = LLVMAppendBasicBlock(function, "entry");
   LLVMPositionBuilderAtEnd(builder, entry);
+  debug_begin_function(function, tipo_node);
   sym_clear();
 
   // Procesar parámetros
-  it = after_id;
+  ast_node *it = idnode->sibling;
   int idx = 0;
   while (it && it->type == NT_PARAMETRO) {
+    if (is_void_param(it)) {
+      it = it->sibling;
+      continue;
+    }
     ast_node *ptype = it->child;
     ast_node *pid = ptype ? ptype->sibling : NULL;
     const char *pname = pid ? pid->value.strVal : "(null)";
     LLVMTypeRef pt = map_type_node(ptype);
-    if (!pt) pt = LLVMInt32Type();
-    //     fprintf(stderr, "  Param %d = %s type=%p\n", idx, pname, (void*)pt);
 
     LLVMValueRef arg = LLVMGetParam(function, idx);
-    //     fprintf(stderr, "    LLVMGetParam OK: %p\n", (void*)arg);
-
     LLVMValueRef a = create_entry_alloca(function, pname, pt);
-    if (!a) { 
-      //       fprintf(stderr, "    ERROR: alloca param NULL for %s\n", pname); 
-    } else {
-      if (arg && a) {
-        LLVMBuildStore(builder, arg, a);
-      } else {
-        //         fprintf(stderr, "    WARNING: arg o alloca inválidos, omitiendo store\n");
-      }
-      sym_put(pname, a);
+    if (a) {
+      LLVMBuildStore(builder, arg, a);
+      sym_put(pname, a, pt, type_is_unsigned(ptype));
+      debug_declare_variable(pname, a, pt, type_is_unsigned(ptype), pid ? pid->lineno : 0, idx + 1);
     }
-    idx++; 
+    idx++;
     it = it->sibling;
   }
 
-  if (param_types) free(param_types);
-
-  ast_node *body = it;
   //   fprintf(stderr, "Body detectado: type=%d addr=%p\n", body ? body->type : -1, (void*)body);
 
+  labels_begin(function);
+  fprof_begin_function(function, tipo_node);
+  profile_begin_function(function, tipo_node, body);
   if (body && body->type == NT_BLOQUE) {
     codegen_block(body, function);
   } else if (body) {
     codegen_statement(body, function);
-  } else {
-    LLVMBuildRet(builder, LLVMConstInt(i32_type, 0, 0));
   }
 
-  // Verificar terminador
+  // Si el cuerpo no terminó con return se devuelve cero (o nada en funciones void)
   if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
-    LLVMBuildRet(builder, LLVMConstInt(i32_type, 0, 0));
+    LLVMTypeRef ret_type = LLVMGetReturnType(LLVMGlobalGetValueType(function));
+    if (LLVMGetTypeKind(ret_type) == LLVMVoidTypeKind)
+      LLVMBuildRetVoid(builder);
+    else
+      LLVMBuildRet(builder, LLVMConstNull(ret_type));
   }
+  labels_end();
+  profile_end_function();
+  fprof_end_function(function);
+  debug_end_function();
 
   //   fprintf(stderr, "==== codegen_function FIN ====\n");
 }
 
+// =======================================================
+// VARIABLES GLOBALES
+// =======================================================
+
+// Función auxiliar donde se generan los inicializadores constantes; se borra al terminar el módulo
+static LLVMValueRef const_eval_fn = NULL;
+
+/*
+Evaluates an initializer at compile time. Scalar expressions are
+generated with the regular expression codegen inside a scratch
+function: LLVM's IRBuilder folds operations on constants, so a
+constant expression comes back as an LLVM constant and anything else
+(a load, a call) is rejected. Brace lists build constant arrays and
+missing elements are zero. Returns NULL if the value is not constant.
+*/
+static LLVMValueRef codegen_const_initializer(ast_node *init, LLVMTypeRef type, int is_unsigned) {
+  if (!init) {
+    return LLVMConstNull(type);
+  }
+
+  int vec = is_vector_type(type) && init->type == NT_LISTA_INIT; // Se llena como un arreglo
+  if (LLVMGetTypeKind(type) == LLVMArrayTypeKind || vec) {
+    if (init->type != NT_LISTA_INIT) {
+      return NULL;
+    }
+    unsigned n = vec ? LLVMGetVectorSize(type) : LLVMGetArrayLength(type);
+    LLVMTypeRef elem_type = LLVMGetElementType(type);
+    LLVMValueRef *values = malloc(sizeof(LLVMValueRef) * (n > 0 ? n : 1));
+    unsigned i = 0;
+    ast_node *item = init->child;
+    for (; item && i < n; item = item->sibling, i++) {
+      values[i] = codegen_const_initializer(item, elem_type, is_unsigned);
+      if (!values[i]) {
+        free(values);
+        return NULL;
+      }
+    }
+    for (; i < n; i++) {
+      values[i] = LLVMConstNull(elem_type);
+    }
+    LLVMValueRef array = item ? NULL : vec ? LLVMConstVector(values, n) : LLVMConstArray(elem_type, values, n); // Sobran inicializadores
+    free(values);
+    return array;
+  }
+
+  if (init->type == NT_LISTA_INIT) { // int x = { 5 };
+    init = init->child;
+  }
+
+  LLVMBasicBlockRef saved = LLVMGetInsertBlock(builder);
+  if (!const_eval_fn) {
+    const_eval_fn = LLVMAddFunction(module, "__freezepiler.const_eval", LLVMFunctionType(LLVMVoidType(), NULL, 0, 0));
+    LLVMAppendBasicBlock(const_eval_fn, "entry");
+  }
+  LLVMPositionBuilderAtEnd(builder, LLVMGetLastBasicBlock(const_eval_fn));
+
+  int u;
+  LLVMValueRef v = codegen_expr_sign(init, const_eval_fn, &u);
+  if (v) {
+    v = vector_convertible(LLVMTypeOf(v), type) ? convert_value(v, u, type, is_unsigned) : NULL;
+  }
+
+  if (saved) {
+    LLVMPositionBuilderAtEnd(builder, saved);
+  } else {
+    LLVMClearInsertionPosition(builder);
+  }
+  return v && LLVMIsConstant(v) ? v : NULL;
+}
+
+/*
+Emits a variable with static storage. LLVM already places it by its
+initializer: all-zero values go to .bss, the rest to .data, and
+globals marked constant go to .rodata. static gives internal linkage
+and extern without an initializer only declares the symbol.
+*/
+static LLVMValueRef codegen_global_variable(const char *name, LLVMTypeRef type, ast_node *tipo, ast_node *init, int lineno) {
+  int is_unsigned = type_is_unsigned(tipo);
+  int is_extern = ast_type_count(tipo, T_EXTERN) > 0;
+
+  LLVMValueRef g = LLVMGetNamedGlobal(module, name);
+  if (!g) {
+    g = LLVMAddGlobal(module, type, name);
+    align_array_storage(g, type);
+  }
+
+  if (!is_extern || init) {
+    LLVMValueRef value = codegen_const_initializer(init, type, is_unsigned);
+    if (!value) {
+      fprintf(stderr, "ERROR: el inicializador de '%s' no es una constante (linea %d)\n", name, lineno);
+      codegen_errors++;
+      return NULL;
+    }
+    // Una definición tentativa (int x;) no reemplaza a un inicializador previo
+    if (init || !LLVMGetInitializer(g)) {
+      LLVMSetInitializer(g, value);
+    }
+  }
+  if (ast_type_count(tipo, T_STATIC) > 0 || (whole_program && !is_extern)) {
+    LLVMSetLinkage(g, LLVMInternalLinkage);
+  }
+  if (ast_type_count(tipo, T_CONST) > 0 && LLVMGetInitializer(g)) {
+    LLVMSetGlobalConstant(g, 1);
+  }
+  return g;
+}
+
+// Declaración en el ámbito de archivo: cada variable se vuelve una global de LLVM
+static void codegen_global_declaration(ast_node *decl) {
+  ast_node *tipo = decl->child;
+  LLVMTypeRef decl_type = map_type_node(tipo);
+
+  for (ast_node *cur = tipo ? tipo->sibling : NULL; cur; cur = cur->sibling) {
+    ast_node *var, *init;
+    const char *name = declarator_parts(cur, &var, &init);
+    if (!name) continue;
+    LLVMTypeRef var_type = declarator_type(var, decl_type, init);
+    if (!var_type) continue;
+
+    LLVMValueRef g = codegen_global_variable(name, var_type, tipo, init, cur->lineno);
+    if (g) {
+      sym_put_global(name, g, var_type, type_is_unsigned(tipo));
+      debug_global_variable(g, name, var_type, type_is_unsigned(tipo), cur->lineno);
+    }
+  }
+}
+
 // =======================================================
 // MÓDULO
 // =======================================================
-int codegen_generate_module(ast_node *root, const char *filename) {
+
+/*
+Máquina destino del host; el nivel de optimización del backend sigue a -O.
+Por omisión el código es PIC y las variables exportadas se leen por la GOT;
+con -no-pie (o -static) el modelo es estático y todo se direcciona directo.
+*/
+LLVMTargetMachineRef codegen_create_target_machine(int opt_level, int no_pie, char **triple) {
+  char *err = NULL;
+  *triple = LLVMGetDefaultTargetTriple();
+  LLVMTargetRef target;
+  if (LLVMGetTargetFromTriple(*triple, &target, &err) != 0) {
+    fprintf(stderr, "ERROR Target: %s\n", err);
+    LLVMDisposeMessage(err);
+    LLVMDisposeMessage(*triple);
+    *triple = NULL;
+    return NULL;
+  }
+
+  LLVMCodeGenOptLevel cg_level = opt_level == 0 ? LLVMCodeGenLevelNone
+                               : opt_level == 1 ? LLVMCodeGenLevelLess
+                               : opt_level == 2 ? LLVMCodeGenLevelDefault
+                                                : LLVMCodeGenLevelAggressive;
+  LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(
+    target, *triple, "generic", "",
+    cg_level, no_pie ? LLVMRelocStatic : LLVMRelocDefault, LLVMCodeModelDefault
+  );
+  if (!target_machine) {
+    //     fprintf(stderr, "ERROR: Falló LLVMCreateTargetMachine\n");
+    LLVMDisposeMessage(*triple);
+    *triple = NULL;
+  }
+  return target_machine;
+}
+
+// Prepara el estado y un módulo vacío; 0 si hubo errores
+static int module_begin(const codegen_options *opts) {
   //printf("[DEBUG] Iniciando generación de módulo\n");
 
   i32_type = LLVMInt32Type();
   i8_type  = LLVMInt8Type();
   f64_type = LLVMDoubleType();
+  codegen_errors = 0;
+  whole_program = opts ? opts->whole_program : 0;
+  freestanding_runtime = opts ? opts->freestanding_runtime : 0;
+  profile_generate = opts ? opts->profile_generate : NULL;
+  fprof_enabled = opts ? opts->profile_functions : 0;
+  fprof_json = opts ? opts->profile_functions_json : NULL;
+  profile_module = opts ? opts->module_name : NULL;
+  if (opts && opts->profile_use && !profile_generate) {
+    profile_use = profile_load(opts->profile_use);
+    if (!profile_use) {
+      return 0;
+    }
+  }
 
-  //printf("[DEBUG] Tipos básicos inicializados\n");
-
-  module = LLVMModuleCreateWithName("mini_c_module");
-  if (!module) {
-    printf("[ERROR] No se pudo crear módulo\n");
-    return -1;
+  char *triple;
+  LLVMTargetMachineRef target_machine = codegen_create_target_machine(0, opts ? opts->no_pie : 0, &triple);
+  if (!target_machine) {
+    return 0;
   }
 
+  module = LLVMModuleCreateWithName(opts && opts->module_name ? opts->module_name : "mini_c_module");
+
+  // Data Layout antes de generar código: el tamaño de los arreglos decide su alineación
+  LLVMTargetDataRef data_layout = LLVMCreateTargetDataLayout(target_machine);
+  LLVMSetModuleDataLayout(module, data_layout);
+  LLVMDisposeTargetData(data_layout);
+  LLVMSetTarget(module, triple);
+  LLVMDisposeTargetMachine(target_machine);
+  LLVMDisposeMessage(triple);
+
   //printf("[DEBUG] Módulo creado: %p\n", (void*)module);
 
   builder = LLVMCreateBuilder();
-  if (!builder) {
-    printf("[ERROR] No se pudo crear builder\n");
-    LLVMDisposeModule(module);
-    return -1;
-  }
-
-  //printf("[DEBUG] Builder creado: %p\n", (void*)builder);
+  debug_begin_module(opts);
 
   //printf("[DEBUG] Declarando printf...\n");
   LLVMTypeRef printf_arg_types[] = { LLVMPointerType(LLVMInt8Type(), 0) };
   LLVMTypeRef printf_type = LLVMFunctionType(LLVMInt32Type(), printf_arg_types, 1, 1);
-  LLVMValueRef printf_func = LLVMAddFunction(module, "printf", printf_type);
-  //printf("[DEBUG] printf declarado: %p\n", (void*)printf_func);
+  LLVMAddFunction(module, "printf", printf_type);
+  return 1;
+}
+
+// Cierra el módulo (perfiles, constructores) y lo verifica; NULL si hubo errores
+static LLVMModuleRef module_finish(void) {
+  if (prof_fns) {
+    profile_emit_dump();
+  }
+  if (fprof_n > 0) {
+    fprof_emit_register();
+  }
+  emit_module_constructors();
+  debug_finish_module();
+  profile_clear();
+  literal_pool_clear();
+  sym_clear();
+  sym_clear_list(&global_table);
+  if (const_eval_fn) {
+    LLVMDeleteFunction(const_eval_fn);
+    const_eval_fn = NULL;
+  }
+  fn_clear();
+  LLVMDisposeBuilder(builder);
 
+  // Verificar módulo
+  // Se devuelve el error en lugar de abortar para que main.c pueda borrar sus temporales
+  char *err = NULL;
+  if (codegen_errors > 0 || LLVMVerifyModule(module, LLVMReturnStatusAction, &err)) {
+    if (err && codegen_errors == 0) fprintf(stderr, "Error verificando módulo: %s\n", err);
+    LLVMDisposeMessage(err);
+    LLVMDisposeModule(module);
+    return NULL;
+  }
+  LLVMDisposeMessage(err);
+  return module;
+}
 
+LLVMModuleRef codegen_build_module(ast_node *root, const codegen_options *opts) {
+  if (!module_begin(opts)) {
+    return NULL;
+  }
 
+  // Variables globales y prototipos antes de generar cualquier cuerpo
+  for (ast_node *fn = root->child; fn; fn = fn->sibling) {
+    if (fn->type == NT_DECLARACION) {
+      codegen_global_declaration(fn);
+    } else if (fn->type == NT_FUNCION) {
+      codegen_prototype(fn);
+    }
+  }
 
   // Procesar funciones
   ast_node *fn = root->child;
@@ -1649,72 +3806,293 @@ int codegen_generate_module(ast_node *root, const char *filename) {
   }
 
   //   fprintf(stderr, "Procesadas %d funciones\n", function_count);
+  return module_finish();
+}
 
-  // Verificar módulo
-  char *err = NULL;
-  //fprintf(stderr, "Verificando módulo...\n");
-  LLVMVerifyModule(module, LLVMAbortProcessAction, &err);
-  if (err) {
-    //fprintf(stderr, "Error verificando módulo: %s\n", err);
-    LLVMDisposeMessage(err);
-    // Continuar a pesar del error
-  }
+// La función de entrada de codegen_build_osr_module, sobre el módulo ya generado
+static void codegen_osr_entry(ast_node *fn_node, ast_node *loop, const codegen_osr_var *vars, int nvars, const char *entry) {
+  ast_node *tipo_node = fn_node->child;
+  const char *fname = tipo_node->sibling->value.strVal;
+  LLVMTypeRef i8p = LLVMPointerType(i8_type, 0);
+  LLVMTypeRef params[2] = { LLVMPointerType(i8p, 0), i8p };
+  LLVMValueRef function = LLVMAddFunction(module, entry, LLVMFunctionType(i32_type, params, 2, 0));
+  add_function_attribute(function, "nounwind");
+  LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(function, "entry"));
+  sym_clear();
 
+  osr_vars = vars;
+  osr_nvars = nvars;
+  osr_slots = calloc(nvars > 0 ? nvars : 1, sizeof(LLVMValueRef));
+  osr_function = fname;
+  current_ret_unsigned = type_is_unsigned(tipo_node);
+  osr_ret_type = LLVMGetReturnType(LLVMGlobalGetValueType(LLVMGetNamedFunction(module, fname)));
+  osr_ret = LLVMGetTypeKind(osr_ret_type) == LLVMVoidTypeKind
+              ? NULL : LLVMBuildBitCast(builder, LLVMGetParam(function, 1), LLVMPointerType(osr_ret_type, 0), "ret");
+
+  // En el orden de declaración, para que una variable tape a las anteriores con su nombre
+  for (int i = 0; i < nvars; i++) {
+    ast_node *tipo = vars[i].tipo;
+    const char *name;
+    LLVMTypeRef type;
+    if (vars[i].declarator->type == NT_PARAMETRO) {
+      ast_node *pid = tipo->sibling;
+      name = pid ? pid->value.strVal : "(null)";
+      type = map_type_node(tipo);
+    } else {
+      ast_node *var, *init;
+      name = declarator_parts(vars[i].declarator, &var, &init);
+      type = name ? declarator_type(var, map_type_node(tipo), init) : NULL;
+    }
+    if (!type) continue;
+
+    LLVMValueRef storage;
+    if (ast_type_count(tipo, T_STATIC) > 0 || ast_type_count(tipo, T_EXTERN) > 0) {
+      char *gname = malloc(strlen(fname) + strlen(name) + 2);
+      if (ast_type_count(tipo, T_EXTERN) > 0) strcpy(gname, name);
+      else sprintf(gname, "%s.%s", fname, name);
+      storage = LLVMGetNamedGlobal(module, gname);
+      free(gname);
+    } else {
+      LLVMValueRef index = LLVMConstInt(LLVMInt64Type(), (unsigned long long)i, 0);
+      LLVMValueRef slot = LLVMBuildInBoundsGEP2(builder, i8p, LLVMGetParam(function, 0), &index, 1, "");
+      storage = LLVMBuildBitCast(builder, LLVMBuildLoad2(builder, i8p, slot, ""), LLVMPointerType(type, 0), name);
+      osr_slots[i] = storage;
+    }
+    if (storage && vars[i].visible) {
+      sym_put(name, storage, type, type_is_unsigned(tipo));
+    }
+  }
 
+  labels_begin(function);
+  codegen_statement(loop, function);
+  if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+    LLVMBuildRet(builder, LLVMConstInt(i32_type, 0, 0));
+  }
+  labels_end();
+
+  free(osr_slots);
+  osr_slots = NULL;
+  osr_vars = NULL;
+  osr_nvars = 0;
+  osr_function = NULL;
+  osr_ret_type = NULL;
+  osr_ret = NULL;
+}
 
-  // 1. Obtener Triple y Target
-  char *triple = LLVMGetDefaultTargetTriple();
-  LLVMTargetRef target;
-  if (LLVMGetTargetFromTriple(triple, &target, &err) != 0) {
-    //     fprintf(stderr, "ERROR Target: %s\n", err);
-    LLVMDisposeMessage(err);
-    LLVMDisposeMessage(triple);
-    return -1;
+LLVMModuleRef codegen_build_osr_module(ast_node *root, const codegen_options *opts, ast_node *function,
+                                       ast_node *loop, const codegen_osr_var *vars, int nvars, const char *entry) {
+  if (!module_begin(opts)) {
+    return NULL;
+  }
+  for (ast_node *fn = root->child; fn; fn = fn->sibling) {
+    if (fn->type == NT_DECLARACION) {
+      codegen_global_declaration(fn);
+    } else if (fn->type == NT_FUNCION) {
+      codegen_prototype(fn);
+    }
+  }
+  for (ast_node *fn = root->child; fn; fn = fn->sibling) {
+    if (fn->type == NT_FUNCION) {
+      codegen_function(fn);
+    }
   }
+  codegen_osr_entry(function, loop, vars, nvars, entry);
+  return module_finish();
+}
 
-  // 2. Crear Target Machine
-  LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(
-    target, triple, "generic", "",
-    LLVMCodeGenLevelDefault, LLVMRelocDefault, LLVMCodeModelDefault
-  );
+/*
+Streaming (-fstreaming): the parser hands over each external declaration
+as soon as it is reduced, so functions are lowered in source order (a
+call needs a previous prototype, as in C99) and their AST can be freed
+right away. With -O1 and up each function is also cleaned up on its own
+(mem2reg, CSE, CFG simplification) before the next one is parsed, so the
+module only accumulates compact IR until codegen_emit_module.
+*/
+static LLVMPassManagerRef stream_fpm = NULL;
+
+int codegen_stream_begin(const codegen_options *opts) {
+  if (!module_begin(opts)) {
+    return 0;
+  }
+  if (opts && opts->opt_level > 0) {
+    stream_fpm = LLVMCreateFunctionPassManagerForModule(module);
+    LLVMAddPromoteMemoryToRegisterPass(stream_fpm);
+    LLVMAddEarlyCSEPass(stream_fpm);
+    LLVMAddCFGSimplificationPass(stream_fpm);
+    LLVMInitializeFunctionPassManager(stream_fpm);
+  }
+  return 1;
+}
 
-  if (!target_machine) {
-    //     fprintf(stderr, "ERROR: Falló LLVMCreateTargetMachine\n");
-    LLVMDisposeMessage(triple);
-    return -1;
+void codegen_stream_external(ast_node *decl) {
+  if (decl->type == NT_DECLARACION) {
+    codegen_global_declaration(decl);
+  } else if (decl->type == NT_FUNCION) {
+    codegen_function(decl);
+    // Sólo funciones válidas: los pases no toleran IR roto
+    ast_node *id = decl->child ? decl->child->sibling : NULL;
+    LLVMValueRef function = id ? LLVMGetNamedFunction(module, id->value.strVal) : NULL;
+    if (stream_fpm && function && !LLVMIsDeclaration(function) && codegen_errors == 0 &&
+        !LLVMVerifyFunction(function, LLVMReturnStatusAction)) {
+      LLVMRunFunctionPassManager(stream_fpm, function);
+    }
   }
+}
 
+LLVMModuleRef codegen_stream_end(void) {
+  if (stream_fpm) {
+    LLVMFinalizeFunctionPassManager(stream_fpm);
+    LLVMDisposePassManager(stream_fpm);
+    stream_fpm = NULL;
+  }
+  return module_finish();
+}
 
+/*
+Últimos ajustes antes de generar código nativo.
+
+-no-pie: el modelo estático no basta, LLVM sigue leyendo por la GOT todo
+símbolo que no sea dso_local, y la API de C no deja marcarlo. Un ejecutable
+no se puede interponer, así que las definiciones exportadas pasan a
+visibilidad protegida, que las hace dso_local y se direccionan directo.
+
+-ffunction-sections / -fdata-sections: cada definición en una sección con
+su nombre (.text.f, .data.x, .bss.x, .rodata.x), como hace gcc. Así ld
+--gc-sections descarta lo que nadie alcanza desde _start. Los literales
+privados se quedan en las secciones mezclables de siempre.
+*/
+static void prepare_native(LLVMModuleRef m, const codegen_options *opts) {
+  char section[512];
+  if (opts->no_pie) {
+    for (LLVMValueRef fn = LLVMGetFirstFunction(m); fn; fn = LLVMGetNextFunction(fn)) {
+      if (!LLVMIsDeclaration(fn) && LLVMGetLinkage(fn) == LLVMExternalLinkage &&
+          LLVMGetVisibility(fn) == LLVMDefaultVisibility) {
+        LLVMSetVisibility(fn, LLVMProtectedVisibility);
+      }
+    }
+    for (LLVMValueRef g = LLVMGetFirstGlobal(m); g; g = LLVMGetNextGlobal(g)) {
+      if (!LLVMIsDeclaration(g) && LLVMGetLinkage(g) == LLVMExternalLinkage &&
+          LLVMGetVisibility(g) == LLVMDefaultVisibility) {
+        LLVMSetVisibility(g, LLVMProtectedVisibility);
+      }
+    }
+  }
+  if (opts->function_sections) {
+    for (LLVMValueRef fn = LLVMGetFirstFunction(m); fn; fn = LLVMGetNextFunction(fn)) {
+      if (!LLVMIsDeclaration(fn) && LLVMGetSection(fn) == NULL) {
+        snprintf(section, sizeof(section), ".text.%s", LLVMGetValueName(fn));
+        LLVMSetSection(fn, section);
+      }
+    }
+  }
+  if (opts->data_sections) {
+    for (LLVMValueRef g = LLVMGetFirstGlobal(m); g; g = LLVMGetNextGlobal(g)) {
+      if (LLVMIsDeclaration(g) || LLVMGetSection(g) != NULL ||
+          LLVMGetLinkage(g) == LLVMPrivateLinkage || LLVMGetLinkage(g) == LLVMAppendingLinkage) {
+        continue;
+      }
+      LLVMValueRef init = LLVMGetInitializer(g);
+      const char *kind = LLVMIsGlobalConstant(g) ? ".rodata"
+                       : LLVMIsNull(init)        ? ".bss"
+                                                 : ".data";
+      snprintf(section, sizeof(section), "%s.%s", kind, LLVMGetValueName(g));
+      LLVMSetSection(g, section);
+    }
+  }
+}
 
-  // 3. Configurar Data Layout
-  LLVMTargetDataRef data_layout = LLVMCreateTargetDataLayout(target_machine);
+int codegen_optimize_module(LLVMModuleRef m, const codegen_options *opts) {
+  int opt_level = opts ? opts->opt_level : 0;
+  lto_phase lto = opts ? opts->lto : LTO_NONE;
+  // prepare_native va al final, sobre lo que sobrevive, y sólo para código nativo
+  int native = opts && (opts->emit == EMIT_OBJECT || opts->emit == EMIT_ASSEMBLY);
+  if (opt_level == 0) {
+    if (native) {
+      prepare_native(m, opts);
+    }
+    return 0;
+  }
 
+  char *triple;
+  LLVMTargetMachineRef target_machine = codegen_create_target_machine(opt_level, opts ? opts->no_pie : 0, &triple);
+  if (!target_machine) {
+    return -1;
+  }
 
-  LLVMSetModuleDataLayout(module, data_layout);
+  /*
+  Optimize with LLVM's standard pipeline (-O1..-O3), which includes the
+  loop and SLP vectorizers. With -flto each file only runs the pre-link
+  half and the full link-time pipeline runs once over the merged module.
+  */
+  char pipeline[32];
+  const char *kind = lto == LTO_PRELINK ? "lto-pre-link" : lto == LTO_LINK ? "lto" : "default";
+  snprintf(pipeline, sizeof(pipeline), "%s<O%d>", kind, opt_level);
+  LLVMPassBuilderOptionsRef pass_opts = LLVMCreatePassBuilderOptions();
+  LLVMPassBuilderOptionsSetLoopVectorization(pass_opts, opt_level >= 2);
+  LLVMPassBuilderOptionsSetSLPVectorization(pass_opts, opt_level >= 2);
+  LLVMPassBuilderOptionsSetLoopInterleaving(pass_opts, opt_level >= 2);
+  LLVMPassBuilderOptionsSetLoopUnrolling(pass_opts, opt_level >= 2);
+  LLVMErrorRef pass_err = LLVMRunPasses(m, pipeline, target_machine, pass_opts);
+  LLVMDisposePassBuilderOptions(pass_opts);
+  LLVMDisposeTargetMachine(target_machine);
+  LLVMDisposeMessage(triple);
+  if (pass_err) {
+    char *msg = LLVMGetErrorMessage(pass_err);
+    fprintf(stderr, "ERROR: falló el pipeline de optimización: %s\n", msg);
+    LLVMDisposeErrorMessage(msg);
+    return -1;
+  }
+  if (native) {
+    prepare_native(m, opts);
+  }
+  return 0;
+}
 
+int codegen_emit_module(LLVMModuleRef m, const char *filename, const codegen_options *opts) {
+  int opt_level = opts ? opts->opt_level : 0;
+  char *err = NULL;
 
-  LLVMDisposeTargetData(data_layout);
+  if (codegen_optimize_module(m, opts) != 0) {
+    LLVMDisposeModule(m);
+    return -1;
+  }
 
-  // 4. Emitir archivo .o
-  //   fprintf(stderr, "Emitiendo objeto a: %s\n", filename);
-  if (LLVMTargetMachineEmitToFile(target_machine, module, (char*)filename, LLVMObjectFile, &err) != 0) {
-    //     fprintf(stderr, "ERROR emitiendo archivo: %s\n", err);
-    LLVMDisposeMessage(err);
-    LLVMDisposeTargetMachine(target_machine);
-    LLVMDisposeMessage(triple);
+  char *triple;
+  LLVMTargetMachineRef target_machine = codegen_create_target_machine(opt_level, opts ? opts->no_pie : 0, &triple);
+  if (!target_machine) {
+    LLVMDisposeModule(m);
     return -1;
   }
 
-  // 5. Limpieza Final
+  // Emitir el archivo pedido (.o, .s, .ll o .bc)
+  emit_kind emit = opts ? opts->emit : EMIT_OBJECT;
+  int emit_failed = 0;
+  if (emit == EMIT_LLVM_IR) {
+    emit_failed = LLVMPrintModuleToFile(m, filename, &err);
+  } else if (emit == EMIT_LLVM_BC) {
+    emit_failed = LLVMWriteBitcodeToFile(m, filename);
+  } else {
+    LLVMCodeGenFileType ft = (emit == EMIT_ASSEMBLY) ? LLVMAssemblyFile : LLVMObjectFile;
+    emit_failed = LLVMTargetMachineEmitToFile(target_machine, m, (char*)filename, ft, &err);
+  }
+  if (emit_failed) {
+    fprintf(stderr, "ERROR: no se pudo escribir '%s'%s%s\n", filename, err ? ": " : "", err ? err : "");
+    if (err) LLVMDisposeMessage(err);
+  }
+
+  // Limpieza Final
   LLVMDisposeTargetMachine(target_machine);
   LLVMDisposeMessage(triple);
-  LLVMDisposeBuilder(builder);
-  LLVMDisposeModule(module);
+  LLVMDisposeModule(m);
 
   //   fprintf(stderr, "EXITO: .o generado.\n");
-  return 0;
+  return emit_failed ? -1 : 0;
 }
 
-
-
-
+int codegen_generate_module(ast_node *root, const char *filename, const codegen_options *opts) {
+  LLVMModuleRef m = codegen_build_module(root, opts);
+  if (!m) {
+    return -1;
+  }
+  return codegen_emit_module(m, filename, opts);
+}
@@ -2,8 +2,87 @@
 #define CODEGEN_H
 
 #include "ast.h"
+#include <llvm-c/Core.h>
+#include <llvm-c/TargetMachine.h>
 
-// Genera el módulo LLVM desde el AST raíz
-int codegen_generate_module(ast_node *root, const char *filename);
+// Tipo de archivo que emite el backend
+typedef enum {
+  EMIT_OBJECT,   // Código objeto nativo (.o)
+  EMIT_ASSEMBLY, // Ensamblador nativo (.s)
+  EMIT_LLVM_IR,  // LLVM IR textual (.ll)
+  EMIT_LLVM_BC   // LLVM bitcode (.bc)
+} emit_kind;
+
+// Fase de -flto en la que se emite el módulo
+typedef enum {
+  LTO_NONE,    // Compilación normal
+  LTO_PRELINK, // Un archivo de -flto -c: se optimiza sólo la mitad previa al enlace
+  LTO_LINK     // Módulo ya enlazado: pipeline completo de tiempo de enlace
+} lto_phase;
+
+// Información de depuración que se emite
+typedef enum {
+  DEBUG_NONE,
+  DEBUG_LINE_TABLES, // -gline-tables-only: subprogramas y líneas, para perfiladores
+  DEBUG_FULL         // -g: además tipos, parámetros y variables
+} debug_level;
+
+// Opciones de generación de código (ver main.c)
+typedef struct codegen_options {
+  emit_kind emit;
+  int opt_level;           // 0..3, como -O0..-O3
+  int whole_program;       // -fwhole-program: todo salvo main y lo extern tiene enlace interno
+  lto_phase lto;
+  const char *module_name; // Identificador del módulo (el archivo fuente), NULL = genérico
+  const char *profile_generate; // -fprofile-generate: perfil que escribe el programa, NULL = sin instrumentar
+  const char *profile_use;      // -fprofile-use: perfil con los conteos, NULL = sin perfil
+  int profile_functions;        // -fprofile-functions: ciclos y llamadas por función
+  const char *profile_functions_json; // -fprofile-functions=<archivo>: JSON en lugar de la tabla
+  debug_level debug_info;       // -g / -gline-tables-only
+  int no_pie;                   // -no-pie / -static: código de dirección fija, sin accesos por la GOT
+  int function_sections;        // -ffunction-sections: cada función en su propia sección .text.<nombre>
+  int data_sections;            // -fdata-sections: cada variable global en su propia sección
+  int freestanding_runtime;     // -ffreestanding-runtime: printf sin %e, %g ni %a
+} codegen_options;
+
+// Genera el módulo LLVM desde el AST raíz sin emitirlo; NULL si hubo errores
+LLVMModuleRef codegen_build_module(ast_node *root, const codegen_options *opts);
+
+// -fstreaming: módulo construido una declaración externa a la vez, en orden de fuente
+int codegen_stream_begin(const codegen_options *opts);          // 0 si hubo errores
+void codegen_stream_external(ast_node *decl);                   // función o variable global; decl se puede liberar después
+LLVMModuleRef codegen_stream_end(void);                         // NULL si hubo errores
+
+// Corre el pipeline de -O<n> (o el de -flto) sobre el módulo; 0 si todo salió bien
+int codegen_optimize_module(LLVMModuleRef module, const codegen_options *opts);
+
+// Optimiza y escribe el módulo en filename; el módulo se libera siempre
+int codegen_emit_module(LLVMModuleRef module, const char *filename, const codegen_options *opts);
+
+// TargetMachine del host para el nivel de optimización (PIC, o estático con no_pie); *triple se libera con LLVMDisposeMessage
+LLVMTargetMachineRef codegen_create_target_machine(int opt_level, int no_pie, char **triple);
+
+// Genera el módulo LLVM desde el AST raíz y lo escribe en filename
+int codegen_generate_module(ast_node *root, const char *filename, const codegen_options *opts);
+
+// -run (ver interp.h): una variable del marco de una función interpretada
+typedef struct codegen_osr_var {
+  ast_node *tipo;       // NT_TIPO de la declaración o del parámetro
+  ast_node *declarator; // el declarador tal como lo recibe NT_DECLARACION, o el NT_PARAMETRO
+  int visible;          // ya declarada donde se reanuda el bucle
+} codegen_osr_var;
+
+/*
+On-stack replacement for -run: the whole module plus
+"i32 entry(i8 **slots, i8 *ret)", which runs loop (a statement of
+function) from the top of an iteration on the interpreter's frame: the
+automatic variable vars[i] lives at slots[i], so the loop continues with
+the values the interpreter left and leaves its own behind. Variables
+with static storage are the module's globals. Returns 1 if the loop
+executed a return (the value is stored at ret) or 0 if it finished.
+NULL on errors.
+*/
+LLVMModuleRef codegen_build_osr_module(ast_node *root, const codegen_options *opts, ast_node *function,
+                                       ast_node *loop, const codegen_osr_var *vars, int nvars, const char *entry);
 
 #endif
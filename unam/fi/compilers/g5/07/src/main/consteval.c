@@ -0,0 +1,733 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ast.h"
+#include "consteval.h"
+#include "simplify.h"
+#include "lexer.h"
+#include "stackguard.h"
+#include "parser.tab.h"
+
+/*
+Pure function evaluation.
+The analysis works on a copy of each definition, which the evaluator
+owns: char literals become integers and every call node keeps the index
+of its callee in value.intVal. Since a kept function only touches its
+own parameters and locals, running it cannot change anything outside,
+and the same arguments always give the same result, so results are
+memoized (fib-style recursion costs one evaluation per argument).
+Arithmetic follows the generated code through simplify_fold_binary;
+anything undefined (division by zero, reading an uninitialized local,
+falling off the end without a return) abandons the evaluation.
+*/
+
+typedef struct ce_function {
+    struct ast_node *def;  // Own copy of the definition
+    struct ast_node *body; // Its BLOQUE
+    const char *name;
+    const char *params[CONSTEVAL_MAX_PARAMS];
+    int nparams;
+} ce_function;
+
+static ce_function *functions = NULL;
+static int functions_len = 0;
+static int functions_cap = 0;
+
+static int find_function(const char *name) {
+    for (int i = 0; i < functions_len; i++) {
+        if (strcmp(functions[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *grow(void *array, int *cap, size_t elem, const char *what) {
+    *cap = *cap ? *cap * 2 : 64;
+    array = realloc(array, elem * *cap);
+    if (array == NULL) {
+        fprintf(stderr, "Fatal Error: realloc failed in consteval %s\n", what);
+        exit(1);
+    }
+    return array;
+}
+
+static int is_plain_int(struct ast_node *tipo) {
+    return tipo != NULL && tipo->type == NT_TIPO && tipo->value.intVal == T_INT &&
+           ast_type_count(tipo, T_UNSIGNED) == 0 && ast_type_count(tipo, T_STATIC) == 0 &&
+           ast_type_count(tipo, T_EXTERN) == 0 && ast_vector_size(tipo) == 0;
+}
+
+/* --- Purity analysis --- */
+
+// Parameters and locals visible at the current point of the analysis
+static const char **names = NULL;
+static int names_len = 0;
+static int names_cap = 0;
+
+static void names_push(const char *name) {
+    if (names_len == names_cap) {
+        names = grow(names, &names_cap, sizeof(const char *), "names");
+    }
+    names[names_len++] = name;
+}
+
+static int is_local_name(struct ast_node *node) {
+    if (node == NULL || (node->type != NT_ID && node->type != NT_VAR)) {
+        return 0;
+    }
+    for (int i = names_len - 1; i >= 0; i--) {
+        if (strcmp(names[i], node->value.strVal) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function being analysed: its name, future index and number of parameters
+static const char *self_name;
+static int self_index;
+static int self_nparams;
+
+static int pure_expr(struct ast_node *expr);
+static int pure_stmt(struct ast_node *stmt);
+
+// Deeply nested code continues on another stack segment (see stackguard.h)
+typedef struct deep_call {
+    struct ast_node *node;
+    int *value;
+    int result;
+} deep_call;
+
+static void pure_expr_deep(void *data) {
+    deep_call *call = data;
+    call->result = pure_expr(call->node);
+}
+
+static void pure_stmt_deep(void *data) {
+    deep_call *call = data;
+    call->result = pure_stmt(call->node);
+}
+
+static int pure_expr(struct ast_node *expr) {
+    if (expr == NULL) {
+        return 0;
+    }
+    if (stack_low()) {
+        deep_call call = { expr, NULL, 0 };
+        stack_extend(pure_expr_deep, &call);
+        return call.result;
+    }
+
+    switch (expr->type) {
+        case NT_ENTERO: // The evaluator only computes in int
+            return ast_int_literal(expr, &(int){ 0 });
+
+        case NT_CARACTER: {
+            char c[9];
+            if (expr->value.span.len <= 0 || expr->value.span.len > 8 ||
+                decode_literal(expr->value.span.ptr, expr->value.span.len, c) != 1) {
+                return 0;
+            }
+            // The copy must not point into the code buffer
+            expr->type = NT_ENTERO;
+            expr->value.lit = (int_lit){ (signed char)c[0], 0, 0 };
+            return 1;
+        }
+
+        case NT_ID:
+        case NT_VAR:
+            return is_local_name(expr);
+
+        case NT_EXPR_SENTENCIA: // Empty parts of a for
+            return expr->child == NULL || pure_expr(expr->child);
+
+        case NT_OP_UNARIO:
+            switch (expr->value.op) {
+                case T_MINUS: case T_NOT: case T_TILDE:
+                    return pure_expr(expr->child);
+                case T_INC: case T_DEC:
+                    return is_local_name(expr->child);
+                default:
+                    return 0;
+            }
+
+        case NT_OP_BINARIO: {
+            struct ast_node *L = expr->child;
+            struct ast_node *R = L ? L->sibling : NULL;
+            if (R == NULL) {
+                return 0;
+            }
+            switch (expr->value.op) {
+                case T_ASSIGN: case T_ASSIGN_PLUS: case T_ASSIGN_MINUS: case T_ASSIGN_STAR:
+                case T_ASSIGN_SLASH: case T_ASSIGN_PERCENT: case T_ASSIGN_LSHIFT:
+                case T_ASSIGN_RSHIFT: case T_ASSIGN_AND: case T_ASSIGN_OR: case T_ASSIGN_XOR:
+                    return is_local_name(L) && pure_expr(R);
+                case T_PLUS: case T_MINUS: case T_STAR: case T_SLASH: case T_PERCENT:
+                case T_LSHIFT: case T_RSHIFT: case T_AMPERSAND: case T_PIPE: case T_CARET:
+                case T_EQ: case T_NEQ: case T_LT: case T_LE: case T_GT: case T_GE:
+                case T_AND: case T_OR:
+                    return pure_expr(L) && pure_expr(R);
+                default:
+                    return 0;
+            }
+        }
+
+        case NT_TERNARIO: {
+            struct ast_node *cond = expr->child;
+            struct ast_node *then_e = cond ? cond->sibling : NULL;
+            struct ast_node *else_e = then_e ? then_e->sibling : NULL;
+            return pure_expr(cond) && pure_expr(then_e) && pure_expr(else_e);
+        }
+
+        case NT_LLAMADA_FUNCION: {
+            struct ast_node *fn = expr->child;
+            if (fn == NULL || fn->type != NT_ID) {
+                return 0;
+            }
+            // Only itself or a pure function analysed before: printf, externs and the rest are out
+            int index = strcmp(fn->value.strVal, self_name) == 0 ? self_index : find_function(fn->value.strVal);
+            if (index < 0) {
+                return 0;
+            }
+            int nargs = 0;
+            for (struct ast_node *arg = fn->sibling; arg != NULL; arg = arg->sibling) {
+                if (!pure_expr(arg)) {
+                    return 0;
+                }
+                nargs++;
+            }
+            expr->value.intVal = index;
+            return nargs == (index == self_index ? self_nparams : functions[index].nparams);
+        }
+
+        default:
+            return 0;
+    }
+}
+
+static int pure_stmt(struct ast_node *stmt) {
+    if (stmt == NULL) {
+        return 1;
+    }
+    if (stack_low()) {
+        deep_call call = { stmt, NULL, 0 };
+        stack_extend(pure_stmt_deep, &call);
+        return call.result;
+    }
+
+    switch (stmt->type) {
+        case NT_BLOQUE: {
+            int saved_len = names_len;
+            int ok = 1;
+            for (struct ast_node *s = stmt->child; s != NULL && ok; s = s->sibling) {
+                ok = pure_stmt(s);
+            }
+            names_len = saved_len;
+            return ok;
+        }
+
+        case NT_DECLARACION: {
+            // Scalar int locals only: no statics, arrays or other types
+            struct ast_node *tipo = stmt->child;
+            if (!is_plain_int(tipo)) {
+                return 0;
+            }
+            for (struct ast_node *cur = tipo->sibling; cur != NULL; cur = cur->sibling) {
+                if (cur->type == NT_VAR || cur->type == NT_ID) {
+                    names_push(cur->value.strVal);
+                } else if (cur->type == NT_OP_BINARIO && cur->value.op == T_ASSIGN && cur->child &&
+                           cur->child->type == NT_VAR) {
+                    names_push(cur->child->value.strVal); // In scope in its own initializer, as in C
+                    if (!pure_expr(cur->child->sibling)) {
+                        return 0;
+                    }
+                } else {
+                    return 0;
+                }
+            }
+            return 1;
+        }
+
+        case NT_EXPR_SENTENCIA:
+            return stmt->child == NULL || pure_expr(stmt->child);
+
+        case NT_RETURN:
+            return pure_expr(stmt->child);
+
+        case NT_IF: {
+            struct ast_node *cond = stmt->child;
+            struct ast_node *then_s = cond ? cond->sibling : NULL;
+            return then_s != NULL && pure_expr(cond) && pure_stmt(then_s) && pure_stmt(then_s->sibling);
+        }
+
+        case NT_WHILE:
+        case NT_DO_WHILE:
+            return stmt->child != NULL && stmt->child->sibling != NULL &&
+                   pure_expr(stmt->child) && pure_stmt(stmt->child->sibling);
+
+        case NT_FOR: {
+            struct ast_node *init = stmt->child;
+            struct ast_node *cond = init ? init->sibling : NULL;
+            struct ast_node *inc = cond ? cond->sibling : NULL;
+            struct ast_node *body = inc ? inc->sibling : NULL;
+            return body != NULL && pure_expr(init) && pure_expr(cond) && pure_expr(inc) && pure_stmt(body);
+        }
+
+        case NT_BREAK:
+        case NT_CONTINUE:
+            return 1;
+
+        default: // switch, goto and labels are left to the generated code
+            return 0;
+    }
+}
+
+void consteval_add_function(struct ast_node *fn) {
+    struct ast_node *tipo = fn ? fn->child : NULL;
+    struct ast_node *id = tipo ? tipo->sibling : NULL;
+    if (id == NULL || id->type != NT_ID || !is_plain_int(tipo) || find_function(id->value.strVal) >= 0) {
+        return;
+    }
+    struct ast_node *last = id;
+    while (last->sibling != NULL) {
+        last = last->sibling;
+    }
+    if (last->type != NT_BLOQUE) { // Prototype
+        return;
+    }
+
+    fn = ast_copy(fn);
+    ce_function f;
+    memset(&f, 0, sizeof(f));
+    f.def = fn;
+    f.name = fn->child->sibling->value.strVal;
+    names_len = 0;
+
+    struct ast_node *it = fn->child->sibling->sibling;
+    int ok = 1;
+    for (; it != NULL && it->type == NT_PARAMETRO && ok; it = it->sibling) {
+        struct ast_node *ptype = it->child;
+        struct ast_node *pid = ptype ? ptype->sibling : NULL;
+        if (pid == NULL && ptype != NULL && ptype->value.intVal == T_VOID) {
+            continue; // f(void)
+        }
+        ok = pid != NULL && pid->type == NT_ID && pid->sibling == NULL && is_plain_int(ptype) &&
+             f.nparams < CONSTEVAL_MAX_PARAMS;
+        if (ok) {
+            f.params[f.nparams++] = pid->value.strVal;
+            names_push(pid->value.strVal);
+        }
+    }
+    f.body = it;
+
+    self_name = f.name;
+    self_index = functions_len;
+    self_nparams = f.nparams;
+    if (!ok || f.body == NULL || !pure_stmt(f.body)) {
+        ast_free(fn);
+        return;
+    }
+    if (functions_len == functions_cap) {
+        functions = grow(functions, &functions_cap, sizeof(ce_function), "functions");
+    }
+    functions[functions_len++] = f;
+}
+
+/* --- Evaluator --- */
+
+typedef enum {
+    FLOW_NEXT,
+    FLOW_BREAK,
+    FLOW_CONTINUE,
+    FLOW_RETURN,
+    FLOW_FAIL
+} flow;
+
+typedef struct ce_var {
+    const char *name;
+    int value;
+    int set; // Reading a local before it is assigned is undefined
+} ce_var;
+
+// Variables of the calls in progress; the current frame starts at frame_base
+static ce_var *vars = NULL;
+static int vars_len = 0;
+static int vars_cap = 0;
+static int frame_base = 0;
+
+static long steps;
+static int depth;
+static int return_value;
+
+static void var_push(const char *name, int value, int set) {
+    if (vars_len == vars_cap) {
+        vars = grow(vars, &vars_cap, sizeof(ce_var), "variables");
+    }
+    vars[vars_len].name = name;
+    vars[vars_len].value = value;
+    vars[vars_len].set = set;
+    vars_len++;
+}
+
+static ce_var *var_lookup(struct ast_node *node) {
+    for (int i = vars_len - 1; i >= frame_base; i--) {
+        if (strcmp(vars[i].name, node->value.strVal) == 0) {
+            return &vars[i];
+        }
+    }
+    return NULL;
+}
+
+/* Memoized results, by function and arguments */
+#define MEMO_SIZE 4096
+
+typedef struct memo_entry {
+    int used;
+    int function;
+    int args[CONSTEVAL_MAX_PARAMS];
+    int result;
+} memo_entry;
+
+static memo_entry *memo = NULL;
+
+static memo_entry *memo_slot(int function, const int *args, int nargs, int *found) {
+    uint32_t h = 2166136261u ^ (uint32_t)function;
+    for (int i = 0; i < nargs; i++) {
+        h = (h ^ (uint32_t)args[i]) * 16777619u;
+    }
+    for (int probe = 0; probe < 8; probe++) {
+        memo_entry *e = &memo[(h + probe) % MEMO_SIZE];
+        if (!e->used) {
+            *found = 0;
+            return e;
+        }
+        if (e->function == function && memcmp(e->args, args, sizeof(int) * nargs) == 0) {
+            *found = 1;
+            return e;
+        }
+    }
+    *found = 0;
+    return NULL; // Full around this key: the result is just not remembered
+}
+
+static int eval_expr(struct ast_node *expr, int *value);
+static flow exec_stmt(struct ast_node *stmt);
+
+static void eval_expr_deep(void *data) {
+    deep_call *call = data;
+    call->result = eval_expr(call->node, call->value);
+}
+
+static void exec_stmt_deep(void *data) {
+    deep_call *call = data;
+    call->result = exec_stmt(call->node);
+}
+
+static int call_function(int index, const int *args, int *result) {
+    ce_function *f = &functions[index];
+    int found;
+    memo_entry *slot = memo_slot(index, args, f->nparams, &found);
+    if (found) {
+        *result = slot->result;
+        return 1;
+    }
+    if (depth == CONSTEVAL_MAX_DEPTH) {
+        return 0;
+    }
+
+    int saved_base = frame_base;
+    int saved_len = vars_len;
+    frame_base = vars_len;
+    for (int i = 0; i < f->nparams; i++) {
+        var_push(f->params[i], args[i], 1);
+    }
+    depth++;
+    flow fl = exec_stmt(f->body);
+    depth--;
+    vars_len = saved_len;
+    frame_base = saved_base;
+    if (fl != FLOW_RETURN) {
+        return 0;
+    }
+
+    *result = return_value;
+    // The slot may have been taken by a nested call meanwhile
+    slot = memo_slot(index, args, f->nparams, &found);
+    if (slot != NULL) {
+        slot->used = 1;
+        slot->function = index;
+        memcpy(slot->args, args, sizeof(int) * f->nparams);
+        slot->result = *result;
+    }
+    return 1;
+}
+
+static int eval_assignment_op(int op) {
+    switch (op) {
+        case T_ASSIGN_PLUS:    return T_PLUS;
+        case T_ASSIGN_MINUS:   return T_MINUS;
+        case T_ASSIGN_STAR:    return T_STAR;
+        case T_ASSIGN_SLASH:   return T_SLASH;
+        case T_ASSIGN_PERCENT: return T_PERCENT;
+        case T_ASSIGN_LSHIFT:  return T_LSHIFT;
+        case T_ASSIGN_RSHIFT:  return T_RSHIFT;
+        case T_ASSIGN_AND:     return T_AMPERSAND;
+        case T_ASSIGN_OR:      return T_PIPE;
+        case T_ASSIGN_XOR:     return T_CARET;
+        default:               return 0;
+    }
+}
+
+static int eval_expr(struct ast_node *expr, int *value) {
+    if (++steps > CONSTEVAL_MAX_STEPS) {
+        return 0;
+    }
+    if (stack_low()) {
+        deep_call call = { expr, value, 0 };
+        stack_extend(eval_expr_deep, &call);
+        return call.result;
+    }
+
+    switch (expr->type) {
+        case NT_ENTERO:
+            return ast_int_literal(expr, value);
+
+        case NT_ID:
+        case NT_VAR: {
+            ce_var *v = var_lookup(expr);
+            if (v == NULL || !v->set) {
+                return 0;
+            }
+            *value = v->value;
+            return 1;
+        }
+
+        case NT_EXPR_SENTENCIA:
+            if (expr->child == NULL) {
+                *value = 1; // An empty for condition is true
+                return 1;
+            }
+            return eval_expr(expr->child, value);
+
+        case NT_OP_UNARIO: {
+            int op = expr->value.op;
+            if (op == T_INC || op == T_DEC) { // Both forms give the new value, as in codegen.c
+                ce_var *v = var_lookup(expr->child);
+                if (v == NULL || !v->set) {
+                    return 0;
+                }
+                v->value = (int)((uint32_t)v->value + (op == T_INC ? 1u : (uint32_t)-1));
+                *value = v->value;
+                return 1;
+            }
+            int x;
+            if (!eval_expr(expr->child, &x)) {
+                return 0;
+            }
+            *value = op == T_MINUS ? (int)(0u - (uint32_t)x) : op == T_NOT ? !x : ~x;
+            return 1;
+        }
+
+        case NT_OP_BINARIO: {
+            int op = expr->value.op;
+            struct ast_node *L = expr->child;
+            struct ast_node *R = L->sibling;
+            int a, b;
+            if (op == T_AND || op == T_OR) {
+                if (!eval_expr(L, &a)) {
+                    return 0;
+                }
+                if ((op == T_AND && a == 0) || (op == T_OR && a != 0)) {
+                    *value = op == T_OR;
+                    return 1;
+                }
+                if (!eval_expr(R, &b)) {
+                    return 0;
+                }
+                *value = b != 0;
+                return 1;
+            }
+            if (op == T_ASSIGN || eval_assignment_op(op)) {
+                if (!eval_expr(R, &b)) {
+                    return 0;
+                }
+                // Looked up after the right side, whose calls may have moved the variables
+                ce_var *v = var_lookup(L);
+                if (v == NULL) {
+                    return 0;
+                }
+                if (op != T_ASSIGN && (!v->set || !simplify_fold_binary(eval_assignment_op(op), v->value, b, &b))) {
+                    return 0;
+                }
+                v->value = b;
+                v->set = 1;
+                *value = b;
+                return 1;
+            }
+            return eval_expr(L, &a) && eval_expr(R, &b) && simplify_fold_binary(op, a, b, value);
+        }
+
+        case NT_TERNARIO: {
+            int c;
+            if (!eval_expr(expr->child, &c)) {
+                return 0;
+            }
+            return eval_expr(c ? expr->child->sibling : expr->child->sibling->sibling, value);
+        }
+
+        case NT_LLAMADA_FUNCION: {
+            int args[CONSTEVAL_MAX_PARAMS];
+            int nargs = 0;
+            for (struct ast_node *arg = expr->child->sibling; arg != NULL; arg = arg->sibling) {
+                if (!eval_expr(arg, &args[nargs++])) {
+                    return 0;
+                }
+            }
+            return call_function(expr->value.intVal, args, value);
+        }
+
+        default:
+            return 0;
+    }
+}
+
+static flow exec_stmt(struct ast_node *stmt) {
+    if (stmt == NULL) {
+        return FLOW_NEXT;
+    }
+    if (++steps > CONSTEVAL_MAX_STEPS) {
+        return FLOW_FAIL;
+    }
+    if (stack_low()) {
+        deep_call call = { stmt, NULL, 0 };
+        stack_extend(exec_stmt_deep, &call);
+        return (flow)call.result;
+    }
+
+    int c;
+    switch (stmt->type) {
+        case NT_BLOQUE: {
+            int saved_len = vars_len;
+            flow fl = FLOW_NEXT;
+            for (struct ast_node *s = stmt->child; s != NULL && fl == FLOW_NEXT; s = s->sibling) {
+                fl = exec_stmt(s);
+            }
+            vars_len = saved_len;
+            return fl;
+        }
+
+        case NT_DECLARACION:
+            for (struct ast_node *cur = stmt->child->sibling; cur != NULL; cur = cur->sibling) {
+                if (cur->type == NT_OP_BINARIO) {
+                    var_push(cur->child->value.strVal, 0, 0);
+                    if (!eval_expr(cur, &c)) {
+                        return FLOW_FAIL;
+                    }
+                } else {
+                    var_push(cur->value.strVal, 0, 0);
+                }
+            }
+            return FLOW_NEXT;
+
+        case NT_EXPR_SENTENCIA:
+            return stmt->child == NULL || eval_expr(stmt->child, &c) ? FLOW_NEXT : FLOW_FAIL;
+
+        case NT_RETURN:
+            return eval_expr(stmt->child, &return_value) ? FLOW_RETURN : FLOW_FAIL;
+
+        case NT_IF:
+            if (!eval_expr(stmt->child, &c)) {
+                return FLOW_FAIL;
+            }
+            return exec_stmt(c ? stmt->child->sibling : stmt->child->sibling->sibling);
+
+        case NT_WHILE:
+        case NT_DO_WHILE:
+        case NT_FOR: {
+            struct ast_node *cond = stmt->child;
+            struct ast_node *inc = NULL;
+            struct ast_node *body = cond->sibling;
+            if (stmt->type == NT_FOR) {
+                if (!eval_expr(stmt->child, &c)) {
+                    return FLOW_FAIL;
+                }
+                cond = stmt->child->sibling;
+                inc = cond->sibling;
+                body = inc->sibling;
+            }
+            int first = stmt->type == NT_DO_WHILE;
+            for (;;) {
+                if (!first) {
+                    if (!eval_expr(cond, &c)) {
+                        return FLOW_FAIL;
+                    }
+                    if (c == 0) {
+                        return FLOW_NEXT;
+                    }
+                }
+                first = 0;
+                flow fl = exec_stmt(body);
+                if (fl == FLOW_BREAK) {
+                    return FLOW_NEXT;
+                }
+                if (fl == FLOW_RETURN || fl == FLOW_FAIL) {
+                    return fl;
+                }
+                if (inc != NULL && !eval_expr(inc, &c)) {
+                    return FLOW_FAIL;
+                }
+            }
+        }
+
+        case NT_BREAK:
+            return FLOW_BREAK;
+
+        case NT_CONTINUE:
+            return FLOW_CONTINUE;
+
+        default:
+            return FLOW_FAIL;
+    }
+}
+
+int consteval_call(const char *name, const int *args, int nargs, int *result) {
+    int index = find_function(name);
+    if (index < 0 || functions[index].nparams != nargs) {
+        return 0;
+    }
+    if (memo == NULL) {
+        memo = calloc(MEMO_SIZE, sizeof(memo_entry));
+        if (memo == NULL) {
+            fprintf(stderr, "Fatal Error: calloc failed in consteval memo\n");
+            exit(1);
+        }
+    }
+    steps = 0;
+    depth = 0;
+    vars_len = 0;
+    frame_base = 0;
+    return call_function(index, args, result);
+}
+
+void consteval_begin(void) {
+    functions_len = 0;
+}
+
+void consteval_end(void) {
+    for (int i = 0; i < functions_len; i++) {
+        ast_free(functions[i].def);
+    }
+    free(functions);
+    free(names);
+    free(vars);
+    free(memo);
+    functions = NULL;
+    names = NULL;
+    vars = NULL;
+    memo = NULL;
+    functions_len = functions_cap = 0;
+    names_len = names_cap = 0;
+    vars_len = vars_cap = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef CONSTEVAL_H
+#define CONSTEVAL_H
+
+#include "ast.h"
+
+/*
+Compile-time evaluation of calls to pure functions, used by simplify.c.
+Every function definition is analysed once it has been simplified; the
+pure ones (int parameters, locals and result, no globals, no I/O, calls
+only to themselves or to pure functions defined before them) are kept,
+and a call to one of them whose arguments are all constants is run by
+a bounded interpreter over the AST and replaced by its result. Calls
+that would do something undefined or reach a limit stay for runtime.
+*/
+
+// Statements and expressions evaluated for one call site, callees included
+#define CONSTEVAL_MAX_STEPS 1000000
+
+// Nested calls during one evaluation
+#define CONSTEVAL_MAX_DEPTH 256
+
+// Parameters of a function that can be evaluated
+#define CONSTEVAL_MAX_PARAMS 16
+
+void consteval_begin(void);
+
+// Analyses a definition (prototypes are ignored) and keeps a copy of it if it is pure
+void consteval_add_function(struct ast_node *fn);
+
+// Evaluates name(args); 1 and *result on success, 0 if it must be left for runtime
+int consteval_call(const char *name, const int *args, int nargs, int *result);
+
+void consteval_end(void);
+
+#endif // CONSTEVAL_H
@@ -0,0 +1,2091 @@
+#include <alloca.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/Support.h>
+#include "interp.h"
+#include "lexer.h"
+#include "parser.tab.h"
+#include "stackguard.h"
+#include "../runtime/freezepiler_rt.h"
+
+// =======================================================
+// VALORES
+// =======================================================
+
+// Tipos escalares, con el tamaño y la representación que les da codegen.c
+typedef enum {
+    K_VOID,
+    K_I1,  // Resultado de una comparación (el i1 de LLVM): 0 o 1
+    K_I8,
+    K_I16,
+    K_I32,
+    K_I64,
+    K_F32,
+    K_F64,
+    K_STR  // Literal de cadena; sólo llega a printf
+} kind;
+
+#define IS_INT(k) ((k) >= K_I1 && (k) <= K_I64)
+#define IS_FLOAT(k) ((k) == K_F32 || (k) == K_F64)
+#define IS_SCALAR(k) (IS_INT(k) || IS_FLOAT(k))
+
+static const unsigned kind_bits[] = { 0, 1, 8, 16, 32, 64, 32, 64, 64 };
+
+/*
+Integers are kept normalized to the width and signedness of their type
+(an unsigned char holds 0..255), so 64-bit arithmetic followed by
+normalization gives the result of the narrow operation. A float is kept
+as a double already rounded to float.
+*/
+typedef union value {
+    int64_t i;
+    double d;
+    const char *s;
+} value;
+
+static size_t kind_size(kind k) {
+    return k == K_I8 ? 1 : k == K_I16 ? 2 : k == K_I32 || k == K_F32 ? 4 : 8;
+}
+
+static int64_t wrap(int64_t v, kind k, int u) {
+    switch (k) {
+    case K_I1:
+        return v != 0;
+    case K_I8:
+        return u ? (int64_t)(uint8_t)v : (int64_t)(int8_t)v;
+    case K_I16:
+        return u ? (int64_t)(uint16_t)v : (int64_t)(int16_t)v;
+    case K_I32:
+        return u ? (int64_t)(uint32_t)v : (int64_t)(int32_t)v;
+    default:
+        return v;
+    }
+}
+
+// fptosi/fptoui como los baja el backend de x86-64: los tipos angostos pasan por un entero más ancho
+static int64_t float_to_int(double d, kind k, int u) {
+    if (k == K_I1) {
+        return d != 0;
+    }
+    if (k == K_I64) {
+        return u ? (int64_t)(uint64_t)d : (int64_t)d;
+    }
+    if (k == K_I32 && u) {
+        return (int64_t)(uint32_t)(int64_t)d;
+    }
+    return wrap((int32_t)d, k, u);
+}
+
+// convert_value de codegen.c: el signo del origen decide sext/zext y sitofp/uitofp
+static value convert(value v, kind sk, int su, kind dk, int du) {
+    value r = v;
+    if (IS_INT(sk) && IS_INT(dk)) {
+        r.i = wrap(v.i, dk, du);
+    } else if (IS_INT(sk) && IS_FLOAT(dk)) {
+        if (su || sk == K_I1) {
+            r.d = dk == K_F32 ? (double)(float)(uint64_t)v.i : (double)(uint64_t)v.i;
+        } else {
+            r.d = dk == K_F32 ? (double)(float)v.i : (double)v.i;
+        }
+    } else if (IS_FLOAT(sk) && IS_INT(dk)) {
+        r.i = float_to_int(v.d, dk, du);
+    } else if (IS_FLOAT(sk) && IS_FLOAT(dk)) {
+        r.d = dk == K_F32 ? (double)(float)v.d : v.d;
+    }
+    return r;
+}
+
+static value load(const char *p, kind k, int u) {
+    value v;
+    switch (k) {
+    case K_I8: {
+        uint8_t x;
+        memcpy(&x, p, 1);
+        v.i = wrap(x, k, u);
+        break;
+    }
+    case K_I16: {
+        uint16_t x;
+        memcpy(&x, p, 2);
+        v.i = wrap(x, k, u);
+        break;
+    }
+    case K_I32: {
+        uint32_t x;
+        memcpy(&x, p, 4);
+        v.i = wrap(x, k, u);
+        break;
+    }
+    case K_F32: {
+        float x;
+        memcpy(&x, p, 4);
+        v.d = x;
+        break;
+    }
+    default:
+        memcpy(&v, p, 8);
+        break;
+    }
+    return v;
+}
+
+static void store(char *p, kind k, value v) {
+    switch (k) {
+    case K_I8: {
+        uint8_t x = (uint8_t)v.i;
+        memcpy(p, &x, 1);
+        break;
+    }
+    case K_I16: {
+        uint16_t x = (uint16_t)v.i;
+        memcpy(p, &x, 2);
+        break;
+    }
+    case K_I32: {
+        uint32_t x = (uint32_t)v.i;
+        memcpy(p, &x, 4);
+        break;
+    }
+    case K_F32: {
+        float x = (float)v.d;
+        memcpy(p, &x, 4);
+        break;
+    }
+    default:
+        memcpy(p, &v, 8);
+        break;
+    }
+}
+
+/*
+build_binary de codegen.c sobre operandos ya convertidos a (k, u). Las
+comparaciones devuelven 0 o 1; los desplazamientos usan la cantidad
+módulo el ancho, como x86.
+*/
+static value arith(int op, kind k, int u, value l, value r) {
+    value v;
+    if (IS_FLOAT(k)) {
+        double x = l.d, y = r.d;
+        switch (op) {
+        case T_PLUS:    v.d = x + y; break;
+        case T_MINUS:   v.d = x - y; break;
+        case T_STAR:    v.d = x * y; break;
+        case T_SLASH:   v.d = x / y; break;
+        case T_PERCENT: v.d = fmod(x, y); break;
+        case T_EQ:      v.i = x == y; return v;
+        case T_NEQ:     v.i = x != y; return v;
+        case T_LT:      v.i = x < y; return v;
+        case T_LE:      v.i = x <= y; return v;
+        case T_GT:      v.i = x > y; return v;
+        default:        v.i = x >= y; return v; // T_GE
+        }
+        if (k == K_F32) {
+            v.d = (float)v.d;
+        }
+        return v;
+    }
+
+    uint64_t x = (uint64_t)l.i, y = (uint64_t)r.i;
+    int64_t sx = l.i, sy = r.i;
+    unsigned amount = (unsigned)(y & (kind_bits[k] - 1));
+    switch (op) {
+    case T_PLUS:      v.i = (int64_t)(x + y); break;
+    case T_MINUS:     v.i = (int64_t)(x - y); break;
+    case T_STAR:      v.i = (int64_t)(x * y); break;
+    case T_SLASH:     v.i = u ? (int64_t)(x / y) : sx / sy; break;
+    case T_PERCENT:   v.i = u ? (int64_t)(x % y) : sx % sy; break;
+    case T_AMPERSAND: v.i = (int64_t)(x & y); break;
+    case T_PIPE:      v.i = (int64_t)(x | y); break;
+    case T_CARET:     v.i = (int64_t)(x ^ y); break;
+    case T_LSHIFT:    v.i = (int64_t)(x << amount); break;
+    case T_RSHIFT:    v.i = u ? (int64_t)(x >> amount) : sx >> amount; break;
+    case T_EQ:        v.i = x == y; return v;
+    case T_NEQ:       v.i = x != y; return v;
+    case T_LT:        v.i = u ? x < y : sx < sy; return v;
+    case T_LE:        v.i = u ? x <= y : sx <= sy; return v;
+    case T_GT:        v.i = u ? x > y : sx > sy; return v;
+    default:          v.i = u ? x >= y : sx >= sy; return v; // T_GE
+    }
+    v.i = wrap(v.i, k, u);
+    return v;
+}
+
+// =======================================================
+// PROGRAMA BAJADO
+// =======================================================
+
+typedef enum {
+    // Expresiones
+    E_CONST,
+    E_LOAD,     // a: dirección
+    E_CONV,     // a convertido a (k, u)
+    E_BIN,      // a op b, ambos ya en (ck, cu)
+    E_AND,
+    E_OR,
+    E_NOT,
+    E_NEG,
+    E_BITNOT,
+    E_TERN,     // a ? b : c, con b y c ya en (k, u)
+    E_ASSIGN,   // a: dirección, b: valor ya en (k, u)
+    E_COMPOUND, // a op= b; b ya en (ck, cu)
+    E_INCDEC,   // ++a / --a, que devuelven el valor nuevo
+    E_CALL,
+    E_PRINTF,   // a: formato, seguido de los argumentos
+    // Direcciones
+    A_VAR,      // var + off
+    A_INDEX,    // a + b * off
+    // Sentencias
+    S_NOP,
+    S_EXPR,
+    S_BLOCK,    // a: primera sentencia, encadenadas por next
+    S_ZERO,     // var = 0, antes de la lista que inicializa un arreglo
+    S_IF,
+    S_WHILE,    // while (a) b
+    S_DO,       // do b while (a)
+    S_FOR,      // for (a; b; c) d
+    S_SWITCH,
+    S_BREAK,
+    S_CONTINUE,
+    S_RETURN
+} op_kind;
+
+typedef struct ivar ivar;
+typedef struct ifunc ifunc;
+typedef struct iloop iloop;
+typedef struct iswitch iswitch;
+typedef struct inode inode;
+
+struct ivar {
+    const char *name;
+    kind k;
+    int u;
+    int ndims;
+    int *dims;
+    size_t elem_size, size, align;
+    int is_static;          // global, static o extern: vive en addr
+    char *addr;
+    size_t offset;          // automática: desplazamiento en el marco
+    char *global_name;      // nombre de la global en el módulo de LLVM
+    ast_node *tipo;         // declaración, para codegen_build_osr_module
+    ast_node *declarator;
+    ivar *next_global;
+};
+
+struct inode {
+    op_kind op;
+    kind k;                 // tipo del resultado
+    int u;
+    kind ck;                // tipo en que operan E_BIN y E_COMPOUND
+    int cu;
+    int tok;                // operador (T_PLUS, T_INC...)
+    inode *a, *b, *c, *d;
+    inode *next;            // siguiente sentencia de un bloque, o siguiente argumento
+    value value;            // E_CONST
+    size_t off;             // A_VAR: desplazamiento; A_INDEX: tamaño del elemento
+    ivar *var;
+    ifunc *fn;
+    iloop *loop;
+    iswitch *sw;
+};
+
+struct iloop {
+    ast_node *origin;       // el bucle en el AST
+    int nvisible;           // variables del marco ya declaradas al empezar el bucle
+    unsigned long count;    // aristas de regreso
+    int state;              // 0 interpretado, 1 compilado, -1 no se pudo compilar
+    int (*entry)(char **slots, void *ret);
+};
+
+struct iswitch {
+    inode **stmts;          // sentencias del cuerpo, en orden
+    int nstmts;
+    int64_t *values;        // valor de cada case, ya en el tipo del switch
+    int *targets;           // sentencia donde empieza cada case
+    int ncases;
+    int default_target;     // -1: sin default, el switch no hace nada
+};
+
+struct ifunc {
+    const char *name;
+    ast_node *def;          // definición; NULL si sólo hay prototipos
+    kind rk;
+    int ru;
+    int nparams;            // tipos de la primera declaración, como codegen_prototype
+    kind *pk;
+    int *pu;
+    ivar **vars;            // parámetros y variables en orden de declaración: la tabla plana de codegen
+    int nvars, cap;
+    size_t frame_size;
+    inode *body;
+    unsigned long calls, backedges;
+    int tier;               // 0 interpretada, 1 nativa, -1 no se pudo compilar
+    void (*native)(uint64_t *args, uint64_t *ret);
+    ifunc *next;
+};
+
+// Todo lo que se baja vive hasta el final de interp_run
+typedef struct allocation {
+    struct allocation *next;
+    _Alignas(16) char data[];
+} allocation;
+static allocation *allocations = NULL;
+
+static void *arena(size_t n) {
+    allocation *a = calloc(1, sizeof(allocation) + n);
+    if (a == NULL) {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    a->next = allocations;
+    allocations = a;
+    return a->data;
+}
+
+static ast_node *program = NULL;
+static codegen_options jit_opts;          // módulos que se compilan durante la ejecución
+static unsigned long hot_threshold = INTERP_DEFAULT_THRESHOLD;
+static LLVMModuleRef base_module = NULL;  // el programa validado y sin optimizar: cada función se compila de una copia
+static LLVMExecutionEngineRef *engines = NULL;
+static int nengines = 0;
+static unsigned jit_count = 0;            // nombres únicos de las funciones de entrada
+static ifunc *functions = NULL;
+static ivar *globals = NULL;              // globales del módulo, también las static locales ("f.x")
+static ifunc *lowering = NULL;            // función que se está bajando; NULL en inicializadores globales
+
+static ifunc *function_named(const char *name) {
+    for (ifunc *f = functions; f; f = f->next) {
+        if (strcmp(f->name, name) == 0) return f;
+    }
+    return NULL;
+}
+
+static ivar *global_named(const char *name) {
+    for (ivar *v = globals; v; v = v->next_global) {
+        if (strcmp(v->global_name, name) == 0) return v;
+    }
+    return NULL;
+}
+
+// sym_lookup de codegen.c: la última declaración de la función, luego las globales
+static ivar *lookup(const char *name) {
+    if (lowering) {
+        for (int i = lowering->nvars - 1; i >= 0; i--) {
+            if (strcmp(lowering->vars[i]->name, name) == 0) return lowering->vars[i];
+        }
+    }
+    for (ivar *v = globals; v; v = v->next_global) {
+        if (strcmp(v->global_name, name) == 0) return v;
+    }
+    return NULL;
+}
+
+static void add_var(ifunc *f, ivar *v) {
+    if (f->nvars == f->cap) {
+        f->cap = f->cap ? f->cap * 2 : 16;
+        ivar **vars = arena(f->cap * sizeof(ivar *));
+        if (f->nvars > 0) memcpy(vars, f->vars, f->nvars * sizeof(ivar *));
+        f->vars = vars;
+    }
+    f->vars[f->nvars++] = v;
+    if (!v->is_static) {
+        v->offset = (f->frame_size + v->align - 1) & ~(v->align - 1);
+        f->frame_size = v->offset + v->size;
+    }
+}
+
+static void add_global(ivar *v, const char *global_name) {
+    v->global_name = arena(strlen(global_name) + 1);
+    strcpy(v->global_name, global_name);
+    v->is_static = 1;
+    v->addr = arena(v->size);
+    v->next_global = globals;
+    globals = v;
+}
+
+// =======================================================
+// BAJADA: TIPOS Y DECLARACIONES
+// =======================================================
+
+// map_type_token y type_is_unsigned de codegen.c
+static void type_of(ast_node *tipo, kind *k, int *u) {
+    switch (tipo ? tipo->value.intVal : T_INT) {
+    case T_CHAR:   *k = K_I8; break;
+    case T_SHORT:  *k = K_I16; break;
+    case T_LONG:   *k = K_I64; break;
+    case T_FLOAT:  *k = K_F32; break;
+    case T_DOUBLE: *k = K_F64; break;
+    case T_VOID:   *k = K_VOID; break;
+    default:       *k = K_I32; break;
+    }
+    *u = ast_type_count(tipo, T_UNSIGNED) > 0;
+}
+
+// declarator_parts de codegen.c
+static const char *declarator_name(ast_node *cur, ast_node **var, ast_node **init) {
+    *var = cur;
+    *init = NULL;
+    if (cur->type == NT_OP_BINARIO && cur->value.op == T_ASSIGN && cur->child) {
+        *var = cur->child;
+        *init = cur->child->sibling;
+    }
+    if ((*var)->type == NT_VAR || (*var)->type == NT_ID) {
+        return (*var)->value.strVal;
+    }
+    if ((*var)->type == NT_ARRAY_DECL && (*var)->child) {
+        return (*var)->child->value.strVal;
+    }
+    return NULL;
+}
+
+// Variable con el tipo y las dimensiones de su declarador (array_type_of de codegen.c)
+static ivar *new_var(const char *name, ast_node *tipo, ast_node *var, ast_node *init) {
+    ivar *v = arena(sizeof(ivar));
+    v->name = name;
+    v->tipo = tipo;
+    type_of(tipo, &v->k, &v->u);
+    if (v->k == K_VOID || ast_vector_size(tipo) > 0) { // Los vectores de gcc sólo los genera codegen.c
+        return NULL;
+    }
+    v->elem_size = v->size = kind_size(v->k);
+    if (var && var->type == NT_ARRAY_DECL) {
+        for (ast_node *d = var->child ? var->child->sibling : NULL; d; d = d->sibling) v->ndims++;
+        v->dims = arena(v->ndims * sizeof(int));
+        int i = 0;
+        for (ast_node *d = var->child ? var->child->sibling : NULL; d; d = d->sibling, i++) {
+            if (i == 0 && d->type == NT_EXPR_SENTENCIA && !d->child && init && init->type == NT_LISTA_INIT) {
+                for (ast_node *item = init->child; item; item = item->sibling) v->dims[0]++;
+            } else if (ast_int_literal(d, &v->dims[i]) && v->dims[i] > 0) {
+            } else {
+                return NULL;
+            }
+            v->size *= (size_t)v->dims[i];
+        }
+    }
+    // Como align_array_storage: los arreglos de 16 bytes o más van alineados a 16
+    v->align = v->ndims > 0 && v->size >= 16 ? 16 : v->elem_size;
+    return v;
+}
+
+// Bytes entre dos elementos consecutivos del nivel level de un arreglo
+static size_t stride(ivar *v, int level) {
+    size_t s = v->elem_size;
+    for (int i = level + 1; i < v->ndims; i++) s *= (size_t)v->dims[i];
+    return s;
+}
+
+static inode *new_node(op_kind op, kind k, int u) {
+    inode *n = arena(sizeof(inode));
+    n->op = op;
+    n->k = k;
+    n->u = u;
+    return n;
+}
+
+static inode *constant(kind k, int u, value v) {
+    inode *n = new_node(E_CONST, k, u);
+    n->value = v;
+    return n;
+}
+
+static inode *convert_node(inode *n, kind k, int u) {
+    if (!n) return NULL;
+    if (!IS_SCALAR(n->k) || !IS_SCALAR(k)) {
+        return n->k == k ? n : NULL;
+    }
+    if (n->k == k && n->u == u) return n;
+    if (n->op == E_CONST) { // Las constantes se pliegan, como hace el IRBuilder
+        return constant(k, u, convert(n->value, n->k, n->u, k, u));
+    }
+    inode *c = new_node(E_CONV, k, u);
+    c->a = n;
+    return c;
+}
+
+static void promote_kind(kind *k, int *u) {
+    if (*k == K_I1 || *k == K_I8 || *k == K_I16) {
+        *k = K_I32;
+        *u = 0;
+    }
+}
+
+static inode *promote(inode *n) {
+    if (!n) return NULL;
+    kind k = n->k;
+    int u = n->u;
+    promote_kind(&k, &u);
+    return convert_node(n, k, u);
+}
+
+// usual_arith_conversions de codegen.c; 0 si algún operando no es aritmético
+static int common_type(kind lk, int lu, kind rk, int ru, kind *k, int *u) {
+    if (!IS_SCALAR(lk) || !IS_SCALAR(rk)) return 0;
+    if (IS_FLOAT(lk) || IS_FLOAT(rk)) {
+        *k = !IS_FLOAT(lk) ? rk : !IS_FLOAT(rk) ? lk : (lk == K_F64 || rk == K_F64) ? K_F64 : K_F32;
+        *u = 0;
+        return 1;
+    }
+    promote_kind(&lk, &lu);
+    promote_kind(&rk, &ru);
+    if (lk == rk) {
+        *k = lk;
+        *u = lu || ru;
+    } else if (kind_bits[lk] > kind_bits[rk]) {
+        *k = lk;
+        *u = lu;
+    } else {
+        *k = rk;
+        *u = ru;
+    }
+    return 1;
+}
+
+static int is_comparison(int op) {
+    return op == T_EQ || op == T_NEQ || op == T_LT || op == T_LE || op == T_GT || op == T_GE;
+}
+
+// Tipo en que se opera (*ck, *cu); 0 si codegen no genera el operador para estos tipos
+static int binary_type(int op, kind lk, int lu, kind rk, int ru, kind *ck, int *cu) {
+    if (op == T_LSHIFT || op == T_RSHIFT) {
+        if (!IS_INT(lk) || !IS_INT(rk)) return 0;
+        *ck = lk;
+        *cu = lu;
+        promote_kind(ck, cu);
+        return 1;
+    }
+    if (!common_type(lk, lu, rk, ru, ck, cu)) return 0;
+    switch (op) {
+    case T_PLUS: case T_MINUS: case T_STAR: case T_SLASH: case T_PERCENT:
+        return 1;
+    case T_AMPERSAND: case T_PIPE: case T_CARET:
+        return IS_INT(*ck);
+    default:
+        return is_comparison(op);
+    }
+}
+
+static inode *binary(int op, inode *l, inode *r) {
+    kind ck;
+    int cu;
+    if (!l || !r || !binary_type(op, l->k, l->u, r->k, r->u, &ck, &cu)) return NULL;
+    l = convert_node(l, ck, cu);
+    r = convert_node(r, ck, cu);
+    int division = op == T_SLASH || op == T_PERCENT;
+    if (l->op == E_CONST && r->op == E_CONST && !(division && IS_INT(ck) && r->value.i == 0)) {
+        return constant(is_comparison(op) ? K_I1 : ck, is_comparison(op) ? 0 : cu, arith(op, ck, cu, l->value, r->value));
+    }
+    inode *n = new_node(E_BIN, is_comparison(op) ? K_I1 : ck, is_comparison(op) ? 0 : cu);
+    n->tok = op;
+    n->ck = ck;
+    n->cu = cu;
+    n->a = l;
+    n->b = r;
+    return n;
+}
+
+// =======================================================
+// BAJADA: EXPRESIONES
+// =======================================================
+
+static inode *lower_expr(ast_node *e);
+
+// Operador binario sin asignación ni corto circuito (is_plain_binary de codegen.c)
+static int is_plain_binary(ast_node *e) {
+    if (e->type != NT_OP_BINARIO || !e->child || !e->child->sibling) return 0;
+    int op = e->value.op;
+    return op != T_ASSIGN && op != T_AND && op != T_OR && !(op >= T_ASSIGN_PLUS && op <= T_ASSIGN_XOR);
+}
+
+static int compound_op(int op) {
+    switch (op) {
+    case T_ASSIGN_PLUS:    return T_PLUS;
+    case T_ASSIGN_MINUS:   return T_MINUS;
+    case T_ASSIGN_STAR:    return T_STAR;
+    case T_ASSIGN_SLASH:   return T_SLASH;
+    case T_ASSIGN_PERCENT: return T_PERCENT;
+    case T_ASSIGN_LSHIFT:  return T_LSHIFT;
+    case T_ASSIGN_RSHIFT:  return T_RSHIFT;
+    case T_ASSIGN_AND:     return T_AMPERSAND;
+    case T_ASSIGN_OR:      return T_PIPE;
+    case T_ASSIGN_XOR:     return T_CARET;
+    default:               return 0;
+    }
+}
+
+// Dirección de un lvalue; *level cuenta las dimensiones de *var ya indexadas
+static inode *lower_address(ast_node *e, ivar **var, int *level) {
+    if (e && e->type == NT_ACCESO_ARRAY) {
+        ast_node *index = e->child ? e->child->sibling : NULL;
+        inode *base = lower_address(e->child, var, level);
+        if (!base || !index || *level >= (*var)->ndims) return NULL;
+        inode *i = lower_expr(index);
+        if (!i || !IS_INT(i->k)) return NULL;
+        i = convert_node(i, K_I64, 0);
+        size_t size = stride(*var, *level);
+        (*level)++;
+        if (i->op == E_CONST && base->op == A_VAR) { // a[2][j]: los índices constantes quedan en el desplazamiento
+            base->off += (size_t)(i->value.i * (int64_t)size);
+            return base;
+        }
+        inode *n = new_node(A_INDEX, K_VOID, 0);
+        n->a = base;
+        n->b = i;
+        n->off = size;
+        return n;
+    }
+    if (!e || (e->type != NT_ID && e->type != NT_VAR) || !e->value.strVal) return NULL;
+    *var = lookup(e->value.strVal);
+    if (!*var) return NULL;
+    *level = 0;
+    inode *n = new_node(A_VAR, K_VOID, 0);
+    n->var = *var;
+    return n;
+}
+
+// Sólo los escalares: un arreglo en una expresión sería un puntero
+static inode *lower_scalar_address(ast_node *e, kind *k, int *u) {
+    ivar *var;
+    int level;
+    inode *a = lower_address(e, &var, &level);
+    if (!a || level != var->ndims) return NULL;
+    *k = var->k;
+    *u = var->u;
+    return a;
+}
+
+static inode *lower_call(ast_node *e);
+
+static inode *lower_expr_unguarded(ast_node *e) {
+    switch (e->type) {
+    case NT_ENTERO: {
+        int_lit lit = e->value.lit;
+        kind k = lit.is_long ? K_I64 : K_I32;
+        return constant(k, lit.is_unsigned, (value){ .i = wrap(lit.value, k, lit.is_unsigned) });
+    }
+
+    case NT_FLOTANTE:
+        return constant(K_F64, 0, (value){ .d = e->value.floatVal });
+
+    case NT_CARACTER: {
+        lit_span span = e->value.span;
+        char *buf = malloc(span.len + 1);
+        int len = decode_literal(span.ptr, span.len, buf);
+        int v = len == 1 ? (signed char)buf[0] : 0;
+        for (int i = 0; len > 1 && i < len; i++) v = (int)((unsigned)v << 8 | (unsigned char)buf[i]);
+        free(buf);
+        return constant(K_I32, 0, (value){ .i = v });
+    }
+
+    case NT_CADENA: {
+        lit_span span = e->value.span;
+        char *bytes = arena(span.len + 1);
+        decode_literal(span.ptr, span.len, bytes);
+        return constant(K_STR, 0, (value){ .s = bytes });
+    }
+
+    case NT_ID:
+    case NT_VAR:
+    case NT_ACCESO_ARRAY: {
+        kind k;
+        int u;
+        inode *a = lower_scalar_address(e, &k, &u);
+        if (!a) return NULL;
+        inode *n = new_node(E_LOAD, k, u);
+        n->a = a;
+        return n;
+    }
+
+    case NT_TERNARIO: {
+        ast_node *c = e->child;
+        inode *cond = lower_expr(c);
+        inode *t = lower_expr(c->sibling);
+        inode *f = lower_expr(c->sibling->sibling);
+        if (!cond || !t || !f || cond->k == K_VOID || !IS_SCALAR(t->k) || !IS_SCALAR(f->k)) return NULL;
+        kind k = t->k;
+        int u = t->u;
+        if (t->k != f->k) {
+            // El tipo común de las dos ramas, como en codegen.c
+            if (IS_FLOAT(t->k) || IS_FLOAT(f->k)) {
+                k = t->k == K_F64 || f->k == K_F64 ? K_F64 : K_F32;
+                u = 0;
+            } else {
+                unsigned lw = kind_bits[t->k] < 32 ? 32 : kind_bits[t->k];
+                unsigned rw = kind_bits[f->k] < 32 ? 32 : kind_bits[f->k];
+                k = (lw > rw ? lw : rw) == 64 ? K_I64 : K_I32;
+                u = lw == rw ? ((t->u && lw == kind_bits[t->k]) || (f->u && rw == kind_bits[f->k])) : (lw > rw ? t->u : f->u);
+            }
+        }
+        inode *n = new_node(E_TERN, k, u);
+        n->a = cond;
+        n->b = convert_node(t, k, u);
+        n->c = convert_node(f, k, u);
+        return n->b && n->c ? n : NULL;
+    }
+
+    case NT_OP_UNARIO: {
+        int op = e->value.op;
+        if (!e->child) return NULL;
+        if (op == T_INC || op == T_DEC) {
+            kind k;
+            int u;
+            inode *a = lower_scalar_address(e->child, &k, &u);
+            if (!a) return NULL;
+            inode *n = new_node(E_INCDEC, k, u);
+            n->tok = op;
+            n->a = a;
+            return n;
+        }
+        inode *x = lower_expr(e->child);
+        if (!x || x->k == K_VOID) return NULL;
+        if (op == T_NOT) {
+            if (x->op == E_CONST && IS_SCALAR(x->k)) {
+                return constant(K_I32, 0, (value){ .i = IS_FLOAT(x->k) ? x->value.d == 0 : x->value.i == 0 });
+            }
+            inode *n = new_node(E_NOT, K_I32, 0);
+            n->a = x;
+            return n;
+        }
+        if (op != T_TILDE && op != T_MINUS) return NULL;
+        if (!IS_SCALAR(x->k) || (op == T_TILDE && !IS_INT(x->k))) return NULL;
+        x = promote(x);
+        inode *n = new_node(op == T_TILDE ? E_BITNOT : E_NEG, x->k, x->u);
+        n->a = x;
+        if (x->op == E_CONST) {
+            value v = x->value;
+            if (IS_FLOAT(x->k)) v.d = -v.d;
+            else v.i = wrap(op == T_TILDE ? ~v.i : (int64_t)(0 - (uint64_t)v.i), x->k, x->u);
+            return constant(x->k, x->u, v);
+        }
+        return n;
+    }
+
+    case NT_OP_BINARIO: {
+        int op = e->value.op;
+        ast_node *L = e->child;
+        ast_node *R = L ? L->sibling : NULL;
+        if (!L || !R) return NULL;
+
+        if (op == T_ASSIGN || compound_op(op)) {
+            kind k;
+            int u;
+            inode *a = lower_scalar_address(L, &k, &u);
+            inode *r = a ? lower_expr(R) : NULL;
+            if (!r || !IS_SCALAR(r->k)) return NULL;
+            if (op == T_ASSIGN) {
+                inode *n = new_node(E_ASSIGN, k, u);
+                n->a = a;
+                n->b = convert_node(r, k, u);
+                return n;
+            }
+            inode *n = new_node(E_COMPOUND, k, u);
+            n->tok = compound_op(op);
+            if (!binary_type(n->tok, k, u, r->k, r->u, &n->ck, &n->cu)) return NULL;
+            n->a = a;
+            n->b = convert_node(r, n->ck, n->cu);
+            return n;
+        }
+
+        if (op == T_AND || op == T_OR) {
+            inode *n = new_node(op == T_AND ? E_AND : E_OR, K_I32, 0);
+            n->a = lower_expr(L);
+            n->b = lower_expr(R);
+            if (!n->a || !n->b || n->a->k == K_VOID || n->b->k == K_VOID) return NULL;
+            return n;
+        }
+
+        // La espina izquierda de a+b+c+... se recorre sin recursión, como en codegen.c
+        int depth = 0;
+        ast_node *leftmost = e;
+        while (is_plain_binary(leftmost)) {
+            leftmost = leftmost->child;
+            depth++;
+        }
+        ast_node **spine = malloc(depth * sizeof(ast_node *));
+        ast_node *n = e;
+        for (int i = depth - 1; i >= 0; i--, n = n->child) spine[i] = n;
+        inode *l = lower_expr(leftmost);
+        for (int i = 0; i < depth && l; i++) {
+            l = binary(spine[i]->value.op, l, lower_expr(spine[i]->child->sibling));
+        }
+        free(spine);
+        return l;
+    }
+
+    case NT_LLAMADA_FUNCION:
+        return lower_call(e);
+
+    case NT_EXPR_SENTENCIA:
+        return e->child ? lower_expr(e->child) : NULL;
+
+    default:
+        return NULL;
+    }
+}
+
+typedef struct deep_lower {
+    ast_node *node;
+    inode *result;
+} deep_lower;
+
+static void lower_expr_deep(void *data) {
+    deep_lower *call = data;
+    call->result = lower_expr(call->node);
+}
+
+static inode *lower_expr(ast_node *e) {
+    if (!e) return NULL;
+    if (stack_low()) {
+        deep_lower call = { e, NULL };
+        stack_extend(lower_expr_deep, &call);
+        return call.result;
+    }
+    return lower_expr_unguarded(e);
+}
+
+// Conversiones que el printf del programa resolvería distinto o que no tienen sentido aquí
+static int printf_format_supported(const char *fmt) {
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') continue;
+        p++;
+        while (*p && strchr("-+ #0'I*.0123456789", *p)) p++;
+        int wide = 0;
+        while (*p && strchr("hlLqjzZt", *p)) wide |= *p == 'l' || *p == 'L', p++;
+        if (*p == '\0') return 1;
+        if (strchr("nmCS", *p) || (wide && (*p == 's' || strchr("eEfFgGaA", *p)))) return 0;
+    }
+    return 1;
+}
+
+static inode *lower_printf(ast_node *args) {
+    inode *n = new_node(E_PRINTF, K_I32, 0);
+    inode **tail = &n->a;
+    for (ast_node *t = args; t; t = t->sibling) {
+        inode *a = lower_expr(t);
+        if (!a || a->k == K_VOID) return NULL;
+        if (t == args) {
+            if (a->k != K_STR || (a->op == E_CONST && !printf_format_supported(a->value.s))) return NULL;
+        } else if (a->k == K_F32) { // Promociones por defecto de los argumentos variádicos
+            a = convert_node(a, K_F64, 0);
+        } else if (IS_INT(a->k)) {
+            a = promote(a);
+        }
+        *tail = a;
+        tail = &a->next;
+    }
+    return n->a ? n : NULL;
+}
+
+static inode *lower_call(ast_node *e) {
+    ast_node *callee = e->child;
+    if (!callee || !callee->value.strVal) return NULL;
+    ifunc *f = function_named(callee->value.strVal);
+    if (strcmp(callee->value.strVal, "printf") == 0 && (!f || !f->def)) {
+        return lower_printf(callee->sibling);
+    }
+    // Sin cuerpo sería una función de otra biblioteca: eso lo resuelve el enlazador
+    if (!f || !f->def) return NULL;
+
+    inode *n = new_node(E_CALL, f->rk, f->ru);
+    n->fn = f;
+    inode **tail = &n->a;
+    int i = 0;
+    for (ast_node *t = callee->sibling; t; t = t->sibling, i++) {
+        if (i == f->nparams) return NULL;
+        inode *a = convert_node(lower_expr(t), f->pk[i], f->pu[i]);
+        if (!a || !IS_SCALAR(a->k)) return NULL;
+        *tail = a;
+        tail = &a->next;
+    }
+    return i == f->nparams ? n : NULL;
+}
+
+// =======================================================
+// BAJADA: SENTENCIAS
+// =======================================================
+
+static inode *lower_statement(ast_node *s);
+
+typedef struct chain {
+    inode *head;
+    inode **tail;
+} chain;
+
+static void chain_add(chain *c, inode *s) {
+    *c->tail = s;
+    c->tail = &s->next;
+}
+
+static inode *block_of(chain *c) {
+    inode *n = new_node(S_BLOCK, K_VOID, 0);
+    n->a = c->head;
+    return n;
+}
+
+static inode *expr_statement(inode *e) {
+    inode *n = new_node(S_EXPR, K_VOID, 0);
+    n->a = e;
+    return n;
+}
+
+// codegen_local_init: el arreglo se llena de ceros y luego se guarda cada elemento de la lista
+static int lower_local_init(chain *c, ivar *v, size_t off, int level, ast_node *init) {
+    if (level < v->ndims) {
+        if (init->type != NT_LISTA_INIT) return 0;
+        int i = 0;
+        ast_node *item = init->child;
+        for (; item && i < v->dims[level]; item = item->sibling, i++) {
+            if (!lower_local_init(c, v, off + (size_t)i * stride(v, level), level + 1, item)) return 0;
+        }
+        return item == NULL;
+    }
+    if (init->type == NT_LISTA_INIT) { // int x = { 5 };
+        init = init->child;
+    }
+    inode *value = convert_node(lower_expr(init), v->k, v->u);
+    if (!value || !IS_SCALAR(value->k)) return 0;
+    inode *a = new_node(A_VAR, K_VOID, 0);
+    a->var = v;
+    a->off = off;
+    inode *n = new_node(E_ASSIGN, v->k, v->u);
+    n->a = a;
+    n->b = value;
+    chain_add(c, expr_statement(n));
+    return 1;
+}
+
+// codegen_const_initializer: el valor se calcula ahora y se escribe en el almacenamiento estático
+static int static_init(ivar *v, size_t off, int level, ast_node *init) {
+    if (level < v->ndims) {
+        if (init->type != NT_LISTA_INIT) return 0;
+        int i = 0;
+        ast_node *item = init->child;
+        for (; item && i < v->dims[level]; item = item->sibling, i++) {
+            if (!static_init(v, off + (size_t)i * stride(v, level), level + 1, item)) return 0;
+        }
+        return item == NULL;
+    }
+    if (init->type == NT_LISTA_INIT) {
+        init = init->child;
+    }
+    inode *value = convert_node(lower_expr(init), v->k, v->u);
+    if (!value || value->op != E_CONST || !IS_SCALAR(value->k)) return 0;
+    store(v->addr + off, v->k, value->value);
+    return 1;
+}
+
+static inode *lower_declaration(ast_node *s) {
+    ast_node *tipo = s->child;
+    chain c = { NULL, &c.head };
+    for (ast_node *cur = tipo ? tipo->sibling : NULL; cur; cur = cur->sibling) {
+        ast_node *var, *init;
+        const char *name = declarator_name(cur, &var, &init);
+        if (!name) continue;
+        ivar *v = new_var(name, tipo, var, init);
+        if (!v) return NULL;
+        v->declarator = cur;
+
+        if (ast_type_count(tipo, T_EXTERN) > 0) {
+            ivar *g = global_named(name);
+            if (!g || init || g->size != v->size) return NULL;
+            v->is_static = 1;
+            v->addr = g->addr;
+            v->global_name = g->global_name;
+        } else if (ast_type_count(tipo, T_STATIC) > 0) {
+            // Una global "función.variable", inicializada una sola vez
+            char *gname = malloc(strlen(lowering->name) + strlen(name) + 2);
+            sprintf(gname, "%s.%s", lowering->name, name);
+            ivar *g = global_named(gname);
+            if (g) {
+                v->is_static = 1;
+                v->addr = g->addr;
+                v->global_name = g->global_name;
+            } else {
+                add_global(v, gname);
+            }
+            free(gname);
+            if (init && !static_init(v, 0, 0, init)) return NULL;
+        }
+        add_var(lowering, v);
+
+        if (!v->is_static && init) {
+            if (v->ndims > 0) {
+                inode *zero = new_node(S_ZERO, K_VOID, 0);
+                zero->var = v;
+                chain_add(&c, zero);
+            }
+            if (!lower_local_init(&c, v, 0, 0, init)) return NULL;
+        }
+    }
+    return block_of(&c);
+}
+
+static iloop *new_loop(ast_node *stmt) {
+    iloop *l = arena(sizeof(iloop));
+    l->origin = stmt;
+    l->nvisible = lowering->nvars;
+    return l;
+}
+
+/*
+switch: the cases may only label statements at the top level of the
+body (case 1: case 2: x; is fine), which is what a jump table into a
+flat list of statements can express.
+*/
+static inode *lower_switch(ast_node *s) {
+    ast_node *expr = s->child;
+    ast_node *body = expr ? expr->sibling : NULL;
+    inode *value = promote(lower_expr(expr));
+    if (!body || !value || !IS_INT(value->k)) return NULL;
+
+    int max = 0;
+    ast_node *list = body->type == NT_BLOQUE ? body->child : body;
+    for (ast_node *t = list; t; t = body->type == NT_BLOQUE ? t->sibling : NULL) {
+        max++;
+        for (ast_node *l = t; l && (l->type == NT_CASE || l->type == NT_DEFAULT); l = l->type == NT_CASE ? l->child->sibling : l->child) max++;
+    }
+    iswitch *sw = arena(sizeof(iswitch));
+    sw->stmts = arena((max + 1) * sizeof(inode *));
+    sw->values = arena((max + 1) * sizeof(int64_t));
+    sw->targets = arena((max + 1) * sizeof(int));
+    sw->default_target = -1;
+
+    for (ast_node *t = list; t; t = body->type == NT_BLOQUE ? t->sibling : NULL) {
+        ast_node *stmt = t;
+        while (stmt && (stmt->type == NT_CASE || stmt->type == NT_DEFAULT)) {
+            if (stmt->type == NT_DEFAULT) {
+                sw->default_target = sw->nstmts;
+                stmt = stmt->child;
+                continue;
+            }
+            inode *label = convert_node(lower_expr(stmt->child), value->k, value->u);
+            if (!label || label->op != E_CONST) return NULL;
+            sw->values[sw->ncases] = label->value.i;
+            sw->targets[sw->ncases++] = sw->nstmts;
+            stmt = stmt->child->sibling;
+        }
+        inode *n = stmt ? lower_statement(stmt) : new_node(S_NOP, K_VOID, 0);
+        if (!n) return NULL;
+        sw->stmts[sw->nstmts++] = n;
+    }
+
+    inode *n = new_node(S_SWITCH, K_VOID, 0);
+    n->a = value;
+    n->sw = sw;
+    return n;
+}
+
+// Condición de un if o de un bucle; NULL en *cond si está vacía (siempre verdadera)
+static int lower_condition(ast_node *e, inode **cond) {
+    *cond = NULL;
+    if (!e || (e->type == NT_EXPR_SENTENCIA && !e->child)) return 1;
+    *cond = lower_expr(e);
+    return *cond && (*cond)->k != K_VOID;
+}
+
+static inode *lower_statement_unguarded(ast_node *s) {
+    switch (s->type) {
+    case NT_BLOQUE: {
+        chain c = { NULL, &c.head };
+        for (ast_node *t = s->child; t; t = t->sibling) {
+            inode *n = lower_statement(t);
+            if (!n) return NULL;
+            chain_add(&c, n);
+        }
+        return block_of(&c);
+    }
+
+    case NT_DECLARACION:
+        return lower_declaration(s);
+
+    case NT_EXPR_SENTENCIA: {
+        if (!s->child) return new_node(S_NOP, K_VOID, 0);
+        inode *e = lower_expr(s->child);
+        return e ? expr_statement(e) : NULL;
+    }
+
+    case NT_RETURN: {
+        inode *n = new_node(S_RETURN, K_VOID, 0);
+        if (s->child) {
+            n->a = lower_expr(s->child);
+            if (!n->a) return NULL;
+            if (lowering->rk != K_VOID) {
+                n->a = convert_node(n->a, lowering->rk, lowering->ru);
+                if (!n->a || !IS_SCALAR(n->a->k)) return NULL;
+            }
+        }
+        return n;
+    }
+
+    case NT_IF: {
+        ast_node *cond = s->child;
+        ast_node *then_node = cond ? cond->sibling : NULL;
+        if (!then_node) return new_node(S_NOP, K_VOID, 0);
+        inode *n = new_node(S_IF, K_VOID, 0);
+        if (!lower_condition(cond, &n->a)) return NULL;
+        n->b = lower_statement(then_node);
+        n->c = then_node->sibling ? lower_statement(then_node->sibling) : NULL;
+        return n->b && (n->c || !then_node->sibling) ? n : NULL;
+    }
+
+    case NT_WHILE: {
+        inode *n = new_node(S_WHILE, K_VOID, 0);
+        if (!lower_condition(s->child, &n->a)) return NULL;
+        n->loop = new_loop(s);
+        n->b = lower_statement(s->child->sibling);
+        return n->b ? n : NULL;
+    }
+
+    case NT_DO_WHILE: {
+        inode *n = new_node(S_DO, K_VOID, 0);
+        if (!s->child || !s->child->sibling || !lower_condition(s->child, &n->a)) return NULL;
+        n->loop = new_loop(s);
+        n->b = lower_statement(s->child->sibling);
+        return n->b ? n : NULL;
+    }
+
+    case NT_FOR: {
+        ast_node *init = s->child;
+        ast_node *cond = init ? init->sibling : NULL;
+        ast_node *inc = cond ? cond->sibling : NULL;
+        ast_node *body = inc ? inc->sibling : NULL;
+        if (!body) return new_node(S_NOP, K_VOID, 0);
+        inode *n = new_node(S_FOR, K_VOID, 0);
+        if (init->child && !(n->a = lower_expr(init))) return NULL;
+        if (!lower_condition(cond, &n->b)) return NULL;
+        if (inc->child && !(n->c = lower_expr(inc))) return NULL;
+        n->loop = new_loop(s);
+        n->d = lower_statement(body);
+        return n->d ? n : NULL;
+    }
+
+    case NT_SWITCH:
+        return lower_switch(s);
+
+    case NT_BREAK:
+        return new_node(S_BREAK, K_VOID, 0);
+
+    case NT_CONTINUE:
+        return new_node(S_CONTINUE, K_VOID, 0);
+
+    default: // case fuera del cuerpo de un switch, goto, etiquetas...
+        return NULL;
+    }
+}
+
+static void lower_statement_deep(void *data) {
+    deep_lower *call = data;
+    call->result = lower_statement(call->node);
+}
+
+static inode *lower_statement(ast_node *s) {
+    if (!s) return NULL;
+    if (stack_low()) {
+        deep_lower call = { s, NULL };
+        stack_extend(lower_statement_deep, &call);
+        return call.result;
+    }
+    return lower_statement_unguarded(s);
+}
+
+// =======================================================
+// BAJADA: PROGRAMA
+// =======================================================
+
+static int is_void_param(ast_node *param) {
+    ast_node *ptype = param ? param->child : NULL;
+    return ptype && ptype->value.intVal == T_VOID && ptype->sibling == NULL;
+}
+
+static int lower_global_declaration(ast_node *decl) {
+    ast_node *tipo = decl->child;
+    for (ast_node *cur = tipo ? tipo->sibling : NULL; cur; cur = cur->sibling) {
+        ast_node *var, *init;
+        const char *name = declarator_name(cur, &var, &init);
+        if (!name) continue;
+        ivar *v = new_var(name, tipo, var, init);
+        if (!v) return 0;
+        v->declarator = cur;
+        ivar *g = global_named(name);
+        if (!g) {
+            add_global(v, name);
+            g = v;
+        } else if (g->k != v->k || g->size != v->size) {
+            return 0;
+        }
+        // Una definición tentativa deja el valor que ya tenía
+        if (init && !static_init(g, 0, 0, init)) return 0;
+    }
+    return 1;
+}
+
+// codegen_prototype: la primera declaración fija los tipos del retorno y de los parámetros
+static void declare_function(ast_node *fn_node) {
+    ast_node *tipo = fn_node->child;
+    ast_node *id = tipo ? tipo->sibling : NULL;
+    if (!id || !id->value.strVal) return;
+    ast_node *body = id->sibling;
+    while (body && body->type == NT_PARAMETRO) body = body->sibling;
+
+    ifunc *f = function_named(id->value.strVal);
+    if (!f) {
+        f = arena(sizeof(ifunc));
+        f->name = id->value.strVal;
+        type_of(tipo, &f->rk, &f->ru);
+        for (ast_node *p = id->sibling; p && p->type == NT_PARAMETRO; p = p->sibling) {
+            if (!is_void_param(p)) f->nparams++;
+        }
+        f->pk = arena((f->nparams + 1) * sizeof(kind));
+        f->pu = arena((f->nparams + 1) * sizeof(int));
+        int i = 0;
+        for (ast_node *p = id->sibling; p && p->type == NT_PARAMETRO; p = p->sibling) {
+            if (!is_void_param(p)) type_of(p->child, &f->pk[i], &f->pu[i]), i++;
+        }
+        f->next = functions;
+        functions = f;
+    }
+    if (body && !f->def) {
+        f->def = fn_node;
+    }
+}
+
+static int lower_function(ifunc *f) {
+    ast_node *id = f->def->child->sibling;
+    if (ast_vector_size(f->def->child) > 0) return 0;
+    ast_node *p = id->sibling;
+    lowering = f;
+    for (; p && p->type == NT_PARAMETRO; p = p->sibling) {
+        if (is_void_param(p)) continue;
+        ast_node *pid = p->child ? p->child->sibling : NULL;
+        ivar *v = new_var(pid ? pid->value.strVal : "(null)", p->child, NULL, NULL);
+        if (!v || f->nvars == f->nparams || v->k != f->pk[f->nvars]) return 0;
+        v->declarator = p;
+        add_var(f, v);
+    }
+    if (f->nvars != f->nparams) return 0;
+    f->body = lower_statement(p);
+    lowering = NULL;
+    return f->body != NULL;
+}
+
+/*
+Lowers the whole program, or nothing: 0 as soon as something is outside
+what the interpreter covers (goto, strings outside printf, calls to
+other libraries...), and interp_run compiles the program instead.
+*/
+static int lower_program(ast_node *root) {
+    for (ast_node *d = root->child; d; d = d->sibling) {
+        if (d->type == NT_DECLARACION && !lower_global_declaration(d)) {
+            return 0;
+        }
+        if (d->type == NT_FUNCION) {
+            declare_function(d);
+        }
+    }
+    for (ifunc *f = functions; f; f = f->next) {
+        if (f->def && !lower_function(f)) return 0;
+    }
+    return 1;
+}
+
+// =======================================================
+// EJECUCIÓN
+// =======================================================
+
+typedef enum {
+    X_NEXT,
+    X_BREAK,
+    X_CONTINUE,
+    X_RETURN
+} status;
+
+typedef struct frame {
+    ifunc *fn;
+    char *base;             // variables automáticas
+    value ret;              // valor de return
+} frame;
+
+// Un marco más grande que esto va al heap
+#define INTERP_FRAME_MAX (64 * 1024)
+
+static value eval(inode *n, frame *fr);
+static status exec(inode *s, frame *fr);
+static value call_function(ifunc *f, value *args);
+static void tier_up(ifunc *f);
+static void osr_compile(iloop *l, ifunc *f);
+
+static char *address(inode *n, frame *fr) {
+    if (n->op == A_VAR) {
+        return (n->var->is_static ? n->var->addr : fr->base + n->var->offset) + n->off;
+    }
+    char *base = address(n->a, fr);
+    return base + eval(n->b, fr).i * (int64_t)n->off;
+}
+
+static int truth(inode *n, frame *fr) {
+    if (!n) return 1; // for (;;)
+    value v = eval(n, fr);
+    return IS_FLOAT(n->k) ? v.d != 0 : v.i != 0;
+}
+
+// -----------------------------------------------------------------------------
+// printf
+// -----------------------------------------------------------------------------
+
+typedef struct strbuf {
+    char *data;
+    size_t len, cap;
+} strbuf;
+
+static void buf_add(strbuf *b, const char *s, size_t n) {
+    if (b->len + n > b->cap) {
+        b->cap = (b->len + n) * 2 + 64;
+        b->data = realloc(b->data, b->cap);
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+/*
+The arguments where va_arg would find them on x86-64: the first five
+integers after the format in general registers, eight doubles in SSE
+registers, and the rest on the stack in order. A format that does not
+match its arguments reads the same values the compiled program would.
+*/
+typedef struct printf_args {
+    value gp[5], fp[8], *stack;
+    kind gk[5], *sk;
+    int ngp, nfp, nstack;
+    int gread, fread, sread;
+} printf_args;
+
+static value next_arg(printf_args *pa, int want_float, kind *k) {
+    value zero = { 0 };
+    *k = K_VOID;
+    if (want_float && pa->fread < 8) {
+        return pa->fread < pa->nfp ? pa->fp[pa->fread++] : (pa->fread++, zero);
+    }
+    if (!want_float && pa->gread < 5) {
+        if (pa->gread >= pa->ngp) return pa->gread++, zero;
+        *k = pa->gk[pa->gread];
+        return pa->gp[pa->gread++];
+    }
+    if (pa->sread >= pa->nstack) return zero;
+    *k = pa->sk[pa->sread];
+    return pa->stack[pa->sread++];
+}
+
+#define FORMAT_WITH(x) (nstars == 0 ? snprintf(buf, size, spec, x) \
+                        : nstars == 1 ? snprintf(buf, size, spec, stars[0], x) \
+                                      : snprintf(buf, size, spec, stars[0], stars[1], x))
+
+// Una conversión: glibc la formatea con el tipo de C que corresponde
+static void format_one(strbuf *out, char *spec, char conv, int is_long, printf_args *pa) {
+    int stars[2], nstars = 0;
+    kind k;
+    for (char *p = spec; *p; p++) {
+        if (*p == '*') stars[nstars++] = (int)next_arg(pa, 0, &k).i;
+    }
+    value v = next_arg(pa, strchr("eEfFgGaA", conv) != NULL, &k);
+
+    char small[256];
+    char *buf = small, *heap = NULL;
+    size_t size = sizeof(small);
+    for (;;) {
+        int n;
+        switch (conv) {
+        case 'd':
+        case 'i':
+            n = is_long ? FORMAT_WITH((long)v.i) : FORMAT_WITH((int)v.i);
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            n = is_long ? FORMAT_WITH((unsigned long)v.i) : FORMAT_WITH((unsigned)v.i);
+            break;
+        case 'c':
+            n = FORMAT_WITH((int)v.i);
+            break;
+        case 's':
+            n = FORMAT_WITH(k == K_STR ? v.s : (const char *)NULL);
+            break;
+        case 'p':
+            n = FORMAT_WITH((void *)(intptr_t)v.i);
+            break;
+        default:
+            n = FORMAT_WITH(v.d);
+            break;
+        }
+        if (n < 0) break;
+        if ((size_t)n < size) {
+            buf_add(out, buf, (size_t)n);
+            break;
+        }
+        size = (size_t)n + 1;
+        buf = heap = malloc(size);
+    }
+    free(heap);
+}
+
+static value eval_printf(inode *n, frame *fr) {
+    int count = 0;
+    for (inode *a = n->a; a; a = a->next) count++;
+    printf_args pa = { 0 };
+    pa.stack = malloc(count * sizeof(value));
+    pa.sk = malloc(count * sizeof(kind));
+    const char *fmt = eval(n->a, fr).s;
+    for (inode *a = n->a->next; a; a = a->next) {
+        value v = eval(a, fr);
+        if (IS_FLOAT(a->k) && pa.nfp < 8) {
+            pa.fp[pa.nfp++] = v;
+        } else if (!IS_FLOAT(a->k) && pa.ngp < 5) {
+            pa.gk[pa.ngp] = a->k;
+            pa.gp[pa.ngp++] = v;
+        } else {
+            pa.sk[pa.nstack] = a->k;
+            pa.stack[pa.nstack++] = v;
+        }
+    }
+
+    strbuf out = { NULL, 0, 0 };
+    const char *p = fmt;
+    while (*p) {
+        const char *start = p;
+        if (*p != '%') {
+            while (*p && *p != '%') p++;
+            buf_add(&out, start, (size_t)(p - start));
+            continue;
+        }
+        p++;
+        while (*p && strchr("-+ #0'I", *p)) p++;
+        if (*p == '*') p++;
+        while (*p >= '0' && *p <= '9') p++;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') p++;
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        int is_long = 0;
+        while (*p && strchr("hlLqjzZt", *p)) is_long |= *p != 'h', p++;
+        char conv = *p;
+        if (conv) p++;
+        if (conv == '%') {
+            buf_add(&out, "%", 1);
+        } else if (conv && strchr("diouxXcspeEfFgGaA", conv)) {
+            char *spec = malloc((size_t)(p - start) + 1);
+            memcpy(spec, start, (size_t)(p - start));
+            spec[p - start] = '\0';
+            format_one(&out, spec, conv, is_long, &pa);
+            free(spec);
+        } else { // Conversión desconocida o % al final: se escribe tal cual, como glibc
+            buf_add(&out, start, (size_t)(p - start));
+        }
+    }
+
+    value r = { .i = __freezepiler_write(out.data ? out.data : "", (int)out.len) };
+    free(out.data);
+    free(pa.stack);
+    free(pa.sk);
+    return r;
+}
+
+// -----------------------------------------------------------------------------
+// Expresiones y sentencias
+// -----------------------------------------------------------------------------
+
+typedef struct deep_eval {
+    inode *node;
+    frame *fr;
+    value result;
+    status st;
+} deep_eval;
+
+static void eval_deep(void *data) {
+    deep_eval *call = data;
+    call->result = eval(call->node, call->fr);
+}
+
+static value eval(inode *n, frame *fr) {
+    value v, l, r;
+    switch (n->op) {
+    case E_CONST:
+        return n->value;
+    case E_LOAD:
+        return load(address(n->a, fr), n->k, n->u);
+    default:
+        break;
+    }
+    if (stack_low()) {
+        deep_eval call = { n, fr };
+        stack_extend(eval_deep, &call);
+        return call.result;
+    }
+
+    switch (n->op) {
+    case E_CONV:
+        return convert(eval(n->a, fr), n->a->k, n->a->u, n->k, n->u);
+
+    case E_BIN:
+        l = eval(n->a, fr);
+        r = eval(n->b, fr);
+        return arith(n->tok, n->ck, n->cu, l, r);
+
+    case E_AND:
+        v.i = truth(n->a, fr) && truth(n->b, fr);
+        return v;
+
+    case E_OR:
+        v.i = truth(n->a, fr) || truth(n->b, fr);
+        return v;
+
+    case E_NOT:
+        v.i = !truth(n->a, fr);
+        return v;
+
+    case E_NEG:
+        v = eval(n->a, fr);
+        if (IS_FLOAT(n->k)) v.d = -v.d;
+        else v.i = wrap((int64_t)(0 - (uint64_t)v.i), n->k, n->u);
+        return v;
+
+    case E_BITNOT:
+        v = eval(n->a, fr);
+        v.i = wrap(~v.i, n->k, n->u);
+        return v;
+
+    case E_TERN:
+        return truth(n->a, fr) ? eval(n->b, fr) : eval(n->c, fr);
+
+    case E_ASSIGN: {
+        char *p = address(n->a, fr);
+        v = eval(n->b, fr);
+        store(p, n->k, v);
+        return v;
+    }
+
+    case E_COMPOUND: {
+        char *p = address(n->a, fr);
+        r = eval(n->b, fr);
+        l = convert(load(p, n->k, n->u), n->k, n->u, n->ck, n->cu);
+        v = convert(arith(n->tok, n->ck, n->cu, l, r), n->ck, n->cu, n->k, n->u);
+        store(p, n->k, v);
+        return v;
+    }
+
+    case E_INCDEC: {
+        char *p = address(n->a, fr);
+        v = load(p, n->k, n->u);
+        if (IS_FLOAT(n->k)) {
+            v.d += n->tok == T_INC ? 1.0 : -1.0;
+            if (n->k == K_F32) v.d = (float)v.d;
+        } else {
+            v.i = wrap((int64_t)((uint64_t)v.i + (n->tok == T_INC ? 1 : (uint64_t)-1)), n->k, n->u);
+        }
+        store(p, n->k, v);
+        return v;
+    }
+
+    case E_CALL: {
+        value *args = alloca((n->fn->nparams + 1) * sizeof(value));
+        int i = 0;
+        for (inode *a = n->a; a; a = a->next) args[i++] = eval(a, fr);
+        return call_function(n->fn, args);
+    }
+
+    case E_PRINTF:
+        return eval_printf(n, fr);
+
+    default:
+        v.i = 0;
+        return v;
+    }
+}
+
+/*
+Back-edge of a loop. Once the loop is hot it is compiled on its own (see
+osr_compile) and the rest of its iterations run natively; *st is then
+how the loop ended. Returns 0 to keep interpreting.
+*/
+static int back_edge(iloop *l, frame *fr, status *st) {
+    fr->fn->backedges++;
+    if (++l->count < hot_threshold || l->state < 0) return 0;
+    if (l->state == 0) osr_compile(l, fr->fn);
+    if (l->state != 1) return 0;
+
+    ifunc *f = fr->fn;
+    char **slots = alloca((f->nvars + 1) * sizeof(char *));
+    for (int i = 0; i < f->nvars; i++) {
+        slots[i] = f->vars[i]->is_static ? NULL : fr->base + f->vars[i]->offset;
+    }
+    uint64_t ret = 0;
+    if (l->entry(slots, &ret)) {
+        fr->ret = load((char *)&ret, f->rk == K_VOID ? K_I64 : f->rk, f->ru);
+        *st = X_RETURN;
+    } else {
+        *st = X_NEXT;
+    }
+    return 1;
+}
+
+static void exec_deep(void *data) {
+    deep_eval *call = data;
+    call->st = exec(call->node, call->fr);
+}
+
+static status exec(inode *s, frame *fr) {
+    status st;
+    if (stack_low()) {
+        deep_eval call = { s, fr };
+        stack_extend(exec_deep, &call);
+        return call.st;
+    }
+
+    switch (s->op) {
+    case S_EXPR:
+        eval(s->a, fr);
+        return X_NEXT;
+
+    case S_BLOCK:
+        for (inode *t = s->a; t; t = t->next) {
+            st = exec(t, fr);
+            if (st != X_NEXT) return st;
+        }
+        return X_NEXT;
+
+    case S_ZERO:
+        memset(fr->base + s->var->offset, 0, s->var->size);
+        return X_NEXT;
+
+    case S_IF:
+        if (truth(s->a, fr)) return exec(s->b, fr);
+        return s->c ? exec(s->c, fr) : X_NEXT;
+
+    case S_WHILE:
+        while (truth(s->a, fr)) {
+            st = exec(s->b, fr);
+            if (st == X_BREAK) break;
+            if (st == X_RETURN) return st;
+            if (back_edge(s->loop, fr, &st)) return st;
+        }
+        return X_NEXT;
+
+    case S_DO:
+        do {
+            st = exec(s->b, fr);
+            if (st == X_BREAK) break;
+            if (st == X_RETURN) return st;
+            if (back_edge(s->loop, fr, &st)) return st;
+        } while (truth(s->a, fr));
+        return X_NEXT;
+
+    case S_FOR:
+        if (s->a) eval(s->a, fr);
+        while (truth(s->b, fr)) {
+            st = exec(s->d, fr);
+            if (st == X_BREAK) break;
+            if (st == X_RETURN) return st;
+            if (s->c) eval(s->c, fr);
+            if (back_edge(s->loop, fr, &st)) return st;
+        }
+        return X_NEXT;
+
+    case S_SWITCH: {
+        iswitch *sw = s->sw;
+        int64_t v = eval(s->a, fr).i;
+        int start = sw->default_target;
+        for (int i = 0; i < sw->ncases; i++) {
+            if (sw->values[i] == v) {
+                start = sw->targets[i];
+                break;
+            }
+        }
+        for (int i = start < 0 ? sw->nstmts : start; i < sw->nstmts; i++) {
+            st = exec(sw->stmts[i], fr);
+            if (st == X_BREAK) return X_NEXT;
+            if (st != X_NEXT) return st;
+        }
+        return X_NEXT;
+    }
+
+    case S_BREAK:
+        return X_BREAK;
+
+    case S_CONTINUE:
+        return X_CONTINUE;
+
+    case S_RETURN:
+        if (s->a) {
+            value v = eval(s->a, fr);
+            if (fr->fn->rk != K_VOID) fr->ret = v;
+        }
+        return X_RETURN;
+
+    default: // S_NOP
+        return X_NEXT;
+    }
+}
+
+typedef struct deep_call {
+    ifunc *fn;
+    value *args;
+    value result;
+} deep_call;
+
+static void call_deep(void *data) {
+    deep_call *call = data;
+    call->result = call_function(call->fn, call->args);
+}
+
+static value call_function(ifunc *f, value *args) {
+    value result = { 0 };
+    // args queda en la pila de quien llama: los parámetros se copian antes de que la use nadie más
+    if (stack_low()) {
+        deep_call call = { f, args };
+        stack_extend(call_deep, &call);
+        return call.result;
+    }
+    f->calls++;
+    if (f->tier == 0 && (f->calls >= hot_threshold || f->backedges >= hot_threshold)) {
+        tier_up(f);
+    }
+    if (f->native) {
+        uint64_t *raw = alloca((f->nparams + 1) * sizeof(uint64_t));
+        for (int i = 0; i < f->nparams; i++) raw[i] = (uint64_t)args[i].i;
+        uint64_t ret = 0;
+        f->native(raw, &ret);
+        memcpy(&result, &ret, sizeof(ret));
+        return result;
+    }
+
+    frame fr = { f, NULL, { 0 } };
+    int on_heap = f->frame_size > INTERP_FRAME_MAX;
+    fr.base = on_heap ? malloc(f->frame_size) : alloca(f->frame_size + 1);
+    memset(fr.base, 0, f->frame_size);
+    for (int i = 0; i < f->nparams; i++) {
+        store(fr.base + f->vars[i]->offset, f->vars[i]->k, args[i]);
+    }
+    if (exec(f->body, &fr) == X_RETURN) {
+        result = fr.ret;
+    }
+    if (on_heap) {
+        free(fr.base);
+    }
+    return result;
+}
+
+// =======================================================
+// COMPILACIÓN EN TIEMPO DE EJECUCIÓN
+// =======================================================
+
+// Lo que el código generado llama del runtime; el compilador ya lo trae enlazado
+static const struct {
+    const char *name;
+    void *addr;
+} runtime_symbols[] = {
+    { "__freezepiler_write", (void *)__freezepiler_write },
+    { "__freezepiler_puts", (void *)__freezepiler_puts },
+    { "__freezepiler_putchar", (void *)__freezepiler_putchar },
+    { "__freezepiler_write_i64", (void *)__freezepiler_write_i64 },
+    { "__freezepiler_write_u64", (void *)__freezepiler_write_u64 },
+    { "__freezepiler_write_hex", (void *)__freezepiler_write_hex },
+    { "__freezepiler_printf", (void *)__freezepiler_printf },
+    { "__freezepiler_print_lock", (void *)__freezepiler_print_lock },
+    { "__freezepiler_print_unlock", (void *)__freezepiler_print_unlock },
+    { "__freezepiler_parallel_for", (void *)__freezepiler_parallel_for },
+    { "__freezepiler_loop_next", (void *)__freezepiler_loop_next },
+    { "__freezepiler_parallel_lock", (void *)__freezepiler_parallel_lock },
+    { "__freezepiler_parallel_unlock", (void *)__freezepiler_parallel_unlock },
+};
+
+static void *runtime_symbol(const char *name) {
+    for (size_t i = 0; i < sizeof(runtime_symbols) / sizeof(runtime_symbols[0]); i++) {
+        if (strcmp(name, runtime_symbols[i].name) == 0) {
+            return runtime_symbols[i].addr;
+        }
+    }
+    return NULL;
+}
+
+/*
+Lo que m declara y nadie define: ni el módulo, ni el runtime, ni las
+bibliotecas cargadas en el proceso (la libc). MCJIT resolvería esos
+símbolos a 0 y el programa saltaría a una dirección nula. Con
+shared_globals las variables del programa son del intérprete.
+*/
+static int report_undefined(LLVMModuleRef m, int shared_globals) {
+    static int process_loaded = 0;
+    if (!process_loaded) {
+        LLVMLoadLibraryPermanently(NULL); // Los símbolos del propio compilador y sus bibliotecas
+        process_loaded = 1;
+    }
+    int undefined = 0;
+    for (LLVMValueRef fn = LLVMGetFirstFunction(m); fn; fn = LLVMGetNextFunction(fn)) {
+        const char *name = LLVMGetValueName(fn);
+        if (LLVMIsDeclaration(fn) && !LLVMGetIntrinsicID(fn) && !runtime_symbol(name) &&
+            !LLVMSearchForAddressOfSymbol(name)) {
+            fprintf(stderr, "ERROR: undefined function %s\n", name);
+            undefined++;
+        }
+    }
+    for (LLVMValueRef g = LLVMGetFirstGlobal(m); g; g = LLVMGetNextGlobal(g)) {
+        const char *name = LLVMGetValueName(g);
+        if (LLVMIsDeclaration(g) && !(shared_globals && global_named(name)) && !LLVMSearchForAddressOfSymbol(name)) {
+            fprintf(stderr, "ERROR: undefined variable %s\n", name);
+            undefined++;
+        }
+    }
+    return undefined;
+}
+
+/*
+void thunk(i64 *args, i64 *ret): calls fn with its real signature. An
+argument arrives in its slot as the interpreter keeps it (an integer
+sign- or zero-extended, a float as the bits of a double) and the result
+leaves the same way.
+*/
+static void build_thunk(LLVMModuleRef m, LLVMValueRef fn, int ret_unsigned, const char *name) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef params[2] = { LLVMPointerType(i64, 0), LLVMPointerType(i64, 0) };
+    LLVMValueRef thunk = LLVMAddFunction(m, name, LLVMFunctionType(LLVMVoidType(), params, 2, 0));
+    LLVMBuilderRef b = LLVMCreateBuilder();
+    LLVMPositionBuilderAtEnd(b, LLVMAppendBasicBlock(thunk, "entry"));
+
+    LLVMTypeRef fty = LLVMGlobalGetValueType(fn);
+    unsigned n = LLVMCountParamTypes(fty);
+    LLVMTypeRef *types = malloc((n + 1) * sizeof(LLVMTypeRef));
+    LLVMValueRef *args = malloc((n + 1) * sizeof(LLVMValueRef));
+    LLVMGetParamTypes(fty, types);
+    for (unsigned i = 0; i < n; i++) {
+        LLVMValueRef idx = LLVMConstInt(i64, i, 0);
+        LLVMValueRef slot = LLVMBuildGEP2(b, i64, LLVMGetParam(thunk, 0), &idx, 1, "");
+        LLVMValueRef raw = LLVMBuildLoad2(b, i64, slot, "");
+        LLVMTypeKind k = LLVMGetTypeKind(types[i]);
+        if (k == LLVMFloatTypeKind || k == LLVMDoubleTypeKind) {
+            args[i] = LLVMBuildBitCast(b, raw, LLVMDoubleType(), "");
+            if (k == LLVMFloatTypeKind) args[i] = LLVMBuildFPTrunc(b, args[i], types[i], "");
+        } else {
+            args[i] = LLVMBuildTrunc(b, raw, types[i], "");
+        }
+    }
+    LLVMValueRef call = LLVMBuildCall2(b, fty, fn, args, n, "");
+    LLVMSetInstructionCallConv(call, LLVMGetFunctionCallConv(fn));
+
+    LLVMTypeRef rt = LLVMGetReturnType(fty);
+    LLVMTypeKind rk = LLVMGetTypeKind(rt);
+    if (rk != LLVMVoidTypeKind) {
+        LLVMValueRef r;
+        if (rk == LLVMFloatTypeKind || rk == LLVMDoubleTypeKind) {
+            r = rk == LLVMFloatTypeKind ? LLVMBuildFPExt(b, call, LLVMDoubleType(), "") : call;
+            r = LLVMBuildBitCast(b, r, i64, "");
+        } else {
+            r = ret_unsigned ? LLVMBuildZExt(b, call, i64, "") : LLVMBuildSExt(b, call, i64, "");
+        }
+        LLVMBuildStore(b, r, LLVMGetParam(thunk, 1));
+    }
+    LLVMBuildRetVoid(b);
+    LLVMDisposeBuilder(b);
+    free(types);
+    free(args);
+}
+
+/*
+Compiles m with MCJIT and returns the address of root, 0 on errors. Only
+root stays visible, so the optimizer can inline the rest into it. With
+shared_globals the module's variables become declarations mapped onto
+the interpreter's storage, so native and interpreted code see the same
+globals; otherwise the module keeps its own.
+*/
+static uint64_t jit_compile(LLVMModuleRef m, const char *root, int shared_globals) {
+    for (LLVMValueRef fn = LLVMGetFirstFunction(m); fn; fn = LLVMGetNextFunction(fn)) {
+        if (!LLVMIsDeclaration(fn) && strcmp(LLVMGetValueName(fn), root) != 0) {
+            LLVMSetLinkage(fn, LLVMInternalLinkage);
+        }
+    }
+    if (shared_globals) {
+        LLVMValueRef g = LLVMGetFirstGlobal(m);
+        while (g) {
+            LLVMValueRef next = LLVMGetNextGlobal(g);
+            // Los literales de cadena (privados) se quedan en el módulo
+            if (LLVMGetInitializer(g) && LLVMGetLinkage(g) != LLVMPrivateLinkage) {
+                char *name = strdup(LLVMGetValueName(g));
+                LLVMValueRef decl = LLVMAddGlobal(m, LLVMGlobalGetValueType(g), "");
+                LLVMSetAlignment(decl, LLVMGetAlignment(g));
+                LLVMReplaceAllUsesWith(g, decl);
+                LLVMDeleteGlobal(g);
+                LLVMSetValueName2(decl, name, strlen(name));
+                free(name);
+            }
+            g = next;
+        }
+    }
+    if (codegen_optimize_module(m, &jit_opts) != 0) {
+        LLVMDisposeModule(m);
+        return 0;
+    }
+
+    struct LLVMMCJITCompilerOptions options;
+    LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
+    options.OptLevel = (unsigned)jit_opts.opt_level;
+    options.CodeModel = LLVMCodeModelLarge; // El código y el intérprete pueden quedar a más de 2 GB
+    LLVMExecutionEngineRef engine;
+    char *err = NULL;
+    if (LLVMCreateMCJITCompilerForModule(&engine, m, &options, sizeof(options), &err)) {
+        fprintf(stderr, "ERROR: MCJIT: %s\n", err);
+        LLVMDisposeMessage(err);
+        return 0;
+    }
+    engines = realloc(engines, (nengines + 1) * sizeof(LLVMExecutionEngineRef));
+    engines[nengines++] = engine;
+
+    for (LLVMValueRef g = LLVMGetFirstGlobal(m); g && shared_globals; g = LLVMGetNextGlobal(g)) {
+        ivar *v = LLVMIsDeclaration(g) ? global_named(LLVMGetValueName(g)) : NULL;
+        if (v) LLVMAddGlobalMapping(engine, g, v->addr);
+    }
+    for (LLVMValueRef fn = LLVMGetFirstFunction(m); fn; fn = LLVMGetNextFunction(fn)) {
+        void *addr = runtime_symbol(LLVMGetValueName(fn));
+        if (addr) LLVMAddGlobalMapping(engine, fn, addr);
+    }
+    if (report_undefined(m, shared_globals)) {
+        return 0;
+    }
+    return LLVMGetFunctionAddress(engine, root);
+}
+
+// Función caliente: se compila con todo el programa y las llamadas siguientes van al código nativo
+static void tier_up(ifunc *f) {
+    char name[32];
+    snprintf(name, sizeof(name), "__tier.%u", jit_count++);
+    LLVMModuleRef m = LLVMCloneModule(base_module);
+    build_thunk(m, LLVMGetNamedFunction(m, f->name), f->ru, name);
+    uint64_t addr = jit_compile(m, name, 1);
+    f->tier = addr ? 1 : -1;
+    f->native = (void (*)(uint64_t *, uint64_t *))(uintptr_t)addr;
+}
+
+/*
+Bucle caliente: codegen_build_osr_module genera una función que lo
+continúa sobre el marco del intérprete. Un for se reanuda sin su
+inicialización y un do-while como while, porque la arista de regreso
+llega justo antes de la condición.
+*/
+static void osr_compile(iloop *l, ifunc *f) {
+    ast_node *cond = l->origin->child;
+    ast_node *init = NULL, *stmt = l->origin;
+    if (l->origin->type == NT_FOR) {
+        init = make_node(NT_EXPR_SENTENCIA, NULL);
+        init->sibling = cond->sibling;
+        stmt = make_node(NT_FOR, init);
+    } else if (l->origin->type == NT_DO_WHILE) {
+        stmt = make_node(NT_WHILE, cond);
+    }
+    stmt->lineno = l->origin->lineno;
+
+    codegen_osr_var *vars = malloc((f->nvars + 1) * sizeof(codegen_osr_var));
+    for (int i = 0; i < f->nvars; i++) {
+        vars[i].tipo = f->vars[i]->tipo;
+        vars[i].declarator = f->vars[i]->declarator;
+        vars[i].visible = i < l->nvisible;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "__tier.osr.%u", jit_count++);
+    LLVMModuleRef m = codegen_build_osr_module(program, &jit_opts, f->def, stmt, vars, f->nvars, name);
+    uint64_t addr = m ? jit_compile(m, name, 1) : 0;
+    free(vars);
+    // Los nodos sintéticos sólo enlazan nodos del AST, que siguen siendo del programa
+    if (stmt != l->origin) free(stmt);
+    free(init);
+
+    l->state = addr ? 1 : -1;
+    l->entry = (int (*)(char **, void *))(uintptr_t)addr;
+}
+
+// =======================================================
+// ENTRADA
+// =======================================================
+
+static void interp_reset(void) {
+    for (int i = 0; i < nengines; i++) {
+        LLVMDisposeExecutionEngine(engines[i]);
+    }
+    free(engines);
+    engines = NULL;
+    nengines = 0;
+    if (base_module) {
+        LLVMDisposeModule(base_module);
+        base_module = NULL;
+    }
+    while (allocations) {
+        allocation *next = allocations->next;
+        free(allocations);
+        allocations = next;
+    }
+    functions = NULL;
+    globals = NULL;
+    lowering = NULL;
+    program = NULL;
+}
+
+int interp_run(ast_node *root, const codegen_options *opts, unsigned long threshold, int *exit_code) {
+    LLVMLinkInMCJIT();
+    program = root;
+    hot_threshold = threshold > 0 ? threshold : 1;
+    jit_opts = *opts;
+    jit_opts.emit = EMIT_LLVM_BC; // Nada se emite ni se enlaza: sin prepare_native
+    jit_opts.opt_level = opts->opt_level > 0 ? opts->opt_level : 2;
+    jit_opts.lto = LTO_NONE;
+    jit_opts.debug_info = DEBUG_NONE;
+    jit_opts.no_pie = 0;
+    jit_opts.function_sections = 0;
+    jit_opts.data_sections = 0;
+
+    // El módulo completo valida el programa igual que una compilación normal
+    base_module = codegen_build_module(root, &jit_opts);
+    if (!base_module) {
+        interp_reset();
+        return 1;
+    }
+
+    LLVMValueRef main_decl = LLVMGetNamedFunction(base_module, "main");
+    if (!main_decl || LLVMIsDeclaration(main_decl)) {
+        fprintf(stderr, "ERROR: el programa no define main\n");
+        interp_reset();
+        return 1;
+    }
+    // Nada corre si falta una función o variable: ni el intérprete ni el código nativo
+    if (report_undefined(base_module, 0)) {
+        interp_reset();
+        return 1;
+    }
+    LLVMTypeKind ret_kind = LLVMGetTypeKind(LLVMGetReturnType(LLVMGlobalGetValueType(main_decl)));
+
+    uint64_t ret = 0;
+    if (lower_program(root)) {
+        ifunc *main_fn = function_named("main");
+        value *args = calloc(main_fn->nparams + 1, sizeof(value));
+        if (main_fn->nparams > 0) { // argc: sólo el nombre del programa
+            args[0] = convert((value){ .i = 1 }, K_I32, 0, main_fn->pk[0], main_fn->pu[0]);
+        }
+        value r = call_function(main_fn, args);
+        free(args);
+        ret = (uint64_t)r.i;
+    } else {
+        // Fuera de lo que cubre el intérprete: todo el programa se compila y corre nativo desde el inicio
+        LLVMModuleRef m = base_module;
+        base_module = NULL;
+        build_thunk(m, main_decl, 0, "__tier.main");
+        uint64_t addr = jit_compile(m, "__tier.main", 0);
+        if (!addr) {
+            interp_reset();
+            return 1;
+        }
+        uint64_t args[2] = { 1, 0 };
+        ((void (*)(uint64_t *, uint64_t *))(uintptr_t)addr)(args, &ret);
+    }
+    *exit_code = ret_kind == LLVMIntegerTypeKind ? (int)ret : 0;
+    interp_reset();
+    return 0;
+}
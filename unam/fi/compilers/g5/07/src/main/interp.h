@@ -0,0 +1,28 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "ast.h"
+#include "codegen.h"
+
+/*
+-run: tiered execution, with nothing emitted or linked. The simplified
+AST is lowered to a tree of typed nodes that mirrors what codegen.c
+would generate (same conversions, same memory layout) and interpreted.
+Calls and loop back-edges are counted per function; once a function
+reaches the threshold it is compiled in-process with MCJIT and later
+calls go to the native code. A loop that reaches it while it runs (the
+loop of main, typically) is compiled on its own and continues natively
+from the iteration it was in, over the interpreter's variables.
+
+Programs with constructs the interpreter does not cover are compiled
+whole instead and run natively from the start, so -run accepts every
+program the compiler does.
+*/
+
+// Calls or back-edges that make a function (or a loop) hot
+#define INTERP_DEFAULT_THRESHOLD 1000
+
+// Runs main and stores its return value in *exit_code; 0 on success, nonzero if the program could not be compiled
+int interp_run(ast_node *root, const codegen_options *opts, unsigned long threshold, int *exit_code);
+
+#endif // INTERP_H
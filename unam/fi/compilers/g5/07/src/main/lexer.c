@@ -3,6 +3,8 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include "parser.tab.h"
 #include <assert.h>
 
@@ -18,11 +20,50 @@ Scanner scanner;
 
 int yylineno = 1;
 
+/*
+# lines continued with backslash-newline, joined into a copy since the
+source cannot be modified. T_PRAGMA spans point into them, so they live
+as long as the source buffer: until the next file is scanned.
+*/
+static char **joined_lines = NULL;
+static int joined_count = 0;
+
+static void freeJoinedLines()
+{
+    for (int i = 0; i < joined_count; i++)
+        free(joined_lines[i]);
+    free(joined_lines);
+    joined_lines = NULL;
+    joined_count = 0;
+}
+
+// Copy of [start, end) without its backslash-newlines; *joined_end is set to the end of the copy
+static const char *joinLines(const char *start, const char *end, const char **joined_end)
+{
+    char *copy = (char *)malloc(end - start + 1);
+    char *out = copy;
+    for (const char *p = start; p < end; p++)
+    {
+        if (*p == '\\' && p + 1 < end && *(p + 1) == '\n')
+            p++;
+        else
+            *out++ = *p;
+    }
+    *out = '\0';
+    joined_lines = (char **)realloc(joined_lines, (joined_count + 1) * sizeof(char *));
+    joined_lines[joined_count++] = copy;
+    *joined_end = out;
+    return copy;
+}
+
 // Initialize the scanner
 void initScanner(const char *source_code)
 {
     scanner.start = source_code;
     scanner.current = source_code;
+    yylineno = 1; // Several files can be scanned in one run (-flto)
+    ast_typedef_clear();
+    freeJoinedLines();
 }
 
 // Save the value of a token in the bison yylval variable
@@ -33,6 +74,98 @@ void saveYYVal() {
     yylval.strVal[len] = '\0';
 }
 
+// String and char literals are not copied: the token is a span into the source, without the quotes
+static void saveYYSpan() {
+    yylval.span.ptr = scanner.start + 1;
+    yylval.span.len = (int)(scanner.current - scanner.start) - 2;
+}
+
+/*
+The # line just skipped, from line to end (the source itself, or its
+copy without backslash-newlines): if it is a pragma the compiler handles
+(see pragma.h), its text after "pragma" becomes the span of a T_PRAGMA
+token and 1 is returned. Only these
+directives are recognized, so the rest (#pragma once, GCC diagnostic...)
+can still appear anywhere.
+*/
+static int pragmaToken(const char *line, const char *end) {
+    static const char *directives[] = { "omp", "unroll", "nounroll", "ivdep", "GCC unroll", "GCC ivdep", "clang loop" };
+    const char *p = line + 1;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (strncmp(p, "pragma", 6) != 0 || (p[6] != ' ' && p[6] != '\t'))
+        return 0;
+    p += 6;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    for (size_t i = 0; i < sizeof(directives) / sizeof(directives[0]); i++)
+    {
+        // Un espacio de la directiva acepta cualquier cantidad de espacios
+        const char *d = directives[i], *q = p;
+        while (*d && q < end)
+        {
+            if (*d == ' ' && (*q == ' ' || *q == '\t'))
+            {
+                while (*q == ' ' || *q == '\t')
+                    q++;
+                d++;
+            }
+            else if (*d == *q)
+                d++, q++;
+            else
+                break;
+        }
+        if (*d == '\0' && !isalnum((unsigned char)*q) && *q != '_')
+        {
+            yylval.span.ptr = p;
+            yylval.span.len = (int)(end - p);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int decode_literal(const char *raw, int len, char *out) {
+    int o = 0;
+    for (int i = 0; i < len; i++) {
+        char c = raw[i];
+        if (c != '\\' || i + 1 == len) {
+            out[o++] = c;
+            continue;
+        }
+        c = raw[++i];
+        switch (c) {
+            case 'n': out[o++] = '\n'; break;
+            case 't': out[o++] = '\t'; break;
+            case 'r': out[o++] = '\r'; break;
+            case 'a': out[o++] = '\a'; break;
+            case 'b': out[o++] = '\b'; break;
+            case 'f': out[o++] = '\f'; break;
+            case 'v': out[o++] = '\v'; break;
+            case 'x': {
+                unsigned v = 0;
+                while (i + 1 < len && isxdigit((unsigned char)raw[i + 1])) {
+                    char h = raw[++i];
+                    v = v * 16 + (isdigit((unsigned char)h) ? h - '0' : (h | 0x20) - 'a' + 10);
+                }
+                out[o++] = (char)v;
+                break;
+            }
+            default:
+                if (c >= '0' && c <= '7') { // Octal, up to three digits (\0 included)
+                    unsigned v = c - '0';
+                    for (int k = 0; k < 2 && i + 1 < len && raw[i + 1] >= '0' && raw[i + 1] <= '7'; k++)
+                        v = v * 8 + (raw[++i] - '0');
+                    out[o++] = (char)v;
+                } else { // \\ \' \" \? and unknown escapes stand for the character itself
+                    out[o++] = c;
+                }
+        }
+    }
+    out[o] = '\0';
+    return o;
+}
+
 // Return a boolean if the lexeme match with the given string
 bool matchStr(const char *start, int len, const char *str)
 {
@@ -51,6 +184,10 @@ int lookupKeyword(const char *start, const char *end)
     // Decide which keyword is
     switch (start[0])
     {
+    case '_':
+        if (matchStr(start, len, "__attribute__") || matchStr(start, len, "__attribute"))
+            return T_ATTRIBUTE;
+        break;
     case 'a':
         if (matchStr(start, len, "auto"))
             return T_AUTO;
@@ -98,6 +235,8 @@ int lookupKeyword(const char *start, const char *end)
     case 'i':
         if (matchStr(start, len, "if"))
             return T_IF;
+        if (matchStr(start, len, "inline"))
+            return T_INLINE;
         if (matchStr(start, len, "int"))
             return T_INT;
         break;
@@ -294,6 +433,9 @@ int lookupPunctuator(const char *c)
                 return T_ASSIGN_XOR;
             }
             return T_CARET;
+        case '~':
+            scanner.current++;
+            return T_TILDE;
         case '<':
             scanner.current++;
             if (*scanner.current == '<')
@@ -358,11 +500,24 @@ int siguiente_token(){
         skipWhitespaces();
         scanner.start = scanner.current;
 
-        // Skipping macros
+        // Skipping macros, except the pragmas the compiler understands
         if (*scanner.current == '#')
         {
+            bool continued = false;
             while (*scanner.current != '\n' && *scanner.current != '\0')
+            {
+                if (*scanner.current == '\\' && scanner.current[1] == '\n')
+                {
+                    scanner.current++;
+                    yylineno++;
+                    continued = true;
+                }
                 scanner.current++;
+            }
+            const char *end = scanner.current;
+            const char *line = continued ? joinLines(scanner.start, scanner.current, &end) : scanner.start;
+            if (pragmaToken(line, end))
+                return T_PRAGMA;
             continue;
         }
 
@@ -402,19 +557,27 @@ int siguiente_token(){
             {
                 if (*scanner.current == '\n') // Multiline strings
                     yylineno++;
+                if (*scanner.current == '\\' && *(scanner.current + 1) != '\0') // \" does not end the string
+                    scanner.current++;
                 scanner.current++;
             }
-            scanner.current++; //gets the runaway "
-            saveYYVal();
+            if (*scanner.current == '"')
+                scanner.current++; //gets the runaway "
+            saveYYSpan();
             return T_CADENA;
         }
         if (c == '\'')
         {
             scanner.current++;
             while (*scanner.current != '\'' && *scanner.current != '\0')
+            {
+                if (*scanner.current == '\\' && *(scanner.current + 1) != '\0') // '\''
+                    scanner.current++;
                 scanner.current++;
-            scanner.current++; //same as string, gets the runaway '
-            saveYYVal();
+            }
+            if (*scanner.current == '\'')
+                scanner.current++; //same as string, gets the runaway '
+            saveYYSpan();
             return T_CARACTER;
         }
 
@@ -440,6 +603,23 @@ int siguiente_token(){
                 scanner.current++;
             }
 
+            // Integer suffixes: u, l, ll and their combinations, in either case
+            int u_suffix = 0, l_suffix = 0, bad_suffix = 0;
+            if (dot_consumed == 0 && e_consumed == 0)
+            {
+                char prev = 0;
+                while (*scanner.current == 'u' || *scanner.current == 'U' || *scanner.current == 'l' || *scanner.current == 'L')
+                {
+                    char ch = *scanner.current;
+                    if (ch == 'u' || ch == 'U')
+                        u_suffix++;
+                    else if (l_suffix++ == 1 && prev != ch) // ll or LL, together
+                        bad_suffix = 1;
+                    prev = ch;
+                    scanner.current++;
+                }
+            }
+
             int len = (int)(scanner.current - scanner.start);
             char *lexeme = (char *)malloc(len + 1);
             strncpy(lexeme, scanner.start, len);
@@ -447,7 +627,22 @@ int siguiente_token(){
 
             if (dot_consumed == 0 && e_consumed == 0)
             {
-                yylval.intVal = atoi(lexeme);
+                errno = 0;
+                unsigned long long value = strtoull(lexeme, NULL, 10);
+                if (errno == ERANGE || bad_suffix || u_suffix > 1 || l_suffix > 2 || isalnum(*scanner.current))
+                {
+                    printf("(LEXICAL ERROR): in line %d: invalid integer constant '%s'\n", yylineno, lexeme);
+                    free(lexeme);
+                    return YYEOF;
+                }
+                // As in C, the first of int, long (unsigned int, unsigned long with U) where it fits;
+                // a decimal constant only becomes unsigned without U when not even long holds it
+                int_lit lit = { (long long)value, l_suffix > 0, u_suffix > 0 };
+                if (lit.is_unsigned ? value > UINT_MAX : value > INT_MAX)
+                    lit.is_long = 1;
+                if (value > LLONG_MAX)
+                    lit.is_unsigned = 1;
+                yylval.intLit = lit;
                 free(lexeme);
                 return T_ENTERO;
             }
@@ -474,7 +669,12 @@ int siguiente_token(){
             }
             int type = lookupKeyword(scanner.start, scanner.current);
             if (type == T_ID)
+            {
                 saveYYVal();
+                // Declared with typedef: the parser sees a type (see ast_typedef_lookup)
+                if (ast_typedef_lookup(yylval.strVal))
+                    return T_TYPE_NAME;
+            }
             return type;
         }
 
@@ -3,6 +3,9 @@
 
 void initScanner(const char *source_code);
 char *readFile(const char *source_file_path);
+
+// Decodes the escape sequences of a literal span into out, which needs len + 1 bytes; returns the decoded length
+int decode_literal(const char *raw, int len, char *out);
 int yylex();
 
 #endif
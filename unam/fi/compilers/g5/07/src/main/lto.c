@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <string.h>
+#include "lto.h"
+
+#include <llvm-c/BitReader.h>
+#include <llvm-c/Linker.h>
+
+int lto_is_bitcode_file(const char *path) {
+    unsigned char magic[4];
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == 4 && magic[0] == 'B' && magic[1] == 'C' && magic[2] == 0xC0 && magic[3] == 0xDE;
+}
+
+LLVMModuleRef lto_load_bitcode(const char *path) {
+    LLVMMemoryBufferRef buffer;
+    char *err = NULL;
+    if (LLVMCreateMemoryBufferWithContentsOfFile(path, &buffer, &err)) {
+        fprintf(stderr, "ERROR: Unable to read %s: %s\n", path, err);
+        LLVMDisposeMessage(err);
+        return NULL;
+    }
+
+    LLVMModuleRef module = NULL;
+    if (LLVMParseBitcode2(buffer, &module)) {
+        fprintf(stderr, "ERROR: %s is not valid LLVM bitcode\n", path);
+        module = NULL;
+    }
+    LLVMDisposeMemoryBuffer(buffer);
+    return module;
+}
+
+int lto_link_into(LLVMModuleRef dest, LLVMModuleRef src) {
+    // LLVMLinkModules2 reports conflicts (e.g. a symbol defined twice) through the context's diagnostic handler
+    if (LLVMLinkModules2(dest, src)) {
+        fprintf(stderr, "ERROR: Unable to link LLVM modules\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+After the final link nothing outside the merged module can reference
+its symbols except through main (and libc, which only sees what we
+declare). Internal linkage lets the link-time pipeline inline across
+the former file boundaries, switch calls to fastcc and drop whatever
+ends up unused.
+*/
+void lto_internalize(LLVMModuleRef module) {
+    for (LLVMValueRef fn = LLVMGetFirstFunction(module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        if (!LLVMIsDeclaration(fn) && LLVMGetLinkage(fn) == LLVMExternalLinkage &&
+            strcmp(LLVMGetValueName(fn), "main") != 0) {
+            LLVMSetLinkage(fn, LLVMInternalLinkage);
+        }
+    }
+    for (LLVMValueRef g = LLVMGetFirstGlobal(module); g != NULL; g = LLVMGetNextGlobal(g)) {
+        if (!LLVMIsDeclaration(g) && LLVMGetLinkage(g) == LLVMExternalLinkage) {
+            LLVMSetLinkage(g, LLVMInternalLinkage);
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef LTO_H
+#define LTO_H
+
+#include <llvm-c/Core.h>
+
+/*
+In-process link-time optimization, driven by main.c for -flto. Files
+compiled with -flto -c hold LLVM bitcode instead of machine code; at
+link time they are loaded, merged with LLVMLinkModules2 into a single
+module and optimized once as a whole program.
+*/
+
+// 1 if path starts with the LLVM bitcode magic ('BC' 0xC0DE)
+int lto_is_bitcode_file(const char *path);
+
+// Loads a bitcode file into the global context; NULL on error
+LLVMModuleRef lto_load_bitcode(const char *path);
+
+// Links src into dest and destroys src; returns 0 on success
+int lto_link_into(LLVMModuleRef dest, LLVMModuleRef src);
+
+// Gives internal linkage to every definition except main
+void lto_internalize(LLVMModuleRef module);
+
+#endif // LTO_H
@@ -1,159 +1,861 @@
+#include <errno.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "lexer.h"
 #include "ast.h"
 #include "parser.tab.h"
 #include "codegen.h"
+#include "simplify.h"
+#include "lto.h"
+#include "profile.h"
+#include "partition.h"
+#include "interp.h"
 #include <llvm-c/Target.h>
 #include <llvm-c/ExecutionEngine.h>
 
 /*
-Arguments: <source_file_path> | <-s source_str>
+Arguments: [options] <input>... | [options] -s <source_str>
+Inputs are C sources (.c), object files, or bitcode files made with -flto -c.
+Options:
+  -o <path>    Output file (default: 'program', or <name>.o/.s/.ll/.bc)
+  -c           Compile only, emit object code (LLVM bitcode with -emit-llvm)
+  -S           Compile only, emit assembly (textual LLVM IR with -emit-llvm)
+  -emit-llvm   Emit LLVM IR instead of native code (implies -c unless -S)
+  -O<n>        Optimization level 0-3 (default: -O0; -O alone means -O2)
+  -fwhole-program  Give internal linkage and fastcc to everything but main
+                   and extern definitions, so the optimizer can inline them
+  -flto        Link-time optimization: -c writes LLVM bitcode, and the link
+               merges every module in-process and optimizes them together
+  -fprofile-generate[=<file>]  Instrument the program to count function
+               entries and branch outcomes; each run appends them to <file>
+               (default: freezepiler.prof)
+  -fprofile-use[=<file>]  Optimize with the counts of an instrumented run
+  -fprofile-functions[=<file>]  Measure calls and self/inclusive cycles of
+               every function; the program prints a flat profile on stderr
+               at exit, or writes it to <file> as JSON
+  -fstreaming  Lower each function as soon as it is parsed and free its
+               AST, so memory does not grow with the size of the file;
+               functions must be declared before they are called
+  -g           Emit DWARF debug info: line tables, types and variables
+  -gline-tables-only  Emit only functions and line tables, enough for
+               perf and other profilers to show hot source lines
+  -static      Link libc and the runtime statically: no dynamic loader,
+               no relocation at startup and no PLT (implies -no-pie)
+  -no-pie      Generate position-dependent code that addresses globals
+               directly instead of through the GOT
+  -ffreestanding-runtime  Link a small bundled runtime instead of crt1.o
+               and libc: its own _start, exit and buffered write over raw
+               system calls, and a printf subset. Static, a few kilobytes
+  -ffunction-sections  Put each function in its own .text.<name> section
+  -fdata-sections      Put each global variable in its own section
+  --gc-sections        Let ld drop every section nothing reaches; with the
+               two options above this removes unused functions and data
+  -j[<n>]      Split each module into up to <n> partitions of functions
+               (default: one per CPU) and generate their machine code on
+               parallel threads; ignored with -S and -emit-llvm
+  -run         Run the program in this process instead of writing it:
+               interpret it and compile hot functions and loops in memory
+               with the JIT; the exit status is the value main returns
+  -ftier-threshold=<n>  Calls or loop iterations after which -run compiles
+               a function or loop (default: 1000)
+  -v           Verbose: print the AST and run the generated program
 Examples of execution:
-./lexer path/to/program.c
-./lexer -s 'printf("Hello World!");'
+./main path/to/program.c
+./main -s 'int main(void) { printf("Hello World!"); return 0; }'
+./main -c -o build/program.o path/to/program.c
+./main -O3 path/to/program.c
+./main -O2 -flto -c a.c && ./main -O2 -flto -c b.c && ./main -O2 -flto a.o b.o
+./main -fprofile-generate -o prog p.c && ./prog && ./main -O2 -fprofile-use p.c
+./main -O2 -static -ffunction-sections -fdata-sections --gc-sections -o prog p.c
+./main -run path/to/program.c; echo $?
 */
-int main(int argc, char *argv[])
+
+static void usage(void)
 {
-    LLVMInitializeAllTargetInfos();
-    LLVMInitializeAllTargets();
-    LLVMInitializeAllTargetMCs();
-    LLVMInitializeAllAsmPrinters();
-    int extras = 0;
-    char *HLL_code = NULL;
-    if (argc < 2)
+    printf("Usage: main [-o <path>] [-c | -S] [-emit-llvm] [-O<n>] [-fwhole-program] [-flto] [-fprofile-generate[=<file>] | -fprofile-use[=<file>]] [-fprofile-functions[=<file>]] [-fstreaming] [-g | -gline-tables-only] [-static | -no-pie | -ffreestanding-runtime] [-ffunction-sections] [-fdata-sections] [--gc-sections] [-j[<n>]] [-run [-ftier-threshold=<n>]] [-v] <input>... | -s <source_str>\n");
+}
+
+// Builds "<basename of src without extension><ext>" in the current directory
+static char *default_output_name(const char *src_path, const char *ext)
+{
+    const char *base = "out";
+    if (src_path != NULL)
     {
-        printf("ERROR: Please specify a file or a string to analize.\n");
-        return 1;
+        const char *slash = strrchr(src_path, '/');
+        base = slash ? slash + 1 : src_path;
+    }
+    const char *dot = strrchr(base, '.');
+    size_t len = dot && dot != base ? (size_t)(dot - base) : strlen(base);
+
+    char *name = malloc(len + strlen(ext) + 1);
+    memcpy(name, base, len);
+    strcpy(name + len, ext);
+    return name;
+}
+
+// Creates a unique temporary object file so parallel compiles never clobber each other
+static int make_temp_object(char *path, size_t size)
+{
+    const char *tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL || tmpdir[0] == '\0')
+        tmpdir = "/tmp";
+    snprintf(path, size, "%s/freezepiler-XXXXXX.o", tmpdir);
+    int fd = mkstemps(path, 2);
+    if (fd < 0)
+    {
+        perror("mkstemps");
+        return -1;
     }
+    close(fd);
+    return 0;
+}
 
-    if (argc == 2 || (argc == 3 && strcmp(argv[2], "-v") == 0)  ) // A source file path is received
+// Runs `gcc -print-file-name=<name>` and stores the resulting path
+static void gcc_file_name(const char *name, char *out, size_t size)
+{
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "gcc -print-file-name=%s", name);
+    out[0] = '\0';
+    FILE *fp = popen(cmd, "r");
+    if (fp)
     {
-        FILE *file = fopen(argv[1], "r");
-        if (file == NULL) {
-            printf("ERROR: Unable to open file %s", argv[1]);
-            return 1;
-        } else {
-            fclose(file);
-        }
-        if(argc == 3){
-            extras = 1;
+        if (fgets(out, size, fp) == NULL)
+            out[0] = '\0';
+        pclose(fp);
+    }
+    // Quitar saltos de línea
+    out[strcspn(out, "\n")] = 0;
+}
+
+// The runtime archives live next to the compiler executable; out is empty if it is missing
+static void runtime_library(const char *name, char *out, size_t size)
+{
+    out[0] = '\0';
+    char exe[512];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0)
+        return;
+    exe[len] = '\0';
+    char *slash = strrchr(exe, '/');
+    if (slash == NULL)
+        return;
+    *slash = '\0';
+    snprintf(out, size, "%s/%s", exe, name);
+    if (access(out, R_OK) != 0)
+        out[0] = '\0';
+}
+
+extern char **environ;
+
+// Command line of an external tool, passed to it as is: paths need no quoting
+typedef struct arg_list
+{
+    const char **argv;
+    int argc;
+    int cap;
+} arg_list;
+
+static void arg_push(arg_list *args, const char *arg)
+{
+    if (args->argc + 1 >= args->cap)
+    {
+        args->cap = args->cap ? args->cap * 2 : 32;
+        args->argv = realloc(args->argv, args->cap * sizeof(char *));
+        if (args->argv == NULL)
+        {
+            perror("realloc");
+            exit(1);
         }
-        HLL_code = readFile(argv[1]);
     }
-    else if ((argc == 3 && strcmp(argv[1], "-s") == 0) ||
-            (argc == 4 && strcmp(argv[1], "-s") == 0 && strcmp(argv[3], "-v") == 0))
-    { // A string is received
-        int len = strlen(argv[2]);
-        HLL_code = (char *)malloc(len * sizeof(char) + 1);
-        strcpy(HLL_code, argv[2]);
-        if(argc == 4)
+    args->argv[args->argc++] = arg;
+    args->argv[args->argc] = NULL;
+}
+
+// Runs the command (searched in PATH) and waits for it; frees the list. 0 if it exited with 0
+static int run_tool(arg_list *args)
+{
+    pid_t pid;
+    int status = -1;
+    fflush(NULL); // Lo que ya se imprimió sale antes que la salida de la herramienta
+    int err = posix_spawnp(&pid, args->argv[0], NULL, NULL, (char *const *)args->argv, environ);
+    if (err != 0)
+        fprintf(stderr, "ERROR: cannot run %s: %s\n", args->argv[0], strerror(err));
+    else
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+    free(args->argv);
+    args->argv = NULL;
+    args->argc = args->cap = 0;
+    return err == 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
+
+// How the executable is linked
+typedef struct link_options
+{
+    int static_link; // -static
+    int freestanding; // -ffreestanding-runtime
+    int no_pie;      // -no-pie
+    int gc_sections; // --gc-sections
+} link_options;
+
+/*
+-ffreestanding-runtime: no crt files and no libc, only the bundled
+runtime and libgcc for the helpers LLVM may call. Without separate code
+and RELRO pages the program fits in a few kilobytes.
+*/
+static int link_freestanding(char **objects, int n_objects, const char *output_path, const link_options *lo)
+{
+    char runtime[512], libgcc[512];
+    runtime_library("libfreezepiler_freestanding.a", runtime, sizeof(runtime));
+    if (runtime[0] == '\0')
+    {
+        fprintf(stderr, "ERROR: libfreezepiler_freestanding.a not found next to the compiler.\n");
+        return 1;
+    }
+    gcc_file_name("libgcc.a", libgcc, sizeof(libgcc));
+
+    arg_list ld = { 0 };
+    arg_push(&ld, "ld");
+    arg_push(&ld, "-static");
+    arg_push(&ld, "-nostdlib");
+    arg_push(&ld, "-z");
+    arg_push(&ld, "noseparate-code");
+    arg_push(&ld, "-z");
+    arg_push(&ld, "norelro");
+    if (lo->gc_sections)
+        arg_push(&ld, "--gc-sections");
+    for (int i = 0; i < n_objects; i++)
+        arg_push(&ld, objects[i]);
+    arg_push(&ld, runtime);
+    arg_push(&ld, libgcc);
+    arg_push(&ld, "-o");
+    arg_push(&ld, output_path);
+    int status = run_tool(&ld);
+    if (status != 0)
+    {
+        fprintf(stderr, "ERROR: ld failed linking %s with the freestanding runtime.\n", output_path);
+        return 1;
+    }
+    return 0;
+}
+
+// Links object files into an executable with ld
+static int link_executable(char **objects, int n_objects, const char *output_path, const link_options *lo,
+                           int verbose)
+{
+    char linker[512], crt1[512], crti[512], crtbegin[512], crtend[512], crtn[512], runtime[512];
+    char libgcc[512], libgcc_eh[512];
+
+    if (lo->freestanding)
+    {
+        if (verbose)
+            printf("INFO: Linking executable (%s) with ld and the freestanding runtime...\n", output_path);
+        return link_freestanding(objects, n_objects, output_path, lo);
+    }
+
+    // Obtener rutas usando gcc -print-file-name
+    gcc_file_name("ld-linux-x86-64.so.2", linker, sizeof(linker));
+    gcc_file_name("crt1.o", crt1, sizeof(crt1));
+    gcc_file_name("crti.o", crti, sizeof(crti));
+    gcc_file_name("crtn.o", crtn, sizeof(crtn));
+    // crtbegin.o define __dso_handle, que necesita atexit (la usa -fprofile-generate)
+    // Estático: crtbeginT.o, y libgcc para lo que la libc.a no trae
+    gcc_file_name(lo->static_link ? "crtbeginT.o" : "crtbegin.o", crtbegin, sizeof(crtbegin));
+    gcc_file_name("crtend.o", crtend, sizeof(crtend));
+    gcc_file_name("libgcc.a", libgcc, sizeof(libgcc));
+    gcc_file_name("libgcc_eh.a", libgcc_eh, sizeof(libgcc_eh));
+    runtime_library("libfreezepiler_rt.a", runtime, sizeof(runtime));
+
+    // Armar los argumentos de ld
+    arg_list ld = { 0 };
+    arg_push(&ld, "ld");
+    if (lo->static_link)
+        arg_push(&ld, "-static");
+    else
+    {
+        arg_push(&ld, "-dynamic-linker");
+        arg_push(&ld, linker);
+        if (lo->no_pie)
+            arg_push(&ld, "-no-pie");
+    }
+    if (lo->gc_sections)
+        arg_push(&ld, "--gc-sections");
+    arg_push(&ld, crt1);
+    arg_push(&ld, crti);
+    arg_push(&ld, crtbegin);
+    for (int i = 0; i < n_objects; i++)
+        arg_push(&ld, objects[i]);
+    // El runtime va después de los objetos que lo usan y antes de la libc que él usa
+    if (runtime[0] != '\0')
+        arg_push(&ld, runtime);
+    if (lo->static_link)
+    {
+        arg_push(&ld, "--start-group");
+        arg_push(&ld, libgcc);
+        arg_push(&ld, libgcc_eh);
+        arg_push(&ld, "-lc");
+        arg_push(&ld, "--end-group");
+    }
+    else
+        arg_push(&ld, "-lc");
+    arg_push(&ld, crtend);
+    arg_push(&ld, crtn);
+    arg_push(&ld, "-o");
+    arg_push(&ld, output_path);
+
+    if (verbose)
+    {
+        printf("INFO: Linking executable (%s) with ld...\n", output_path);
+    }
+    int status = run_tool(&ld);
+    if (status != 0)
+    {
+        fprintf(stderr, "ERROR: ld failed. Verify the paths passed to ld and look for it in PATH env variable.\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Merges partition objects into the single relocatable object asked for with -c
+static int combine_objects(char **objects, int n_objects, const char *output_path)
+{
+    arg_list ld = { 0 };
+    arg_push(&ld, "ld");
+    arg_push(&ld, "-r");
+    arg_push(&ld, "-o");
+    arg_push(&ld, output_path);
+    for (int i = 0; i < n_objects; i++)
+        arg_push(&ld, objects[i]);
+    int status = run_tool(&ld);
+    if (status != 0)
+    {
+        fprintf(stderr, "ERROR: ld -r failed combining the partitions of %s\n", output_path);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+Emits a module as machine code into new temporary objects appended to
+objects[]: one, or with -j up to `jobs` partitions generated in parallel.
+The module is disposed; returns 0 on success.
+*/
+static int emit_temp_objects(LLVMModuleRef m, int jobs, const codegen_options *opts,
+                             char **objects, int *temporary, int *n_objects)
+{
+    int n = jobs > 1 ? partition_count(m, jobs) : 1;
+    for (int p = 0; p < n; p++)
+    {
+        objects[*n_objects] = malloc(4096);
+        temporary[*n_objects] = 1;
+        if (make_temp_object(objects[(*n_objects)++], 4096) != 0)
         {
-            extras = 1;
+            LLVMDisposeModule(m);
+            return 1;
         }
     }
+    char **parts = objects + *n_objects - n;
+    if (n == 1)
+        return codegen_emit_module(m, parts[0], opts) != 0;
 
+    // The IR pipeline runs once over the whole module; only the backend is split
+    if (codegen_optimize_module(m, opts) != 0)
+    {
+        LLVMDisposeModule(m);
+        return 1;
+    }
+    return partition_emit(m, parts, n, opts) != 0;
+}
+
+static int is_source_file(const char *path)
+{
+    size_t len = strlen(path);
+    return len > 2 && strcmp(path + len - 2, ".c") == 0;
+}
+
+// Parses, validates and simplifies one translation unit; NULL on a parse error
+static ast_node *parse_source(const char *HLL_code, int extras)
+{
     initScanner(HLL_code);
+    ast_root = NULL;
 
     int parse_result = yyparse(); // It takes the tokens from lexer (yylex())
 
-    if (parse_result != 0) 
+    if (parse_result != 0)
     {
         printf("ERROR: Parsing error...\n");
         //printf("SDT error...\n");
-        return parse_result;
+        return NULL;
+    }
+
+    //printf("Parsing Success!\n");
+    int sdt_result = validate_sdt(ast_root);
+
+    if (sdt_result == 1)
+    {
+        //printf("SDT Verified!\n");
+        if(extras ==1)
+        {
+            print_ast(ast_root, 0);
+            printf("Total number of tokens: %d\n", token_count );
+        }
+    }
+    else
+        printf("ERROR: SDT error...\n");
+
+    // Fold constants and prune dead branches before handing the AST to LLVM
+    ast_simplify(ast_root);
+    return ast_root;
+}
+
+// Reads a source given by path, or copies the -s string when path is NULL
+static char *read_source(const char *path, const char *source_str)
+{
+    char *HLL_code;
+    if (path != NULL) // A source file path is received
+    {
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+            printf("ERROR: Unable to open file %s", path);
+            return NULL;
+        } else {
+            fclose(file);
+        }
+        HLL_code = readFile(path);
+    }
+    else
+    { // A string is received
+        HLL_code = (char *)malloc(strlen(source_str) + 1);
+        strcpy(HLL_code, source_str);
+    }
+    return HLL_code;
+}
+
+static int stream_extras = 0;
+
+// -fstreaming: every external declaration is simplified, lowered and freed as soon as it is parsed
+static void stream_external(ast_node *decl)
+{
+    if (stream_extras == 1)
+        print_ast(decl, 1);
+    ast_simplify_external(decl);
+    codegen_stream_external(decl);
+    ast_free(decl);
+}
+
+/*
+Compiles one source into an LLVM module; NULL on errors. String literals
+in the AST point into the code buffer, so it is freed only after codegen.
+*/
+static LLVMModuleRef compile_source(const char *path, const char *source_str, int extras, int streaming,
+                                    const codegen_options *opts)
+{
+    char *code = read_source(path, source_str);
+    if (code == NULL)
+        return NULL;
+
+    LLVMModuleRef m = NULL;
+    if (streaming)
+    {
+        if (!codegen_stream_begin(opts))
+        {
+            free(code);
+            return NULL;
+        }
+        stream_extras = extras;
+        ast_external_handler = stream_external;
+        ast_simplify_begin();
+        initScanner(code);
+        int parse_result = yyparse();
+        ast_simplify_end();
+        ast_external_handler = NULL;
+        m = codegen_stream_end();
+        if (parse_result != 0)
+        {
+            printf("ERROR: Parsing error...\n");
+            if (m != NULL)
+                LLVMDisposeModule(m);
+            m = NULL;
+        }
+        else if (extras == 1)
+            printf("Total number of tokens: %d\n", token_count);
+        ast_free(ast_root);
+        ast_root = NULL;
     }
-    else 
+    else
     {
-        //printf("Parsing Success!\n");
-        int sdt_result = validate_sdt(ast_root);
+        ast_node *root = parse_source(code, extras);
+        m = root ? codegen_build_module(root, opts) : NULL;
+    }
+    free(code);
+    return m;
+}
 
-        if (sdt_result == 1)
+/*
+-run: nothing is written or linked. The program runs in this process,
+interpreted at first, and the exit status is the value main returns.
+*/
+static int run_source(const char *path, const char *source_str, int extras, const codegen_options *opts,
+                      unsigned long threshold)
+{
+    char *code = read_source(path, source_str);
+    if (code == NULL)
+        return 1;
+
+    int exit_code = 1;
+    ast_node *root = parse_source(code, extras);
+    if (root == NULL || interp_run(root, opts, threshold, &exit_code) != 0)
+    {
+        fprintf(stderr, "ERROR: Object Code generation error...\n");
+        exit_code = 1;
+    }
+    free(code);
+    return exit_code;
+}
+
+int main(int argc, char *argv[])
+{
+    LLVMInitializeAllTargetInfos();
+    LLVMInitializeAllTargets();
+    LLVMInitializeAllTargetMCs();
+    LLVMInitializeAllAsmPrinters();
+    int extras = 0;
+    int compile_only = 0, assembly_only = 0, emit_llvm = 0, opt_level = 0, whole_program = 0, lto = 0;
+    const char *output_path = NULL;
+    const char *source_str = NULL;
+    const char *profile_generate = NULL, *profile_use = NULL, *profile_functions_json = NULL;
+    int profile_functions = 0, streaming = 0, jobs = 1;
+    debug_level debug_info = DEBUG_NONE;
+    link_options link_opts = { 0, 0, 0, 0 };
+    int function_sections = 0, data_sections = 0;
+    int run = 0;
+    unsigned long tier_threshold = INTERP_DEFAULT_THRESHOLD;
+    const char **inputs = calloc(argc, sizeof(char *));
+    int n_inputs = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+            extras = 1;
+        else if (strcmp(argv[i], "-c") == 0)
+            compile_only = 1;
+        else if (strcmp(argv[i], "-S") == 0)
+            assembly_only = 1;
+        else if (strcmp(argv[i], "-emit-llvm") == 0)
+            emit_llvm = 1;
+        else if (strcmp(argv[i], "-fwhole-program") == 0)
+            whole_program = 1;
+        else if (strcmp(argv[i], "-flto") == 0)
+            lto = 1;
+        else if (strcmp(argv[i], "-fprofile-generate") == 0)
+            profile_generate = PROFILE_DEFAULT_PATH;
+        else if (strncmp(argv[i], "-fprofile-generate=", 19) == 0 && argv[i][19] != '\0')
+            profile_generate = argv[i] + 19;
+        else if (strcmp(argv[i], "-fprofile-use") == 0)
+            profile_use = PROFILE_DEFAULT_PATH;
+        else if (strncmp(argv[i], "-fprofile-use=", 14) == 0 && argv[i][14] != '\0')
+            profile_use = argv[i] + 14;
+        else if (strcmp(argv[i], "-fprofile-functions") == 0)
+            profile_functions = 1;
+        else if (strncmp(argv[i], "-fprofile-functions=", 20) == 0 && argv[i][20] != '\0')
         {
-            //printf("SDT Verified!\n");
-            if(extras ==1)
+            profile_functions = 1;
+            profile_functions_json = argv[i] + 20;
+        }
+        else if (strcmp(argv[i], "-g") == 0)
+            debug_info = DEBUG_FULL;
+        else if (strcmp(argv[i], "-gline-tables-only") == 0)
+            debug_info = DEBUG_LINE_TABLES;
+        else if (strcmp(argv[i], "-g0") == 0)
+            debug_info = DEBUG_NONE;
+        else if (strcmp(argv[i], "-static") == 0)
+            link_opts.static_link = 1;
+        else if (strcmp(argv[i], "-ffreestanding-runtime") == 0)
+            link_opts.freestanding = 1;
+        else if (strcmp(argv[i], "-no-pie") == 0)
+            link_opts.no_pie = 1;
+        else if (strcmp(argv[i], "-ffunction-sections") == 0)
+            function_sections = 1;
+        else if (strcmp(argv[i], "-fdata-sections") == 0)
+            data_sections = 1;
+        else if (strcmp(argv[i], "--gc-sections") == 0)
+            link_opts.gc_sections = 1;
+        else if (strcmp(argv[i], "-fstreaming") == 0)
+            streaming = 1;
+        else if (strcmp(argv[i], "-run") == 0)
+            run = 1;
+        else if (strncmp(argv[i], "-ftier-threshold=", 17) == 0 && strtoul(argv[i] + 17, NULL, 10) > 0)
+            tier_threshold = strtoul(argv[i] + 17, NULL, 10);
+        else if (strcmp(argv[i], "-j") == 0)
+        {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            jobs = cpus > 0 ? (int)cpus : 1;
+        }
+        else if (strncmp(argv[i], "-j", 2) == 0 && atoi(argv[i] + 2) > 0)
+            jobs = atoi(argv[i] + 2);
+        else if (strcmp(argv[i], "-O") == 0)
+            opt_level = 2;
+        else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '3' && argv[i][3] == '\0')
+            opt_level = argv[i][2] - '0';
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "-s") == 0)
+        {
+            if (i + 1 >= argc)
             {
-                print_ast(ast_root, 0);
-                printf("Total number of tokens: %d\n", token_count );
+                printf("ERROR: Option %s requires an argument.\n", argv[i]);
+                usage();
+                return 1;
             }
+            if (argv[i][1] == 'o')
+                output_path = argv[++i];
+            else
+                source_str = argv[++i];
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            printf("ERROR: Unknown option %s\n", argv[i]);
+            usage();
+            return 1;
         }
         else
-            printf("ERROR: SDT error...\n");
+            inputs[n_inputs++] = argv[i];
     }
 
-    /*
-       printf("--- Abstract Syntax Tree (AST) ---\n");
-       print_ast(ast_root, 0);
-       printf("----------------------------------\n");
-       */
-
-    if (codegen_generate_module(ast_root, "out.o") != 0)
+    if (n_inputs == 0 && source_str == NULL)
     {
-        fprintf(stderr, "ERROR: Object Code generation error...\n");
+        printf("ERROR: Please specify a file or a string to analize.\n");
+        usage();
         return 1;
     }
-    if (extras == 1) 
+    if (source_str != NULL)
+        inputs[n_inputs++] = NULL; // The -s string is compiled like one more source
+    if (profile_generate != NULL && profile_use != NULL)
     {
-        //printf("==========================================================================================================================");
-        printf("OK: out.o succesfully generated (Object Code).\n");
+        printf("ERROR: -fprofile-generate and -fprofile-use cannot be combined.\n");
+        return 1;
+    }
+    if (link_opts.freestanding && (profile_generate != NULL || profile_functions))
+    {
+        printf("ERROR: -fprofile-generate and -fprofile-functions write with stdio, which -ffreestanding-runtime does not have.\n");
+        return 1;
     }
 
-    char linker[512], crt1[512], crti[512], crtn[512];
-    FILE *fp;
+    // Select what the backend emits and where it goes
+    codegen_options opts = { EMIT_OBJECT, opt_level, whole_program, LTO_NONE, NULL, profile_generate, profile_use,
+                             profile_functions, profile_functions_json, debug_info,
+                             link_opts.static_link || link_opts.no_pie || link_opts.freestanding,
+                             function_sections, data_sections, link_opts.freestanding };
+    if (run)
+    {
+        if (n_inputs != 1 || (inputs[0] != NULL && !is_source_file(inputs[0])))
+        {
+            printf("ERROR: -run takes exactly one C source.\n");
+            return 1;
+        }
+        if (compile_only || assembly_only || emit_llvm || lto || streaming || profile_generate != NULL ||
+            profile_use != NULL || profile_functions || link_opts.freestanding)
+        {
+            printf("ERROR: -run cannot be combined with -c, -S, -emit-llvm, -flto, -fstreaming, profiling or -ffreestanding-runtime.\n");
+            return 1;
+        }
+        int status = run_source(inputs[0], source_str, extras, &opts, tier_threshold);
+        free(inputs);
+        return status;
+    }
 
-    // Obtener rutas usando gcc -print-file-name
-    fp = popen("gcc -print-file-name=ld-linux-x86-64.so.2", "r");
-    fgets(linker, sizeof(linker), fp); fclose(fp);
+    const char *ext = NULL;
+    int link = 0;
+    if (assembly_only)
+    {
+        // -flto -S writes textual IR, like clang
+        opts.emit = emit_llvm || lto ? EMIT_LLVM_IR : EMIT_ASSEMBLY;
+        ext = opts.emit == EMIT_LLVM_IR ? ".ll" : ".s";
+    }
+    else if (compile_only || emit_llvm)
+    {
+        // -flto -c keeps the .o name but the file holds bitcode for the link step
+        opts.emit = emit_llvm || lto ? EMIT_LLVM_BC : EMIT_OBJECT;
+        ext = emit_llvm ? ".bc" : ".o";
+    }
+    else
+    {
+        link = 1;
+    }
+    if (lto && !link)
+        opts.lto = LTO_PRELINK;
 
-    fp = popen("gcc -print-file-name=crt1.o", "r");
-    fgets(crt1, sizeof(crt1), fp); fclose(fp);
+    int n_sources = 0;
+    for (int i = 0; i < n_inputs; i++)
+        if (inputs[i] == NULL || is_source_file(inputs[i]))
+            n_sources++;
 
-    fp = popen("gcc -print-file-name=crti.o", "r");
-    fgets(crti, sizeof(crti), fp); fclose(fp);
+    if (!link)
+    {
+        if (output_path != NULL && n_sources > 1)
+        {
+            printf("ERROR: Cannot specify -o with -c or -S and multiple files.\n");
+            return 1;
+        }
+        for (int i = 0; i < n_inputs; i++)
+        {
+            const char *path = inputs[i];
+            if (path != NULL && !is_source_file(path))
+            {
+                printf("WARNING: %s: linker input file unused because linking not done\n", path);
+                continue;
+            }
+            opts.module_name = path ? path : "-s";
+            LLVMModuleRef m = compile_source(path, source_str, extras, streaming, &opts);
+            if (m == NULL)
+            {
+                fprintf(stderr, "ERROR: Object Code generation error...\n");
+                return 1;
+            }
 
-    fp = popen("gcc -print-file-name=crtn.o", "r");
-    fgets(crtn, sizeof(crtn), fp); fclose(fp);
+            char *default_output = default_output_name(path, ext);
+            const char *out = output_path ? output_path : default_output;
+            int status;
+            if (jobs > 1 && opts.emit == EMIT_OBJECT)
+            {
+                // -c -j: the partitions are combined into the requested object with ld -r
+                char **parts = calloc(jobs, sizeof(char *));
+                int *part_temporary = calloc(jobs, sizeof(int));
+                int n_parts = 0;
+                status = emit_temp_objects(m, jobs, &opts, parts, part_temporary, &n_parts);
+                if (status == 0)
+                    status = combine_objects(parts, n_parts, out);
+                for (int p = 0; p < n_parts; p++)
+                {
+                    remove(parts[p]);
+                    free(parts[p]);
+                }
+                free(parts);
+                free(part_temporary);
+            }
+            else
+                status = codegen_emit_module(m, out, &opts);
+            if (status != 0)
+            {
+                fprintf(stderr, "ERROR: Object Code generation error...\n");
+                return 1;
+            }
+            if (extras == 1)
+                printf("OK: %s succesfully generated.\n", out);
+            free(default_output);
+        }
+        free(inputs);
+        return 0;
+    }
 
-    // Quitar saltos de línea
-    linker[strcspn(linker, "\n")] = 0;
-    crt1[strcspn(crt1, "\n")] = 0;
-    crti[strcspn(crti, "\n")] = 0;
-    crtn[strcspn(crtn, "\n")] = 0;
+    if (output_path == NULL)
+        output_path = "program";
 
-    // Crear el comando ld dinámicamente
-    char *ld_command = malloc(2048);
-    if (!ld_command) 
-    { 
-        perror("malloc");
-        return 1; 
-    }
+    // The objects we compile only live in unique temporary files until they are linked
+    char **objects = calloc(n_inputs * jobs + 1, sizeof(char *));
+    int *temporary = calloc(n_inputs * jobs + 1, sizeof(int));
+    int n_objects = 0;
+    int failed = 0;
 
-    snprintf(ld_command, 2048,
-            "ld -dynamic-linker %s %s %s out.o -lc %s -o program",
-            linker, crt1, crti, crtn);
+    int use_lto = lto;
+    for (int i = 0; i < n_inputs; i++)
+        if (inputs[i] != NULL && !is_source_file(inputs[i]) && lto_is_bitcode_file(inputs[i]))
+            use_lto = 1;
 
-    //printf("Comando ld generado:\n%s\n", ld_command);
-    if (extras == 1)
+    if (use_lto)
     {
-        printf("INFO: Linking executable (program) with ld...\n");
+        // Every source and bitcode input is merged into one module that is optimized and emitted once
+        LLVMModuleRef merged = NULL;
+        for (int i = 0; i < n_inputs && !failed; i++)
+        {
+            const char *path = inputs[i];
+            LLVMModuleRef m = NULL;
+            if (path == NULL || is_source_file(path))
+            {
+                opts.module_name = path ? path : "-s";
+                m = compile_source(path, source_str, extras, streaming, &opts);
+            }
+            else if (lto_is_bitcode_file(path))
+                m = lto_load_bitcode(path);
+            else
+            {
+                objects[n_objects++] = (char *)path;
+                continue;
+            }
+
+            if (m == NULL)
+                failed = 1;
+            else if (merged == NULL)
+                merged = m;
+            else if (lto_link_into(merged, m) != 0)
+                failed = 1;
+        }
+
+        if (!failed && merged != NULL)
+        {
+            lto_internalize(merged);
+            opts.emit = EMIT_OBJECT;
+            opts.lto = LTO_LINK;
+            failed = emit_temp_objects(merged, jobs, &opts, objects, temporary, &n_objects);
+        }
+        else if (merged != NULL)
+            LLVMDisposeModule(merged);
     }
-    if (system(ld_command) != 0)
+    else
     {
-        fprintf(stderr, "ERROR: ld failed. Verify ld_command paths and look for it in PATH env variable.\n");
-        return 1;
+        for (int i = 0; i < n_inputs && !failed; i++)
+        {
+            const char *path = inputs[i];
+            if (path != NULL && !is_source_file(path))
+            {
+                objects[n_objects++] = (char *)path;
+                continue;
+            }
+            opts.module_name = path ? path : "-s";
+            LLVMModuleRef m = compile_source(path, source_str, extras, streaming, &opts);
+            if (m == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            failed = emit_temp_objects(m, jobs, &opts, objects, temporary, &n_objects);
+        }
+    }
+
+    if (failed)
+        fprintf(stderr, "ERROR: Object Code generation error...\n");
+    else
+    {
+        if (extras == 1)
+            printf("OK: Object code succesfully generated.\n");
+        failed = link_executable(objects, n_objects, output_path, &link_opts, extras) != 0;
     }
 
+    for (int i = 0; i < n_objects; i++)
+    {
+        if (temporary[i])
+        {
+            remove(objects[i]);
+            free(objects[i]);
+        }
+    }
+    free(objects);
+    free(temporary);
+    free(inputs);
+    if (failed)
+        return 1;
+
     if (extras == 1)
     {
-        //printf("==========================================================================================================================");
-        printf("OK: Compilation finished. Program 'program' generated.\n");
+        printf("OK: Compilation finished. Program '%s' generated.\n", output_path);
         printf("Executing program ...\n");
-        system("./program");
+        char run_path[4096 + 8];
+        snprintf(run_path, sizeof(run_path), "%s%s", strchr(output_path, '/') ? "" : "./", output_path);
+        arg_list run = { 0 };
+        arg_push(&run, run_path);
+        run_tool(&run);
     }
-    //system("rm out.o");
-
-    free(ld_command);
-    free(HLL_code);
     return 0;
 }
@@ -7,6 +7,7 @@
  * ------------------------------------------------------------------
  */
 %{
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,8 +23,25 @@ void yyerror(const char *s);
 
 /* Global line number variable from lexer */
 extern int yylineno;
+
+/* DECLARACION(tipo, declarators...), or an empty statement for a typedef; NULL on error */
+static struct ast_node *make_declaration(struct ast_node *tipo, struct ast_node *declarators);
+
+/* The parser stack lives on the heap; the default limit (10000) rejects deeply nested generated code */
+#define YYMAXDEPTH 10000000
 %}
 
+/* The semantic value union uses lit_span, so the generated header needs ast.h too */
+%code requires {
+#include "ast.h"
+}
+
+/* Last syntax error, for callers without a console (libfreezepiler); quiet stops the print */
+%code provides {
+extern char parse_error_message[256];
+extern int parse_errors_quiet;
+}
+
 /* * ------------------------------------------------------------------
  * UNION AND TOKENS
  * ------------------------------------------------------------------
@@ -32,8 +50,10 @@ extern int yylineno;
 /* Defines the semantic values that symbols can have */
 %union {
   int intVal;
-  float floatVal;
+  int_lit intLit;        /* Integer constants with their type */
+  double floatVal;
   char* strVal;
+  lit_span span;         /* String and char literals, pointing into the source */
   struct ast_node *node; /* Non-terminals will return an AST node pointer */
 }
 
@@ -57,12 +77,12 @@ extern int yylineno;
 %token <strVal> T_ID
 
 //CONSTANTS
-%token <intVal> T_ENTERO
+%token <intLit> T_ENTERO
 %token <floatVal> T_NUMERO
 
 //LITERALS
-%token <strVal> T_CADENA
-%token <strVal> T_CARACTER
+%token <span> T_CADENA
+%token <span> T_CARACTER
 
 //PUNCTUATORS
 //parentesis
@@ -101,13 +121,19 @@ extern int yylineno;
 %token T_TILDE     /* ~ */
 %token T_LSHIFT T_RSHIFT /* << >> */
 
+// Keywords added later go last so the existing token numbers stay stable
+%token T_INLINE
+%token <span> T_PRAGMA /* #pragma omp ...: the text after "pragma" */
+%token T_ATTRIBUTE
+%token <strVal> T_TYPE_NAME /* A name declared with typedef (see ast_typedef_lookup) */
+
 /* * ------------------------------------------------------------------
  * NON-TERMINAL TYPES
  * ------------------------------------------------------------------
  */
 /* Specify that all non-terminals return a <node> pointer */
-%type <node> programa declaracion_externa declaracion tipo_specifier
-%type <node> lista_init_var init_var var funcion parametros parametro
+%type <node> programa declaracion_externa declaracion tipo_specifier tipo_simple atributo
+%type <node> lista_init_var init_var var inicializador lista_inicializadores funcion parametros parametro
 %type <node> bloque sentencia expr_opcional if_sent while_sent
 %type <node> do_while_sent for_sent switch_sent expr lista_args_opt lista_args
 
@@ -171,18 +197,12 @@ programa:
           ast_root = $$;
       }
 
-    | declaracion_externa
-      {
-          // Primer declaración: crear PROGRAMA y ponerla como hijo
-          struct ast_node *prog = make_node(NT_PROGRAMA, $1);
-          ast_root = prog;
-          $$ = prog;
-      }
-
     | programa declaracion_externa
       {
-          // Agregar la nueva declaración como hermano del primer hijo
-          ast_append_sibling($1->child, $2);
+          // Agregar la nueva declaración como hermano del primer hijo (o entregarla con -fstreaming).
+          // La primera también entra por aquí: una regla aparte para ella hacía que cada token
+          // que empieza un tipo fuera un conflicto shift/reduce con la regla vacía
+          ast_add_external($1, $2);
           ast_root = $1;
           $$ = $1;
       }
@@ -199,10 +219,43 @@ declaracion_externa:
 /* --- Declarations --- */
 declaracion:
     tipo_specifier lista_init_var T_SEMICOLON
-    { $$ = make_node(NT_DECLARACION, $1); $$->child->sibling = $2; }
+    { $$ = make_declaration($1, $2); if (!$$) YYERROR; }
+    /* typedef int v4i __attribute__((vector_size(16))); the attribute applies to the whole type */
+  | tipo_specifier var atributo T_SEMICOLON
+    { $$ = make_declaration(ast_add_type_specifier($1, $3), $2); if (!$$) YYERROR; }
+  | tipo_specifier var atributo T_ASSIGN inicializador T_SEMICOLON
+    { $$ = make_declaration(ast_add_type_specifier($1, $3), make_op_node(T_ASSIGN, $2, $5)); if (!$$) YYERROR; }
   ;
 
+/* A type is one or more specifiers (const int, unsigned long long, ...) */
 tipo_specifier:
+    tipo_simple
+    { $$ = $1; }
+  | tipo_specifier tipo_simple
+    { $$ = ast_add_type_specifier($1, $2); }
+  | tipo_specifier atributo
+    { $$ = ast_add_type_specifier($1, $2); }
+  ;
+
+/* __attribute__((vector_size(N))): only GCC vector types so far */
+atributo:
+    T_ATTRIBUTE T_LPAREN T_LPAREN T_ID T_LPAREN T_ENTERO T_RPAREN T_RPAREN T_RPAREN
+    {
+        if (strcmp($4, "vector_size") != 0 && strcmp($4, "__vector_size__") != 0) {
+            yyerror("unsupported attribute");
+            YYERROR;
+        }
+        if ($6.value > INT_MAX) {
+            yyerror("vector_size is too large");
+            YYERROR;
+        }
+        $$ = make_leaf_int(NT_TIPO, T_ATTRIBUTE);
+        $$->child = make_leaf_lit($6);
+        free($4);
+    }
+  ;
+
+tipo_simple:
     T_VOID
     { $$ = make_leaf_int(NT_TIPO, T_VOID); }
   | T_CHAR
@@ -223,6 +276,12 @@ tipo_specifier:
     { $$ = make_leaf_int(NT_TIPO, T_UNSIGNED); }
   | T_CONST
     { $$ = make_leaf_int(NT_TIPO, T_CONST); }
+  | T_STATIC
+    { $$ = make_leaf_int(NT_TIPO, T_STATIC); }
+  | T_EXTERN
+    { $$ = make_leaf_int(NT_TIPO, T_EXTERN); }
+  | T_INLINE
+    { $$ = make_leaf_int(NT_TIPO, T_INLINE); }
   | T_VOLATILE
     { $$ = make_leaf_int(NT_TIPO, T_VOLATILE); }
   | T_STRUCT T_ID
@@ -233,6 +292,8 @@ tipo_specifier:
     { $$ = make_leaf_str(NT_TIPO, $2); $$->value.op = T_ENUM; }
   | T_TYPEDEF
     { $$ = make_leaf_int(NT_TIPO, T_TYPEDEF); }
+  | T_TYPE_NAME
+    { $$ = ast_copy(ast_typedef_lookup($1)); $$->lineno = yylineno; free($1); }
   ;
 
 lista_init_var:
@@ -245,15 +306,37 @@ lista_init_var:
 init_var:
     var
     { $$ = $1; }
-  | var T_ASSIGN expr 
+  | var T_ASSIGN inicializador
     { $$ = make_op_node(T_ASSIGN, $1, $3); }
   ;
 
+/* int t[2][3] = { {1, 2, 3}, {4, 5, 6} }; the trailing comma is allowed */
+inicializador:
+    expr
+    { $$ = $1; }
+  | T_LBRACE lista_inicializadores T_RBRACE
+    { $$ = make_node(NT_LISTA_INIT, $2); }
+  | T_LBRACE lista_inicializadores T_COMMA T_RBRACE
+    { $$ = make_node(NT_LISTA_INIT, $2); }
+  ;
+
+lista_inicializadores:
+    inicializador
+    { $$ = $1; }
+  | lista_inicializadores T_COMMA inicializador
+    { $$ = ast_append_sibling($1, $3); }
+  ;
+
 var:
     T_ID
     { $$ = make_leaf_str(NT_VAR, $1); }
-  | T_ID T_LBRACKET expr_opcional T_RBRACKET
-    { $$ = make_node(NT_ARRAY_DECL, make_leaf_str(NT_VAR, $1)); $$->child->sibling = $3; }
+  | var T_LBRACKET expr_opcional T_RBRACKET
+    {
+        /* Each dimension is appended after the name: ARRAY_DECL(VAR, dim1, dim2, ...); a[] keeps an empty placeholder */
+        struct ast_node *dim = $3 ? $3 : make_node(NT_EXPR_SENTENCIA, NULL);
+        $$ = $1->type == NT_VAR ? make_node(NT_ARRAY_DECL, $1) : $1;
+        ast_append_sibling($$->child, dim);
+    }
   ;
 
 /* --- Functions --- */
@@ -310,6 +393,25 @@ funcion:
 
           $$ = make_node(NT_FUNCION, ret);
       }
+
+    /* Prototypes: a FUNCION node without a BLOQUE, for functions defined later or in another file */
+    | tipo_specifier T_ID T_LPAREN T_RPAREN T_SEMICOLON
+      {
+          $$ = make_node(NT_FUNCION, $1);
+          $1->sibling = make_leaf_str(NT_ID, $2);
+      }
+    | tipo_specifier T_ID T_LPAREN T_VOID T_RPAREN T_SEMICOLON
+      {
+          $$ = make_node(NT_FUNCION, $1);
+          $1->sibling = make_leaf_str(NT_ID, $2);
+          $1->sibling->sibling = make_node(NT_PARAMETRO, make_leaf_int(NT_TIPO, T_VOID));
+      }
+    | tipo_specifier T_ID T_LPAREN parametros T_RPAREN T_SEMICOLON
+      {
+          $$ = make_node(NT_FUNCION, $1);
+          $1->sibling = make_leaf_str(NT_ID, $2);
+          $1->sibling->sibling = $4;
+      }
     ;
 
 
@@ -359,8 +461,12 @@ sentencia:
     { $$ = make_node(NT_RETURN, $2); }
   | T_GOTO T_ID T_SEMICOLON
     { $$ = make_node(NT_GOTO, make_leaf_str(NT_ID, $2)); }
+  | T_GOTO T_STAR expr T_SEMICOLON
+    { $$ = make_node(NT_GOTO, make_unary_op_node(T_STAR, $3)); } /* Computed goto (GNU): GOTO(*expr) */
   | T_LBRACE bloque T_RBRACE
     { $$ = make_node(NT_BLOQUE, $2); }
+  | T_PRAGMA sentencia
+    { $$ = make_leaf_span(NT_PRAGMA, $1); $$->child = $2; } /* PRAGMA(sentencia), the text in value.span */
   | T_ID T_COLON sentencia
     { $$ = make_node(NT_ETIQUETA, make_leaf_str(NT_ID, $1)); $$->child->sibling = $3; }
   | T_CASE expr T_COLON sentencia
@@ -399,7 +505,13 @@ do_while_sent:
 
 for_sent:
     T_FOR T_LPAREN expr_opcional T_SEMICOLON expr_opcional T_SEMICOLON expr_opcional T_RPAREN sentencia
-    { $$ = make_node(NT_FOR, $3); $$->child->sibling = $5; $$->child->sibling->sibling = $7; $$->child->sibling->sibling->sibling = $9; }
+    {
+        /* Las partes vacías se guardan como EXPR_SENTENCIA sin hijo para conservar la forma init, cond, inc, cuerpo */
+        struct ast_node *init = $3 ? $3 : make_node(NT_EXPR_SENTENCIA, NULL);
+        struct ast_node *cond = $5 ? $5 : make_node(NT_EXPR_SENTENCIA, NULL);
+        struct ast_node *inc = $7 ? $7 : make_node(NT_EXPR_SENTENCIA, NULL);
+        $$ = make_node(NT_FOR, init); init->sibling = cond; cond->sibling = inc; inc->sibling = $9;
+    }
   ;
 
 switch_sent:
@@ -410,8 +522,8 @@ switch_sent:
 /* --- Expressions --- */
 expr:
     /* Assignment */
-    T_ID T_ASSIGN expr
-    { $$ = make_op_node(T_ASSIGN, make_leaf_str(NT_ID, $1), $3); }
+    expr T_ASSIGN expr
+    { $$ = make_op_node(T_ASSIGN, $1, $3); }
   | expr T_ASSIGN_PLUS expr
     { $$ = make_op_node(T_ASSIGN_PLUS, $1, $3); }
   | expr T_ASSIGN_MINUS expr
@@ -498,6 +610,8 @@ expr:
     { $$ = make_unary_op_node(T_AMPERSAND, $2); } /* Address-of */
   | T_STAR expr %prec T_UMINUS 
     { $$ = make_unary_op_node(T_STAR, $2); } /* Dereference */
+  | T_AND T_ID %prec T_UMINUS
+    { $$ = make_unary_op_node(T_AND, make_leaf_str(NT_ID, $2)); } /* Address of a label (GNU &&label) */
   | T_SIZEOF expr
     { $$ = make_unary_op_node(T_SIZEOF, $2); }
   | T_SIZEOF T_LPAREN tipo_specifier T_RPAREN
@@ -519,13 +633,13 @@ expr:
   | T_ID
     { $$ = make_leaf_str(NT_ID, $1); }
   | T_ENTERO
-    { $$ = make_leaf_int(NT_ENTERO, $1); }
+    { $$ = make_leaf_lit($1); }
   | T_NUMERO
     { $$ = make_leaf_float(NT_FLOTANTE, $1); }
   | T_CARACTER
-    { $$ = make_leaf_str(NT_CARACTER, $1); }
+    { $$ = make_leaf_span(NT_CARACTER, $1); }
   | T_CADENA
-    { $$ = make_leaf_str(NT_CADENA, $1); }
+    { $$ = make_leaf_span(NT_CADENA, $1); }
   ;
 
 lista_args_opt:
@@ -552,6 +666,26 @@ lista_args:
  * have been moved to 'ast.c'.
  */
 
+char parse_error_message[256];
+int parse_errors_quiet = 0;
+
 void yyerror(const char *s) {
-    fprintf(stderr, "Syntax error in line %d: %s\n", yylineno, s);
+    snprintf(parse_error_message, sizeof(parse_error_message), "Syntax error in line %d: %s", yylineno, s);
+    if (!parse_errors_quiet) {
+        fprintf(stderr, "%s\n", parse_error_message);
+    }
+}
+
+static struct ast_node *make_declaration(struct ast_node *tipo, struct ast_node *declarators) {
+    if (ast_type_count(tipo, T_TYPEDEF) > 0) {
+        // The names become types for the lexer; nothing is left to generate
+        if (!ast_typedef_declare(tipo, declarators)) {
+            yyerror("a typedef can only declare plain names");
+            return NULL;
+        }
+        return make_node(NT_EXPR_SENTENCIA, NULL);
+    }
+    struct ast_node *decl = make_node(NT_DECLARACION, tipo);
+    tipo->sibling = declarators;
+    return decl;
 }
@@ -0,0 +1,312 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "partition.h"
+#include "codegen.h"
+
+#include <llvm-c/BitReader.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/TargetMachine.h>
+
+static unsigned instruction_count(LLVMValueRef fn) {
+    unsigned n = 0;
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(fn); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst != NULL; inst = LLVMGetNextInstruction(inst)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static int defined_functions(LLVMModuleRef module) {
+    int n = 0;
+    for (LLVMValueRef fn = LLVMGetFirstFunction(module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        if (!LLVMIsDeclaration(fn)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+int partition_count(LLVMModuleRef module, int jobs) {
+    int n = defined_functions(module);
+    return jobs < n ? jobs : (n > 0 ? n : 1);
+}
+
+static int is_local(LLVMValueRef value) {
+    LLVMLinkage linkage = LLVMGetLinkage(value);
+    return linkage == LLVMInternalLinkage || linkage == LLVMPrivateLinkage;
+}
+
+// Static symbols get a unique hidden name: several partitions (and files) may use the same one
+static void externalize(LLVMValueRef value, unsigned long long key) {
+    size_t len;
+    const char *name = LLVMGetValueName2(value, &len);
+    if (len >= 5 && strncmp(name, "llvm.", 5) == 0) {
+        return; // llvm.global_ctors y demás se quedan en la partición 0
+    }
+    char *unique = malloc(len + 32);
+    snprintf(unique, len + 32, "%.*s.__part%llx", (int)len, len ? name : "anon", key);
+    LLVMSetValueName2(value, unique, strlen(unique));
+    free(unique);
+    LLVMSetLinkage(value, LLVMExternalLinkage);
+    LLVMSetVisibility(value, LLVMHiddenVisibility);
+    LLVMSetUnnamedAddress(value, LLVMNoUnnamedAddr);
+}
+
+// Turns a definition into a declaration: first the uses between its instructions go, then the code
+static void delete_body(LLVMValueRef fn) {
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(fn); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst != NULL; inst = LLVMGetNextInstruction(inst)) {
+            LLVMTypeRef type = LLVMTypeOf(inst);
+            if (LLVMGetTypeKind(type) != LLVMVoidTypeKind) {
+                LLVMReplaceAllUsesWith(inst, LLVMGetUndef(type));
+            }
+        }
+    }
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(fn); bb != NULL; bb = LLVMGetNextBasicBlock(bb)) {
+        LLVMValueRef inst;
+        while ((inst = LLVMGetFirstInstruction(bb)) != NULL) {
+            LLVMInstructionEraseFromParent(inst);
+        }
+    }
+    LLVMBasicBlockRef bb;
+    while ((bb = LLVMGetFirstBasicBlock(fn)) != NULL) {
+        LLVMDeleteBasicBlock(bb);
+    }
+    LLVMGlobalClearMetadata(fn);
+    LLVMSetLinkage(fn, LLVMExternalLinkage);
+}
+
+/*
+Functions whose labels are addressed (&&label) from a global initializer,
+such as a static dispatch table. The initializers stay in partition 0
+and a blockaddress can only name a block defined in the same module, so
+those functions go to partition 0 too.
+*/
+static void find_block_addresses(LLVMValueRef c, LLVMValueRef *fns, int *n, int max) {
+    if (LLVMGetValueKind(c) == LLVMBlockAddressValueKind) {
+        LLVMValueRef fn = LLVMGetOperand(c, 0);
+        for (int i = 0; i < *n; i++) {
+            if (fns[i] == fn) {
+                return;
+            }
+        }
+        if (*n < max) {
+            fns[(*n)++] = fn;
+        }
+        return;
+    }
+    int ops = LLVMGetNumOperands(c);
+    for (int i = 0; i < ops; i++) {
+        LLVMValueRef op = LLVMGetOperand(c, i);
+        if (op != NULL && LLVMIsAConstant(op) && !LLVMIsAGlobalValue(op)) {
+            find_block_addresses(op, fns, n, max);
+        }
+    }
+}
+
+typedef struct function_size {
+    unsigned size;
+    int index;
+} function_size;
+
+static int by_size_desc(const void *a, const void *b) {
+    const function_size *x = a, *y = b;
+    return x->size != y->size ? (x->size < y->size ? 1 : -1) : x->index - y->index;
+}
+
+typedef struct partition_job {
+    const char *bitcode;
+    size_t size;
+    const int *owner;  // partición de cada función definida, en orden del módulo
+    int index;
+    const char *object;
+    int opt_level;
+    int no_pie;
+    int failed;
+} partition_job;
+
+static void *emit_partition(void *data) {
+    partition_job *job = data;
+    job->failed = 1;
+
+    // Cada hilo tiene su propio contexto: LLVM no comparte uno entre hilos
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMMemoryBufferRef buffer = LLVMCreateMemoryBufferWithMemoryRange(job->bitcode, job->size, "partition", 0);
+    LLVMModuleRef module = NULL;
+    if (LLVMParseBitcodeInContext2(context, buffer, &module)) {
+        fprintf(stderr, "ERROR: Unable to read partition %d\n", job->index);
+        LLVMDisposeMemoryBuffer(buffer);
+        LLVMContextDispose(context);
+        return NULL;
+    }
+    LLVMDisposeMemoryBuffer(buffer);
+
+    int i = 0;
+    for (LLVMValueRef fn = LLVMGetFirstFunction(module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        if (!LLVMIsDeclaration(fn) && job->owner[i++] != job->index) {
+            delete_body(fn);
+        }
+    }
+    // Las variables globales y los constructores quedan en la partición 0
+    if (job->index != 0) {
+        LLVMValueRef g = LLVMGetFirstGlobal(module);
+        while (g != NULL) {
+            LLVMValueRef next = LLVMGetNextGlobal(g);
+            if (strncmp(LLVMGetValueName(g), "llvm.", 5) == 0) {
+                LLVMDeleteGlobal(g);
+            } else if (!LLVMIsDeclaration(g)) {
+                LLVMSetInitializer(g, NULL);
+                LLVMSetLinkage(g, LLVMExternalLinkage);
+            }
+            g = next;
+        }
+    }
+
+    char *triple, *err = NULL;
+    LLVMTargetMachineRef target_machine = codegen_create_target_machine(job->opt_level, job->no_pie, &triple);
+    if (target_machine != NULL) {
+        if (LLVMTargetMachineEmitToFile(target_machine, module, (char *)job->object, LLVMObjectFile, &err)) {
+            fprintf(stderr, "ERROR: Unable to write partition %d to %s: %s\n", job->index, job->object, err);
+            LLVMDisposeMessage(err);
+        } else {
+            job->failed = 0;
+        }
+        LLVMDisposeTargetMachine(target_machine);
+        LLVMDisposeMessage(triple);
+    }
+    LLVMDisposeModule(module);
+    LLVMContextDispose(context);
+    return NULL;
+}
+
+// FNV-1a over n bytes, continuing from h
+static unsigned long long fnv1a(unsigned long long h, const char *s, size_t n) {
+    for (size_t c = 0; c < n; c++) {
+        h = (h ^ (unsigned char)s[c]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/*
+Suffix for the static symbols of a module. It only depends on the module,
+so the same build always gives the same objects: the identifier (the
+source path), the order of the module among those this process emits,
+and the names of its external definitions. Two objects linked together
+cannot define the same external name, so their suffixes differ even when
+they come from the same path in different directories.
+*/
+static unsigned long long module_key(LLVMModuleRef module, unsigned serial) {
+    size_t len;
+    const char *id = LLVMGetModuleIdentifier(module, &len);
+    unsigned long long key = fnv1a(14695981039346656037ULL, id, len);
+    key = fnv1a(key, (const char *)&serial, sizeof(serial));
+    for (LLVMValueRef fn = LLVMGetFirstFunction(module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        if (!LLVMIsDeclaration(fn) && !is_local(fn)) {
+            const char *name = LLVMGetValueName2(fn, &len);
+            key = fnv1a(key, name, len + 1); // Con el '\0': "ab","c" no es "a","bc"
+        }
+    }
+    for (LLVMValueRef g = LLVMGetFirstGlobal(module); g != NULL; g = LLVMGetNextGlobal(g)) {
+        if (!LLVMIsDeclaration(g) && !is_local(g)) {
+            const char *name = LLVMGetValueName2(g, &len);
+            key = fnv1a(key, name, len + 1);
+        }
+    }
+    return key;
+}
+
+int partition_emit(LLVMModuleRef module, char **objects, int n, const codegen_options *opts) {
+    // Nombres únicos entre los módulos de un mismo proceso y entre archivos
+    static unsigned serial = 0;
+    unsigned long long key = module_key(module, serial++);
+    for (LLVMValueRef fn = LLVMGetFirstFunction(module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        if (!LLVMIsDeclaration(fn) && is_local(fn)) {
+            externalize(fn, key);
+        }
+    }
+    for (LLVMValueRef g = LLVMGetFirstGlobal(module); g != NULL; g = LLVMGetNextGlobal(g)) {
+        if (!LLVMIsDeclaration(g) && is_local(g)) {
+            externalize(g, key);
+        }
+    }
+
+    // Reparto greedy: cada función, de la más grande a la más chica, a la partición con menos instrucciones
+    int nfuncs = defined_functions(module);
+    int *owner = calloc(nfuncs > 0 ? nfuncs : 1, sizeof(int));
+    function_size *sizes = calloc(nfuncs > 0 ? nfuncs : 1, sizeof(function_size));
+    unsigned long long *load = calloc(n, sizeof(unsigned long long));
+    LLVMValueRef *pinned = calloc(nfuncs > 0 ? nfuncs : 1, sizeof(LLVMValueRef));
+    int npinned = 0;
+    for (LLVMValueRef g = LLVMGetFirstGlobal(module); g != NULL; g = LLVMGetNextGlobal(g)) {
+        if (LLVMGetInitializer(g) != NULL) {
+            find_block_addresses(LLVMGetInitializer(g), pinned, &npinned, nfuncs);
+        }
+    }
+    int i = 0, nsized = 0;
+    for (LLVMValueRef fn = LLVMGetFirstFunction(module); fn != NULL; fn = LLVMGetNextFunction(fn)) {
+        if (LLVMIsDeclaration(fn)) {
+            continue;
+        }
+        int pin = 0;
+        for (int k = 0; k < npinned && !pin; k++) {
+            pin = pinned[k] == fn;
+        }
+        if (pin) {
+            owner[i] = 0;
+            load[0] += instruction_count(fn) + 1;
+        } else {
+            sizes[nsized++] = (function_size){ instruction_count(fn), i };
+        }
+        i++;
+    }
+    qsort(sizes, nsized, sizeof(function_size), by_size_desc);
+    for (i = 0; i < nsized; i++) {
+        int best = 0;
+        for (int p = 1; p < n; p++) {
+            if (load[p] < load[best]) {
+                best = p;
+            }
+        }
+        owner[sizes[i].index] = best;
+        load[best] += sizes[i].size + 1;
+    }
+
+    LLVMMemoryBufferRef bitcode = LLVMWriteBitcodeToMemoryBuffer(module);
+    LLVMDisposeModule(module);
+
+    partition_job *jobs = calloc(n, sizeof(partition_job));
+    pthread_t *threads = calloc(n, sizeof(pthread_t));
+    char *started = calloc(n, 1);
+    for (int p = 0; p < n; p++) {
+        jobs[p] = (partition_job){ LLVMGetBufferStart(bitcode), LLVMGetBufferSize(bitcode), owner, p,
+                                   objects[p], opts->opt_level, opts->no_pie, 1 };
+    }
+    // La partición 0 se emite en este hilo
+    for (int p = 1; p < n; p++) {
+        started[p] = pthread_create(&threads[p], NULL, emit_partition, &jobs[p]) == 0;
+        if (!started[p]) {
+            emit_partition(&jobs[p]); // Sin hilo disponible se emite aquí mismo
+        }
+    }
+    emit_partition(&jobs[0]);
+    int failed = jobs[0].failed;
+    for (int p = 1; p < n; p++) {
+        if (started[p]) {
+            pthread_join(threads[p], NULL);
+        }
+        failed |= jobs[p].failed;
+    }
+
+    LLVMDisposeMemoryBuffer(bitcode);
+    free(jobs);
+    free(threads);
+    free(started);
+    free(owner);
+    free(sizes);
+    free(pinned);
+    free(load);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,22 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <llvm-c/Core.h>
+#include "codegen.h"
+
+/*
+Parallel backend code generation, driven by main.c for -j. An optimized
+module is split into partitions of functions balanced by instruction
+count. Each partition is emitted to its own object file on its own
+thread, with its own LLVMContext and TargetMachine, and the objects are
+linked together afterwards. Symbols with internal linkage become hidden
+globals with a unique name so the partitions can reference each other.
+*/
+
+// Number of partitions worth making for at most jobs threads (1 = emit normally)
+int partition_count(LLVMModuleRef module, int jobs);
+
+// Emits the module as n objects in parallel and disposes it; 0 on success
+int partition_emit(LLVMModuleRef module, char **objects, int n, const codegen_options *opts);
+
+#endif // PARTITION_H
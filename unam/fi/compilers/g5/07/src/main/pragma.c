@@ -0,0 +1,267 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pragma.h"
+
+// Cursor over the text of the pragma; words are identifiers or numbers, anything else one character
+typedef struct pragma_scanner {
+    const char *p, *end;
+} pragma_scanner;
+
+static void skip_spaces(pragma_scanner *s) {
+    while (s->p < s->end && isspace((unsigned char)*s->p)) {
+        s->p++;
+    }
+}
+
+static int at_end(pragma_scanner *s) {
+    skip_spaces(s);
+    return s->p >= s->end;
+}
+
+// Next word into out (truncated to size); 0 if the next thing is not a word
+static int next_word(pragma_scanner *s, char *out, int size) {
+    skip_spaces(s);
+    const char *start = s->p;
+    while (s->p < s->end && (isalnum((unsigned char)*s->p) || *s->p == '_')) {
+        s->p++;
+    }
+    int len = (int)(s->p - start);
+    if (len == 0) {
+        return 0;
+    }
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return 1;
+}
+
+static int accept(pragma_scanner *s, const char *punct) {
+    skip_spaces(s);
+    size_t n = strlen(punct);
+    if ((size_t)(s->end - s->p) >= n && strncmp(s->p, punct, n) == 0) {
+        s->p += n;
+        return 1;
+    }
+    return 0;
+}
+
+static int fail(pragma_info *info, const char *msg) {
+    snprintf(info->error, sizeof(info->error), "%s", msg);
+    return 0;
+}
+
+// schedule(static|dynamic[, chunk])
+static int parse_schedule(pragma_scanner *s, pragma_info *info) {
+    char word[PRAGMA_MAX_NAME];
+    if (!accept(s, "(") || !next_word(s, word, sizeof(word))) {
+        return fail(info, "schedule necesita (static) o (dynamic)");
+    }
+    if (strcmp(word, "static") == 0) {
+        info->schedule = PRAGMA_SCHEDULE_STATIC;
+    } else if (strcmp(word, "dynamic") == 0) {
+        info->schedule = PRAGMA_SCHEDULE_DYNAMIC;
+    } else {
+        return fail(info, "sólo se admiten schedule(static) y schedule(dynamic)");
+    }
+    if (accept(s, ",")) {
+        char *tail;
+        if (!next_word(s, word, sizeof(word)) || (info->chunk = strtol(word, &tail, 10)) <= 0 || *tail) {
+            return fail(info, "el tamaño de bloque de schedule debe ser un entero positivo");
+        }
+    }
+    return accept(s, ")") ? 1 : fail(info, "falta ) en schedule");
+}
+
+// reduction(op: a, b, ...)
+static int parse_reduction(pragma_scanner *s, pragma_info *info) {
+    static const struct {
+        const char *text;
+        pragma_reduction_op op;
+    } ops[] = {
+        { "&&", PRAGMA_RED_LAND }, { "||", PRAGMA_RED_LOR }, { "+", PRAGMA_RED_ADD }, { "-", PRAGMA_RED_ADD },
+        { "*", PRAGMA_RED_MUL },   { "&", PRAGMA_RED_BAND }, { "|", PRAGMA_RED_BOR }, { "^", PRAGMA_RED_BXOR },
+        { "max", PRAGMA_RED_MAX }, { "min", PRAGMA_RED_MIN },
+    };
+    if (!accept(s, "(")) {
+        return fail(info, "reduction necesita (operador: variables)");
+    }
+    int found = -1;
+    for (int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])) && found < 0; i++) {
+        if (accept(s, ops[i].text)) {
+            found = i;
+        }
+    }
+    if (found < 0 || !accept(s, ":")) {
+        return fail(info, "operador de reduction no soportado");
+    }
+    do {
+        if (info->nreductions == PRAGMA_MAX_REDUCTIONS) {
+            return fail(info, "demasiadas variables en reduction");
+        }
+        pragma_reduction *r = &info->reductions[info->nreductions];
+        if (!next_word(s, r->name, sizeof(r->name)) || isdigit((unsigned char)r->name[0])) {
+            return fail(info, "reduction espera nombres de variables");
+        }
+        r->op = ops[found].op;
+        info->nreductions++;
+    } while (accept(s, ","));
+    return accept(s, ")") ? 1 : fail(info, "falta ) en reduction");
+}
+
+// A positive integer, alone or between parentheses; 0 if there is none
+static int parse_count(pragma_scanner *s, int *value) {
+    char word[PRAGMA_MAX_NAME];
+    char *tail;
+    int paren = accept(s, "(");
+    if (!next_word(s, word, sizeof(word)) || (*value = (int)strtol(word, &tail, 10)) < 0 || *tail) {
+        return 0;
+    }
+    return !paren || accept(s, ")");
+}
+
+// unroll [N]: N <= 1 turns unrolling off; without N the unroller decides how much
+static int parse_unroll(pragma_scanner *s, pragma_info *info, int needs_count) {
+    int n;
+    if (at_end(s) && !needs_count) {
+        info->loop.unroll = PRAGMA_HINT_ENABLE;
+        return 1;
+    }
+    if (!parse_count(s, &n)) {
+        return fail(info, "unroll espera un número de copias");
+    }
+    if (n <= 1) {
+        info->loop.unroll = PRAGMA_HINT_DISABLE;
+    } else {
+        info->loop.unroll_count = n;
+    }
+    return 1;
+}
+
+// clang loop option(value) ...
+static int parse_clang_loop(pragma_scanner *s, pragma_info *info) {
+    pragma_loop_hints *h = &info->loop;
+    char option[PRAGMA_MAX_NAME], value[PRAGMA_MAX_NAME];
+    while (!at_end(s)) {
+        if (!next_word(s, option, sizeof(option))) {
+            return fail(info, "se esperaba una opción de clang loop");
+        }
+        int *state = NULL, *count = NULL;
+        if (strcmp(option, "vectorize") == 0) state = &h->vectorize;
+        else if (strcmp(option, "interleave") == 0) state = &h->interleave;
+        else if (strcmp(option, "unroll") == 0) state = &h->unroll;
+        else if (strcmp(option, "vectorize_width") == 0) count = &h->vectorize_width;
+        else if (strcmp(option, "interleave_count") == 0) count = &h->interleave_count;
+        else if (strcmp(option, "unroll_count") == 0) count = &h->unroll_count;
+        else {
+            snprintf(info->error, sizeof(info->error), "opción '%s' de clang loop no soportada", option);
+            return 0;
+        }
+        if (count) {
+            if (!accept(s, "(") || !parse_count(s, count) || *count == 0 || !accept(s, ")")) {
+                snprintf(info->error, sizeof(info->error), "%s espera un entero positivo entre paréntesis", option);
+                return 0;
+            }
+            continue;
+        }
+        if (!accept(s, "(") || !next_word(s, value, sizeof(value)) || !accept(s, ")")) {
+            snprintf(info->error, sizeof(info->error), "%s espera (enable) o (disable)", option);
+            return 0;
+        }
+        if (strcmp(value, "enable") == 0) {
+            *state = PRAGMA_HINT_ENABLE;
+        } else if (strcmp(value, "disable") == 0) {
+            *state = PRAGMA_HINT_DISABLE;
+        } else if (strcmp(value, "full") == 0 && state == &h->unroll) {
+            *state = PRAGMA_HINT_FULL;
+        } else if (strcmp(value, "assume_safety") == 0 && state == &h->vectorize) {
+            *state = PRAGMA_HINT_ENABLE; // Como en clang: vectorizar sin comprobar dependencias
+            h->ivdep = 1;
+        } else {
+            snprintf(info->error, sizeof(info->error), "valor '%s' no válido para %s", value, option);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int parse_omp(pragma_scanner *s, pragma_info *info) {
+    char word[PRAGMA_MAX_NAME];
+    char w1[PRAGMA_MAX_NAME], w2[PRAGMA_MAX_NAME];
+    if (!next_word(s, w1, sizeof(w1)) || !next_word(s, w2, sizeof(w2)) ||
+        strcmp(w1, "parallel") != 0 || strcmp(w2, "for") != 0) {
+        return 1;
+    }
+    info->kind = PRAGMA_OMP_PARALLEL_FOR;
+    info->schedule = PRAGMA_SCHEDULE_STATIC;
+
+    while (!at_end(s)) {
+        accept(s, ","); // Las cláusulas pueden separarse con comas
+        if (!next_word(s, word, sizeof(word))) {
+            return fail(info, "se esperaba una cláusula");
+        }
+        if (strcmp(word, "schedule") == 0) {
+            if (!parse_schedule(s, info)) return 0;
+        } else if (strcmp(word, "reduction") == 0) {
+            if (!parse_reduction(s, info)) return 0;
+        } else {
+            snprintf(info->error, sizeof(info->error), "cláusula '%s' no soportada", word);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int pragma_parse(const char *text, int len, pragma_info *info) {
+    memset(info, 0, sizeof(*info));
+    info->kind = PRAGMA_UNKNOWN;
+    pragma_scanner s = { text, text + len };
+    char word[PRAGMA_MAX_NAME];
+
+    if (!next_word(&s, word, sizeof(word))) {
+        return 1;
+    }
+    if (strcmp(word, "omp") == 0) {
+        return parse_omp(&s, info);
+    }
+    // GCC unroll N y GCC ivdep son los de siempre con otro nombre; ahí N es obligatorio
+    int gcc = strcmp(word, "GCC") == 0;
+    if (gcc && !next_word(&s, word, sizeof(word))) {
+        return 1;
+    }
+    if (strcmp(word, "clang") == 0) {
+        if (!next_word(&s, word, sizeof(word)) || strcmp(word, "loop") != 0) {
+            return 1;
+        }
+        info->kind = PRAGMA_LOOP;
+        return parse_clang_loop(&s, info);
+    }
+
+    info->kind = PRAGMA_LOOP;
+    if (strcmp(word, "unroll") == 0) {
+        if (!parse_unroll(&s, info, gcc)) return 0;
+    } else if (strcmp(word, "nounroll") == 0) {
+        info->loop.unroll = PRAGMA_HINT_DISABLE;
+    } else if (strcmp(word, "ivdep") == 0) {
+        info->loop.ivdep = 1;
+    } else {
+        info->kind = PRAGMA_UNKNOWN;
+        return 1;
+    }
+    return at_end(&s) ? 1 : fail(info, "texto de más al final");
+}
+
+void pragma_merge_hints(pragma_loop_hints *into, const pragma_loop_hints *from) {
+    if (from->unroll || from->unroll_count) {
+        into->unroll = from->unroll;
+        into->unroll_count = from->unroll_count;
+    }
+    if (from->vectorize) into->vectorize = from->vectorize;
+    if (from->vectorize_width) into->vectorize_width = from->vectorize_width;
+    if (from->interleave) into->interleave = from->interleave;
+    if (from->interleave_count) into->interleave_count = from->interleave_count;
+    if (from->ivdep) into->ivdep = 1;
+}
@@ -0,0 +1,70 @@
+#ifndef PRAGMA_H
+#define PRAGMA_H
+
+/*
+#pragma directives in front of a statement. The lexer hands the text
+after "pragma" to the parser as a T_PRAGMA token for the directives the
+compiler knows (see lexer.c); every other # line is still skipped.
+codegen.c parses that text here when it reaches the statement.
+*/
+
+typedef enum {
+    PRAGMA_UNKNOWN,          // Known namespace, unsupported directive: ignored with a warning
+    PRAGMA_OMP_PARALLEL_FOR, // #pragma omp parallel for [schedule(...)] [reduction(...)]
+    PRAGMA_LOOP              // unroll, nounroll, ivdep, GCC unroll/ivdep, clang loop: hints in info->loop
+} pragma_kind;
+
+// Values of the enable/disable fields of pragma_loop_hints; 0 means the pragma does not say
+#define PRAGMA_HINT_ENABLE 1
+#define PRAGMA_HINT_DISABLE 2
+#define PRAGMA_HINT_FULL 3 // unroll only
+
+// What the pragmas in front of a loop ask for; codegen.c turns it into llvm.loop metadata
+typedef struct pragma_loop_hints {
+    int unroll, unroll_count;
+    int vectorize, vectorize_width;
+    int interleave, interleave_count;
+    int ivdep; // The iterations do not depend on each other through memory
+} pragma_loop_hints;
+
+// Same values as FREEZEPILER_SCHEDULE_* in src/runtime/freezepiler_rt.h
+#define PRAGMA_SCHEDULE_STATIC 0
+#define PRAGMA_SCHEDULE_DYNAMIC 1
+
+typedef enum {
+    PRAGMA_RED_ADD, // + and -: partial sums are added in both cases
+    PRAGMA_RED_MUL,
+    PRAGMA_RED_BAND,
+    PRAGMA_RED_BOR,
+    PRAGMA_RED_BXOR,
+    PRAGMA_RED_LAND,
+    PRAGMA_RED_LOR,
+    PRAGMA_RED_MAX,
+    PRAGMA_RED_MIN
+} pragma_reduction_op;
+
+#define PRAGMA_MAX_REDUCTIONS 16
+#define PRAGMA_MAX_NAME 64
+
+typedef struct pragma_reduction {
+    pragma_reduction_op op;
+    char name[PRAGMA_MAX_NAME];
+} pragma_reduction;
+
+typedef struct pragma_info {
+    pragma_kind kind;
+    int schedule;
+    long chunk; // 0: the schedule's default
+    int nreductions;
+    pragma_reduction reductions[PRAGMA_MAX_REDUCTIONS];
+    pragma_loop_hints loop;
+    char error[192]; // Why pragma_parse failed
+} pragma_info;
+
+// Parses the text of a T_PRAGMA token; 0 with info->error set if a clause is malformed
+int pragma_parse(const char *text, int len, pragma_info *info);
+
+// Adds the hints of a later pragma for the same loop: what it sets replaces what was there
+void pragma_merge_hints(pragma_loop_hints *into, const pragma_loop_hints *from);
+
+#endif // PRAGMA_H
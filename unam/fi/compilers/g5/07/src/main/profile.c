@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+typedef struct profile_record {
+    char *name;
+    uint64_t hash;
+    unsigned n;
+    uint64_t *counts;
+    struct profile_record *next;
+} profile_record;
+
+struct profile_data {
+    profile_record *records;
+};
+
+static profile_record *find_record(const profile_data *profile, const char *name, uint64_t hash, unsigned n) {
+    for (profile_record *r = profile->records; r != NULL; r = r->next) {
+        if (r->hash == hash && r->n == n && strcmp(r->name, name) == 0) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+profile_data *profile_load(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "ERROR: Unable to open profile %s\n", path);
+        return NULL;
+    }
+
+    profile_data *profile = calloc(1, sizeof(profile_data));
+    char name[512];
+    unsigned long long hash;
+    unsigned n;
+    int line = 0;
+    // Una línea por función y ejecución; las ejecuciones repetidas se suman
+    while (fscanf(fp, "%511s %llu %u", name, &hash, &n) == 3) {
+        line++;
+        profile_record *r = find_record(profile, name, hash, n);
+        if (r == NULL) {
+            r = calloc(1, sizeof(profile_record));
+            r->name = strdup(name);
+            r->hash = hash;
+            r->n = n;
+            r->counts = calloc(n ? n : 1, sizeof(uint64_t));
+            r->next = profile->records;
+            profile->records = r;
+        }
+        for (unsigned i = 0; i < n; i++) {
+            unsigned long long c;
+            if (fscanf(fp, "%llu", &c) != 1) {
+                fprintf(stderr, "ERROR: Truncated record for %s in profile %s (line %d)\n", name, path, line);
+                fclose(fp);
+                profile_free(profile);
+                return NULL;
+            }
+            r->counts[i] += c;
+        }
+    }
+    if (!feof(fp)) {
+        fprintf(stderr, "ERROR: Malformed profile %s (line %d)\n", path, line + 1);
+        fclose(fp);
+        profile_free(profile);
+        return NULL;
+    }
+    fclose(fp);
+    return profile;
+}
+
+const uint64_t *profile_lookup(const profile_data *profile, const char *name, uint64_t hash, unsigned *n) {
+    for (profile_record *r = profile ? profile->records : NULL; r != NULL; r = r->next) {
+        if (r->hash == hash && strcmp(r->name, name) == 0) {
+            *n = r->n;
+            return r->counts;
+        }
+    }
+    return NULL;
+}
+
+void profile_free(profile_data *profile) {
+    if (profile == NULL) {
+        return;
+    }
+    profile_record *r = profile->records;
+    while (r != NULL) {
+        profile_record *next = r->next;
+        free(r->name);
+        free(r->counts);
+        free(r);
+        r = next;
+    }
+    free(profile);
+}
+
+// FNV-1a over the node kinds in preorder: any change to the control flow changes the hash
+static int hash_node(struct ast_node *node, int depth, void *data) {
+    uint64_t *h = data;
+    (void)depth;
+    *h ^= (uint64_t)node->type + 1;
+    *h *= 1099511628211ULL;
+    return 0;
+}
+
+uint64_t profile_function_hash(const struct ast_node *body) {
+    if (body == NULL) {
+        return 0;
+    }
+    // Sólo el cuerpo, no sus hermanos
+    uint64_t h = 14695981039346656037ULL;
+    ast_preorder((struct ast_node *)body, hash_node, &h);
+    return h;
+}
@@ -0,0 +1,34 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "ast.h"
+
+/*
+Profile-guided optimization, used by codegen.c. With -fprofile-generate
+every function counts its entries and the outcomes of its if, loop and
+switch conditions, and the program appends one line per function to a
+text profile when it exits:
+
+    <function> <structural hash> <n counters> <count>...
+
+Later runs append more lines, which -fprofile-use sums up. A function
+whose hash no longer matches its source is compiled without profile.
+*/
+
+#define PROFILE_DEFAULT_PATH "freezepiler.prof"
+
+typedef struct profile_data profile_data;
+
+// Reads a profile written by an instrumented program; NULL on error
+profile_data *profile_load(const char *path);
+
+// Counters recorded for a function with this hash, or NULL; *n receives their number
+const uint64_t *profile_lookup(const profile_data *profile, const char *name, uint64_t hash, unsigned *n);
+
+void profile_free(profile_data *profile);
+
+// Hash of the shape of a function body, to detect profiles made from other source
+uint64_t profile_function_hash(const struct ast_node *body);
+
+#endif // PROFILE_H
@@ -0,0 +1,743 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ast.h"
+#include "simplify.h"
+#include "consteval.h"
+#include "lexer.h"
+#include "stackguard.h"
+#include "parser.tab.h"
+
+/*
+AST simplification pass.
+Integer folding follows the semantics of the generated code: 32-bit
+two's complement with wraparound, arithmetic shift right. Operations
+whose result is undefined (division by zero, INT_MIN / -1, shifts by
+32 or more) are left for runtime. Identities are only applied when both
+operands are known to be integers, so float code keeps its rounding.
+*/
+
+typedef enum {
+    KIND_UNKNOWN,
+    KIND_INT,
+    KIND_FLOAT
+} value_kind;
+
+// Names visible at the current point: variables, parameters and functions
+typedef struct scope_entry {
+    const char *name;
+    value_kind kind;
+    int has_value; // const initialized with an integer constant
+    int value;
+    int owned;     // name is a copy (file scope names outlive their AST with -fstreaming)
+} scope_entry;
+
+static scope_entry *scope = NULL;
+static int scope_len = 0;
+static int scope_cap = 0;
+
+static void scope_push(const char *name, value_kind kind, int has_value, int value) {
+    if (name == NULL) {
+        return;
+    }
+    if (scope_len == scope_cap) {
+        scope_cap = scope_cap ? scope_cap * 2 : 64;
+        scope = realloc(scope, sizeof(scope_entry) * scope_cap);
+        if (scope == NULL) {
+            fprintf(stderr, "Fatal Error: realloc failed in simplify scope\n");
+            exit(1);
+        }
+    }
+    scope[scope_len].name = name;
+    scope[scope_len].kind = kind;
+    scope[scope_len].has_value = has_value;
+    scope[scope_len].value = value;
+    scope[scope_len].owned = 0;
+    scope_len++;
+}
+
+static scope_entry *scope_lookup(const char *name) {
+    if (name == NULL) {
+        return NULL;
+    }
+    // Innermost declarations are at the end, so they shadow outer ones
+    for (int i = scope_len - 1; i >= 0; i--) {
+        if (strcmp(scope[i].name, name) == 0) {
+            return &scope[i];
+        }
+    }
+    return NULL;
+}
+
+static value_kind kind_of_type(struct ast_node *tipo) {
+    if (tipo == NULL || tipo->type != NT_TIPO || ast_vector_size(tipo) > 0) {
+        return KIND_UNKNOWN;
+    }
+    switch (tipo->value.intVal) {
+        case T_FLOAT:
+        case T_DOUBLE:
+            return KIND_FLOAT;
+        case T_VOID:
+        case T_STRUCT:
+        case T_UNION:
+            return KIND_UNKNOWN;
+        default:
+            return KIND_INT;
+    }
+}
+
+/* --- Node rewriting helpers --- */
+
+// Turns node into an integer literal, keeping its place among its siblings
+static void replace_with_int(struct ast_node *node, int value) {
+    node->type = NT_ENTERO;
+    node->child = NULL;
+    node->value.lit = (int_lit){ value, 0, 0 };
+}
+
+// Copies src over node, keeping node's place among its siblings
+static void replace_with_node(struct ast_node *node, struct ast_node *src) {
+    struct ast_node *sibling = node->sibling;
+    *node = *src;
+    node->sibling = sibling;
+}
+
+// A loop, or the pragmas in front of one
+static int is_loop_stmt(struct ast_node *node) {
+    return node && (node->type == NT_FOR || node->type == NT_WHILE || node->type == NT_DO_WHILE || node->type == NT_PRAGMA);
+}
+
+// Turns node into an empty statement
+static void replace_with_empty(struct ast_node *node) {
+    node->type = NT_EXPR_SENTENCIA;
+    node->child = NULL;
+}
+
+// Integer value of a literal (int or single-character char literal, escapes included)
+static int const_int_value(struct ast_node *node, int *value) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (ast_int_literal(node, value)) {
+        return 1;
+    }
+    if (node->type == NT_CARACTER && node->value.span.len > 0 && node->value.span.len <= 8) {
+        char c[9];
+        if (decode_literal(node->value.span.ptr, node->value.span.len, c) == 1) {
+            *value = (signed char)c[0];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int is_assignment_op(int op) {
+    switch (op) {
+        case T_ASSIGN: case T_ASSIGN_PLUS: case T_ASSIGN_MINUS: case T_ASSIGN_STAR:
+        case T_ASSIGN_SLASH: case T_ASSIGN_PERCENT: case T_ASSIGN_LSHIFT:
+        case T_ASSIGN_RSHIFT: case T_ASSIGN_AND: case T_ASSIGN_OR: case T_ASSIGN_XOR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int is_side_effect(struct ast_node *node, int depth, void *data) {
+    (void)depth;
+    (void)data;
+    return node->type == NT_LLAMADA_FUNCION ||
+           (node->type == NT_OP_BINARIO && is_assignment_op(node->value.op)) ||
+           (node->type == NT_OP_UNARIO && (node->value.op == T_INC || node->value.op == T_DEC));
+}
+
+static int has_side_effects(struct ast_node *node) {
+    return ast_preorder(node, is_side_effect, NULL) != NULL;
+}
+
+static int is_jump_target(struct ast_node *node, int depth, void *data) {
+    (void)depth;
+    (void)data;
+    return node->type == NT_ETIQUETA || node->type == NT_CASE || node->type == NT_DEFAULT;
+}
+
+// A subtree can only be discarded if nothing jumps into it
+static int can_prune(struct ast_node *node) {
+    return ast_preorder(node, is_jump_target, NULL) == NULL;
+}
+
+// Returns k if value == 2^k (k >= 1), -1 otherwise
+static int log2_exact(int value) {
+    if (value <= 1 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    int k = 0;
+    while ((value >> k) != 1) {
+        k++;
+    }
+    return k;
+}
+
+/* --- Constant folding --- */
+
+int simplify_fold_binary(int op, int a, int b, int *result) {
+    uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+    switch (op) {
+        case T_PLUS:      *result = (int)(ua + ub); return 1;
+        case T_MINUS:     *result = (int)(ua - ub); return 1;
+        case T_STAR:      *result = (int)(ua * ub); return 1;
+        case T_SLASH:
+        case T_PERCENT:
+            if (b == 0 || (a == INT32_MIN && b == -1)) {
+                return 0;
+            }
+            *result = op == T_SLASH ? a / b : a % b;
+            return 1;
+        case T_LSHIFT:
+            if (b < 0 || b >= 32) {
+                return 0;
+            }
+            *result = (int)(ua << b);
+            return 1;
+        case T_RSHIFT:
+            if (b < 0 || b >= 32) {
+                return 0;
+            }
+            *result = a >> b;
+            return 1;
+        case T_AMPERSAND: *result = a & b; return 1;
+        case T_PIPE:      *result = a | b; return 1;
+        case T_CARET:     *result = a ^ b; return 1;
+        case T_EQ:        *result = a == b; return 1;
+        case T_NEQ:       *result = a != b; return 1;
+        case T_LT:        *result = a < b; return 1;
+        case T_LE:        *result = a <= b; return 1;
+        case T_GT:        *result = a > b; return 1;
+        case T_GE:        *result = a >= b; return 1;
+        case T_AND:       *result = a && b; return 1;
+        case T_OR:        *result = a || b; return 1;
+        default:
+            return 0;
+    }
+}
+
+static value_kind simplify_expr(struct ast_node *expr);
+static void simplify_stmt(struct ast_node *stmt);
+
+// Deeply nested code continues on another stack segment (see stackguard.h)
+typedef struct deep_call {
+    struct ast_node *node;
+    value_kind kind;
+} deep_call;
+
+static void simplify_expr_deep(void *data) {
+    deep_call *call = data;
+    call->kind = simplify_expr(call->node);
+}
+
+static void simplify_stmt_deep(void *data) {
+    deep_call *call = data;
+    simplify_stmt(call->node);
+}
+
+// Simplifies inside an lvalue without replacing the variable itself
+static value_kind simplify_lvalue(struct ast_node *lv) {
+    if (lv == NULL) {
+        return KIND_UNKNOWN;
+    }
+    if (lv->type == NT_ID || lv->type == NT_VAR) {
+        scope_entry *e = scope_lookup(lv->value.strVal);
+        return e ? e->kind : KIND_UNKNOWN;
+    }
+    if (lv->type == NT_ACCESO_ARRAY) {
+        simplify_lvalue(lv->child);
+        if (lv->child) {
+            simplify_expr(lv->child->sibling);
+        }
+        return KIND_UNKNOWN;
+    }
+    return simplify_expr(lv);
+}
+
+// x op identity -> x (and x*2^k -> x<<k) when both sides are integers
+static void simplify_identity(struct ast_node *expr, value_kind lk, value_kind rk) {
+    struct ast_node *L = expr->child;
+    struct ast_node *R = L->sibling;
+    int op = expr->value.op;
+    int lc, rc;
+    int l_const = const_int_value(L, &lc);
+    int r_const = const_int_value(R, &rc);
+
+    if (lk != KIND_INT || rk != KIND_INT) {
+        return;
+    }
+
+    if (r_const) {
+        if ((rc == 0 && (op == T_PLUS || op == T_MINUS || op == T_PIPE || op == T_CARET ||
+                         op == T_LSHIFT || op == T_RSHIFT)) ||
+            (rc == 1 && (op == T_STAR || op == T_SLASH))) {
+            replace_with_node(expr, L);
+            return;
+        }
+    }
+    if (l_const) {
+        if ((lc == 0 && (op == T_PLUS || op == T_PIPE || op == T_CARET)) ||
+            (lc == 1 && op == T_STAR)) {
+            replace_with_node(expr, R);
+            return;
+        }
+    }
+    if (op == T_STAR && ((r_const && rc == 0 && !has_side_effects(L)) ||
+                         (l_const && lc == 0 && !has_side_effects(R)))) {
+        replace_with_int(expr, 0);
+        return;
+    }
+    if (op == T_STAR) {
+        int k = r_const ? log2_exact(rc) : (l_const ? log2_exact(lc) : -1);
+        if (k > 0) {
+            struct ast_node *x = r_const ? L : R;
+            struct ast_node *c = r_const ? R : L;
+            replace_with_int(c, k);
+            expr->value.op = T_LSHIFT;
+            expr->child = x;
+            x->sibling = c;
+            c->sibling = NULL;
+        }
+    }
+}
+
+static value_kind simplify_expr(struct ast_node *expr) {
+    if (expr == NULL) {
+        return KIND_UNKNOWN;
+    }
+    if (stack_low()) {
+        deep_call call = { expr, KIND_UNKNOWN };
+        stack_extend(simplify_expr_deep, &call);
+        return call.kind;
+    }
+
+    switch (expr->type) {
+        case NT_ENTERO:
+        case NT_CARACTER:
+            return KIND_INT;
+
+        case NT_FLOTANTE:
+            return KIND_FLOAT;
+
+        case NT_ID:
+        case NT_VAR: {
+            scope_entry *e = scope_lookup(expr->value.strVal);
+            if (e == NULL) {
+                return KIND_UNKNOWN;
+            }
+            if (e->has_value) {
+                replace_with_int(expr, e->value);
+            }
+            return e->kind;
+        }
+
+        case NT_EXPR_SENTENCIA:
+            return simplify_expr(expr->child);
+
+        case NT_OP_UNARIO: {
+            int op = expr->value.op;
+            if (op == T_INC || op == T_DEC || op == T_AMPERSAND) {
+                return simplify_lvalue(expr->child);
+            }
+            if (op == T_SIZEOF) {
+                return KIND_INT;
+            }
+            if (op == T_AND) { // &&label: the child is a label, not a variable
+                return KIND_UNKNOWN;
+            }
+            value_kind k = simplify_expr(expr->child);
+            int v;
+            if (const_int_value(expr->child, &v)) {
+                if (op == T_MINUS) {
+                    replace_with_int(expr, (int)(0u - (uint32_t)v));
+                    return KIND_INT;
+                }
+                if (op == T_NOT) {
+                    replace_with_int(expr, !v);
+                    return KIND_INT;
+                }
+                if (op == T_TILDE) {
+                    replace_with_int(expr, ~v);
+                    return KIND_INT;
+                }
+            }
+            return op == T_NOT ? KIND_INT : k;
+        }
+
+        case NT_OP_BINARIO: {
+            int op = expr->value.op;
+            struct ast_node *L = expr->child;
+            struct ast_node *R = L ? L->sibling : NULL;
+            if (L == NULL || R == NULL) {
+                return KIND_UNKNOWN;
+            }
+            if (is_assignment_op(op)) {
+                value_kind lk = simplify_lvalue(L);
+                simplify_expr(R);
+                return lk;
+            }
+
+            value_kind lk = simplify_expr(L);
+            value_kind rk = simplify_expr(R);
+            int lc, rc, result;
+            int l_const = const_int_value(L, &lc);
+            int r_const = const_int_value(R, &rc);
+
+            if (l_const && r_const && simplify_fold_binary(op, lc, rc, &result)) {
+                replace_with_int(expr, result);
+                return KIND_INT;
+            }
+
+            // A constant left operand decides && and || without evaluating the right one
+            if ((op == T_AND || op == T_OR) && l_const) {
+                if ((op == T_AND && lc == 0) || (op == T_OR && lc != 0)) {
+                    replace_with_int(expr, op == T_OR);
+                    return KIND_INT;
+                }
+            }
+
+            switch (op) {
+                case T_EQ: case T_NEQ: case T_LT: case T_LE: case T_GT: case T_GE:
+                case T_AND: case T_OR:
+                    return KIND_INT;
+                default:
+                    break;
+            }
+            simplify_identity(expr, lk, rk);
+            if (lk == KIND_FLOAT || rk == KIND_FLOAT) {
+                return KIND_FLOAT;
+            }
+            return (lk == KIND_INT && rk == KIND_INT) ? KIND_INT : KIND_UNKNOWN;
+        }
+
+        case NT_TERNARIO: {
+            struct ast_node *cond = expr->child;
+            struct ast_node *then_e = cond ? cond->sibling : NULL;
+            struct ast_node *else_e = then_e ? then_e->sibling : NULL;
+            if (cond == NULL || then_e == NULL || else_e == NULL) {
+                return KIND_UNKNOWN;
+            }
+            simplify_expr(cond);
+            int c;
+            if (const_int_value(cond, &c)) {
+                replace_with_node(expr, c ? then_e : else_e);
+                return simplify_expr(expr);
+            }
+            value_kind tk = simplify_expr(then_e);
+            value_kind ek = simplify_expr(else_e);
+            return tk == ek ? tk : KIND_UNKNOWN;
+        }
+
+        case NT_LLAMADA_FUNCION: {
+            struct ast_node *fn = expr->child;
+            if (fn == NULL) {
+                return KIND_UNKNOWN;
+            }
+            int args[CONSTEVAL_MAX_PARAMS];
+            int nargs = 0, all_const = 1;
+            for (struct ast_node *arg = fn->sibling; arg != NULL; arg = arg->sibling) {
+                simplify_expr(arg);
+                if (all_const && nargs < CONSTEVAL_MAX_PARAMS && const_int_value(arg, &args[nargs])) {
+                    nargs++;
+                } else {
+                    all_const = 0;
+                }
+            }
+            // A pure function with constant arguments is run now (see consteval.h)
+            int result;
+            if (all_const && fn->type == NT_ID && consteval_call(fn->value.strVal, args, nargs, &result)) {
+                replace_with_int(expr, result);
+                return KIND_INT;
+            }
+            scope_entry *e = scope_lookup(fn->value.strVal);
+            return e ? e->kind : KIND_UNKNOWN;
+        }
+
+        case NT_ACCESO_ARRAY:
+            simplify_lvalue(expr);
+            return KIND_UNKNOWN;
+
+        case NT_LISTA_INIT:
+            for (struct ast_node *item = expr->child; item != NULL; item = item->sibling) {
+                simplify_expr(item);
+            }
+            return KIND_UNKNOWN;
+
+        default:
+            return KIND_UNKNOWN;
+    }
+}
+
+// Folds the dimensions of ARRAY_DECL(VAR, dim1, dim2, ...) and declares the name
+static void simplify_array_decl(struct ast_node *decl) {
+    if (decl->child == NULL) {
+        return;
+    }
+    for (struct ast_node *dim = decl->child->sibling; dim != NULL; dim = dim->sibling) {
+        simplify_expr(dim); // Array sizes
+    }
+    scope_push(decl->child->value.strVal, KIND_UNKNOWN, 0, 0);
+}
+
+static void simplify_declaration(struct ast_node *decl) {
+    struct ast_node *tipo = decl->child;
+    value_kind kind = kind_of_type(tipo);
+    int is_const = ast_type_count(tipo, T_CONST) > 0;
+    // Only plain int constants are propagated: narrower, wider or unsigned
+    // types would need their own wrap-around rules when folded
+    int plain_int = tipo && tipo->value.intVal == T_INT && ast_type_count(tipo, T_UNSIGNED) == 0 &&
+                    ast_vector_size(tipo) == 0;
+
+    for (struct ast_node *cur = tipo ? tipo->sibling : NULL; cur != NULL; cur = cur->sibling) {
+        if (cur->type == NT_VAR || cur->type == NT_ID) {
+            scope_push(cur->value.strVal, kind, 0, 0);
+        } else if (cur->type == NT_ARRAY_DECL) {
+            simplify_array_decl(cur);
+        } else if (cur->type == NT_OP_BINARIO && cur->value.op == T_ASSIGN && cur->child) {
+            struct ast_node *var = cur->child;
+            struct ast_node *init = var->sibling;
+            int v;
+            simplify_expr(init);
+            if (var->type == NT_ARRAY_DECL) { // int t[] = { ... }
+                simplify_array_decl(var);
+                continue;
+            }
+            int known = is_const && plain_int && var->type == NT_VAR && const_int_value(init, &v);
+            scope_push(var->value.strVal, var->type == NT_VAR ? kind : KIND_UNKNOWN, known, known ? v : 0);
+        }
+    }
+}
+
+// Simplifies the statements of a block in their own scope
+static void simplify_block(struct ast_node *block) {
+    int saved_len = scope_len;
+    for (struct ast_node *stmt = block->child; stmt != NULL; stmt = stmt->sibling) {
+        simplify_stmt(stmt);
+    }
+    scope_len = saved_len;
+}
+
+static void simplify_stmt(struct ast_node *stmt) {
+    if (stmt == NULL) {
+        return;
+    }
+    if (stack_low()) {
+        deep_call call = { stmt, KIND_UNKNOWN };
+        stack_extend(simplify_stmt_deep, &call);
+        return;
+    }
+
+    switch (stmt->type) {
+        case NT_DECLARACION:
+            simplify_declaration(stmt);
+            break;
+
+        case NT_BLOQUE:
+            simplify_block(stmt);
+            break;
+
+        case NT_EXPR_SENTENCIA:
+        case NT_RETURN:
+            simplify_expr(stmt->child);
+            break;
+
+        case NT_IF: {
+            struct ast_node *cond = stmt->child;
+            struct ast_node *then_s = cond ? cond->sibling : NULL;
+            struct ast_node *else_s = then_s ? then_s->sibling : NULL;
+            if (cond == NULL || then_s == NULL) {
+                break;
+            }
+            simplify_expr(cond);
+            int c;
+            if (const_int_value(cond, &c) && can_prune(c ? else_s : then_s)) {
+                struct ast_node *kept = c ? then_s : else_s;
+                if (kept) {
+                    kept->sibling = NULL;
+                    replace_with_node(stmt, kept);
+                    simplify_stmt(stmt);
+                } else {
+                    replace_with_empty(stmt);
+                }
+                break;
+            }
+            simplify_stmt(then_s);
+            simplify_stmt(else_s);
+            break;
+        }
+
+        case NT_WHILE: {
+            struct ast_node *cond = stmt->child;
+            if (cond == NULL) {
+                break;
+            }
+            simplify_expr(cond);
+            int c;
+            if (const_int_value(cond, &c) && c == 0 && can_prune(cond->sibling)) {
+                replace_with_empty(stmt);
+                break;
+            }
+            simplify_stmt(cond->sibling);
+            break;
+        }
+
+        case NT_DO_WHILE:
+            simplify_expr(stmt->child);
+            if (stmt->child) {
+                simplify_stmt(stmt->child->sibling);
+            }
+            break;
+
+        case NT_FOR: {
+            struct ast_node *init = stmt->child;
+            struct ast_node *cond = init ? init->sibling : NULL;
+            struct ast_node *inc = cond ? cond->sibling : NULL;
+            struct ast_node *body = inc ? inc->sibling : NULL;
+            if (body == NULL) {
+                break;
+            }
+            simplify_expr(init);
+            simplify_expr(cond);
+            int c;
+            if (const_int_value(cond, &c) && c == 0 && can_prune(body)) {
+                // Only the initialization runs
+                init->sibling = NULL;
+                if (init->type == NT_EXPR_SENTENCIA) {
+                    replace_with_node(stmt, init);
+                } else {
+                    stmt->type = NT_EXPR_SENTENCIA;
+                    stmt->child = init;
+                }
+                break;
+            }
+            simplify_expr(inc);
+            simplify_stmt(body);
+            break;
+        }
+
+        case NT_SWITCH:
+            simplify_expr(stmt->child);
+            if (stmt->child) {
+                simplify_stmt(stmt->child->sibling);
+            }
+            break;
+
+        case NT_CASE:
+            simplify_expr(stmt->child);
+            if (stmt->child) {
+                simplify_stmt(stmt->child->sibling);
+            }
+            break;
+
+        case NT_DEFAULT:
+            simplify_stmt(stmt->child);
+            break;
+
+        case NT_GOTO:
+            if (stmt->child && stmt->child->type != NT_ID) { // goto *expr
+                simplify_expr(stmt->child);
+            }
+            break;
+
+        case NT_ETIQUETA:
+            if (stmt->child) {
+                simplify_stmt(stmt->child->sibling);
+            }
+            break;
+
+        case NT_PRAGMA: {
+            // Si el bucle al que se refiere se poda, el pragma se va con él
+            int loop = is_loop_stmt(stmt->child);
+            simplify_stmt(stmt->child);
+            if (loop && !is_loop_stmt(stmt->child)) {
+                replace_with_node(stmt, stmt->child);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void simplify_function(struct ast_node *fn) {
+    struct ast_node *tipo = fn->child;
+    struct ast_node *id = tipo ? tipo->sibling : NULL;
+    if (id == NULL) {
+        return;
+    }
+    int saved_len = scope_len;
+    struct ast_node *it = id->sibling;
+    while (it != NULL && it->type == NT_PARAMETRO) {
+        struct ast_node *ptype = it->child;
+        struct ast_node *pid = ptype ? ptype->sibling : NULL;
+        if (pid) {
+            scope_push(pid->value.strVal, kind_of_type(ptype), 0, 0);
+        }
+        it = it->sibling;
+    }
+    if (it != NULL && it->type == NT_BLOQUE) {
+        simplify_block(it);
+    }
+    scope_len = saved_len;
+}
+
+void ast_simplify_begin(void) {
+    scope_len = 0;
+    consteval_begin();
+}
+
+void ast_simplify_external(struct ast_node *decl) {
+    int base = scope_len;
+    if (decl->type == NT_FUNCION) {
+        // The name goes first so recursive calls know their return kind
+        if (decl->child && decl->child->sibling) {
+            scope_push(decl->child->sibling->value.strVal, kind_of_type(decl->child), 0, 0);
+        }
+        simplify_function(decl);
+        consteval_add_function(decl);
+    } else if (decl->type == NT_DECLARACION) {
+        simplify_declaration(decl);
+    }
+    // What remains pushed is at file scope and must not point into decl, which may be freed
+    for (int i = base; i < scope_len; i++) {
+        scope[i].name = strdup(scope[i].name);
+        scope[i].owned = 1;
+    }
+}
+
+void ast_simplify_end(void) {
+    for (int i = 0; i < scope_len; i++) {
+        if (scope[i].owned) {
+            free((char *)scope[i].name);
+        }
+    }
+    free(scope);
+    scope = NULL;
+    scope_len = scope_cap = 0;
+    consteval_end();
+}
+
+void ast_simplify(struct ast_node *root) {
+    if (root == NULL) {
+        return;
+    }
+    ast_simplify_begin();
+
+    // Return kinds of every function, so calls can be typed before their definition
+    for (struct ast_node *n = root->child; n != NULL; n = n->sibling) {
+        if (n->type == NT_FUNCION && n->child && n->child->sibling) {
+            scope_push(n->child->sibling->value.strVal, kind_of_type(n->child), 0, 0);
+        }
+    }
+
+    for (struct ast_node *n = root->child; n != NULL; n = n->sibling) {
+        ast_simplify_external(n);
+    }
+    ast_simplify_end();
+}
@@ -0,0 +1,23 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include "ast.h"
+
+/*
+Frontend simplification pass over the AST, run by main.c before codegen.
+Folds constant subexpressions, propagates const locals initialized with
+a constant, simplifies integer identities and prunes branches whose
+condition is constant. Calls to pure functions with constant arguments
+are evaluated (consteval.h). The tree is rewritten in place.
+*/
+void ast_simplify(struct ast_node *root);
+
+// The same pass one external declaration at a time, in source order (-fstreaming)
+void ast_simplify_begin(void);
+void ast_simplify_external(struct ast_node *decl);
+void ast_simplify_end(void);
+
+// a op b with the int semantics of the generated code; 0 if the result is undefined
+int simplify_fold_binary(int op, int a, int b, int *result);
+
+#endif // SIMPLIFY_H
@@ -0,0 +1,60 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "stackguard.h"
+
+// Lowest address this thread may reach before switching segments
+static __thread char *stack_floor = NULL;
+
+static char *current_floor(void) {
+    if (stack_floor == NULL) {
+        pthread_attr_t attr;
+        void *addr;
+        size_t size;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            if (pthread_attr_getstack(&attr, &addr, &size) == 0) {
+                stack_floor = (char *)addr + STACK_RED_ZONE;
+            }
+            pthread_attr_destroy(&attr);
+        }
+        if (stack_floor == NULL) {
+            // Sin información de la pila: se asume un segmento a partir de aquí
+            stack_floor = (char *)__builtin_frame_address(0) - STACK_SEGMENT_SIZE + STACK_RED_ZONE;
+        }
+    }
+    return stack_floor;
+}
+
+int stack_low(void) {
+    // La pila crece hacia abajo en todas las arquitecturas que soporta el backend
+    return (char *)__builtin_frame_address(0) < current_floor();
+}
+
+typedef struct segment_call {
+    void (*fn)(void *);
+    void *arg;
+} segment_call;
+
+static void *segment_main(void *data) {
+    segment_call *call = data;
+    call->fn(call->arg);
+    return NULL;
+}
+
+void stack_extend(void (*fn)(void *), void *arg) {
+    // Un hilo sólo para tener otra pila: el que llama espera, así que nunca corren a la vez
+    segment_call call = { fn, arg };
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STACK_SEGMENT_SIZE);
+    if (pthread_create(&thread, &attr, segment_main, &call) != 0) {
+        fprintf(stderr, "Fatal Error: unable to allocate a stack segment for deeply nested code\n");
+        exit(1);
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+}
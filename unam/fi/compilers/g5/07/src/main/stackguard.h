@@ -0,0 +1,25 @@
+#ifndef STACKGUARD_H
+#define STACKGUARD_H
+
+/*
+Stack-depth guard for the recursive passes over the AST (simplify.c and
+codegen.c). Deeply nested input (generated expressions, long if-else
+chains) would otherwise overflow the C stack. Each recursive entry point
+checks stack_low() and, when the current stack is nearly used up,
+continues the recursion on a fresh segment with stack_extend(), so
+nesting is limited by memory instead of by the size of one stack.
+*/
+
+// Bytes kept free below the last check, for the callees (LLVM included)
+#define STACK_RED_ZONE (256 * 1024)
+
+// Size of each extra segment
+#define STACK_SEGMENT_SIZE (32 * 1024 * 1024)
+
+// 1 if less than STACK_RED_ZONE bytes remain on the current stack
+int stack_low(void);
+
+// Runs fn(arg) on a new stack segment and waits for it to return
+void stack_extend(void (*fn)(void *), void *arg);
+
+#endif // STACKGUARD_H
@@ -0,0 +1,263 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freezepiler_rt.h"
+
+/*
+vsnprintf for -ffreestanding-runtime, where __freezepiler_printf has no
+libc to format with. It covers what the language can print: %d %i %u
+%o %x %X %c %s %p %f %F and %%, with the - + space # 0 flags, width and
+precision (also as *), and the hh h l ll z j t length modifiers. %f is
+exact for integer parts below 2^64; larger ones keep 19 significant
+digits. Other conversions are written out as they appear.
+*/
+
+typedef struct output {
+    char *buf;
+    size_t size;
+    size_t n; // Lo que se habría escrito sin límite, como devuelve vsnprintf
+} output;
+
+static void put(output *o, char c) {
+    if (o->n + 1 < o->size) {
+        o->buf[o->n] = c;
+    }
+    o->n++;
+}
+
+static void put_repeat(output *o, char c, int count) {
+    for (; count > 0; count--) {
+        put(o, c);
+    }
+}
+
+typedef struct spec {
+    int left, plus, space, alt, zero;
+    int width;
+    int precision; // -1 = no se dio
+} spec;
+
+// Relleno y signo alrededor de digits[0..len), que ya trae los ceros de la precisión
+static void put_field(output *o, const spec *sp, const char *prefix, const char *digits, int len) {
+    int prefix_len = 0;
+    while (prefix[prefix_len]) {
+        prefix_len++;
+    }
+    int pad = sp->width - prefix_len - len;
+    if (!sp->left && !sp->zero) {
+        put_repeat(o, ' ', pad);
+    }
+    for (int i = 0; i < prefix_len; i++) {
+        put(o, prefix[i]);
+    }
+    if (!sp->left && sp->zero) {
+        put_repeat(o, '0', pad);
+    }
+    for (int i = 0; i < len; i++) {
+        put(o, digits[i]);
+    }
+    if (sp->left) {
+        put_repeat(o, ' ', pad);
+    }
+}
+
+static void put_integer(output *o, spec sp, uint64_t v, int negative, int base, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[96];
+    char *end = tmp + sizeof(tmp), *p = end;
+    int is_zero = v == 0;
+    while (v != 0) {
+        *--p = digits[v % (unsigned)base];
+        v /= (unsigned)base;
+    }
+    // Con precisión no se rellena con ceros a la izquierda; %.0d de 0 no escribe dígitos
+    if (sp.precision >= 0) {
+        sp.zero = 0;
+    }
+    int precision = sp.precision >= 0 ? (sp.precision < 64 ? sp.precision : 64) : 1;
+    while (end - p < precision) {
+        *--p = '0';
+    }
+    if (sp.alt && base == 8 && (p == end || *p != '0')) {
+        *--p = '0';
+    }
+    const char *prefix = negative ? "-" : sp.plus ? "+" : sp.space ? " " : "";
+    if (sp.alt && base == 16 && !is_zero) {
+        prefix = upper ? "0X" : "0x";
+    }
+    put_field(o, &sp, prefix, p, (int)(end - p));
+}
+
+static void put_double(output *o, spec sp, double x, int upper) {
+    const char *prefix = "";
+    union { double d; uint64_t u; } bits = { x };
+    if (bits.u >> 63) { // También -0.0 y -nan
+        prefix = "-";
+        x = -x;
+    } else if (sp.plus) {
+        prefix = "+";
+    } else if (sp.space) {
+        prefix = " ";
+    }
+    if (x != x || x > 1.7976931348623157e308) {
+        sp.zero = 0;
+        put_field(o, &sp, prefix, x != x ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf"), 3);
+        return;
+    }
+
+    int precision = sp.precision >= 0 ? (sp.precision < 17 ? sp.precision : 17) : 6;
+    uint64_t scale = 1;
+    for (int i = 0; i < precision; i++) {
+        scale *= 10;
+    }
+    // Parte entera en 64 bits; lo que no cabe se reduce a 19 cifras y ceros
+    int zeros = 0;
+    while (x >= 1e19) {
+        x /= 10;
+        zeros++;
+    }
+    uint64_t whole = (uint64_t)x;
+    double scaled = (x - (double)whole) * (double)scale;
+    uint64_t frac = (uint64_t)scaled;
+    // Redondeo al par en los empates, como glibc: %.0f de 2.5 es 2
+    double rest = scaled - (double)frac;
+    if (rest > 0.5 || (rest == 0.5 && ((precision > 0 ? frac : whole) & 1))) {
+        frac++;
+    }
+    if (frac >= scale) {
+        frac -= scale;
+        whole++;
+    }
+
+    char tmp[360];
+    char *end = tmp + sizeof(tmp), *p = end;
+    for (int i = 0; i < precision; i++) {
+        *--p = (char)('0' + frac % 10);
+        frac /= 10;
+    }
+    if (precision > 0 || sp.alt) {
+        *--p = '.';
+    }
+    for (int i = 0; i < zeros; i++) {
+        *--p = '0';
+    }
+    do {
+        *--p = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole != 0);
+    put_field(o, &sp, prefix, p, (int)(end - p));
+}
+
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+    output o = { buf, size, 0 };
+    while (*fmt) {
+        if (*fmt != '%') {
+            put(&o, *fmt++);
+            continue;
+        }
+        const char *start = fmt++;
+        spec sp = { 0, 0, 0, 0, 0, 0, -1 };
+        for (;; fmt++) {
+            if (*fmt == '-') sp.left = 1;
+            else if (*fmt == '+') sp.plus = 1;
+            else if (*fmt == ' ') sp.space = 1;
+            else if (*fmt == '#') sp.alt = 1;
+            else if (*fmt == '0') sp.zero = 1;
+            else break;
+        }
+        if (*fmt == '*') {
+            sp.width = va_arg(ap, int);
+            if (sp.width < 0) {
+                sp.left = 1;
+                sp.width = -sp.width;
+            }
+            fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9') {
+            sp.width = sp.width * 10 + (*fmt++ - '0');
+        }
+        if (*fmt == '.') {
+            fmt++;
+            sp.precision = 0;
+            if (*fmt == '*') {
+                sp.precision = va_arg(ap, int);
+                fmt++;
+            }
+            while (*fmt >= '0' && *fmt <= '9') {
+                sp.precision = sp.precision * 10 + (*fmt++ - '0');
+            }
+        }
+        // Ancho en bits del argumento entero: los varargs llegan promovidos a int
+        int bits = 32;
+        if (fmt[0] == 'h' && fmt[1] == 'h') { bits = 8; fmt += 2; }
+        else if (fmt[0] == 'h') { bits = 16; fmt++; }
+        else if (fmt[0] == 'l' && fmt[1] == 'l') { bits = 64; fmt += 2; }
+        else if (*fmt == 'l' || *fmt == 'z' || *fmt == 'j' || *fmt == 't') { bits = 64; fmt++; }
+        else if (*fmt == 'L') { fmt++; }
+
+        char conv = *fmt;
+        if (conv != '\0') {
+            fmt++;
+        }
+        switch (conv) {
+        case 'd':
+        case 'i': {
+            int64_t v = bits == 64 ? va_arg(ap, int64_t) : va_arg(ap, int);
+            v = bits == 8 ? (int8_t)v : bits == 16 ? (int16_t)v : v;
+            put_integer(&o, sp, v < 0 ? -(uint64_t)v : (uint64_t)v, v < 0, 10, 0);
+            break;
+        }
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X': {
+            uint64_t v = bits == 64 ? va_arg(ap, uint64_t) : va_arg(ap, unsigned);
+            v = bits == 8 ? (uint8_t)v : bits == 16 ? (uint16_t)v : v;
+            sp.plus = sp.space = 0;
+            put_integer(&o, sp, v, 0, conv == 'u' ? 10 : conv == 'o' ? 8 : 16, conv == 'X');
+            break;
+        }
+        case 'p':
+            sp.alt = 1;
+            sp.plus = sp.space = 0;
+            put_integer(&o, sp, (uintptr_t)va_arg(ap, void *), 0, 16, 0);
+            break;
+        case 'c': {
+            char c = (char)va_arg(ap, int);
+            sp.zero = 0;
+            put_field(&o, &sp, "", &c, 1);
+            break;
+        }
+        case 's': {
+            const char *s = va_arg(ap, const char *);
+            if (s == NULL) {
+                s = "(null)";
+            }
+            int len = 0;
+            while (s[len] && (sp.precision < 0 || len < sp.precision)) {
+                len++;
+            }
+            sp.zero = 0;
+            put_field(&o, &sp, "", s, len);
+            break;
+        }
+        case 'f':
+        case 'F':
+            put_double(&o, sp, va_arg(ap, double), conv == 'F');
+            break;
+        case '%':
+            put(&o, '%');
+            break;
+        default:
+            // Conversión fuera del subconjunto: se copia tal cual
+            while (start < fmt) {
+                put(&o, *start++);
+            }
+            break;
+        }
+    }
+    if (size > 0) {
+        buf[o.n < size ? o.n : size - 1] = '\0';
+    }
+    return o.n > 0x7fffffff ? -1 : (int)o.n;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freezepiler_rt.h"
+
+uint64_t __freezepiler_fprof_child = 0;
+
+static fprof_record **records = NULL;
+static int n_records = 0;
+static const char *output_path = NULL;
+static int dump_registered = 0;
+
+// Mayor tiempo propio primero; a igual tiempo, por nombre para que la salida sea estable
+static int by_self_cycles(const void *a, const void *b) {
+    const fprof_record *x = *(fprof_record *const *)a;
+    const fprof_record *y = *(fprof_record *const *)b;
+    if (x->self_cycles != y->self_cycles) {
+        return x->self_cycles < y->self_cycles ? 1 : -1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+static void write_json_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', fp);
+        }
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+static void write_json(FILE *fp, uint64_t total) {
+    fprintf(fp, "{\n  \"unit\": \"cycles\",\n  \"total_cycles\": %llu,\n  \"functions\": [", (unsigned long long)total);
+    for (int i = 0; i < n_records; i++) {
+        fprof_record *r = records[i];
+        fprintf(fp, "%s\n    {\"name\": ", i ? "," : "");
+        write_json_string(fp, r->name);
+        fprintf(fp, ", \"calls\": %llu, \"self_cycles\": %llu, \"inclusive_cycles\": %llu}",
+                (unsigned long long)r->calls, (unsigned long long)r->self_cycles,
+                (unsigned long long)r->inclusive_cycles);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+static void write_table(FILE *fp, uint64_t total) {
+    fprintf(fp, "Flat profile (cycles):\n");
+    fprintf(fp, "%7s %16s %16s %12s %14s  %s\n", "% self", "self", "inclusive", "calls", "self/call", "name");
+    for (int i = 0; i < n_records; i++) {
+        fprof_record *r = records[i];
+        if (r->calls == 0) {
+            continue;
+        }
+        double pct = total ? 100.0 * (double)r->self_cycles / (double)total : 0.0;
+        fprintf(fp, "%6.2f%% %16llu %16llu %12llu %14llu  %s\n", pct, (unsigned long long)r->self_cycles,
+                (unsigned long long)r->inclusive_cycles, (unsigned long long)r->calls,
+                (unsigned long long)(r->self_cycles / r->calls), r->name);
+    }
+}
+
+static void fprof_dump(void) {
+    qsort(records, n_records, sizeof(fprof_record *), by_self_cycles);
+    uint64_t total = 0;
+    for (int i = 0; i < n_records; i++) {
+        total += records[i]->self_cycles;
+    }
+
+    if (output_path == NULL) {
+        write_table(stderr, total);
+        return;
+    }
+    FILE *fp = fopen(output_path, "w");
+    if (fp == NULL) {
+        perror(output_path);
+        return;
+    }
+    write_json(fp, total);
+    fclose(fp);
+}
+
+void __freezepiler_fprof_register(fprof_record **module_records, int n, const char *json_path) {
+    if (!dump_registered) {
+        atexit(fprof_dump);
+        dump_registered = 1;
+    }
+    records = realloc(records, (n_records + n) * sizeof(fprof_record *));
+    memcpy(records + n_records, module_records, n * sizeof(fprof_record *));
+    n_records += n;
+    if (output_path == NULL) {
+        output_path = json_path;
+    }
+}
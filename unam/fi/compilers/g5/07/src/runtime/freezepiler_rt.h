@@ -0,0 +1,79 @@
+#ifndef FREEZEPILER_RT_H
+#define FREEZEPILER_RT_H
+
+#include <stdint.h>
+
+/*
+Runtime support for the programs freezepiler generates. It is built as
+bin/libfreezepiler_rt.a and every link pulls in only the pieces the
+program calls. The entry points are called from code emitted by
+codegen.c, so their names and layouts are part of the compiler ABI.
+
+-ffreestanding-runtime links bin/libfreezepiler_freestanding.a instead,
+with no crt files and no libc: print.c over start.c, which provides
+_start, exit and the few system calls, and format.c, which provides
+vsnprintf. -fprofile-functions needs stdio and is not available there,
+and parallel loops run serially.
+*/
+
+/*
+-fprofile-functions: one record per instrumented function. The calling
+code updates the counters inline; active is the number of frames of
+the function on the stack, so recursive calls add to the inclusive
+time only once.
+*/
+typedef struct fprof_record {
+    const char *name;
+    uint64_t calls;
+    uint64_t self_cycles;
+    uint64_t inclusive_cycles;
+    uint64_t active;
+} fprof_record;
+
+// Cycles spent in the callees of the running function, reset at every entry
+extern uint64_t __freezepiler_fprof_child;
+
+// Called by each module's constructor; json_path NULL prints a table on stderr at exit
+void __freezepiler_fprof_register(fprof_record **records, int n, const char *json_path);
+
+/*
+printf: codegen.c parses constant format strings at compile time and
+calls these directly; any other printf goes to __freezepiler_printf.
+All of them write to stdio's stdout (a buffer of their own in the
+freestanding runtime), so they keep their order with libc output. A
+printf lowered to several calls brackets them with the print lock so
+no other thread's output lands in the middle. Each call returns the
+number of bytes it wrote.
+*/
+int __freezepiler_write(const char *s, int n);
+int __freezepiler_puts(const char *s); // %s: sin salto de línea, a diferencia de puts
+int __freezepiler_putchar(int c);
+int __freezepiler_write_i64(int64_t v);
+int __freezepiler_write_u64(uint64_t v);
+int __freezepiler_write_hex(uint64_t v, int upper);
+int __freezepiler_printf(const char *fmt, ...);
+void __freezepiler_print_lock(void);
+void __freezepiler_print_unlock(void);
+
+/*
+#pragma omp parallel for: codegen.c outlines the loop body into
+body(ctx, state), which asks for ranges of iterations [lo, hi) of the
+n in the loop until __freezepiler_loop_next returns 0. The threads of a
+pool created on first use (FREEZEPILER_NUM_THREADS, else
+OMP_NUM_THREADS, else one per CPU) run it together with the caller.
+Reductions merge their partial results under the parallel lock. A
+parallel loop inside another one, and every loop of the freestanding
+runtime, runs on the calling thread alone.
+*/
+#define FREEZEPILER_SCHEDULE_STATIC 0  // Contiguous blocks, or round-robin chunks
+#define FREEZEPILER_SCHEDULE_DYNAMIC 1 // Chunks (default 1) taken from a shared counter
+
+typedef struct freezepiler_loop_state freezepiler_loop_state;
+
+void __freezepiler_parallel_for(void (*body)(void *ctx, freezepiler_loop_state *state), void *ctx, int64_t n,
+                                int schedule, int64_t chunk);
+int __freezepiler_loop_next(freezepiler_loop_state *state, int64_t *lo, int64_t *hi);
+void __freezepiler_parallel_lock(void);
+void __freezepiler_parallel_unlock(void);
+
+#endif // FREEZEPILER_RT_H
@@ -0,0 +1,198 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "freezepiler_rt.h"
+
+/*
+Work sharing for #pragma omp parallel for. A loop of n iterations is
+described once and every participating thread walks it with its own
+state: the static schedule hands each thread a fixed part of the
+iteration space, the dynamic one a chunk at a time from a shared
+counter, so uneven iterations balance out.
+*/
+
+typedef struct parallel_loop {
+    void (*body)(void *ctx, freezepiler_loop_state *state);
+    void *ctx;
+    int64_t n;
+    int schedule;
+    int64_t chunk;
+    int nthreads;
+    int64_t next; // dynamic: primera iteración sin repartir
+} parallel_loop;
+
+struct freezepiler_loop_state {
+    parallel_loop *loop;
+    int tid;
+    int64_t calls; // rangos entregados a este hilo
+};
+
+static void run_loop(parallel_loop *loop, int tid) {
+    freezepiler_loop_state state = { loop, tid, 0 };
+    loop->body(loop->ctx, &state);
+}
+
+int __freezepiler_loop_next(freezepiler_loop_state *state, int64_t *lo, int64_t *hi) {
+    parallel_loop *loop = state->loop;
+    int64_t n = loop->n;
+    int64_t first;
+    int64_t size;
+    if (loop->schedule == FREEZEPILER_SCHEDULE_DYNAMIC) {
+        size = loop->chunk > 0 ? loop->chunk : 1;
+        first = __atomic_fetch_add(&loop->next, size, __ATOMIC_RELAXED);
+    } else if (loop->chunk > 0) { // Bloques de chunk iteraciones, por turnos
+        size = loop->chunk;
+        int64_t index = state->calls * loop->nthreads + state->tid;
+        if (index > n / size) {
+            return 0;
+        }
+        first = index * size;
+    } else { // Un solo bloque contiguo por hilo
+        if (state->calls > 0) {
+            return 0;
+        }
+        int64_t base = n / loop->nthreads, extra = n % loop->nthreads;
+        first = state->tid * base + (state->tid < extra ? state->tid : extra);
+        size = base + (state->tid < extra);
+    }
+    state->calls++;
+    if (first >= n || size == 0) {
+        return 0;
+    }
+    *lo = first;
+    *hi = size < n - first ? first + size : n;
+    return 1;
+}
+
+#if __STDC_HOSTED__
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_THREADS 256
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t reduction_lock = PTHREAD_MUTEX_INITIALIZER;
+static int pool_threads = 0;        // hilos del pool más el que llama; 0 antes de crearlo
+static parallel_loop *current = NULL;
+static unsigned generation = 0;     // cambia con cada bucle publicado
+static int pending = 0;             // hilos del pool que no terminaron el bucle actual
+static __thread int in_parallel = 0;
+
+static int requested_threads(void) {
+    const char *names[] = { "FREEZEPILER_NUM_THREADS", "OMP_NUM_THREADS" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const char *value = getenv(names[i]);
+        if (value && atoi(value) > 0) {
+            return atoi(value);
+        }
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+static void *worker(void *arg) {
+    int tid = (int)(intptr_t)arg;
+    unsigned seen = 0;
+    in_parallel = 1;
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (generation == seen) {
+            pthread_cond_wait(&work_ready, &pool_lock);
+        }
+        seen = generation;
+        parallel_loop *loop = current;
+        pthread_mutex_unlock(&pool_lock);
+
+        run_loop(loop, tid);
+
+        pthread_mutex_lock(&pool_lock);
+        if (--pending == 0) {
+            pthread_cond_signal(&work_done);
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return NULL;
+}
+
+// El hilo que llama es el 0; si no se puede crear un hilo el pool se queda con los que haya
+static void start_pool(void) {
+    int wanted = requested_threads();
+    if (wanted > MAX_THREADS) {
+        wanted = MAX_THREADS;
+    }
+    pool_threads = 1;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (int tid = 1; tid < wanted; tid++) {
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, worker, (void *)(intptr_t)tid) != 0) {
+            break;
+        }
+        pool_threads++;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+void __freezepiler_parallel_for(void (*body)(void *ctx, freezepiler_loop_state *state), void *ctx, int64_t n,
+                                int schedule, int64_t chunk) {
+    if (n <= 0) {
+        return;
+    }
+    parallel_loop loop = { body, ctx, n, schedule, chunk, 1, 0 };
+    if (in_parallel) { // Anidado: lo corre sólo este hilo
+        run_loop(&loop, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_threads == 0) {
+        start_pool();
+    }
+    loop.nthreads = pool_threads;
+    current = &loop;
+    pending = pool_threads - 1;
+    generation++;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&pool_lock);
+
+    in_parallel = 1;
+    run_loop(&loop, 0);
+    in_parallel = 0;
+
+    pthread_mutex_lock(&pool_lock);
+    while (pending > 0) {
+        pthread_cond_wait(&work_done, &pool_lock);
+    }
+    current = NULL;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void __freezepiler_parallel_lock(void) {
+    pthread_mutex_lock(&reduction_lock);
+}
+
+void __freezepiler_parallel_unlock(void) {
+    pthread_mutex_unlock(&reduction_lock);
+}
+
+#else // -ffreestanding-runtime: sin hilos, el bucle corre entero en quien llama
+
+void __freezepiler_parallel_for(void (*body)(void *ctx, freezepiler_loop_state *state), void *ctx, int64_t n,
+                                int schedule, int64_t chunk) {
+    if (n > 0) {
+        parallel_loop loop = { body, ctx, n, schedule, chunk, 1, 0 };
+        run_loop(&loop, 0);
+    }
+}
+
+void __freezepiler_parallel_lock(void) {
+}
+
+void __freezepiler_parallel_unlock(void) {
+}
+
+#endif
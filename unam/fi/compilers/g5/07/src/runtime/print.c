@@ -0,0 +1,191 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // fwrite_unlocked
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "freezepiler_rt.h"
+
+#if __STDC_HOSTED__
+
+/*
+The hosted runtime writes through stdio's stdout, so the specialized
+printf keeps its order with puts, putchar or any other libc output of
+the program, and stdio's own lock keeps each call whole when several
+threads print at once. __freezepiler_print_lock holds that lock across
+the pieces of one specialized printf so a line is never split; while
+this thread holds it, the pieces skip stdio's per-call locking.
+*/
+static __thread int print_locked = 0;
+
+static void put_bytes(const char *s, size_t n) {
+    if (!print_locked) {
+        fwrite(s, 1, n, stdout);
+    } else if (n == 1) {
+        putc_unlocked(*s, stdout);
+    } else {
+        fwrite_unlocked(s, 1, n, stdout);
+    }
+}
+
+void __freezepiler_print_lock(void) {
+    flockfile(stdout);
+    print_locked++;
+}
+
+void __freezepiler_print_unlock(void) {
+    print_locked--;
+    funlockfile(stdout);
+}
+
+#else // -ffreestanding-runtime: sin libc, un búfer propio sobre write
+
+/*
+Buffered stdout shared by every printf of the program, specialized or
+not, so output keeps its order. Like stdio it is line buffered on a
+terminal and fully buffered otherwise, and it is flushed at exit.
+Parallel loops run serially here, so it needs no lock.
+*/
+static char buffer[8192];
+static size_t used = 0;
+static int line_buffered = 0;
+static int initialized = 0;
+
+static void write_all(const char *s, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(STDOUT_FILENO, s, n);
+        if (w <= 0) {
+            return; // Como stdio: un error de escritura descarta la salida
+        }
+        s += w;
+        n -= (size_t)w;
+    }
+}
+
+static void flush(void) {
+    write_all(buffer, used);
+    used = 0;
+}
+
+static void put_bytes(const char *s, size_t n) {
+    if (!initialized) {
+        initialized = 1;
+        line_buffered = isatty(STDOUT_FILENO);
+        atexit(flush);
+    }
+    if (n > sizeof(buffer) - used) {
+        flush();
+        if (n >= sizeof(buffer)) {
+            write_all(s, n);
+            return;
+        }
+    }
+    memcpy(buffer + used, s, n);
+    used += n;
+    if (line_buffered && memchr(s, '\n', n) != NULL) {
+        flush();
+    }
+}
+
+void __freezepiler_print_lock(void) {
+}
+
+void __freezepiler_print_unlock(void) {
+}
+
+#endif
+
+int __freezepiler_write(const char *s, int n) {
+    put_bytes(s, (size_t)n);
+    return n;
+}
+
+int __freezepiler_puts(const char *s) {
+    if (s == NULL) {
+        s = "(null)";
+    }
+    size_t n = strlen(s);
+    put_bytes(s, n);
+    return (int)n;
+}
+
+int __freezepiler_putchar(int c) {
+    char ch = (char)c;
+    put_bytes(&ch, 1);
+    return 1;
+}
+
+// Dos dígitos por división: la mitad de divisiones que dígito a dígito
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+int __freezepiler_write_u64(uint64_t v) {
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while (v >= 100) {
+        unsigned pair = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (v >= 10) {
+        *--p = digit_pairs[v * 2 + 1];
+        *--p = digit_pairs[v * 2];
+    } else {
+        *--p = (char)('0' + v);
+    }
+    int n = (int)(tmp + sizeof(tmp) - p);
+    put_bytes(p, (size_t)n);
+    return n;
+}
+
+int __freezepiler_write_i64(int64_t v) {
+    if (v >= 0) {
+        return __freezepiler_write_u64((uint64_t)v);
+    }
+    put_bytes("-", 1);
+    return 1 + __freezepiler_write_u64(-(uint64_t)v);
+}
+
+int __freezepiler_write_hex(uint64_t v, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[16];
+    char *p = tmp + sizeof(tmp);
+    do {
+        *--p = digits[v & 15];
+        v >>= 4;
+    } while (v != 0);
+    int n = (int)(tmp + sizeof(tmp) - p);
+    put_bytes(p, (size_t)n);
+    return n;
+}
+
+int __freezepiler_printf(const char *fmt, ...) {
+    char small[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return n;
+    }
+    if ((size_t)n < sizeof(small)) {
+        put_bytes(small, (size_t)n);
+        return n;
+    }
+
+    char *big = malloc((size_t)n + 1);
+    if (big == NULL) {
+        return -1;
+    }
+    va_start(ap, fmt);
+    vsnprintf(big, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    put_bytes(big, (size_t)n);
+    free(big);
+    return n;
+}
@@ -0,0 +1,214 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "freezepiler_rt.h"
+
+/*
+-ffreestanding-runtime: the program is linked without crt1.o and libc.
+This file is the whole platform: the entry point, the handful of
+system calls print.c needs, exit with atexit handlers, and the memory
+and string functions that both print.c and LLVM-generated code call.
+Everything goes straight to the kernel, so it is x86-64 Linux only.
+*/
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error "the freestanding runtime only supports x86-64 Linux"
+#endif
+
+#define SYS_write 1
+#define SYS_mmap 9
+#define SYS_munmap 11
+#define SYS_ioctl 16
+#define SYS_exit_group 231
+
+static long syscall3(long n, long a, long b, long c) {
+    long ret;
+    __asm__ volatile("syscall" : "=a"(ret) : "a"(n), "D"(a), "S"(b), "d"(c) : "rcx", "r11", "memory");
+    return ret;
+}
+
+static long syscall6(long n, long a, long b, long c, long d, long e, long f) {
+    long ret;
+    register long r10 __asm__("r10") = d;
+    register long r8 __asm__("r8") = e;
+    register long r9 __asm__("r9") = f;
+    __asm__ volatile("syscall"
+                     : "=a"(ret)
+                     : "a"(n), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+                     : "rcx", "r11", "memory");
+    return ret;
+}
+
+// Los errores del kernel llegan como -errno; aquí sólo importa que fallaron
+long write(int fd, const void *buf, size_t n) {
+    long ret = syscall3(SYS_write, fd, (long)buf, (long)n);
+    return ret < 0 ? -1 : ret;
+}
+
+int isatty(int fd) {
+    char termios[64];
+    return syscall3(SYS_ioctl, fd, 0x5401 /* TCGETS */, (long)termios) == 0;
+}
+
+_Noreturn void _exit(int status) {
+    for (;;) {
+        syscall3(SYS_exit_group, status, 0, 0);
+    }
+}
+
+// Sólo lo usa __freezepiler_printf para salidas largas: un mmap por bloque basta
+void *malloc(size_t n) {
+    size_t total = (n + 16 + 4095) & ~(size_t)4095;
+    long p = syscall6(SYS_mmap, 0, (long)total, 3 /* PROT_READ|PROT_WRITE */, 0x22 /* MAP_PRIVATE|MAP_ANONYMOUS */,
+                      -1, 0);
+    if (p < 0 && p > -4096) {
+        return NULL;
+    }
+    *(size_t *)p = total;
+    return (char *)p + 16;
+}
+
+void free(void *ptr) {
+    if (ptr != NULL) {
+        char *block = (char *)ptr - 16;
+        syscall3(SYS_munmap, (long)block, (long)*(size_t *)block, 0);
+    }
+}
+
+// =======================================================
+// exit y atexit
+// =======================================================
+
+#define ATEXIT_MAX 32
+
+static void (*atexit_handlers[ATEXIT_MAX])(void);
+static int atexit_count = 0;
+
+int atexit(void (*fn)(void)) {
+    if (atexit_count == ATEXIT_MAX) {
+        return -1;
+    }
+    atexit_handlers[atexit_count++] = fn;
+    return 0;
+}
+
+extern void (*__fini_array_start[])(void);
+extern void (*__fini_array_end[])(void);
+
+_Noreturn void exit(int status) {
+    // En orden inverso al registro, como la libc; un manejador puede registrar otro
+    while (atexit_count > 0) {
+        atexit_handlers[--atexit_count]();
+    }
+    for (size_t i = (size_t)(__fini_array_end - __fini_array_start); i > 0; i--) {
+        __fini_array_start[i - 1]();
+    }
+    _exit(status);
+}
+
+// =======================================================
+// ENTRADA
+// =======================================================
+
+/*
+The kernel starts the process with argc at the top of the stack,
+followed by argv and envp. _start hands that pointer to C with the
+stack aligned as the ABI requires, and %rbp cleared so backtraces stop
+here.
+*/
+__asm__(".text\n"
+        ".global _start\n"
+        ".type _start, @function\n"
+        "_start:\n"
+        "    xor %ebp, %ebp\n"
+        "    mov %rsp, %rdi\n"
+        "    and $-16, %rsp\n"
+        "    call __freezepiler_start\n"
+        "    hlt\n"
+        ".size _start, . - _start\n");
+
+int main(int argc, char **argv, char **envp);
+
+// ld define los límites de .init_array/.fini_array en ejecutables estáticos
+extern void (*__init_array_start[])(int, char **, char **);
+extern void (*__init_array_end[])(int, char **, char **);
+
+_Noreturn void __freezepiler_start(long *sp) {
+    int argc = (int)sp[0];
+    char **argv = (char **)(sp + 1);
+    char **envp = argv + argc + 1;
+    // Los constructores de los módulos (llvm.global_ctors) corren antes de main, como con crt1.o
+    for (size_t i = 0; i < (size_t)(__init_array_end - __init_array_start); i++) {
+        __init_array_start[i](argc, argv, envp);
+    }
+    exit(main(argc, argv, envp));
+}
+
+// =======================================================
+// MEMORIA Y CADENAS
+// =======================================================
+
+// LLVM emite llamadas a estas funciones para copias e inicializaciones de arreglos
+
+void *memcpy(void *dst, const void *src, size_t n) {
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+void *memmove(void *dst, const void *src, size_t n) {
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    if (d < s) {
+        while (n--) {
+            *d++ = *s++;
+        }
+    } else {
+        while (n--) {
+            d[n] = s[n];
+        }
+    }
+    return dst;
+}
+
+void *memset(void *dst, int c, size_t n) {
+    unsigned char *d = dst;
+    while (n--) {
+        *d++ = (unsigned char)c;
+    }
+    return dst;
+}
+
+int memcmp(const void *a, const void *b, size_t n) {
+    const unsigned char *x = a, *y = b;
+    for (size_t i = 0; i < n; i++) {
+        if (x[i] != y[i]) {
+            return x[i] - y[i];
+        }
+    }
+    return 0;
+}
+
+int bcmp(const void *a, const void *b, size_t n) {
+    return memcmp(a, b, n);
+}
+
+void *memchr(const void *s, int c, size_t n) {
+    const unsigned char *p = s;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == (unsigned char)c) {
+            return (void *)(p + i);
+        }
+    }
+    return NULL;
+}
+
+size_t strlen(const char *s) {
+    const char *p = s;
+    while (*p) {
+        p++;
+    }
+    return (size_t)(p - s);
+}
@@ -8,7 +8,7 @@ CYAN='\033[0;36m'
 NC='\033[0m' # No Color
 
 # Definimos los tests y sus resultados esperados según tus pruebas con GCC
-# Formato: "NombreArchivo:ResultadoEsperado"
+# Formato: "NombreArchivo:ResultadoEsperado[:OpcionesDelCompilador]"
 TESTS=(
     "testCompiler1.c:105"
     "testCompiler2.c:99"
@@ -20,6 +20,170 @@ TESTS=(
     "testCompiler8.c:0"
     "testCompiler9.c:0"
     "testCompiler10.c:0"
+    "testCompiler14.c:42"
+    "testCompiler15.c:52"
+    "testCompiler16.c:63"
+    "testCompiler17.c:59"
+    "testCompiler18.c:120"
+    "testCompiler19.c:77:-O2 -fwhole-program"
+    "testCompiler20.c:25:-O2 -flto ../test/testCompiler20_lib.c"
+    "testCompiler21.c:115:-fprofile-generate=test21.prof"
+    "testCompiler21.c:115:-O2 -fprofile-use=test21.prof"
+    "testCompiler21.c:115:-fprofile-functions=test21.json"
+    "testCompiler22.c:51"
+    "testCompiler23.c:68"
+    "testCompiler23.c:68:-O2 -fstreaming"
+    "testCompiler24.c:99"
+    "testCompiler24.c:99:-O2 -j4"
+    "testCompiler25.c:235"
+    "testCompiler25.c:235:-O2 -run"
+    "testCompiler26.c:120"
+    "testCompiler26.c:120:-O3"
+    "testCompiler27.c:164"
+    "testCompiler27.c:164:-O2 -g"
+    "testCompiler30.c:191"
+    "testCompiler30.c:191:-O2 -run"
+    "testCompiler31.c:37"
+    "testCompiler32.c:184"
+    "testCompiler18.c:120:-O2 -fstreaming"
+    "testCompiler18.c:120:-O2 -j4"
+    "testCompiler18.c:120:-O2 -g"
+    "testCompiler18.c:120:-O2 -static -ffunction-sections -fdata-sections --gc-sections"
+    "testCompiler22.c:51:-O2 -ffreestanding-runtime --gc-sections"
+    "testCompiler18.c:120:-run"
+    "testCompiler21.c:115:-run -ftier-threshold=2"
+)
+
+# Pruebas que además revisan lo que escribe el programa o el compilador.
+# Cada una es una función que compila, ejecuta y regresa 0 si todo salió bien.
+check_print_order() {
+    ./main ../test/testCompiler28.c > /dev/null && [ -f ./program ] || return 1
+    [ "$(./program)" = "$(printf 'ABC1\n0-1-2-    7|')" ]
+}
+
+# Ocho hilos imprimiendo a la vez: ninguna línea se pierde ni sale mezclada con otra
+check_parallel_print() {
+    ./main -O2 ../test/testCompiler29.c > /dev/null && [ -f ./program ] || return 1
+    FREEZEPILER_NUM_THREADS=8 ./program > parallel.out
+    [ "$(grep -cE '^linea [0-9]+ de 200000$' parallel.out)" -eq 200000 ] &&
+        [ "$(sort -u parallel.out | wc -l)" -eq 200000 ] && [ "$(wc -l < parallel.out)" -eq 200000 ]
+}
+
+# -c -j: los nombres de los símbolos static no cambian entre compilaciones
+check_reproducible_objects() {
+    ./main -O2 -j4 -c -o repro1.o ../test/testCompiler24.c > /dev/null &&
+        ./main -O2 -j4 -c -o repro2.o ../test/testCompiler24.c > /dev/null && cmp -s repro1.o repro2.o
+}
+
+# Rutas con comillas y espacios: ld las recibe tal cual, sin pasar por un shell
+check_quoted_paths() {
+    local dir="quote's dir"
+    mkdir -p "$dir" && cp ../test/testCompiler3.c "$dir/te'st.c" || return 1
+    ./main "$dir/te'st.c" -o "$dir/pro'gram" > /dev/null && ./main -O2 -j2 -c "$dir/te'st.c" -o "$dir/te'st.o" > /dev/null
+    local ok=$?
+    "$dir/pro'gram" > /dev/null
+    local code=$?
+    [ -f "$dir/te'st.o" ] && [ "$ok" -eq 0 ] && [ "$code" -eq 3 ]
+    ok=$?
+    rm -rf "$dir"
+    return $ok
+}
+
+# Anidamiento profundo: 100000 paréntesis y 20000 else if, con la pila de 8 MB de siempre
+check_deep_nesting() {
+    awk 'BEGIN {
+        n = 100000; m = 20000
+        printf "int main(void) {\n    int x = 0;\n    int y = %d;\n    int r = ", m - 1
+        for (i = 0; i < n; i++) printf "("
+        printf "x"
+        for (i = 0; i < n; i++) printf " + 1)"
+        printf ";\n    if (y == 0) r = r + 1;\n"
+        for (i = 1; i < m; i++) printf "    else if (y == %d) r = r + %d;\n", i, (i == m - 1) ? 3 : 1
+        printf "    else r = r + 2;\n    return r %% 256;\n}\n"
+    }' > deep.c
+    local flags
+    for flags in "" "-O2"; do
+        rm -f ./program
+        (ulimit -s 8192 && ./main $flags deep.c > /dev/null) && [ -f ./program ] || return 1
+        ./program
+        [ $? -eq 163 ] || return 1 # (100000 + 3) % 256
+    done
+    (ulimit -s 8192 && ./main -run deep.c > /dev/null)
+    [ $? -eq 163 ]
+}
+
+# -g: tabla de líneas con el archivo fuente y variables; -gline-tables-only: sólo la tabla de líneas
+check_debug_info() {
+    ./main -O2 -g -c -o debug.o ../test/testCompiler18.c > /dev/null &&
+        ./main -O2 -gline-tables-only -c -o lines.o ../test/testCompiler18.c > /dev/null || return 1
+    readelf --debug-dump=line debug.o | grep -q 'testCompiler18\.c' &&
+        readelf --debug-dump=info debug.o | grep -q DW_TAG_variable &&
+        readelf --debug-dump=line lines.o | grep -q 'testCompiler18\.c' &&
+        ! readelf --debug-dump=info lines.o | grep -q DW_TAG_variable
+}
+
+# -fprofile-functions=archivo: el JSON existe y cuenta las llamadas de cada función
+check_function_profile() {
+    rm -f fprof.json
+    ./main -fprofile-functions=fprof.json ../test/testCompiler21.c > /dev/null && [ -f ./program ] || return 1
+    ./program > /dev/null
+    [ -f fprof.json ] &&
+        grep -q '"name": "main", "calls": 1,' fprof.json &&
+        grep -q '"name": "[^"]*:clasifica", "calls": 37,' fprof.json &&
+        ! grep -q '"calls": 0,' fprof.json
+}
+
+# Pool de literales: una constante privada por texto distinto, sin importar cuántas veces aparezca
+check_literal_pool() {
+    ./main -S -emit-llvm -o pool.ll ../test/testCompiler31.c > /dev/null || return 1
+    [ "$(grep -c '^@.* = private .*constant' pool.ll)" -eq 4 ] &&
+        [ "$(grep -cF 'c"%5d|\0A\00"' pool.ll)" -eq 1 ] &&
+        [ "$(grep -cF 'c"%6d|\0A\00"' pool.ll)" -eq 1 ] &&
+        [ "$(grep -cF 'c"valor: \00"' pool.ll)" -eq 1 ] &&
+        [ "$(grep -cF 'c"\0A\00"' pool.ll)" -eq 1 ]
+}
+
+# -run con una función declarada que nadie define: error y salida 1, sin ejecutar nada
+check_run_undefined() {
+    printf 'int missing(int x);\nint main(void) {\n    printf("corrio\\n");\n    return missing(3);\n}\n' > undefined.c
+    local out
+    out=$(./main -run undefined.c 2> undefined.err)
+    [ $? -eq 1 ] && [ -z "$out" ] && grep -q 'undefined function missing' undefined.err || return 1
+    ./main -run ../test/testCompiler20.c > /dev/null 2> undefined.err
+    [ $? -eq 1 ] && grep -q 'undefined function weight' undefined.err
+}
+
+# Pragmas continuados con "\": la metadata del bucle y las reducciones salen de la segunda línea
+check_continued_pragma() {
+    ./main -S -emit-llvm -o continued.ll ../test/testCompiler32.c > /dev/null || return 1
+    grep -qF '!"llvm.loop.vectorize.enable", i1 true' continued.ll &&
+        grep -qF '!"llvm.loop.interleave.count", i32 4' continued.ll &&
+        [ "$(grep -c 'call void @__freezepiler_parallel_lock()' continued.ll)" -eq 1 ] &&
+        grep -q 'select i1' continued.ll || return 1
+    printf 'int main(void) {\n    int x = 0;\n    #pragma GCC \\\n        ivdep\n    x = 1;\n    return x;\n}\n' > continued.c
+    ./main continued.c 2>&1 | grep -qF 'WARNING: #pragma GCC         ivdep no precede a un bucle, se ignora (linea 5)'
+}
+
+# -ffreestanding-runtime: %e y %g no existen en su printf, se rechazan al compilar con la línea
+check_freestanding_format() {
+    printf 'int main(void) {\n    double d = 2.5;\n    printf("%%5.2f\\n", d);\n    printf("%%e %%g\\n", d, d);\n    return 0;\n}\n' > freestanding.c
+    ./main -ffreestanding-runtime freestanding.c > /dev/null 2> freestanding.err
+    [ $? -eq 1 ] && grep -q '%e .*(linea 4)' freestanding.err && grep -q '%g .*(linea 4)' freestanding.err &&
+        ! grep -q '%f' freestanding.err
+}
+
+CHECKS=(
+    "check_print_order:printf y putchar en orden"
+    "check_quoted_paths:rutas con comillas"
+    "check_deep_nesting:expresiones y else if muy anidados"
+    "check_debug_info:información de depuración de -g y -gline-tables-only"
+    "check_function_profile:el JSON de -fprofile-functions"
+    "check_literal_pool:literales repetidos en una sola constante"
+    "check_run_undefined:-run con funciones sin definir"
+    "check_continued_pragma:pragmas continuados en varias líneas"
+    "check_freestanding_format:%e y %g con -ffreestanding-runtime"
+    "check_parallel_print:printf desde un bucle paralelo"
+    "check_reproducible_objects:objetos reproducibles con -j"
 )
 
 echo -e "${CYAN}=========================================${NC}"
@@ -27,23 +191,44 @@ echo -e "${CYAN}    INICIANDO SUITE DE PRUEBAS AUTOMÁTICA    ${NC}"
 echo -e "${CYAN}=========================================${NC}"
 
 PASS_COUNT=0
-TOTAL_TESTS=${#TESTS[@]}
+TOTAL_TESTS=$((${#TESTS[@]} + ${#CHECKS[@]}))
+
+# Los perfiles de -fprofile-generate se acumulan entre ejecuciones
+rm -f ./*.prof ./*.json ./*.out ./*.o ./*.ll ./*.err ./deep.c ./undefined.c ./continued.c ./freestanding.c
 
 for test_case in "${TESTS[@]}"; do
     # Separar el nombre del archivo y el resultado esperado
     FILE="${test_case%%:*}"
-    EXPECTED="${test_case##*:}"
+    REST="${test_case#*:}"
+    EXPECTED="${REST%%:*}"
+    FLAGS=""
+    if [[ "$REST" == *:* ]]; then
+        FLAGS="${REST#*:}"
+    fi
     SOURCE_PATH="../test/$FILE"
 
-    echo -n "Probando $FILE... "
+    echo -n "Probando $FILE${FLAGS:+ ($FLAGS)}... "
 
     # 1. Limpieza: Borrar ejecutable anterior para evitar falsos positivos
-    if [ -f "./program" ]; then
-        rm "./program" "./out.o"
+    rm -f "./program"
+
+    # -run no genera 'program': el retorno es el del propio compilador
+    if [[ " $FLAGS " == *" -run "* ]]; then
+        ./main $FLAGS "$SOURCE_PATH" > /dev/null
+        EXIT_CODE=$?
+        if [ "$EXIT_CODE" -eq "$EXPECTED" ]; then
+            echo -e "${GREEN} [PASÓ]${NC} (Retorno: $EXIT_CODE)"
+            ((PASS_COUNT++))
+        else
+            echo -e "${RED}[FALLÓ]${NC}"
+            echo -e "   -> Esperado: $EXPECTED"
+            echo -e "   -> Obtenido: $EXIT_CODE"
+        fi
+        continue
     fi
 
     # 2. Ejecutar tu compilador (Silenciamos el stdout para limpiar la pantalla, pero dejamos stderr)
-    ./main "$SOURCE_PATH" > /dev/null
+    ./main $FLAGS "$SOURCE_PATH" > /dev/null
 
     # 3. Verificar si tu compilador generó 'program'
     if [ ! -f "./program" ]; then
@@ -67,6 +252,17 @@ for test_case in "${TESTS[@]}"; do
     fi
 done
 
+for check in "${CHECKS[@]}"; do
+    echo -n "Revisando ${check#*:}... "
+    rm -f "./program"
+    if "${check%%:*}"; then
+        echo -e "${GREEN} [PASÓ]${NC}"
+        ((PASS_COUNT++))
+    else
+        echo -e "${RED}[FALLÓ]${NC}"
+    fi
+done
+
 echo -e "${CYAN}=========================================${NC}"
 echo -e "Resultados Finales: ${GREEN}$PASS_COUNT${NC} de ${CYAN}$TOTAL_TESTS${NC} pruebas pasaron."
 
@@ -0,0 +1,23 @@
+// ===== CORTO CIRCUITO EN && Y || =====
+// boom() divide entre cero: si se evaluara el lado derecho el programa moriría con SIGFPE
+int boom(int x) {
+    return 1 / x;
+}
+
+int main() {
+    int a = 0;
+    int r = 0;
+    if (a != 0 && boom(a)) r = 100;
+    if (a == 0 || boom(a)) r = r + 2;
+    if (!(a != 0 && boom(a))) r = r + 8;
+    int v = a && boom(a);
+    int w = a || 1;
+    int i = 0;
+    while (i < 10 && (a == 0 || boom(a))) {
+        i++;
+    }
+    do {
+        i--;
+    } while (i > 0 && !(a != 0 && boom(a)));
+    return r + v + w + i + 31;
+}
@@ -0,0 +1,24 @@
+// ===== PLEGADO DE CONSTANTES Y PODA DE RAMAS =====
+const N = 4;
+
+int f(int x) {
+    const int K = 3 * 4 + 1;
+    int y = x * 1 + 0;
+    int z = y * 8;
+    if (K > 100) {
+        return 999;
+    } else {
+        z = z + K;
+    }
+    while (0) {
+        z = 5;
+    }
+    for (z = z + (2 << 3); 0; z++) {
+        z = 7;
+    }
+    return z + N * 2 - (K == 13 ? 1 : 50);
+}
+
+int main() {
+    return f(2);
+}
@@ -0,0 +1,40 @@
+// ===== ANCHOS DE TIPOS ENTEROS Y DE PUNTO FLOTANTE =====
+char next(char c) {
+    return c + 1;
+}
+
+unsigned int half(unsigned int u) {
+    return u / 2;
+}
+
+long big(long a) {
+    return a * 1000000;
+}
+
+double scale(double d, int n) {
+    return d * n;
+}
+
+void nothing(int x) {
+    x = x + 1;
+}
+
+int main() {
+    char c = 127;
+    short s = 40000;
+    unsigned int u = 0 - 2;
+    long l = big(5000000);
+    float f = 2.5;
+    double d = scale(f, 4);
+    int r = 0;
+
+    c = next(c);
+    if (c < 0) r = r + 1;
+    if (s < 0) r = r + 2;
+    if (half(u) > 2000000000) r = r + 4;
+    if (l / 1000000 == 5000000) r = r + 8;
+    if (d == 10.0) r = r + 16;
+    if (u > 0) r = r + 32;
+    nothing(r);
+    return r;
+}
@@ -0,0 +1,32 @@
+// ===== ARREGLOS LOCALES, GLOBALES Y DE VARIAS DIMENSIONES =====
+int hist[8];
+float weights[64];
+
+int main() {
+    int a[64];
+    int b[64];
+    int m[4][8];
+    int i;
+    int j;
+    int sum = 0;
+
+    for (i = 0; i < 64; i++) {
+        a[i] = i;
+        b[i] = 2 * i;
+        weights[i] = 0.5;
+    }
+    for (i = 0; i < 64; i++) {
+        a[i] = a[i] + b[i];
+    }
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 8; j++) {
+            m[i][j] = i * j;
+        }
+    }
+    for (i = 0; i < 64; i++) {
+        hist[a[i] % 8] += 1;
+        sum = sum + a[i] * weights[i];
+    }
+    // Mismo resultado que gcc: la suma se trunca a int en cada iteración
+    return sum / 100 + m[3][7] + hist[0];
+}
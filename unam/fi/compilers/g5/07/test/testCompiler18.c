@@ -0,0 +1,28 @@
+// ===== VARIABLES GLOBALES: .data, .bss Y .rodata =====
+const int squares[] = { 0, 1, 4, 9, 16, 25, 36, 49 };
+const double scale = 1.5 * 2;
+static int counter;
+int table[2][3] = { { 1, 2, 3 }, { 4, 5 } };
+long big = 1 << 20;
+char letters[4] = { 'a', 'b' };
+
+int next_id() {
+    static int id = 100;
+    id++;
+    counter = counter + 1;
+    return id;
+}
+
+int main() {
+    int local[5] = { 7, 8 };
+    int i;
+    int sum = 0;
+
+    for (i = 0; i < 8; i++) {
+        sum += squares[i];
+    }
+    next_id();
+    next_id();
+    return sum + table[1][1] + next_id() - 101 + counter + scale + table[1][2] + local[1]
+           + local[4] + (big >> 20) + letters[0] - 139;
+}
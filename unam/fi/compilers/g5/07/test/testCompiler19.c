@@ -0,0 +1,26 @@
+// ===== ENLACE INTERNO, FASTCC E INLINE =====
+static inline int square(int x) {
+    return x * x;
+}
+
+static int unused_helper(int x) {
+    return x + 1;
+}
+
+int add(int a, int b) {
+    return a + b;
+}
+
+extern int exported(int n) {
+    return add(n, n);
+}
+
+int main() {
+    int i;
+    int sum = 0;
+    for (i = 0; i < 5; i++) {
+        sum = add(sum, square(i));
+    }
+    // 30 + 2 * 20 + 7
+    return sum + exported(20) + 7;
+}
@@ -0,0 +1,13 @@
+// ===== LTO: LLAMADAS ENTRE ARCHIVOS (se enlaza con testCompiler20_lib.c) =====
+int weight(int x);
+extern int scale;
+
+int main() {
+    int i;
+    int sum = 0;
+    for (i = 0; i < 4; i++) {
+        sum += weight(i);
+    }
+    // (0 + 1 + 2 + 3) * 3 + 4 + 3
+    return sum + scale;
+}
@@ -0,0 +1,10 @@
+// ===== LTO: FUNCIONES DEFINIDAS EN OTRO ARCHIVO (ver testCompiler20.c) =====
+int scale = 3;
+
+int weight(int x) {
+    return x * scale + 1;
+}
+
+static int unused(int x) {
+    return x;
+}
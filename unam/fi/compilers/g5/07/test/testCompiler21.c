@@ -0,0 +1,33 @@
+// ===== SWITCH, BREAK, CONTINUE Y PGO =====
+static int clasifica(int x) {
+    int r = 0;
+    switch (x % 5) {
+        case 0: r = 1; break;
+        case 1:
+        case 2: r = 2; break;
+        case 3: r = 3;   // Sin break: continúa en default
+        default: r += 4;
+    }
+    return r;
+}
+
+int main() {
+    int suma = 0;
+    int i;
+    for (i = 0; i < 100; i++) {
+        if (i % 10 == 7) continue;
+        if (i > 40) break;
+        suma += clasifica(i);
+    }
+    int j = 0;
+    while (1) {
+        j++;
+        if (j == 12) break;
+    }
+    do {
+        j--;
+        if (j == 9) continue;
+    } while (j > 6);
+    // clasifica(0..40) sin 7, 17, 27 ni 37 suma 121 y j termina en 6
+    return suma - j;
+}
@@ -0,0 +1,11 @@
+// ===== PRINTF CON FORMATO CONSTANTE =====
+int main() {
+    int n = 0;
+    short s = 70000;
+    n += printf("%d|%i|%u\n", -123, 45, -1);       // 19 bytes
+    n += printf("%x %X %c%%\n", 48879, 48879, 'z'); // "beef BEEF z%": 13 bytes
+    n += printf("%hd %hhu\n", s, 257);             // "4464 1": 7 bytes
+    n += printf("%4d|\n", 7);                      // Con ancho: printf general, 6 bytes
+    n += printf("plain\n");                        // 6 bytes
+    return n;
+}
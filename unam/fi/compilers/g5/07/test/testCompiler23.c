@@ -0,0 +1,54 @@
+// ===== FUNCIONES PURAS EVALUADAS AL COMPILAR =====
+int fib(int n) {
+    if (n < 2)
+        return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int power(int base, int exp) {
+    int r = 1;
+    while (exp > 0) {
+        if (exp & 1)
+            r *= base;
+        base *= base;
+        exp >>= 1;
+    }
+    return r;
+}
+
+const int ENTRY = 12;
+
+int table_size(int n) {
+    int size = 0, i;
+    for (i = 0; i < n; i++)
+        size += ENTRY + (i % 4 == 0 ? 8 : 0);
+    return size;
+}
+
+int collatz(int n) {
+    int steps = 0;
+    while (n != 1) {
+        n = n % 2 ? 3 * n + 1 : n / 2;
+        steps++;
+    }
+    return steps;
+}
+
+int counter = 0;
+
+int noisy(int x) { // Escribe un global: se queda como llamada
+    counter++;
+    return x * 2;
+}
+
+int main() {
+    int sizes[table_size(3)];
+    int total = fib(40) % 1000;           // 155
+    total += power(3, 4);                 // 81
+    sizes[table_size(3) - 1] = 4;         // sizes[43]
+    total += sizes[43];                   // 4
+    total += collatz(27) - 100;           // 111 - 100 = 11
+    total += noisy(1) + noisy(2) + counter; // 2 + 4 + 2 = 8
+    total += fib(-1) + 10 / power(0, 1 - 1); // -1 + 10
+    return total - 200;                   // 268 - 200 = 68
+}
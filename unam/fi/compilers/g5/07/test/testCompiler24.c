@@ -0,0 +1,78 @@
+// ===== GOTO Y ETIQUETAS COMO VALORES (DESPACHO CON HILOS) =====
+// Sin punteros en el lenguaje, &&etiqueta se guarda en un long (con GCC sería void *)
+// Bytecode: 0 = push, 1 = add, 2 = mul, 3 = dec-jump-if-not-zero, 4 = halt
+int code[32];
+
+int run(int n) {
+    static long dispatch[] = { &&op_push, &&op_add, &&op_mul, &&op_loop, &&op_halt };
+    int stack[16];
+    int sp = 0, pc = 0, counter = n;
+
+    goto *dispatch[code[pc]];
+op_push:
+    stack[sp] = code[pc + 1];
+    sp++;
+    pc += 2;
+    goto *dispatch[code[pc]];
+op_add:
+    sp--;
+    stack[sp - 1] = stack[sp - 1] + stack[sp];
+    pc++;
+    goto *dispatch[code[pc]];
+op_mul:
+    sp--;
+    stack[sp - 1] = stack[sp - 1] * stack[sp] % 1000;
+    pc++;
+    goto *dispatch[code[pc]];
+op_loop:
+    counter--;
+    if (counter != 0)
+        pc = code[pc + 1];
+    else
+        pc += 2;
+    goto *dispatch[code[pc]];
+op_halt:
+    return stack[sp - 1];
+}
+
+int gcd(int a, int b) {
+again:
+    if (b == 0)
+        goto done;
+    {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    goto again;
+done:
+    return a;
+}
+
+int main() {
+    long local[2];
+    int i = 0, found = 0;
+    local[0] = &&skip;
+    local[1] = &&out;
+
+    // push 1; loop: push 3; mul; push 1; add; djnz loop; halt
+    code[0] = 0; code[1] = 1;
+    code[2] = 0; code[3] = 3;
+    code[4] = 2;
+    code[5] = 0; code[6] = 1;
+    code[7] = 1;
+    code[8] = 3; code[9] = 2;
+    code[10] = 4;
+
+    while (1) {
+        i++;
+        if (i % 7 == 0) {
+            found = found + 1;
+            goto *local[found == 3];
+        }
+skip:
+        ;
+    }
+out:
+    return run(5) + gcd(84, 36) - i; // 364 + 12 - 21 = 355 -> 99
+}
@@ -0,0 +1,49 @@
+// ===== #pragma omp parallel for =====
+// Cada iteración es independiente; las reducciones combinan los resultados de los hilos
+int a[10000];
+int hist[8];
+
+int collatz_steps(int x) {
+    int steps = 0;
+    while (x != 1) {
+        if (x % 2 == 0) x = x / 2;
+        else x = 3 * x + 1;
+        steps++;
+    }
+    return steps;
+}
+
+int main(void) {
+    int i;
+    int n = 10000;
+    long sum = 0;
+    int longest = 0;
+    int bits = 0;
+
+    #pragma omp parallel for
+    for (i = 0; i < n; i++) {
+        a[i] = collatz_steps(i + 1);
+    }
+
+    // Iteraciones de costo desigual: mejor repartidas de a poco
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+: sum) reduction(max: longest)
+    for (i = n - 1; i >= 0; i--) {
+        sum += a[i];
+        if (a[i] > longest) longest = a[i];
+    }
+
+    // Cada hilo escribe entradas distintas; continue salta a la siguiente iteración
+    #pragma omp parallel for schedule(static, 3) reduction(|: bits)
+    for (i = 0; i < 8; i++) {
+        int j;
+        hist[i] = 0;
+        if (i == 5) continue;
+        for (j = i; j < n; j += 8) hist[i] += a[j] % 2;
+        bits |= 1 << i;
+    }
+
+    int odd = 0;
+    for (i = 0; i < 8; i++) odd += hist[i];
+    printf("sum=%ld longest=%d bits=%d odd=%d\n", sum, longest, bits, odd);
+    return (sum + longest + bits + odd) % 256;
+}
@@ -0,0 +1,54 @@
+// ===== PRAGMAS DE BUCLE: unroll, ivdep, clang loop =====
+// Sólo cambian cómo se optimiza cada bucle; el resultado debe ser el mismo con o sin ellos
+int a[1000];
+int b[1000];
+int perm[1000];
+
+int main(void) {
+    int i;
+    int n = 1000;
+    long sum = 0;
+
+    #pragma unroll 4
+    for (i = 0; i < n; i++) {
+        a[i] = i % 13;
+        b[i] = 2;
+        perm[i] = (i * 7) % n; // 7 y 1000 son coprimos: una permutación
+    }
+
+    // Cada índice aparece una vez, así que las iteraciones no dependen entre sí
+    #pragma GCC ivdep
+    for (i = 0; i < n; i++) {
+        a[perm[i]] = a[perm[i]] * b[i] + 1;
+    }
+
+    #pragma clang loop vectorize(enable) interleave_count(4)
+    for (i = 0; i < n; i++) {
+        sum += a[i];
+    }
+
+    // Varios saltos de vuelta al encabezado: todos llevan la metadata
+    #pragma nounroll
+    while (n > 0) {
+        n--;
+        if (a[n] % 2 == 0) continue;
+        sum -= 1;
+    }
+
+    #pragma clang loop unroll(full)
+    do {
+        n++;
+    } while (n < 8);
+
+    #pragma unroll
+    #pragma clang loop vectorize(assume_safety)
+    for (i = 0; i < 1000; i++) {
+        b[perm[i]] = b[perm[i]] + a[i];
+    }
+    for (i = 0; i < 1000; i++) {
+        sum += b[i] % 3;
+    }
+
+    printf("sum=%ld n=%d\n", sum, n);
+    return (sum + n) % 256;
+}
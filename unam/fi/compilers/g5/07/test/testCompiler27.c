@@ -0,0 +1,77 @@
+// ===== VECTORES DE GCC: vector_size, operadores elemento a elemento y shuffles =====
+typedef int v4i __attribute__((vector_size(16)));
+typedef int v8i __attribute__((vector_size(32)));
+typedef unsigned int v4u __attribute__((vector_size(16)));
+typedef float v4f __attribute__((vector_size(16)));
+typedef long i64;
+
+v4i bias = {1, 2, 3, 4};
+v8i rows[4];
+
+// Suma con tope, sin saltos: la máscara de la comparación elige cada elemento
+v8i clamp_add(v8i a, v8i b, v8i hi) {
+    v8i s = a + b;
+    v8i over = s > hi;
+    return (s & ~over) | (hi & over);
+}
+
+int sum4(v4i v) {
+    return v[0] + v[1] + v[2] + v[3];
+}
+
+int main(void) {
+    int i;
+    i64 total = 0;
+
+    // 1. Aritmética y escalares repetidos en cada elemento
+    v4i a = {10, 20, 30, 40};
+    v4i b = a * 2 - bias;            // 19 38 57 76
+    b /= 3;                          // 6 12 19 25
+    b = b % 7 + (b << 1) ^ 1;        // 19 28 42 55
+    total += sum4(b);                // 144
+
+    // 2. Comparaciones: -1 donde se cumple, 0 donde no
+    v4i m = a >= 25;
+    total += sum4(m);                // -2
+
+    // 3. Subíndices para leer y escribir
+    a[1] = 7;
+    a[3] += a[1];
+    total += a[1] + a[3];            // 54
+
+    // 4. Arreglos de vectores y vectores que no están en memoria
+    for (i = 0; i < 4; i++) {
+        v8i r = {i, i, i, i, i, i, i, i};
+        rows[i] = r + i;
+        rows[i][i] = 100;
+    }
+    v8i hi = {150, 150, 150, 150, 150, 150, 150, 150};
+    v8i c = clamp_add(rows[1], rows[3], hi);
+    total += c[0] + c[1] + c[3];     // 8 + 102 + 106 = 216
+    total += (rows[2] * 2)[2];       // 200
+
+    // 5. Shuffles: índices constantes (clang) y máscaras en un vector (gcc)
+    v4i s = __builtin_shufflevector(a, bias, 4, 3, 0, -1);
+    total += s[0] * s[1] + s[2];     // 1 * 47 + 10 = 57
+    v4i mask = {3, 2, 1, 4};         // 4 vuelve a 0: se toma módulo 4
+    v4i r = __builtin_shuffle(bias, mask);
+    total += r[0] * 1000 + r[1] * 100 + r[2] * 10 + r[3]; // 4321
+    v4i r2 = __builtin_shuffle(a, bias, mask + 4);
+    total += sum4(r2);               // 4 + 3 + 2 + 10 = 19
+
+    // 6. Punto flotante y desplazamientos sin signo
+    v4f f = {0.5, 1.5, 2.5, 3.5};
+    f = f * 4 + 1;
+    v4i fm = f < 8;
+    total += sum4(fm) + f[3];        // -2 + 15 = 13
+    v4u u = {1, 2, 3, 4};
+    u = (u - 2) >> 28;
+    total += u[0] + u[3];            // 15 + 0
+
+    v8i w = {1, 2, 3, 4, 5, 6, 7, 8};
+    w++;
+    w = -w;
+    total += w[7];                   // -9
+
+    return total % 256;              // 5028 % 256 = 164
+}
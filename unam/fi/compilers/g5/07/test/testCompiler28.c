@@ -0,0 +1,17 @@
+// ===== printf Y LA SALIDA DE LA LIBC: todo sale en el orden del programa =====
+int putchar(int c);
+
+int main(void) {
+    int i;
+    printf("A");
+    putchar(66);
+    printf("C%d", 1);                // Especializado: texto y entero
+    putchar(10);
+    for (i = 0; i < 3; i++) {
+        printf("%d", i);
+        putchar(45);
+    }
+    printf("%5d|", 7);               // Con ancho: pasa por vsnprintf
+    putchar(10);
+    return 28;
+}
@@ -0,0 +1,10 @@
+// ===== printf DESDE UN BUCLE PARALELO: cada línea sale entera =====
+int main(void) {
+    int i;
+    int n = 200000;
+#pragma omp parallel for
+    for (i = 0; i < n; i++) {
+        printf("linea %d de %d\n", i, n);
+    }
+    return 29;
+}
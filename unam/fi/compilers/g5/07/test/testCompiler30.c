@@ -0,0 +1,19 @@
+// ===== CONSTANTES ENTERAS DE 64 BITS: cada una con el tipo que le da C =====
+long counter = 12000000000;          // No cabe en int: es long
+
+int main() {
+    long l = 3000000000;
+    unsigned int u = 4294967295U;
+    unsigned long big = 18446744073709551615UL;
+    int r = 0;
+
+    if (l / 1000 == 3000000) r = r + 1;
+    if (counter - l == 9000000000) r = r + 2;
+    if (2147483647 + 1L > 0) r = r + 4;        // La suma se hace en long
+    if (u == 4294967295U && u + 1 == 0) r = r + 8;
+    if (big / 3 == 6148914691236517205UL) r = r + 16;
+    if (1u < -1) r = r + 32;                   // -1 pasa a unsigned
+    if (1 < -1L) r = r + 64;                   // Aquí no: long es signed
+    if (2147483648 - 1 == 2147483647) r = r + 128;
+    return r;                                  // 1 + 2 + 4 + 8 + 16 + 32 + 128 = 191
+}
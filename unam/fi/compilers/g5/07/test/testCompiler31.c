@@ -0,0 +1,13 @@
+// ===== POOL DE LITERALES: el mismo texto en varios lugares es una sola constante =====
+int main(void) {
+    int i;
+    for (i = 0; i < 2; i++) {
+        printf("%5d|\n", i);         // Con ancho: el formato entero va al pool
+        printf("valor: %d\n", i);    // Especializado: "valor: " y "\n"
+    }
+    printf("%5d|\n", 7);
+    printf("%6d|\n", 8);             // Distinto: su propia constante
+    printf("valor: %d\n", 9);
+    printf("valor: %d\n", 10);
+    return 37;
+}
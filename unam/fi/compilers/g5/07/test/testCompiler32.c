@@ -0,0 +1,28 @@
+// ===== PRAGMAS CONTINUADOS CON BARRA INVERTIDA =====
+// La línea siguiente a "\" es parte del mismo pragma, como en el preprocesador
+int a[4000];
+
+int main(void) {
+    int i;
+    int n = 4000;
+    long sum = 0;
+    int longest = 0;
+
+    #pragma clang loop vectorize(enable) \
+        interleave_count(4)
+    for (i = 0; i < n; i++) {
+        a[i] = (i * 37) % 101;
+    }
+
+    // Sin la segunda línea los hilos sumarían sin reducción
+    #pragma omp parallel for schedule(static, 8) \
+                             reduction(+: sum) \
+                             reduction(max: longest)
+    for (i = 0; i < n; i++) {
+        sum += a[i];
+        if (a[i] > longest) longest = a[i];
+    }
+
+    printf("sum=%ld longest=%d\n", sum, longest);
+    return (sum + longest) % 256;
+}
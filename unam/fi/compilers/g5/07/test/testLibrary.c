@@ -0,0 +1,67 @@
+// Prueba de libfreezepiler (make check-lib): compila fórmulas en memoria y compara con C
+#include <stdio.h>
+#include <stdlib.h>
+#include "freezepiler.h"
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    if (!ok) {
+        printf("FALLÓ: %s\n", what);
+        failures++;
+    }
+}
+
+int main(void) {
+    char *error = NULL;
+
+    // Una fórmula con variables de distintos tipos, llamada directamente
+    freezepiler_var vars[] = { { "price", FREEZEPILER_DOUBLE }, { "qty", FREEZEPILER_INT } };
+    freezepiler_expr *total = freezepiler_compile("qty > 10 ? price * qty * 0.9 : price * qty", vars, 2,
+                                                  FREEZEPILER_DOUBLE, 2, &error);
+    check(total != NULL, error ? error : "compile total");
+    if (total) {
+        double (*fn)(double, int) = (double (*)(double, int))freezepiler_function(total);
+        check(fn(2.5, 4) == 10.0, "total(2.5, 4)");
+        check(fn(1.0, 20) == 1.0 * 20 * 0.9, "total(1.0, 20)");
+    }
+
+    // Un filtro por lotes sobre columnas
+    freezepiler_var cols[] = { { "a", FREEZEPILER_LONG }, { "b", FREEZEPILER_INT } };
+    freezepiler_expr *filter = freezepiler_compile("(a % 3 == 0 && b > 5) || a < 0", cols, 2, FREEZEPILER_INT, 2, &error);
+    check(filter != NULL, error ? error : "compile filter");
+    if (filter) {
+        enum { N = 1000 };
+        long a[N];
+        int b[N], out[N];
+        for (int i = 0; i < N; i++) {
+            a[i] = i - 10;
+            b[i] = i % 11;
+        }
+        const void *columns[] = { a, b };
+        freezepiler_eval_batch(filter, N, columns, out);
+        int mismatches = 0;
+        for (int i = 0; i < N; i++) {
+            mismatches += out[i] != ((a[i] % 3 == 0 && b[i] > 5) || a[i] < 0);
+        }
+        check(mismatches == 0, "filter batch");
+    }
+
+    // Lo que no es una fórmula se rechaza con un mensaje
+    freezepiler_var x[] = { { "x", FREEZEPILER_INT } };
+    const char *rejected[] = { "x = 3", "x++", "printf(\"hi\")", "x); } int main(void) { return 1", "y + 1", "x +" };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        error = NULL;
+        freezepiler_expr *e = freezepiler_compile(rejected[i], x, 1, FREEZEPILER_INT, 0, &error);
+        check(e == NULL && error != NULL, rejected[i]);
+        free(error);
+        freezepiler_free(e);
+    }
+
+    freezepiler_free(total);
+    freezepiler_free(filter);
+    if (failures == 0) {
+        printf("libfreezepiler: OK\n");
+    }
+    return failures;
+}